@@ -0,0 +1,539 @@
+// ==========================================================================================================
+//! @file buffer_pool.h
+//!       Header file for the fastRNN BufferPool class, a process wide pool of aligned host buffers which are
+//!       keyed by shape, so that temporaries which are needed on every timestep reuse the same memory.
+// ==========================================================================================================
+
+/*
+ * ==========================================================================================================
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *  =========================================================================================================
+ */
+
+#ifndef _FRNN_CONTAINERS_BUFFER_POOL_
+#define _FRNN_CONTAINERS_BUFFER_POOL_
+
+#include "ring_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace frnn {
+
+// ==========================================================================================================
+//! @struct     BufferPoolStats
+//! @brief      Statistics for the usage of a BufferPool.
+// ==========================================================================================================
+struct BufferPoolStats {
+    size_t allocations;             //!< Number of buffers which had to be allocated from the system
+    size_t reuses;                  //!< Number of requests which were served from the pool
+    size_t buffers_in_use;          //!< Number of buffers which are currently handed out
+    size_t bytes_in_use;            //!< Number of bytes which are currently handed out
+    size_t high_water_buffers;      //!< Maximum number of buffers which were handed out at the same time
+    size_t high_water_bytes;        //!< Maximum number of bytes which were handed out at the same time
+};
+
+template <typename T> class PooledBuffer;
+
+// ==========================================================================================================
+//! @class      BufferPool
+//! @brief      A process wide pool of host buffers which are aligned to a cache line and keyed by shape (the
+//!             size of each dimension and the size of an element).                                          \n
+//!                                                                                                          \n
+//!             Each shape has a lock-free freelist (an MpmcRingBuffer) of buffers which have been released,
+//!             and each thread keeps a small cache of released buffers for the shapes it uses, so that the
+//!             common case of a thread requesting the same temporaries on every timestep does not touch any
+//!             shared state. The only lock is taken the first time a thread uses a shape. Buffers are handed
+//!             out as PooledBuffers, which return themselves to the pool when they are destroyed:           \n
+//!                                                                                                          \n
+//!             PooledBuffer<float> outputs = BufferPool::instance().acquire<float>({nodes, batch_size});    \n
+//! @note       Buffers are returned uninitialized, and are only given back to the system by trim() or when
+//!             the freelist for their shape is full.
+// ==========================================================================================================
+class BufferPool {
+public:
+    /* ======================================== Typedefs ================================================== */
+    typedef size_t                  size_type;
+    typedef std::vector<size_type>  shape_type;
+    /* ==================================================================================================== */
+private:
+    static constexpr size_type FREELIST_SIZE     = 64;       //!< Released buffers kept for each shape
+    static constexpr size_type THREAD_CACHE_SIZE = 4;       //!< Released buffers kept for each shape per thread
+
+    // ======================================================================================================
+    //! @struct     Bucket
+    //! @brief      The freelist of buffers for a single shape.
+    // ======================================================================================================
+    struct Bucket {
+        shape_type              shape;          //!< The shape of the buffers
+        size_type               element_bytes;  //!< The size of an element of the buffers
+        size_type               bytes;          //!< The number of bytes in each buffer
+        MpmcRingBuffer<void*>   freelist;       //!< Buffers which have been released
+
+        Bucket(const size_type* dims, size_type rank, size_type element_size, size_type bucket_bytes)
+        : shape(dims, dims + rank), element_bytes(element_size), bytes(bucket_bytes),
+          freelist(FREELIST_SIZE) {}
+
+        bool matches(const size_type* dims, size_type rank, size_type element_size) const
+        {
+            return element_bytes == element_size && shape.size() == rank &&
+                   std::equal(dims, dims + rank, shape.begin());
+        }
+    };
+
+    // ======================================================================================================
+    //! @struct     CacheEntry
+    //! @brief      A thread's cache of released buffers for a single shape.
+    // ======================================================================================================
+    struct CacheEntry {
+        size_type   hash;                           //!< Hash of the shape
+        Bucket*     bucket;                         //!< The bucket for the shape
+        void*       buffers[THREAD_CACHE_SIZE];     //!< Released buffers
+        size_type   count;                          //!< Number of released buffers
+    };
+
+    // ======================================================================================================
+    //! @struct     ThreadCache
+    //! @brief      The caches of a single thread, which give their buffers back to the shared freelists when
+    //!             the thread exits.
+    // ======================================================================================================
+    struct ThreadCache {
+        std::vector<CacheEntry> entries;
+
+        ~ThreadCache() { flush(); }
+
+        void flush()
+        {
+            for (auto& entry : entries) {
+                while (entry.count > 0) giveBack(entry.bucket, entry.buffers[--entry.count]);
+            }
+        }
+    };
+
+    // ======================================================================================================
+    //! @struct     BucketDeleter
+    //! @brief      Destroys a bucket made by newBucket and gives its memory back to the system.
+    // ======================================================================================================
+    struct BucketDeleter {
+        void operator()(Bucket* bucket) const
+        {
+            bucket->~Bucket();
+            free(bucket);
+        }
+    };
+
+    typedef std::vector<std::unique_ptr<Bucket, BucketDeleter>> bucket_list;
+
+    std::mutex                                          _mutex;                 //!< Protects _buckets
+    std::unordered_map<size_type, bucket_list>          _buckets;               //!< Buckets by shape hash
+    alignas(CACHE_LINE_SIZE) std::atomic<size_type>     _allocations;           //!< See BufferPoolStats
+    std::atomic<size_type>                              _reuses;                //!< See BufferPoolStats
+    alignas(CACHE_LINE_SIZE) std::atomic<size_type>     _buffers_in_use;        //!< See BufferPoolStats
+    std::atomic<size_type>                              _bytes_in_use;          //!< See BufferPoolStats
+    std::atomic<size_type>                              _high_water_buffers;    //!< See BufferPoolStats
+    std::atomic<size_type>                              _high_water_bytes;      //!< See BufferPoolStats
+public:
+    // ======================================================================================================
+    //! @brief      Gets the pool for the process.
+    //! @return     A reference to the pool for the process.
+    // ======================================================================================================
+    static BufferPool& instance()
+    {
+        static BufferPool pool;
+        return pool;
+    }
+
+    BufferPool(const BufferPool&)            = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // ======================================================================================================
+    //! @brief      Gives all the buffers in the freelists back to the system. The thread caches have already
+    //!             been flushed, since they are destroyed before the pool.
+    // ======================================================================================================
+    ~BufferPool() { drain(); }
+
+    // ======================================================================================================
+    //! @brief      Gets a buffer with the given shape, reusing a released buffer if there is one.
+    //! @param[in]  shape   The size of each dimension of the buffer.
+    //! @return     A PooledBuffer which gives the buffer back to the pool when it is destroyed.
+    //! @tparam     T       The type of the elements in the buffer.
+    // ======================================================================================================
+    template <typename T>
+    PooledBuffer<T> acquire(const shape_type& shape) { return acquire<T>(shape.data(), shape.size()); }
+
+    // ======================================================================================================
+    //! @brief      Gets a buffer with the given shape, reusing a released buffer if there is one.
+    //! @param[in]  shape   The size of each dimension of the buffer.
+    //! @return     A PooledBuffer which gives the buffer back to the pool when it is destroyed.
+    //! @tparam     T       The type of the elements in the buffer.
+    // ======================================================================================================
+    template <typename T>
+    PooledBuffer<T> acquire(std::initializer_list<size_type> shape)
+    {
+        return acquire<T>(shape.begin(), shape.size());
+    }
+
+    // ======================================================================================================
+    //! @brief      Gets a buffer with the given shape, reusing a released buffer if there is one.
+    //! @param[in]  dims    The size of each dimension of the buffer.
+    //! @param[in]  rank    The number of dimensions of the buffer.
+    //! @return     A PooledBuffer which gives the buffer back to the pool when it is destroyed.
+    //! @tparam     T       The type of the elements in the buffer.
+    // ======================================================================================================
+    template <typename T>
+    PooledBuffer<T> acquire(const size_type* dims, size_type rank);
+
+    // ======================================================================================================
+    //! @brief      Gets the statistics for the pool.
+    //! @return     The statistics for the pool.
+    // ======================================================================================================
+    BufferPoolStats stats() const
+    {
+        BufferPoolStats pool_stats;
+        pool_stats.allocations          = _allocations.load(std::memory_order_relaxed);
+        pool_stats.reuses               = _reuses.load(std::memory_order_relaxed);
+        pool_stats.buffers_in_use       = _buffers_in_use.load(std::memory_order_relaxed);
+        pool_stats.bytes_in_use         = _bytes_in_use.load(std::memory_order_relaxed);
+        pool_stats.high_water_buffers   = _high_water_buffers.load(std::memory_order_relaxed);
+        pool_stats.high_water_bytes     = _high_water_bytes.load(std::memory_order_relaxed);
+        return pool_stats;
+    }
+
+    // ======================================================================================================
+    //! @brief      Resets the high water marks to the current usage, so that the peak usage of a section of
+    //!             code (for example a single epoch) can be measured.
+    // ======================================================================================================
+    void resetHighWater()
+    {
+        _high_water_buffers.store(_buffers_in_use.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        _high_water_bytes.store(_bytes_in_use.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    // ======================================================================================================
+    //! @brief      Gives the buffers in the calling thread's cache and in all the freelists back to the
+    //!             system. Buffers which are in other threads' caches or still in use are not affected.
+    // ======================================================================================================
+    void trim()
+    {
+        threadCache().flush();
+        drain();
+    }
+private:
+    template <typename T> friend class PooledBuffer;
+
+    // ======================================================================================================
+    //! @brief      Constructor, private so that there is only a single pool.
+    // ======================================================================================================
+    BufferPool()
+    : _allocations(0), _reuses(0), _buffers_in_use(0), _bytes_in_use(0), _high_water_buffers(0),
+      _high_water_bytes(0) {}
+
+    // ======================================================================================================
+    //! @brief      Gives the buffers in all the freelists back to the system.
+    // ======================================================================================================
+    void drain()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto& buckets : _buckets) {
+            for (auto& bucket : buckets.second) {
+                void* buffer;
+                while (bucket->freelist.tryPop(buffer)) free(buffer);
+            }
+        }
+    }
+
+    // ======================================================================================================
+    //! @brief      Gets the cache for the calling thread.
+    //! @return     A reference to the calling thread's cache.
+    // ======================================================================================================
+    static ThreadCache& threadCache()
+    {
+        static thread_local ThreadCache cache;
+        return cache;
+    }
+
+    // ======================================================================================================
+    //! @brief      Hashes a shape.
+    //! @param[in]  dims            The size of each dimension.
+    //! @param[in]  rank            The number of dimensions.
+    //! @param[in]  element_bytes   The size of an element.
+    //! @return     The hash of the shape.
+    // ======================================================================================================
+    static size_type hash(const size_type* dims, size_type rank, size_type element_bytes)
+    {
+        size_type shape_hash = (14695981039346656037ull ^ element_bytes) * 1099511628211ull;   // FNV-1a
+        for (size_type d = 0; d < rank; ++d) shape_hash = (shape_hash ^ dims[d]) * 1099511628211ull;
+        return shape_hash;
+    }
+
+    // ======================================================================================================
+    //! @brief      Gets the calling thread's cache entry for a shape, creating it (and the bucket for the
+    //!             shape if no thread has used the shape before) if the thread has not used the shape.
+    //! @param[in]  dims            The size of each dimension.
+    //! @param[in]  rank            The number of dimensions.
+    //! @param[in]  element_bytes   The size of an element.
+    //! @param[in]  bytes           The number of bytes in a buffer with the shape.
+    //! @return     The cache entry for the shape.
+    // ======================================================================================================
+    CacheEntry& cacheEntry(const size_type* dims, size_type rank, size_type element_bytes, size_type bytes)
+    {
+        const size_type shape_hash = hash(dims, rank, element_bytes);
+        ThreadCache&    cache      = threadCache();
+        for (auto& entry : cache.entries) {
+            if (entry.hash == shape_hash && entry.bucket->matches(dims, rank, element_bytes)) return entry;
+        }
+
+        Bucket* bucket = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto& buckets = _buckets[shape_hash];
+            for (auto& candidate : buckets) {
+                if (candidate->matches(dims, rank, element_bytes)) bucket = candidate.get();
+            }
+            if (bucket == nullptr) {
+                buckets.emplace_back(newBucket(dims, rank, element_bytes, bytes));
+                bucket = buckets.back().get();
+            }
+        }
+        CacheEntry entry;
+        entry.hash   = shape_hash;
+        entry.bucket = bucket;
+        entry.count  = 0;
+        cache.entries.push_back(entry);
+        return cache.entries.back();
+    }
+
+    // ======================================================================================================
+    //! @brief      Makes a bucket for a shape. The freelist of a bucket has members which are aligned to a
+    //!             cache line, which new does not honour before C++17, so the bucket is constructed in
+    //!             aligned memory (and must be destroyed by a BucketDeleter).
+    //! @param[in]  dims            The size of each dimension.
+    //! @param[in]  rank            The number of dimensions.
+    //! @param[in]  element_bytes   The size of an element.
+    //! @param[in]  bytes           The number of bytes in a buffer with the shape.
+    //! @return     A pointer to the new bucket.
+    // ======================================================================================================
+    static Bucket* newBucket(const size_type* dims, size_type rank, size_type element_bytes, size_type bytes)
+    {
+        void* memory = nullptr;
+        if (posix_memalign(&memory, std::max(alignof(Bucket), sizeof(void*)), sizeof(Bucket)) != 0)
+            throw std::bad_alloc();
+        try {
+            return new (memory) Bucket(dims, rank, element_bytes, bytes);
+        } catch (...) {
+            free(memory);
+            throw;
+        }
+    }
+
+    // ======================================================================================================
+    //! @brief      Gets a buffer for a shape, first from the thread's cache, then from the shared freelist,
+    //!             and then from the system.
+    //! @param[in]  dims            The size of each dimension.
+    //! @param[in]  rank            The number of dimensions.
+    //! @param[in]  element_bytes   The size of an element.
+    //! @param[in]  bytes           The number of bytes in a buffer with the shape.
+    //! @return     The buffer and the bucket it belongs to.
+    // ======================================================================================================
+    std::pair<void*, Bucket*> take(const size_type* dims, size_type rank, size_type element_bytes,
+                                   size_type bytes)
+    {
+        CacheEntry& entry  = cacheEntry(dims, rank, element_bytes, bytes);
+        void*       buffer = nullptr;
+
+        if (entry.count > 0) {
+            buffer = entry.buffers[--entry.count];
+            _reuses.fetch_add(1, std::memory_order_relaxed);
+        } else if (entry.bucket->freelist.tryPop(buffer)) {
+            _reuses.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            if (posix_memalign(&buffer, CACHE_LINE_SIZE, std::max(bytes, size_type(1))) != 0)
+                throw std::bad_alloc();
+            _allocations.fetch_add(1, std::memory_order_relaxed);
+        }
+        updateHighWater(_high_water_buffers, _buffers_in_use.fetch_add(1, std::memory_order_relaxed) + 1);
+        updateHighWater(_high_water_bytes, _bytes_in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+        return std::make_pair(buffer, entry.bucket);
+    }
+
+    // ======================================================================================================
+    //! @brief      Gives a buffer which is no longer used back to the pool, into the thread's cache if there
+    //!             is space, otherwise into the shared freelist, otherwise back to the system.
+    //! @param[in]  bucket  The bucket which the buffer belongs to.
+    //! @param[in]  buffer  The buffer to give back.
+    // ======================================================================================================
+    void release(Bucket* bucket, void* buffer)
+    {
+        _buffers_in_use.fetch_sub(1, std::memory_order_relaxed);
+        _bytes_in_use.fetch_sub(bucket->bytes, std::memory_order_relaxed);
+
+        for (auto& entry : threadCache().entries) {
+            if (entry.bucket == bucket) {
+                if (entry.count < THREAD_CACHE_SIZE) {
+                    entry.buffers[entry.count++] = buffer;
+                    return;
+                }
+                break;
+            }
+        }
+        giveBack(bucket, buffer);
+    }
+
+    // ======================================================================================================
+    //! @brief      Gives a buffer back to the shared freelist for its shape, or to the system if the freelist
+    //!             is full.
+    //! @param[in]  bucket  The bucket which the buffer belongs to.
+    //! @param[in]  buffer  The buffer to give back.
+    // ======================================================================================================
+    static void giveBack(Bucket* bucket, void* buffer)
+    {
+        if (!bucket->freelist.tryPush(buffer)) free(buffer);
+    }
+
+    // ======================================================================================================
+    //! @brief      Raises a high water mark to a value if the value is higher.
+    //! @param[in]  high_water  The high water mark to raise.
+    //! @param[in]  value       The current value.
+    // ======================================================================================================
+    static void updateHighWater(std::atomic<size_type>& high_water, size_type value)
+    {
+        size_type current = high_water.load(std::memory_order_relaxed);
+        while (current < value &&
+               !high_water.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+};
+
+// ==========================================================================================================
+//! @class      PooledBuffer
+//! @brief      A buffer from the BufferPool which gives itself back to the pool when it is destroyed. It is
+//!             move only, so it can be passed between threads through a ring buffer.
+//! @tparam     T   The type of the elements in the buffer.
+// ==========================================================================================================
+template <typename T>
+class PooledBuffer {
+public:
+    /* ======================================== Typedefs ================================================== */
+    typedef size_t      size_type;
+    typedef T           value_type;
+    typedef T*          iterator;
+    typedef const T*    const_iterator;
+    /* ==================================================================================================== */
+private:
+    T*                      _data;          //!< The elements of the buffer
+    size_type               _size;          //!< The number of elements in the buffer
+    BufferPool::Bucket*     _bucket;        //!< The bucket the buffer belongs to
+public:
+    // ======================================================================================================
+    //! @brief      Creates an empty buffer.
+    // ======================================================================================================
+    PooledBuffer() : _data(nullptr), _size(0), _bucket(nullptr) {}
+
+    // ======================================================================================================
+    //! @brief      Creates a buffer from memory which was taken from the pool.
+    //! @param[in]  data    The memory for the buffer.
+    //! @param[in]  size    The number of elements in the buffer.
+    //! @param[in]  bucket  The bucket the memory belongs to.
+    // ======================================================================================================
+    PooledBuffer(T* data, size_type size, BufferPool::Bucket* bucket)
+    : _data(data), _size(size), _bucket(bucket) {}
+
+    PooledBuffer(const PooledBuffer&)            = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    // ======================================================================================================
+    //! @brief      Move constructor, takes the memory from another buffer.
+    //! @param[in]  other   The buffer to take the memory from.
+    // ======================================================================================================
+    PooledBuffer(PooledBuffer&& other) : _data(other._data), _size(other._size), _bucket(other._bucket)
+    {
+        other._data = nullptr; other._size = 0; other._bucket = nullptr;
+    }
+
+    // ======================================================================================================
+    //! @brief      Move assignment, gives this buffer's memory back to the pool and takes the memory from
+    //!             another buffer.
+    //! @param[in]  other   The buffer to take the memory from.
+    //! @return     A reference to this buffer.
+    // ======================================================================================================
+    PooledBuffer& operator=(PooledBuffer&& other)
+    {
+        if (this != &other) {
+            reset();
+            std::swap(_data, other._data); std::swap(_size, other._size); std::swap(_bucket, other._bucket);
+        }
+        return *this;
+    }
+
+    // ======================================================================================================
+    //! @brief      Destructor, gives the memory back to the pool.
+    // ======================================================================================================
+    ~PooledBuffer() { reset(); }
+
+    // ======================================================================================================
+    //! @brief      Gives the memory back to the pool, leaving the buffer empty.
+    // ======================================================================================================
+    void reset()
+    {
+        if (_data != nullptr) BufferPool::instance().release(_bucket, _data);
+        _data = nullptr; _size = 0; _bucket = nullptr;
+    }
+
+    // ======================================================================================================
+    //! @brief      Gets a pointer to the elements of the buffer, which is aligned to a cache line.
+    //! @return     A pointer to the elements of the buffer.
+    // ======================================================================================================
+    T* data() const { return _data; }
+
+    // ======================================================================================================
+    //! @brief      Gets the number of elements in the buffer.
+    //! @return     The number of elements in the buffer.
+    // ======================================================================================================
+    size_type size() const { return _size; }
+
+    // ======================================================================================================
+    //! @brief      Gets an element of the buffer.
+    //! @param[in]  i   The index of the element.
+    //! @return     A reference to the element.
+    // ======================================================================================================
+    T& operator[](size_type i) const { return _data[i]; }
+
+    iterator begin() const { return _data; }
+    iterator end()   const { return _data + _size; }
+};
+
+template <typename T>
+PooledBuffer<T> BufferPool::acquire(const size_type* dims, size_type rank)
+{
+    size_type elements = 1;
+    for (size_type d = 0; d < rank; ++d) elements *= dims[d];
+
+    std::pair<void*, Bucket*> buffer = take(dims, rank, sizeof(T), elements * sizeof(T));
+    return PooledBuffer<T>(static_cast<T*>(buffer.first), elements, buffer.second);
+}
+
+}       // End namespace frnn
+
+#endif
@@ -23,9 +23,14 @@
 
 #include "tuple.h"
 #include "index_map.h"
+#include "ring_buffer.h"
+#include "buffer_pool.h"
 
 #include <string>
 #include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
 
 TEST( frnnTuple, CanCreateTupleWithMultipleTypes )
 {
@@ -151,3 +156,132 @@ TEST( frnnIndexMap, CanEraseASingleElementWithAnIterator )
     
     EXPECT_EQ( size_after, 0 ); 
 }
+
+TEST( frnnIndexMap, IteratesInInsertionOrderAfterErase )
+{
+    using namespace frnn::index;
+    frnn::IndexMap<frnn::Index> imap(l, i, k, j);
+    
+    imap.erase(i);
+    
+    std::vector<size_t> keys, values;
+    for (auto& elem : imap) {
+        keys.push_back(elem.first());
+        values.push_back(elem.second);
+    }
+    
+    EXPECT_EQ( keys[0]  , 3 );
+    EXPECT_EQ( keys[1]  , 2 );
+    EXPECT_EQ( keys[2]  , 1 );
+    EXPECT_EQ( values[1], 2 );                  // Values are still the argument positions
+}
+
+TEST( frnnTuple, CanUseTupleInConstantExpressions )
+{
+    constexpr frnn::Tuple<int, size_t, char> tuple(4, 7, 'c');
+    
+    static_assert(frnn::get<1>(tuple) == 7, "Tuple element must be usable at compile time");
+    static_assert(frnn::tuple::size(tuple) == 3, "Tuple size must be usable at compile time");
+    
+    EXPECT_EQ( frnn::get<2>(tuple), 'c' );
+}
+
+TEST( frnnRingBuffer, CanMoveElementsBetweenSingleProducerAndConsumer )
+{
+    frnn::SpscRingBuffer<std::unique_ptr<int>> buffer(3);
+    const int num_elements = 1000;
+    
+    std::thread producer([&buffer]() {
+        for (int e = 0; e < num_elements; ++e) buffer.push(std::unique_ptr<int>(new int(e)));
+        buffer.close();
+    });
+    
+    std::vector<int>     popped;
+    std::unique_ptr<int> element;
+    while (buffer.pop(element)) popped.push_back(*element);
+    producer.join();
+    
+    EXPECT_EQ( buffer.capacity(), 4 );                  // Rounded up to a power of 2
+    EXPECT_EQ( popped.size(), num_elements );
+    EXPECT_TRUE( std::is_sorted(popped.begin(), popped.end()) );
+}
+
+TEST( frnnRingBuffer, CanShareBufferBetweenMultipleProducersAndConsumers )
+{
+    frnn::MpmcRingBuffer<long> buffer(16);
+    const long num_elements = 10000;
+    
+    long empty_element;
+    EXPECT_FALSE( buffer.tryPop(empty_element) );       // Nothing has been pushed yet
+    
+    std::vector<std::thread> producers, consumers;
+    std::vector<long>        sums(2, 0);
+    for (long p = 0; p < 2; ++p) {
+        producers.emplace_back([&buffer, p]() {
+            for (long e = p; e < num_elements; e += 2) buffer.push(std::move(e));
+        });
+    }
+    for (long c = 0; c < 2; ++c) {
+        consumers.emplace_back([&buffer, &sums, c]() {
+            long element;
+            while (buffer.pop(element)) sums[c] += element;
+        });
+    }
+    for (auto& producer : producers) producer.join();
+    buffer.close();
+    for (auto& consumer : consumers) consumer.join();
+    
+    EXPECT_EQ( sums[0] + sums[1], num_elements * (num_elements - 1) / 2 );
+    EXPECT_EQ( buffer.size(), 0 );
+}
+
+TEST( frnnBufferPool, ReusesBuffersWithTheSameShape )
+{
+    frnn::BufferPool& pool  = frnn::BufferPool::instance();
+    frnn::BufferPoolStats before = pool.stats();
+    
+    float* first_data = nullptr;
+    {
+        frnn::PooledBuffer<float> buffer = pool.acquire<float>({8, 3});
+        first_data = buffer.data();
+        EXPECT_EQ( buffer.size(), 24 );
+        EXPECT_EQ( reinterpret_cast<uintptr_t>(buffer.data()) % frnn::CACHE_LINE_SIZE, 0 );
+    }
+    frnn::PooledBuffer<float>  same_shape  = pool.acquire<float>({8, 3});
+    frnn::PooledBuffer<float>  other_shape = pool.acquire<float>({3, 8});
+    frnn::PooledBuffer<double> other_type  = pool.acquire<double>({8, 3});
+    
+    frnn::BufferPoolStats after = pool.stats();
+    
+    EXPECT_EQ( same_shape.data(), first_data );                 // Reused from the thread's cache
+    EXPECT_NE( other_shape.data(), first_data );
+    EXPECT_EQ( after.reuses - before.reuses, 1 );
+    EXPECT_EQ( after.allocations - before.allocations, 3 );
+    EXPECT_EQ( after.buffers_in_use - before.buffers_in_use, 3 );
+    EXPECT_GE( after.high_water_bytes, 24 * sizeof(float) * 2 + 24 * sizeof(double) );
+}
+
+TEST( frnnBufferPool, CanShareBuffersBetweenThreads )
+{
+    frnn::BufferPool& pool = frnn::BufferPool::instance();
+    frnn::SpscRingBuffer<frnn::PooledBuffer<int>> batches(4);
+    const int num_batches = 100;
+    
+    std::thread loader([&pool, &batches]() {
+        for (int b = 0; b < num_batches; ++b) {
+            frnn::PooledBuffer<int> batch = pool.acquire<int>({16, 4});
+            std::fill(batch.begin(), batch.end(), b);
+            batches.push(std::move(batch));
+        }
+        batches.close();
+    });
+    
+    int                     total = 0;
+    frnn::PooledBuffer<int> batch;
+    while (batches.pop(batch)) total += batch[63];
+    batch.reset();
+    loader.join();
+    
+    EXPECT_EQ( total, num_batches * (num_batches - 1) / 2 );
+    EXPECT_LE( pool.stats().buffers_in_use, 3 );                // Only the previous test's buffers
+}
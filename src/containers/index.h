@@ -50,6 +50,11 @@ class Index {
 private:   
     size_t _idx;                                                                //!< Value of the dimension
 public:
+     // =====================================================================================================
+     //! @brief         Default constructor, sets the value of the Index to 0 (the first dimension).
+     // =====================================================================================================
+    constexpr Index() : _idx(0) {}
+    
      // =====================================================================================================
      //! @brief         Sets the value of the Index.
      //! @param[in] i   The value to set the Index to.
@@ -90,19 +95,19 @@ public:
 
 namespace index {
     
-Index i(0);                                                 //!< Represents the first dimension of an Index
-Index j(1);                                                 //!< Represents the second dimension of an Index
-Index k(2);                                                 //!< Represents the third dimension of an Index 
-Index l(3);                                                 //!< Represents the fourth dimension of an Index 
-Index m(4);                                                 //!< Represents the fifth dimension of an Index 
-Index n(5);                                                 //!< Represents the sixth dimension of an Index
-Index o(6);                                                 //!< Represents the seventh dimension of an Index 
-Index p(7);                                                 //!< Represents the eighth dimension of an Index
-Index q(8);                                                 //!< Represents the ninth dimension of an Index 
-Index r(9);                                                 //!< Represents the tenth dimension of an Index 
-Index s(10);                                                //!< Represents the eleventh dimension of an Index 
-Index t(11);                                                //!< Represents the twelvth dimension of an Index 
-Index u(12);                                                //!< Represents the thirteenth dimension of an Index 
+constexpr Index i(0);                                       //!< Represents the first dimension of an Index
+constexpr Index j(1);                                       //!< Represents the second dimension of an Index
+constexpr Index k(2);                                       //!< Represents the third dimension of an Index 
+constexpr Index l(3);                                       //!< Represents the fourth dimension of an Index 
+constexpr Index m(4);                                       //!< Represents the fifth dimension of an Index 
+constexpr Index n(5);                                       //!< Represents the sixth dimension of an Index
+constexpr Index o(6);                                       //!< Represents the seventh dimension of an Index 
+constexpr Index p(7);                                       //!< Represents the eighth dimension of an Index
+constexpr Index q(8);                                       //!< Represents the ninth dimension of an Index 
+constexpr Index r(9);                                       //!< Represents the tenth dimension of an Index 
+constexpr Index s(10);                                      //!< Represents the eleventh dimension of an Index 
+constexpr Index t(11);                                      //!< Represents the twelvth dimension of an Index 
+constexpr Index u(12);                                      //!< Represents the thirteenth dimension of an Index 
 
 }       // End namespace dim
 
@@ -1,6 +1,6 @@
 // ==========================================================================================================
 //! @file index_map.h
-//!       Header file for the fastRNN IndexMap class to create a hastable where the keys as Indexes and
+//!       Header file for the fastRNN IndexMap class to create a small map where the keys are Indexes and
 //!       each key has a value which is equal to number the element was inserted into the map.
 // ==========================================================================================================
 
@@ -29,9 +29,10 @@
 
 #include "index.h"
 
-#include <unordered_map>
 #include <algorithm>
+#include <iostream>
 #include <typeinfo>
+#include <utility>
 
 namespace frnn {
 
@@ -39,28 +40,36 @@ namespace frnn {
 //! @struct     IndexMap
 //! @brief      Creates an IndexMap  where each of the arguments are the keys (an Index) and the values are 
 //!             position the key was inserted into the map i.e it is its index in the map as if the map
-//!             was a vector, thus the map can be searched for an Index quickly (since it is the key) but the
-//!             index of the Index in the map can also be found (which is usefull when passing a variable 
-//!             number of Index elements as arguments to a function).
-//!             in constant time while still being able to determine their order.
-//! @tparam     K       The type of the keys for the map (the Index class or a similar functor class).
+//!             was a vector, thus the map can be searched for an Index but the index of the Index in the 
+//!             map can also be found (which is usefull when passing a variable number of Index elements as 
+//!             arguments to a function).                                                                    \n
+//!                                                                                                          \n
+//!             Since the map only ever holds a handful of dimension indices, the elements are stored inline 
+//!             in a fixed size array in the order they were inserted, so creating the map does not allocate
+//!             and searching it is a short linear scan over contiguous memory, which is faster than hashing
+//!             for so few elements. Iteration is in insertion order, and erasing an element keeps the order
+//!             of the remaining elements.
+//! @tparam     K       The type of the keys for the map (the Index class or a similar functor class), which 
+//!                     must be default constructible.
+//! @tparam     N       The maximum number of elements in the map.
 // ==========================================================================================================
-template <typename K>    
+template <typename K, size_t N = 16>    
 struct IndexMap {
 public:
     /* ======================================== Typedefs ================================================== */
-    typedef std::unordered_map<K, size_t, IndexHasher>      map;
-    typedef typename map::size_type                         size_type;
-    typedef typename map::iterator                          iterator;
-    typedef typename map::const_iterator                    const_iterator;
+    typedef size_t                                          size_type;
+    typedef std::pair<K, size_type>                         value_type;
+    typedef value_type*                                     iterator;
+    typedef const value_type*                               const_iterator;
     /* ==================================================================================================== */ 
 private:
-    std::unordered_map<K, size_type, IndexHasher>           _elements;          //!< Key-value pair elements   
+    value_type                                              _elements[N];       //!< Key-value pair elements   
+    size_type                                               _size;              //!< Number of elements
 public:
     // ======================================================================================================
     //! @brief      Default constructor.
     // ======================================================================================================
-    IndexMap() {}
+    IndexMap() : _size(0) {}
     
     // ======================================================================================================
     //! @brief      Adds all arguments as keys in the map, which the value being the element's argument index.
@@ -69,13 +78,13 @@ public:
     //! @tparam     Ks          The types of the other elements (keys) to add to the map.
     // ======================================================================================================
     template <typename... Ks>
-    IndexMap(K element, Ks... elements) 
+    IndexMap(K element, Ks... elements) : _size(0)
     {
         createMap<0>(element, elements...);
     }    
         
     // ======================================================================================================
-    //! @brief      Creates an unordered_map - terminating case.
+    //! @brief      Creates the map - terminating case.
     //! @param[in]  element     The element to add to the map.
     //! @tparam     iter        The iteration of the createMap function.
     //! @tparam     E           The type of the element to add to the mao.
@@ -83,11 +92,11 @@ public:
     template <size_type iter, typename E>
     void createMap(E element)
     {
-        _elements.insert(std::make_pair<K, size_type>(static_cast<K>(element), iter));
+        add(static_cast<K>(element), iter);
     }
     
     // ======================================================================================================
-    //! @brief      Creates an unordered_map - case for all but the terminating case.
+    //! @brief      Creates the map - case for all but the terminating case.
     //! @param[in]  element     The element to add to the map.
     //! @param[in]  elements    The other elements still to be added to the map.
     //! @tparam     iter        The iteration number of the createMapfunction.
@@ -97,7 +106,7 @@ public:
     template <size_type iter = 0, typename E, typename... Es>
     void createMap(E element, Es... elements)
     {
-        _elements.insert(std::make_pair<K, size_type>(static_cast<K>(element), iter));
+        add(static_cast<K>(element), iter);
         createMap<iter + 1>(elements...);
     }
 
@@ -107,16 +116,16 @@ public:
     // ======================================================================================================
     void insert(K&& key) 
     {
-        _elements.insert(std::make_pair<K, size_type>(static_cast<K>(key), _elements.size()));
+        add(static_cast<K>(key), _size);
     }
    
     // ======================================================================================================
-    //! @brief      Moves an element from one map to this map.
-    //! @param      it      The iterator to move to this map.
+    //! @brief      Copies an element from one map to this map.
+    //! @param      it      The iterator to the element to copy to this map.
     // ======================================================================================================
-    void insert(iterator it) 
+    void insert(const_iterator it) 
     {
-        _elements.insert(std::move(*it));
+        add(it->first, it->second);
     }
    
     // ======================================================================================================
@@ -125,7 +134,7 @@ public:
     // ======================================================================================================
     void insert(K& key) 
     {
-        _elements.insert(std::make_pair<K, size_type>(std::move(key()), _elements.size()));
+        add(K(key()), _size);
     }
 
     // ======================================================================================================
@@ -136,48 +145,54 @@ public:
     // ======================================================================================================
     size_type erase(const K& key) 
     {
-        return _elements.erase(key);
+        iterator pos = find(key);
+        if (pos == end()) return 0;
+        erase(pos);
+        return 1;
     }
    
     // ======================================================================================================
-    //! @brief      Erases an element pointer to by an iterator.
+    //! @brief      Erases an element pointer to by an iterator, the elements after it are moved forward so 
+    //!             that the insertion order is kept.
     //! @param[in]  pos     The position of the element to remove.
     //! @return     A new iterator pointing to the element after the removed one.
     // ======================================================================================================
     iterator erase(iterator pos) 
     {
-        return _elements.erase(pos);
+        std::copy(pos + 1, end(), pos);
+        --_size;
+        return pos;
     }
     
     // ======================================================================================================
     //! @brief  Gets the size of the map.
     //! @return The size of the map.
     // ======================================================================================================
-    size_type size() const { return _elements.size(); }
+    size_type size() const { return _size; }
     
     // ======================================================================================================
     //! @brief  Gets an iterator to the start of the map.
     //! @return A constant iterator which points to the beginning of the map.
     // ======================================================================================================
-    const_iterator begin() const { return _elements.begin(); }
+    const_iterator begin() const { return _elements; }
     
     // ======================================================================================================
     //! @brief  Gets an iterator to the start of the map.
     //! @return An iterator which points to the beginning of the map.
     // ======================================================================================================
-    iterator begin() { return _elements.begin(); }
+    iterator begin() { return _elements; }
    
     // ======================================================================================================
     //! @brief  Gets an iterator to the end of the map.
     //! @return A constant iterator which points to the end of the map.
     // ======================================================================================================
-    const_iterator end() const  { return _elements.end(); }
+    const_iterator end() const  { return _elements + _size; }
 
     // ======================================================================================================
     //! @brief  Gets an iterator to the end of the map.
     //! @return An iterator which points to the end of the map.
     // ======================================================================================================
-    iterator end() { return _elements.end(); }    
+    iterator end() { return _elements + _size; }    
    
     // ======================================================================================================
     //! @brief  Searches for an element in the map, and if found, returns an iterator to the element,
@@ -186,7 +201,12 @@ public:
     //! @return An iterator which points to the element with a key key if key is a valid key for the map,
     //!         otherwise an iterator to the end of the map.
     // ======================================================================================================
-    iterator find(const K& key) { return _elements.find(key()); }
+    iterator find(const K& key) 
+    { 
+        iterator it = begin();
+        while (it != end() && it->first() != key()) ++it;
+        return it;
+    }
 
     // ======================================================================================================
     //! @brief  Searches for an element in the map, and if found, returns an iterator to the element,
@@ -195,7 +215,29 @@ public:
     //! @return A constant iterator which points to the element with a key key if key is a valid key for the 
     //!         map, otherwise an iterator to the end of the map.
     // ======================================================================================================
-    const_iterator find(const K& key) const { return _elements.find(key()); }
+    const_iterator find(const K& key) const 
+    { 
+        const_iterator it = begin();
+        while (it != end() && it->first() != key()) ++it;
+        return it;
+    }
+    
+private:
+    // ======================================================================================================
+    //! @brief      Adds an element to the end of the map, if the key is not already in the map and the map 
+    //!             is not full.
+    //! @param[in]  key     The key of the element to add.
+    //! @param[in]  value   The value of the element to add.
+    // ======================================================================================================
+    void add(const K& key, size_type value)
+    {
+        if (find(key) != end()) return;                             // Keys are unique
+        if (_size == N) {
+            std::cerr << "Error : IndexMap is full : Can not add more than " << N << " elements\n";
+            return;
+        }
+        _elements[_size++] = value_type(key, value);
+    }
 };
 
 }       // End namespace frnn
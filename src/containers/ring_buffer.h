@@ -0,0 +1,475 @@
+// ==========================================================================================================
+//! @file ring_buffer.h
+//!       Header file for the fastRNN lock-free ring buffers, which are bounded queues used to pass data (for
+//!       example Tensors or pooled buffers holding batches of sequences) between threads without locks.
+// ==========================================================================================================
+
+/*
+ * ==========================================================================================================
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *  =========================================================================================================
+ */
+
+#ifndef _FRNN_CONTAINERS_RING_BUFFER_
+#define _FRNN_CONTAINERS_RING_BUFFER_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace frnn {
+
+static constexpr size_t CACHE_LINE_SIZE = 64;       //!< Size of a cache line, used to pad shared variables
+
+namespace detail {
+
+// ==========================================================================================================
+//! @brief      Rounds a number up to the next power of 2 (at least 2), so that the position of an element in
+//!             a ring buffer can be found with a mask rather than a division.
+//! @param[in]  n   The number to round up.
+//! @return     The smallest power of 2 which is greater than or equal to n.
+// ==========================================================================================================
+inline size_t nextPowerOf2(size_t n)
+{
+    size_t power = 2;
+    while (power < n) power <<= 1;
+    return power;
+}
+
+// ==========================================================================================================
+//! @struct     Backoff
+//! @brief      Waits for another thread with an increasing delay: first by spinning, then by yielding the
+//!             thread, and then by sleeping, so that a blocked thread does not use a core which the thread
+//!             it is waiting for could be using.
+// ==========================================================================================================
+struct Backoff {
+public:
+    size_t _iteration;      //!< The number of times the thread has waited
+public:
+    // ======================================================================================================
+    //! @brief      Constructor, starts with spinning.
+    // ======================================================================================================
+    Backoff() : _iteration(0) {}
+
+    // ======================================================================================================
+    //! @brief      Waits for a short while, longer on each call.
+    // ======================================================================================================
+    void wait()
+    {
+        if (_iteration < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else if (_iteration < 128) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        ++_iteration;
+    }
+};
+
+}   // End namespace detail
+
+// ==========================================================================================================
+//! @class      SpscRingBuffer
+//! @brief      A bounded lock-free queue for a single producer thread and a single consumer thread.         \n
+//!                                                                                                          \n
+//!             The head (written by the consumer) and the tail (written by the producer) are on separate
+//!             cache lines, and each thread keeps a cached copy of the other thread's position so that it
+//!             only reads the shared position when the buffer looks full (or empty). Elements are moved into
+//!             and out of the buffer, so move only types (like Tensors or pooled buffers) can be passed
+//!             between the threads without copying their data.                                             \n
+//!                                                                                                          \n
+//!             The try functions return immediately, while push and pop block until they succeed or until
+//!             the buffer is closed, which is used to signal the consumer that there is no more data.
+//! @tparam     T       The type of the elements in the buffer, which must be move constructible.
+// ==========================================================================================================
+template <typename T>
+class SpscRingBuffer {
+public:
+    /* ======================================== Typedefs ================================================== */
+    typedef T           value_type;
+    typedef size_t      size_type;
+    /* ==================================================================================================== */
+private:
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_type;
+
+    const size_type                                 _capacity;          //!< Number of slots (a power of 2)
+    const size_type                                 _mask;              //!< Mask to get a slot from a position
+    storage_type*                                   _slots;             //!< Storage for the elements
+    alignas(CACHE_LINE_SIZE) std::atomic<size_type> _head;              //!< Position to pop from (consumer)
+    size_type                                       _cached_tail;       //!< Consumer's copy of the tail
+    alignas(CACHE_LINE_SIZE) std::atomic<size_type> _tail;              //!< Position to push to (producer)
+    size_type                                       _cached_head;       //!< Producer's copy of the head
+    alignas(CACHE_LINE_SIZE) std::atomic<bool>      _closed;            //!< If no more elements will be pushed
+    char                                            _padding[CACHE_LINE_SIZE - sizeof(std::atomic<bool>)];
+public:
+    // ======================================================================================================
+    //! @brief      Creates the buffer with space for at least capacity elements.
+    //! @param[in]  capacity    The minimum number of elements the buffer must hold, which is rounded up to
+    //!                         a power of 2.
+    // ======================================================================================================
+    explicit SpscRingBuffer(size_type capacity)
+    : _capacity(detail::nextPowerOf2(capacity)), _mask(_capacity - 1), _slots(new storage_type[_capacity]),
+      _head(0), _cached_tail(0), _tail(0), _cached_head(0), _closed(false) {}
+
+    SpscRingBuffer(const SpscRingBuffer&)            = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    // ======================================================================================================
+    //! @brief      Destroys any elements which are still in the buffer.
+    // ======================================================================================================
+    ~SpscRingBuffer()
+    {
+        const size_type tail = _tail.load(std::memory_order_relaxed);
+        for (size_type pos = _head.load(std::memory_order_relaxed); pos != tail; ++pos)
+            slot(pos)->~T();
+        delete[] _slots;
+    }
+
+    // ======================================================================================================
+    //! @brief      Tries to move an element into the buffer, without waiting (producer only).
+    //! @param[in]  element     The element to move into the buffer.
+    //! @return     If the element was added, which is false if the buffer is full.
+    // ======================================================================================================
+    bool tryPush(T&& element) { return emplace(std::move(element)); }
+
+    // ======================================================================================================
+    //! @brief      Tries to copy an element into the buffer, without waiting (producer only).
+    //! @param[in]  element     The element to copy into the buffer.
+    //! @return     If the element was added, which is false if the buffer is full.
+    // ======================================================================================================
+    bool tryPush(const T& element) { return emplace(element); }
+
+    // ======================================================================================================
+    //! @brief      Tries to move the element at the front of the buffer out of the buffer, without waiting
+    //!             (consumer only).
+    //! @param[out] element     The element to move the front element into.
+    //! @return     If an element was removed, which is false if the buffer is empty.
+    // ======================================================================================================
+    bool tryPop(T& element)
+    {
+        const size_type head = _head.load(std::memory_order_relaxed);
+        if (head == _cached_tail) {                                         // Looks empty, check the tail
+            _cached_tail = _tail.load(std::memory_order_acquire);
+            if (head == _cached_tail) return false;
+        }
+        T* front = slot(head);
+        element  = std::move(*front);
+        front->~T();
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // ======================================================================================================
+    //! @brief      Moves an element into the buffer, waiting while the buffer is full (producer only).
+    //! @param[in]  element     The element to move into the buffer.
+    //! @return     If the element was added, which is false if the buffer was closed.
+    // ======================================================================================================
+    bool push(T&& element)
+    {
+        detail::Backoff backoff;
+        while (!_closed.load(std::memory_order_acquire)) {
+            if (emplace(std::move(element))) return true;
+            backoff.wait();
+        }
+        return false;
+    }
+
+    // ======================================================================================================
+    //! @brief      Moves the front element out of the buffer, waiting while the buffer is empty (consumer
+    //!             only). Elements which were pushed before the buffer was closed are still returned.
+    //! @param[out] element     The element to move the front element into.
+    //! @return     If an element was removed, which is false only if the buffer is closed and empty.
+    // ======================================================================================================
+    bool pop(T& element)
+    {
+        detail::Backoff backoff;
+        while (true) {
+            if (tryPop(element)) return true;
+            if (_closed.load(std::memory_order_acquire)) return tryPop(element);
+            backoff.wait();
+        }
+    }
+
+    // ======================================================================================================
+    //! @brief      Closes the buffer so that no more elements can be pushed, and wakes any blocked threads.
+    // ======================================================================================================
+    void close() { _closed.store(true, std::memory_order_release); }
+
+    // ======================================================================================================
+    //! @brief      Gets if the buffer has been closed.
+    //! @return     If the buffer has been closed.
+    // ======================================================================================================
+    bool closed() const { return _closed.load(std::memory_order_acquire); }
+
+    // ======================================================================================================
+    //! @brief      Gets the number of elements in the buffer, which is only approximate while other threads
+    //!             are using the buffer.
+    //! @return     The number of elements in the buffer.
+    // ======================================================================================================
+    size_type size() const
+    {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+
+    // ======================================================================================================
+    //! @brief      Gets the maximum number of elements which the buffer can hold.
+    //! @return     The maximum number of elements which the buffer can hold.
+    // ======================================================================================================
+    size_type capacity() const { return _capacity; }
+private:
+    // ======================================================================================================
+    //! @brief      Gets a pointer to the element in the slot for a position.
+    //! @param[in]  pos     The position (head or tail) to get the slot for.
+    //! @return     A pointer to the element in the slot.
+    // ======================================================================================================
+    T* slot(size_type pos) const { return reinterpret_cast<T*>(&_slots[pos & _mask]); }
+
+    // ======================================================================================================
+    //! @brief      Constructs an element at the tail of the buffer, if there is space.
+    //! @param[in]  element     The element to construct the new element from.
+    //! @return     If the element was added.
+    //! @tparam     U           The type of the element (a reference to T).
+    // ======================================================================================================
+    template <typename U>
+    bool emplace(U&& element)
+    {
+        const size_type tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _cached_head == _capacity) {                             // Looks full, check the head
+            _cached_head = _head.load(std::memory_order_acquire);
+            if (tail - _cached_head == _capacity) return false;
+        }
+        new (slot(tail)) T(std::forward<U>(element));
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// ==========================================================================================================
+//! @class      MpmcRingBuffer
+//! @brief      A bounded lock-free queue for any number of producer and consumer threads.                   \n
+//!                                                                                                          \n
+//!             Each slot has a sequence number which says whether the slot is ready to be written to or read
+//!             from for a given position, so producers (and consumers) only contend on a compare and swap of
+//!             the tail (or head), which are on separate cache lines. An element is moved into the slot
+//!             after the position has been claimed, so move only types can be passed through the buffer.   \n
+//!                                                                                                          \n
+//!             The try functions return immediately, while push and pop block until they succeed or until
+//!             the buffer is closed.
+//! @tparam     T       The type of the elements in the buffer, which must be move constructible.
+// ==========================================================================================================
+template <typename T>
+class MpmcRingBuffer {
+public:
+    /* ======================================== Typedefs ================================================== */
+    typedef T           value_type;
+    typedef size_t      size_type;
+    /* ==================================================================================================== */
+private:
+    // ======================================================================================================
+    //! @struct     Slot
+    //! @brief      A slot in the buffer which holds an element and the sequence number of the slot.
+    // ======================================================================================================
+    struct Slot {
+        std::atomic<size_type>                                      sequence;   //!< Position the slot is for
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type  storage;    //!< Storage for the element
+    };
+
+    const size_type                                 _capacity;          //!< Number of slots (a power of 2)
+    const size_type                                 _mask;              //!< Mask to get a slot from a position
+    Slot*                                           _slots;             //!< The slots of the buffer
+    alignas(CACHE_LINE_SIZE) std::atomic<size_type> _head;              //!< Position to pop from
+    alignas(CACHE_LINE_SIZE) std::atomic<size_type> _tail;              //!< Position to push to
+    alignas(CACHE_LINE_SIZE) std::atomic<bool>      _closed;            //!< If no more elements will be pushed
+    char                                            _padding[CACHE_LINE_SIZE - sizeof(std::atomic<bool>)];
+public:
+    // ======================================================================================================
+    //! @brief      Creates the buffer with space for at least capacity elements.
+    //! @param[in]  capacity    The minimum number of elements the buffer must hold, which is rounded up to
+    //!                         a power of 2.
+    // ======================================================================================================
+    explicit MpmcRingBuffer(size_type capacity)
+    : _capacity(detail::nextPowerOf2(capacity)), _mask(_capacity - 1), _slots(new Slot[_capacity]),
+      _head(0), _tail(0), _closed(false)
+    {
+        for (size_type i = 0; i < _capacity; ++i) _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcRingBuffer(const MpmcRingBuffer&)            = delete;
+    MpmcRingBuffer& operator=(const MpmcRingBuffer&) = delete;
+
+    // ======================================================================================================
+    //! @brief      Destroys any elements which are still in the buffer.
+    // ======================================================================================================
+    ~MpmcRingBuffer()
+    {
+        const size_type tail = _tail.load(std::memory_order_relaxed);
+        for (size_type pos = _head.load(std::memory_order_relaxed); pos != tail; ++pos)
+            element(_slots[pos & _mask])->~T();
+        delete[] _slots;
+    }
+
+    // ======================================================================================================
+    //! @brief      Tries to move an element into the buffer, without waiting.
+    //! @param[in]  element     The element to move into the buffer.
+    //! @return     If the element was added, which is false if the buffer is full.
+    // ======================================================================================================
+    bool tryPush(T&& element) { return emplace(std::move(element)); }
+
+    // ======================================================================================================
+    //! @brief      Tries to copy an element into the buffer, without waiting.
+    //! @param[in]  element     The element to copy into the buffer.
+    //! @return     If the element was added, which is false if the buffer is full.
+    // ======================================================================================================
+    bool tryPush(const T& element) { return emplace(element); }
+
+    // ======================================================================================================
+    //! @brief      Tries to move the element at the front of the buffer out of the buffer, without waiting.
+    //! @param[out] value   The element to move the front element into.
+    //! @return     If an element was removed, which is false if the buffer is empty.
+    // ======================================================================================================
+    bool tryPop(T& value)
+    {
+        size_type head = _head.load(std::memory_order_relaxed);
+        while (true) {
+            Slot&           slot     = _slots[head & _mask];
+            const size_type sequence = slot.sequence.load(std::memory_order_acquire);
+            const long      diff     = static_cast<long>(sequence) - static_cast<long>(head + 1);
+
+            if (diff == 0) {                                                    // Slot has an element
+                if (_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+                    T* front = element(slot);
+                    value    = std::move(*front);
+                    front->~T();
+                    slot.sequence.store(head + _capacity, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {                                              // Empty
+                return false;
+            } else {                                                            // Another consumer won
+                head = _head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // ======================================================================================================
+    //! @brief      Moves an element into the buffer, waiting while the buffer is full.
+    //! @param[in]  element     The element to move into the buffer.
+    //! @return     If the element was added, which is false if the buffer was closed.
+    // ======================================================================================================
+    bool push(T&& element)
+    {
+        detail::Backoff backoff;
+        while (!_closed.load(std::memory_order_acquire)) {
+            if (emplace(std::move(element))) return true;
+            backoff.wait();
+        }
+        return false;
+    }
+
+    // ======================================================================================================
+    //! @brief      Moves the front element out of the buffer, waiting while the buffer is empty. Elements
+    //!             which were pushed before the buffer was closed are still returned.
+    //! @param[out] value   The element to move the front element into.
+    //! @return     If an element was removed, which is false only if the buffer is closed and empty.
+    // ======================================================================================================
+    bool pop(T& value)
+    {
+        detail::Backoff backoff;
+        while (true) {
+            if (tryPop(value)) return true;
+            if (_closed.load(std::memory_order_acquire)) return tryPop(value);
+            backoff.wait();
+        }
+    }
+
+    // ======================================================================================================
+    //! @brief      Closes the buffer so that no more elements can be pushed, and wakes any blocked threads.
+    // ======================================================================================================
+    void close() { _closed.store(true, std::memory_order_release); }
+
+    // ======================================================================================================
+    //! @brief      Gets if the buffer has been closed.
+    //! @return     If the buffer has been closed.
+    // ======================================================================================================
+    bool closed() const { return _closed.load(std::memory_order_acquire); }
+
+    // ======================================================================================================
+    //! @brief      Gets the number of elements in the buffer, which is only approximate while other threads
+    //!             are using the buffer.
+    //! @return     The number of elements in the buffer.
+    // ======================================================================================================
+    size_type size() const
+    {
+        const size_type head = _head.load(std::memory_order_acquire);
+        const size_type tail = _tail.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    // ======================================================================================================
+    //! @brief      Gets the maximum number of elements which the buffer can hold.
+    //! @return     The maximum number of elements which the buffer can hold.
+    // ======================================================================================================
+    size_type capacity() const { return _capacity; }
+private:
+    // ======================================================================================================
+    //! @brief      Gets a pointer to the element in a slot.
+    //! @param[in]  slot    The slot to get the element of.
+    //! @return     A pointer to the element in the slot.
+    // ======================================================================================================
+    static T* element(Slot& slot) { return reinterpret_cast<T*>(&slot.storage); }
+
+    // ======================================================================================================
+    //! @brief      Claims the slot at the tail of the buffer and constructs an element in it, if there is
+    //!             space.
+    //! @param[in]  value   The element to construct the new element from.
+    //! @return     If the element was added.
+    //! @tparam     U       The type of the element (a reference to T).
+    // ======================================================================================================
+    template <typename U>
+    bool emplace(U&& value)
+    {
+        size_type tail = _tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot&           slot     = _slots[tail & _mask];
+            const size_type sequence = slot.sequence.load(std::memory_order_acquire);
+            const long      diff     = static_cast<long>(sequence) - static_cast<long>(tail);
+
+            if (diff == 0) {                                                    // Slot is free
+                if (_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    new (element(slot)) T(std::forward<U>(value));
+                    slot.sequence.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {                                              // Full
+                return false;
+            } else {                                                            // Another producer won
+                tail = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+}       // End namespace frnn
+
+#endif
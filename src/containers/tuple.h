@@ -28,51 +28,93 @@
 #ifndef _FRNN_CONTAINERS_TUPLE_
 #define _FRNN_CONTAINERS_TUPLE_
 
+#include <cstddef>
+
 namespace frnn {
 
 // ==========================================================================================================
-//! @struct  Tuple 
-//! @brief   Holds any number of elements of any type.
-//! @details Usage : Tuple<type1, type2, ...> tuple(elem1 of type1, elem2 of type2, ...)
-//! @tparam  Ts     The types of the elements to be stored in teh Tuple.
+//! @struct  IndexSequence
+//! @brief   Holds a compile time sequence of indices, which can be expanded to access each element of a
+//!          Tuple without recursion (a C++11 version of std::index_sequence).
+//! @tparam  Is     The indices in the sequence.
 // ==========================================================================================================
-template <typename... Ts> struct Tuple {};
+template <size_t... Is> struct IndexSequence {};
 
 // ==========================================================================================================
-//! @struct  Tuple 
+//! @struct  MakeIndexSequence
+//! @brief   Creates the IndexSequence 0, 1, ..., N - 1 as the type member.
+//! @tparam  N      The number of indices in the sequence.
+//! @tparam  Is     The indices which have been created so far.
+// ==========================================================================================================
+template <size_t N, size_t... Is> 
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, Is...> {};
+
+// ==========================================================================================================
+//! @struct  MakeIndexSequence
+// ==========================================================================================================
+template <size_t... Is> 
+struct MakeIndexSequence<0, Is...> {
+    typedef IndexSequence<Is...> type;
+};
+
+// ==========================================================================================================
+//! @struct  TupleElement
+//! @brief   Holds a single element of a Tuple, the index makes the type of each element of a Tuple unique, 
+//!          even when the elements have the same type.
+//! @tparam  i      The index of the element in the Tuple.
+//! @tparam  T      The type of the element.
 // ==========================================================================================================
-template <typename T>
-struct Tuple<T> {
+template <size_t i, typename T>
+struct TupleElement {
 public:
-    T _back;            //!< Element of the Tuple
+    T _value;           //!< Element of the Tuple
 public:
     // ======================================================================================================
-    //! @brief      Constuctor for a Tuple when there is only one element (base case of recursive 
-    //!             construction).
-    //! @param[in]  element     The element to add to the Tuple.
-    //! @tparam     T           Type of the element to add to the Tuple.
+    //! @brief      Sets the value of the element.
+    //! @param[in]  element     The value of the element.
     // ======================================================================================================
-    Tuple(T element) : _back(element) {}
+    constexpr TupleElement(T element) : _value(element) {}
+};
+
+// ==========================================================================================================
+//! @struct  TupleStorage
+//! @brief   Stores all the elements of a Tuple as direct bases, so the storage is flat rather than nested.
+//! @tparam  S      The IndexSequence for the elements.
+//! @tparam  Ts     The types of the elements.
+// ==========================================================================================================
+template <typename S, typename... Ts> struct TupleStorage;
+
+// ==========================================================================================================
+//! @struct  TupleStorage
+// ==========================================================================================================
+template <size_t... Is, typename... Ts>
+struct TupleStorage<IndexSequence<Is...>, Ts...> : TupleElement<Is, Ts>... {
+public:
+    // ======================================================================================================
+    //! @brief      Constructs each of the elements from the arguments.
+    //! @param[in]  elements    The elements to store.
+    // ======================================================================================================
+    constexpr TupleStorage(Ts... elements) : TupleElement<Is, Ts>(elements)... {}
 };
 
 // ==========================================================================================================
 //! @struct  Tuple 
+//! @brief   Holds any number of elements of any type. The elements are stored flat (not recursively) and the
+//!          Tuple can be constructed and read in constant expressions, so Tuples of Indexes which are known 
+//!          at compile time can be used to build compile time plans.
+//! @details Usage : Tuple<type1, type2, ...> tuple(elem1 of type1, elem2 of type2, ...)
+//! @tparam  Ts     The types of the elements to be stored in teh Tuple.
 // ==========================================================================================================
-template <typename T, typename... Ts>
-struct Tuple<T, Ts...> : Tuple<Ts...> {
-public: 
-    T _back;            //!< Element of the Tuple
+template <typename... Ts> 
+struct Tuple : TupleStorage<typename MakeIndexSequence<sizeof...(Ts)>::type, Ts...> {
 public:
-     // =====================================================================================================
-     //! @brief     Constructor for a Tuple when there is more than one element.
-     //! @param[in] element     The element to add to the Tuple on this iteration of the recursive 
-     //!            construction.
-     //! @param[in] elements    The rest of the elements to add to the Tuple on the remaining iterations.
-     //! @tparam    T           Type of the element to add to the Tuple. 
-     //! @tparam    Ts          The types of the elements to add to the Tuple on the following iterations of 
-     //!            the recursive construction.
-     //  ====================================================================================================
-    Tuple(T element, Ts... elements) : Tuple<Ts...>(elements...), _back(element) {}
+    // ======================================================================================================
+    //! @brief      Constructs the Tuple from the elements.
+    //! @param[in]  elements    The elements to add to the Tuple.
+    //! @tparam     Ts          The types of the elements to add to the Tuple.
+    // ======================================================================================================
+    constexpr Tuple(Ts... elements) 
+    : TupleStorage<typename MakeIndexSequence<sizeof...(Ts)>::type, Ts...>(elements...) {}
 };
 
 // ==========================================================================================================
@@ -100,32 +142,52 @@ struct TupleElementTypeHolder<i, Tuple<T, Ts...>> {
     typedef typename TupleElementTypeHolder<i - 1, Tuple<Ts...>>::type type;  
 };
 
+namespace detail {
+    
 // ==========================================================================================================
-//! @brief      Gets the 0th element in a Tuple. Enabled if i is equal to 0.
+//! @brief      Gets the value of a TupleElement, the type of the element is deduced from the conversion of 
+//!             the Tuple to its TupleElement base with index i.
+//! @param[in]  element     The element to get the value of.
+//! @tparam     i           The index of the element.
+//! @tparam     T           The type of the element.
+// ==========================================================================================================
+template <size_t i, typename T>
+constexpr const T& getElement(const TupleElement<i, T>& element) { return element._value; }
+
+// ==========================================================================================================
+//! @brief      Gets a reference to the value of a TupleElement.
+//! @param[in]  element     The element to get the value of.
+//! @tparam     i           The index of the element.
+//! @tparam     T           The type of the element.
+// ==========================================================================================================
+template <size_t i, typename T>
+T& getElement(TupleElement<i, T>& element) { return element._value; }
+
+}   // End namespace detail
+
+// ==========================================================================================================
+//! @brief      Gets a reference to the element at position i in the Tuple.
 //! @param[in]  tuple   The Tuple to get the element from.
-//! @tparam     i       The index of the element to get.
-//! @tparam     Ts      The types of all elements in the Tuple.
+//! @tparam     i       The index of the element in the Tuple.
+//! @tparam     Ts      The types of all the elements in the Tuple.
 // ==========================================================================================================
 template <size_t i, typename... Ts>
-typename std::enable_if<i == 0, typename TupleElementTypeHolder<0, Tuple<Ts...>>::type&>::type 
-get(Tuple<Ts...>& tuple) 
+typename TupleElementTypeHolder<i, Tuple<Ts...>>::type& get(Tuple<Ts...>& tuple) 
 {
-    return tuple._back;
+    return detail::getElement<i>(tuple);
 }
 
 // ==========================================================================================================
-//! @brief      Gets the element at position i in the Tuple. Enabled if i is not equal to 0.
+//! @brief      Gets a constant reference to the element at position i in the Tuple, which can be used in 
+//!             constant expressions.
 //! @param[in]  tuple   The Tuple to get the element from.
 //! @tparam     i       The index of the element in the Tuple.
-//! @tparam     T       The type of the element at position i.
 //! @tparam     Ts      The types of all the elements in the Tuple.
 // ==========================================================================================================
-template <size_t i, typename T, typename... Ts>
-typename std::enable_if<i != 0, typename TupleElementTypeHolder<i, Tuple<T, Ts...>>::type&>::type
-get(Tuple<T, Ts...>& tuple) 
+template <size_t i, typename... Ts>
+constexpr const typename TupleElementTypeHolder<i, Tuple<Ts...>>::type& get(const Tuple<Ts...>& tuple) 
 {
-    Tuple<Ts...>& tupleBase = tuple;
-    return get<i - 1>(tupleBase);       
+    return detail::getElement<i>(tuple);
 }
 
 namespace tuple {
@@ -137,7 +199,7 @@ namespace tuple {
 //! @return     The size of the Tuple tuple.
 // ========================================================================================================== 
 template <typename... Ts>
-size_t size(Tuple<Ts...>& tuple) { return sizeof...(Ts); }
+constexpr size_t size(const Tuple<Ts...>& tuple) { return sizeof...(Ts); }
 
 }
 
@@ -0,0 +1,187 @@
+/*
+ *  Header file for fastRNN CPU feature detection, which determines the widest SIMD instruction set which
+ *  the host supports so that CPU kernels which are compiled for several instruction sets can pick the
+ *  fastest version at runtime.
+ *
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FRNN_CPU_FEATURES_
+#define _FRNN_CPU_FEATURES_
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+// Target attributes for functions which are compiled for a specific instruction set. Any vector types must
+// stay inside functions with the attribute, since passing them to a function compiled for a different
+// instruction set changes the ABI. The width generic kernels do pass vectors between functions without the
+// attribute, but they are always inlined into a function with it (see FRNN_FORCE_INLINE), so no vector ever
+// crosses a real call. GCC still warns (-Wpsabi) for them, and reports the warning for the end of the
+// translation unit, so it can not be scoped with a pragma in the headers : builds with warnings enabled
+// must add -Wno-psabi (see the Makefiles).
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define FRNN_X86                1
+#define FRNN_TARGET_SSE2        __attribute__(( target( "sse2" ) ))
+#define FRNN_TARGET_AVX2        __attribute__(( target( "avx2,fma" ) ))
+#define FRNN_TARGET_AVX512      __attribute__(( target( "avx512f,avx2,fma" ) ))
+#else
+#define FRNN_X86                0
+#define FRNN_TARGET_SSE2
+#define FRNN_TARGET_AVX2
+#define FRNN_TARGET_AVX512
+#endif
+
+// Width generic kernels must be inlined into the function for the instruction set they are used with
+#define FRNN_FORCE_INLINE       inline __attribute__(( always_inline ))
+
+namespace frnn {
+
+/*
+ * ==========================================================================================================
+ * Enum         : isa
+ *
+ * Description  : Enumerator for the SIMD instruction sets which CPU kernels are compiled for, in order of
+ *                increasing vector width so that they can be compared.
+ *
+ *                SCALAR    : No SIMD instructions (also used on non-x86 hosts)
+ *                SSE2      : 128 bit vectors
+ *                AVX2      : 256 bit vectors and fused multiply add
+ *                AVX512    : 512 bit vectors
+ * ==========================================================================================================
+ */
+enum isa : int {
+    SCALAR  = 0,
+    SSE2    = 1,
+    AVX2    = 2,
+    AVX512  = 3
+};
+
+namespace cpu {
+namespace detail {
+
+/*
+ * ==========================================================================================================
+ * Function     : detectIsa
+ *
+ * Description  : Uses CPUID to determine the widest instruction set which the host supports. The FRNN_ISA
+ *                environment variable (scalar, sse2, avx2 or avx512) can be used to lower the result, for
+ *                example to compare the results of the different kernel versions.
+ *
+ * Outputs      : The widest instruction set supported by the host
+ * ==========================================================================================================
+ */
+inline isa detectIsa() {
+    isa level = SCALAR;
+#if FRNN_X86
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "sse2" ) )                                         level = SSE2;
+    if ( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )      level = AVX2;
+    if ( __builtin_cpu_supports( "avx512f" ) && level == AVX2 )                     level = AVX512;
+#endif
+    const char* requested = std::getenv( "FRNN_ISA" );
+    if ( requested != NULL ) {
+        isa limit = level;
+        if      ( std::strcmp( requested, "scalar" ) == 0 ) limit = SCALAR;
+        else if ( std::strcmp( requested, "sse2"   ) == 0 ) limit = SSE2;
+        else if ( std::strcmp( requested, "avx2"   ) == 0 ) limit = AVX2;
+        if ( limit < level ) level = limit;
+    }
+    return level;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : isaLimit
+ *
+ * Description  : Gets the limit on the instruction set which kernels may use, which can be lowered at
+ *                runtime with setIsaLimit
+ *
+ * Outputs      : A reference to the limit
+ * ==========================================================================================================
+ */
+inline std::atomic<int>& isaLimit() {
+    static std::atomic<int> limit( AVX512 );
+    return limit;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : threadIsaLimit
+ *
+ * Description  : Gets the limit on the instruction set for the calling thread only, which is used to run a
+ *                specific variant of a kernel (see frnn/kernel_selector.h). It does not apply to the other
+ *                threads of an OpenMP region started by the thread.
+ *
+ * Outputs      : A reference to the limit for the calling thread
+ * ==========================================================================================================
+ */
+inline int& threadIsaLimit() {
+    static thread_local int limit = AVX512;
+    return limit;
+}
+
+}   // Namespace detail
+
+/*
+ * ==========================================================================================================
+ * Function     : supportedIsa
+ *
+ * Description  : Gets the widest instruction set supported by the host, which is determined once
+ *
+ * Outputs      : The widest instruction set supported by the host
+ * ==========================================================================================================
+ */
+inline isa supportedIsa() {
+    static const isa supported = detail::detectIsa();
+    return supported;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : activeIsa
+ *
+ * Description  : Gets the instruction set which CPU kernels should use, which is the widest supported one
+ *                unless a lower limit has been set (for all threads, or for the calling thread)
+ *
+ * Outputs      : The instruction set which CPU kernels should use
+ * ==========================================================================================================
+ */
+inline isa activeIsa() {
+    int limit = detail::isaLimit().load( std::memory_order_relaxed );
+    if ( detail::threadIsaLimit() < limit ) limit = detail::threadIsaLimit();
+    return static_cast<isa>( limit < supportedIsa() ? limit : supportedIsa() );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : setIsaLimit
+ *
+ * Description  : Limits the instruction set which CPU kernels use (it can never be raised above the widest
+ *                one supported by the host)
+ *
+ * Inputs       : limit     : The widest instruction set which the kernels may use
+ * ==========================================================================================================
+ */
+inline void setIsaLimit( isa limit ) {
+    detail::isaLimit().store( limit, std::memory_order_relaxed );
+}
+
+}   // Namespace cpu
+}   // Namespace frnn
+
+#endif
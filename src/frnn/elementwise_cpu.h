@@ -0,0 +1,217 @@
+/*
+ *  Header file for the fastRNN CPU elementwise engine, which applies an operation to the elements of one
+ *  or more arrays with the vectorized instructions, so that every elementwise CPU function (xmy, axpy, the
+ *  Hadamard product and the activations) shares the same loop.
+ *
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FRNN_ELEMENTWISE_CPU_
+#define _FRNN_ELEMENTWISE_CPU_
+
+#include <omp.h>
+#include <algorithm>
+#include <cstdint>
+
+#include "vectorized_types_cpu.h"
+
+/*
+ * =========================================== NOTES ========================================================
+ *
+ * 1. An operation is a struct with a packet function, as the functors have, which takes one vector for
+ *    each input array and returns the vector of results :
+ *
+ *      struct minus {
+ *          template <isa level, typename dType>
+ *          FRNN_FORCE_INLINE static typename VectorizedInstructionsCpu<dType, level>::vect_type
+ *          packet( const vect_type& x, const vect_type& y ) { ... }
+ *      };
+ *
+ *    The packet function may also be a (const) member function, for operations which hold parameters (for
+ *    example a scalar). The engine calls it as op.packet<level, dType>( ... ).
+ *
+ * 2. Each block of the output is processed in three parts : elements up to the first aligned address of
+ *    the output (with partial loads and stores), whole vectors with aligned stores, and the tail (again
+ *    with partial loads and stores). No element outside [0, N) is ever read or written. The inputs are
+ *    loaded unaligned, since they can not all be aligned at the same time as the output.
+ *
+ * 3. Outputs which are larger than streamingBytes() are written with non-temporal stores, which bypass
+ *    the cache, since they would evict everything else from it before they are read again anyway.
+ *
+ * 4. The output may be one of the inputs (the result for an element only depends on the same element of
+ *    the inputs), but it must not partially overlap an input.
+ * ==========================================================================================================
+ */
+
+namespace frnn   {
+namespace cpu    {
+namespace detail {
+
+// Minimum number of elements for the bulk functions to use more than one thread, and elements per task
+constexpr size_t mathParallelSize() { return 1 << 15; }
+constexpr size_t mathBlockSize()    { return 1 << 12; }
+
+// Size of the output (in bytes) from which the results are written with non-temporal stores
+constexpr size_t streamingBytes()   { return size_t( 1 ) << 25; }
+
+/*
+ * ==========================================================================================================
+ * Function     : threadsOverride
+ *
+ * Description  : Gets the number of threads which the bulk functions called from the calling thread must
+ *                use, which is set to run a specific variant of a function (see frnn/kernel_selector.h)
+ *
+ * Outputs      : A reference to the number of threads (0 if the size thresholds should be used)
+ * ==========================================================================================================
+ */
+inline int& threadsOverride() {
+    static thread_local int threads = 0;
+    return threads;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : parallelThreads
+ *
+ * Description  : Determines the number of threads a bulk function should use for N elements : the number
+ *                set by threadsOverride if there is one, otherwise one thread below mathParallelSize and
+ *                max_threads from it
+ *
+ * Inputs       : N             : The number of elements
+ *              : max_threads   : The maximum number of threads which may be used
+ *
+ * Outputs      : The number of threads to use (1 to run serially)
+ * ==========================================================================================================
+ */
+inline int parallelThreads( size_t N, int max_threads ) {
+    const int forced = threadsOverride();
+    if ( forced > 0 ) return std::max( 1, std::min( forced, max_threads ) );
+    return N >= mathParallelSize() ? std::max( 1, max_threads ) : 1;
+}
+
+inline int parallelThreads( size_t N ) { return parallelThreads( N, omp_get_max_threads() ); }
+
+/*
+ * ==========================================================================================================
+ * Struct       : ElementwiseKernel
+ *
+ * Description  : Kernel which applies an operation to the elements of the input arrays, for one block
+ *                (see the notes above)
+ *
+ * Inputs       : op        : The operation
+ *              : stream    : If the aligned stores should be non-temporal
+ *              : N         : The number of elements in each array
+ *              : ins       : The input arrays
+ *
+ * Outputs      : out       : The results of the operation
+ *
+ * Params       : Op        : The type of the operation
+ * ==========================================================================================================
+ */
+template <typename Op> struct ElementwiseKernel {
+    template <isa level, typename dType, typename... Ins>
+    FRNN_FORCE_INLINE static void apply( const Op& op, bool stream, dType* out, size_t N, Ins... ins ) {
+        typedef VectorizedInstructionsCpu<dType, level> vect_ins;
+        const size_t step  = vect_ins::typeSize();
+        const size_t bytes = step * sizeof( dType );
+
+        // Peel elements until the output is aligned
+        const size_t offset = reinterpret_cast<std::uintptr_t>( out ) % bytes;
+        const size_t head   = std::min( N, offset == 0 ? 0 : ( bytes - offset ) / sizeof( dType ) );
+        if ( head > 0 ) {
+            vect_ins::mm_store_n( out, op.template packet<level, dType>( vect_ins::mm_load_n( ins, head )... ), head );
+        }
+
+        size_t i = head;
+        if ( stream ) {
+            for ( ; i + step <= N; i += step ) {
+                vect_ins::mm_stream_p( out + i, op.template packet<level, dType>( vect_ins::mm_load_u( ins + i )... ) );
+            }
+            vect_ins::mm_fence();
+        } else {
+            for ( ; i + step <= N; i += step ) {
+                vect_ins::mm_store_p( out + i, op.template packet<level, dType>( vect_ins::mm_load_u( ins + i )... ) );
+            }
+        }
+
+        if ( i < N ) {
+            vect_ins::mm_store_n( out + i, op.template packet<level, dType>( vect_ins::mm_load_n( ins + i, N - i )... ),
+                                  N - i );
+        }
+    }
+};
+
+}   // Namespace detail
+
+/*
+ * ==========================================================================================================
+ * Function     : elementwise
+ *
+ * Description  : Applies an operation to the elements of any number of input arrays, with the widest
+ *                instruction set which the host supports. Large arrays are split into blocks between at
+ *                most the given number of OpenMP threads.
+ *
+ * Inputs       : threads   : The maximum number of threads to use
+ *              : op        : The operation (see the notes above)
+ *              : N         : The number of elements in each array
+ *              : ins       : The input arrays
+ *
+ * Outputs      : out       : The results of the operation (which may be one of the inputs)
+ *
+ * Params       : Op        : The type of the operation
+ *              : dType     : The type of data in the arrays
+ *              : Ins       : The types of the input arrays (pointers to dType)
+ * ==========================================================================================================
+ */
+template <typename Op, typename dType, typename... Ins>
+void elementwise( int threads, const Op& op, dType* out, size_t N, const Ins*... ins ) {
+    const size_t block    = detail::mathBlockSize();
+    const long   blocks   = static_cast<long>( ( N + block - 1 ) / block );
+    const bool   stream   = N * sizeof( dType ) >= detail::streamingBytes();
+    const int    used     = detail::parallelThreads( N, threads );
+
+    #pragma omp parallel for num_threads( used ) schedule( static ) if ( used > 1 )
+    for ( long b = 0; b < blocks; b++ ) {
+        const size_t start = b * block;
+        dispatch<detail::ElementwiseKernel<Op>>( op, stream, out + start, std::min( block, N - start ),
+                                                 ( ins + start )... );
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : elementwise
+ *
+ * Description  : Applies an operation to the elements of any number of input arrays, using as many threads
+ *                as OpenMP would for a parallel region
+ *
+ * Inputs       : op        : The operation (see the notes above)
+ *              : N         : The number of elements in each array
+ *              : ins       : The input arrays
+ *
+ * Outputs      : out       : The results of the operation (which may be one of the inputs)
+ * ==========================================================================================================
+ */
+template <typename Op, typename dType, typename... Ins>
+void elementwise( const Op& op, dType* out, size_t N, const Ins*... ins ) {
+    elementwise( omp_get_max_threads(), op, out, N, ins... );
+}
+
+}   // Namespace cpu
+}   // Namespace frnn
+
+#endif
@@ -19,10 +19,22 @@
  */
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
+#include <limits>
+#include <thread>
 #include <typeinfo>
+#include <vector>
 
 #include "types.h"
+#include "vectorized_types_cpu.h"
+#include "vectorized_math_cpu.h"
+#include "elementwise_cpu.h"
+#include "kernel_selector.h"
+#include "../functors/functors.cuh"
 
 /* 
  * =========================================== NOTES ========================================================
@@ -141,3 +153,288 @@ TEST( frnnTypesCpu, CanDetermineVectorizedCharFromChar ) {
     
     EXPECT_EQ( typeid( frnnVectorizedCpu ).name(), typeid( sseVectorizedCpu ).name() );
 }
+
+// Width generic kernel for the dispatch test, which returns the number of elements per vector
+struct SubtractKernel {
+    template <frnn::isa level, typename dType>
+    FRNN_FORCE_INLINE static size_t apply( const dType* x, const dType* y, dType* out, size_t N ) {
+        typedef frnn::VectorizedInstructionsCpu<dType, level> vect_ins;
+        const size_t step = vect_ins::typeSize();
+        size_t i = 0;
+        for ( ; i + step <= N; i += step ) {
+            vect_ins::mm_store_p( out + i, vect_ins::mm_sub_p( vect_ins::mm_load_u( x + i ), 
+                                                               vect_ins::mm_load_u( y + i ) ) );
+        }
+        for ( ; i < N; i++ ) out[ i ] = x[ i ] - y[ i ];
+        return step;
+    }
+};
+
+TEST( frnnTypesCpu, CanDispatchKernelsForEachInstructionSet ) {
+    const size_t widths[] = { 1, 4, 8, 16 };                // Floats per vector for each instruction set
+    const size_t N        = 37;
+    alignas( 64 ) float x[ N ], y[ N ], out[ N ];
+    
+    for ( size_t i = 0; i < N; i++ ) { x[ i ] = 2.0f * i; y[ i ] = 1.0f * i; }
+    
+    for ( int level = frnn::SCALAR; level <= frnn::cpu::supportedIsa(); level++ ) {
+        frnn::cpu::setIsaLimit( static_cast<frnn::isa>( level ) );
+        
+        EXPECT_EQ( frnn::cpu::activeIsa(), level );
+        EXPECT_EQ( frnn::cpu::dispatch<SubtractKernel>( x, y, out, N ), widths[ level ] );
+        for ( size_t i = 0; i < N; i++ ) EXPECT_EQ( out[ i ], float( i ) );
+    }
+    frnn::cpu::setIsaLimit( frnn::AVX512 );
+}
+
+// Kernel for the primitives test : out = x * y + 1 where x > y, otherwise min( x, y ), and returns the sum
+// and the maximum of max( x, y ), using partial loads and stores for the tail
+struct PrimitivesKernel {
+    template <frnn::isa level, typename dType>
+    FRNN_FORCE_INLINE static dType apply( const dType* x, const dType* y, dType* out, size_t N, dType* max ) {
+        typedef frnn::VectorizedInstructionsCpu<dType, level> vect_ins;
+        typedef typename vect_ins::vect_type                  vect_type;
+        const size_t step = vect_ins::typeSize();
+        vect_type    sum  = vect_ins::mm_zero(), biggest = vect_ins::mm_set1( x[ 0 ] );
+        
+        for ( size_t i = 0; i < N; i += step ) {
+            const size_t    n = N - i < step ? N - i : step;
+            const vect_type a = vect_ins::mm_load_n( x + i, n ), b = vect_ins::mm_load_n( y + i, n );
+            const vect_type r = vect_ins::mm_blend_p( vect_ins::mm_min_p( a, b ),
+                                                      vect_ins::mm_fmadd_p( a, b, vect_ins::mm_set1( 1 ) ),
+                                                      vect_ins::mm_cmpgt_p( a, b )                         );
+            vect_ins::mm_store_n( out + i, r, n );
+            sum     = vect_ins::mm_add_p( sum, vect_ins::mm_max_p( a, b ) );
+            biggest = vect_ins::mm_max_p( biggest, vect_ins::mm_max_p( a, b ) );
+        }
+        *max = vect_ins::mm_hmax( biggest );
+        return vect_ins::mm_hsum( sum );
+    }
+};
+
+template <typename dType> void testPrimitives() {
+    const size_t N = 43;                                    // Not a multiple of any vector width
+    dType        x[ N ], y[ N ], out[ N + 1 ];
+    dType        expected_sum = 0;
+    
+    for ( size_t i = 0; i < N; i++ ) { x[ i ] = dType( i % 7 ); y[ i ] = dType( i % 5 ); }
+    for ( size_t i = 0; i < N; i++ ) expected_sum += std::max( x[ i ], y[ i ] );
+    
+    for ( int level = frnn::SCALAR; level <= frnn::cpu::supportedIsa(); level++ ) {
+        frnn::cpu::setIsaLimit( static_cast<frnn::isa>( level ) );
+        dType max   = 0;
+        out[ N ]    = dType( -1 );                          // Must not be written by the partial store
+        
+        EXPECT_EQ( frnn::cpu::dispatch<PrimitivesKernel>( x, y, out, N, &max ), expected_sum );
+        EXPECT_EQ( max, dType( 6 ) );
+        EXPECT_EQ( out[ N ], dType( -1 ) );
+        for ( size_t i = 0; i < N; i++ ) {
+            EXPECT_EQ( out[ i ], x[ i ] > y[ i ] ? x[ i ] * y[ i ] + 1 : std::min( x[ i ], y[ i ] ) );
+        }
+    }
+    frnn::cpu::setIsaLimit( frnn::AVX512 );
+}
+
+TEST( frnnTypesCpu, PrimitivesGiveTheSameResultsForEachInstructionSet ) {
+    testPrimitives<float>();
+    testPrimitives<double>();
+    testPrimitives<int>();
+}
+
+// Error of a result in units in the last place of the (correctly rounded) reference
+template <typename dType> double ulpError( dType result, long double reference ) {
+    const long double ulp = std::max( std::ldexp( 1.0L, std::ilogb( static_cast<dType>( reference ) ) - 
+                                                        std::numeric_limits<dType>::digits + 1      ),
+                                      static_cast<long double>( std::numeric_limits<dType>::denorm_min() ) );
+    return static_cast<double>( std::fabs( result - reference ) / ulp );
+}
+
+template <typename dType, frnn::accuracy acc> void testVectorizedMath( double exp_ulp, double log_ulp, double tanh_ulp ) {
+    const size_t      N = 10001;
+    std::vector<dType> x( N ), positive( N ), out( N );
+    for ( size_t i = 0; i < N; i++ ) {
+        x[ i ]        = dType( -80 ) + dType( 160 ) * i / ( N - 1 );
+        positive[ i ] = std::ldexp( dType( 1 ) + dType( i % 97 ) / 97, int( i % 200 ) - 100 );
+    }
+    
+    for ( int level = frnn::SCALAR; level <= frnn::cpu::supportedIsa(); level++ ) {
+        frnn::cpu::setIsaLimit( static_cast<frnn::isa>( level ) );
+        double exp_err = 0, log_err = 0, sigmoid_err = 0, tanh_err = 0;
+        
+        frnn::cpu::vexp<acc>( x.data(), out.data(), N );
+        for ( size_t i = 0; i < N; i++ ) exp_err = std::max( exp_err, ulpError( out[ i ], std::exp( (long double)x[ i ] ) ) );
+        frnn::cpu::vlog<acc>( positive.data(), out.data(), N );
+        for ( size_t i = 0; i < N; i++ ) log_err = std::max( log_err, ulpError( out[ i ], std::log( (long double)positive[ i ] ) ) );
+        frnn::cpu::vsigmoid<acc>( x.data(), out.data(), N );
+        for ( size_t i = 0; i < N; i++ ) {
+            sigmoid_err = std::max( sigmoid_err, ulpError( out[ i ], 1.0L / ( 1.0L + std::exp( -(long double)x[ i ] ) ) ) );
+        }
+        frnn::cpu::vtanh<acc>( x.data(), out.data(), N );
+        for ( size_t i = 0; i < N; i++ ) tanh_err = std::max( tanh_err, ulpError( out[ i ], std::tanh( (long double)x[ i ] ) ) );
+        
+        EXPECT_LE( exp_err    , exp_ulp  );
+        EXPECT_LE( log_err    , log_ulp  );
+        EXPECT_LE( sigmoid_err, exp_ulp + 1 );
+        EXPECT_LE( tanh_err   , tanh_ulp );
+    }
+    frnn::cpu::setIsaLimit( frnn::AVX512 );
+}
+
+TEST( frnnTypesCpu, VectorizedMathIsWithinTheDocumentedErrors ) {
+    testVectorizedMath<float , frnn::ACCURATE>( 2  , 1  , 4   );
+    testVectorizedMath<float , frnn::FAST    >( 40 , 44 , 110 );
+    testVectorizedMath<double, frnn::ACCURATE>( 2  , 1  , 3   );
+    testVectorizedMath<double, frnn::FAST    >( 1.8e6, 1.3e7, 4.8e6 );
+}
+
+TEST( frnnTypesCpu, VectorizedMathHandlesSpecialValues ) {
+    const float inf = std::numeric_limits<float>::infinity(), nan = std::numeric_limits<float>::quiet_NaN();
+    const float x[ 7 ] = { -inf, inf, 0.0f, -1.0f, nan, 1e-40f, -200.0f };
+    float       out[ 7 ];
+    
+    for ( int level = frnn::SCALAR; level <= frnn::cpu::supportedIsa(); level++ ) {
+        frnn::cpu::setIsaLimit( static_cast<frnn::isa>( level ) );
+        frnn::cpu::vexp( x, out, 7 );
+        EXPECT_EQ( out[ 0 ], 0.0f ); EXPECT_EQ( out[ 1 ], inf ); EXPECT_EQ( out[ 2 ], 1.0f ); 
+        EXPECT_TRUE( std::isnan( out[ 4 ] ) ); EXPECT_EQ( out[ 6 ], 0.0f );
+        frnn::cpu::vlog( x, out, 7 );
+        EXPECT_TRUE( std::isnan( out[ 0 ] ) ); EXPECT_EQ( out[ 1 ], inf ); EXPECT_EQ( out[ 2 ], -inf );
+        EXPECT_TRUE( std::isnan( out[ 3 ] ) ); EXPECT_TRUE( std::isnan( out[ 4 ] ) );
+        EXPECT_NEAR( out[ 5 ], std::log( 1e-40f ), 1e-4f );                  // Denormal input
+        frnn::cpu::vtanh( x, out, 7 );
+        EXPECT_EQ( out[ 0 ], -1.0f ); EXPECT_EQ( out[ 1 ], 1.0f ); EXPECT_EQ( out[ 2 ], 0.0f );
+        frnn::cpu::vsigmoid( x, out, 7 );
+        EXPECT_EQ( out[ 0 ], 0.0f ); EXPECT_EQ( out[ 1 ], 1.0f ); EXPECT_EQ( out[ 2 ], 0.5f );
+    }
+    frnn::cpu::setIsaLimit( frnn::AVX512 );
+}
+
+// Kernel which applies a functor to an array through its packet function
+template <typename Functor> struct FunctorKernel {
+    template <frnn::isa level, typename dType>
+    FRNN_FORCE_INLINE static void apply( const dType* x, dType* out, size_t N ) {
+        typedef frnn::VectorizedInstructionsCpu<dType, level> vect_ins;
+        for ( size_t i = 0; i < N; i += vect_ins::typeSize() ) {
+            vect_ins::mm_store_u( out + i, Functor::template packet<level, dType>( vect_ins::mm_load_u( x + i ) ) );
+        }
+    }
+};
+
+TEST( frnnTypesCpu, FunctorPacketsMatchTheScalarFunctors ) {
+    const size_t N = 64;
+    alignas( 64 ) float x[ N ], out[ N ];
+    for ( size_t i = 0; i < N; i++ ) x[ i ] = -4.0f + 0.125f * i;
+    
+    frnn::cpu::dispatch<FunctorKernel<frnn::functors::sigmoid>>( x, out, N );
+    for ( size_t i = 0; i < N; i++ ) EXPECT_NEAR( out[ i ], frnn::functors::sigmoid()( x[ i ] ), 1e-6f );
+    frnn::cpu::dispatch<FunctorKernel<frnn::functors::exp>>( x, out, N );
+    for ( size_t i = 0; i < N; i++ ) EXPECT_NEAR( out[ i ], frnn::functors::exp()( x[ i ] ), 1e-6f * out[ i ] );
+    frnn::cpu::dispatch<FunctorKernel<frnn::functors::tanh>>( x, out, N );
+    for ( size_t i = 0; i < N; i++ ) EXPECT_NEAR( out[ i ], frnn::functors::tanh()( x[ i ] ), 1e-6f );
+}
+
+TEST( frnnTypesCpu, ElementwiseEngineOnlyTouchesTheOutputForEachInstructionSet ) {
+    const size_t N_MAX = 70, GUARD = 16;
+    alignas( 64 ) float x[ N_MAX + 2 * GUARD ], y[ N_MAX + 2 * GUARD ], out[ N_MAX + 2 * GUARD ];
+    for ( size_t i = 0; i < N_MAX + 2 * GUARD; i++ ) { x[ i ] = 3.0f * i; y[ i ] = 1.0f * i; }
+
+    for ( int level = frnn::SCALAR; level <= frnn::cpu::supportedIsa(); level++ ) {
+        frnn::cpu::setIsaLimit( static_cast<frnn::isa>( level ) );
+        
+        // Every misalignment of the output, and lengths which end on and off vector boundaries
+        for ( size_t offset = 0; offset < GUARD; offset += 3 ) {
+            for ( size_t N = 0; N <= N_MAX; N += 7 ) {
+                std::fill( out, out + N_MAX + 2 * GUARD, -1.0f );
+                frnn::cpu::elementwise( frnn::functors::minus(), out + GUARD + offset, N, 
+                                        static_cast<const float*>( x + offset ), static_cast<const float*>( y ) );
+                for ( size_t i = 0; i < N_MAX + 2 * GUARD; i++ ) {
+                    const size_t j = i - GUARD - offset;                // Index into the inputs
+                    const bool   inside = i >= GUARD + offset && j < N;
+                    EXPECT_EQ( out[ i ], inside ? x[ offset + j ] - y[ j ] : -1.0f );
+                }
+            }
+        }
+    }
+    frnn::cpu::setIsaLimit( frnn::AVX512 );
+}
+
+TEST( frnnTypesCpu, ElementwiseEngineStreamsLargeOutputs ) {
+    // One element past the streaming size, with a misaligned output so that the head, the non-temporal
+    // stores and the tail are all used
+    const size_t        N = frnn::cpu::detail::streamingBytes() / sizeof( double ) + 1;
+    std::vector<double> x( N + 1 ), y( N + 1 ), out( N + 1, 0.0 );
+    for ( size_t i = 0; i < N + 1; i++ ) { x[ i ] = 0.5 * ( i % 1024 ); y[ i ] = 2.0; }
+
+    frnn::cpu::elementwise( frnn::functors::hadamard(), &out[ 1 ], N, 
+                            static_cast<const double*>( &x[ 0 ] ), static_cast<const double*>( &y[ 0 ] ) );
+    EXPECT_EQ( out[ 0 ], 0.0 );
+    for ( size_t i = 0; i < N; i++ ) {
+        if ( out[ i + 1 ] != 2.0 * x[ i ] ) { EXPECT_EQ( out[ i + 1 ], 2.0 * x[ i ] ); break; }
+    }
+}
+
+TEST( frnnKernelSelector, ScopedVariantOnlyAppliesToTheCallingThreadWhileItExists ) {
+    {
+        frnn::cpu::ScopedVariant scope( frnn::SCALAR_SERIAL );
+        EXPECT_EQ( frnn::cpu::activeIsa(), frnn::SCALAR );
+        EXPECT_EQ( frnn::cpu::detail::parallelThreads( 1 << 20 ), 1 );
+    }
+    EXPECT_EQ( frnn::cpu::activeIsa(), frnn::cpu::supportedIsa() );
+    {
+        frnn::cpu::ScopedVariant scope( frnn::SIMD_PARALLEL );
+        EXPECT_EQ( frnn::cpu::activeIsa(), frnn::cpu::supportedIsa() );
+        EXPECT_EQ( frnn::cpu::detail::parallelThreads( 16 ), omp_get_max_threads() );
+    }
+    EXPECT_EQ( frnn::cpu::detail::parallelThreads( 16 ), 1 );
+}
+
+TEST( frnnKernelSelector, BenchmarksEachBucketOnceAndPersistsTheChoices ) {
+    frnn::KernelSelector& selector = frnn::KernelSelector::instance();
+    const std::string     path     = "frnn_tuning_test.txt";
+    size_t                calls    = 0;
+
+    // Only SIMD_SERIAL is fast, so it must be chosen
+    auto bench = [&]( frnn::kernelVariant variant, size_t n ) {
+        calls++;
+        if ( variant != frnn::SIMD_SERIAL ) std::this_thread::sleep_for( std::chrono::milliseconds( 2 ) );
+    };
+
+    selector.clear();
+    selector.setFile( path );
+    EXPECT_EQ( selector.select( "test<float>", 1000, false, bench ), frnn::SIMD_SERIAL );
+    EXPECT_EQ( calls, 12u );                                    // Three variants, four runs each
+
+    // Same bucket (512 to 1023 elements), so no more benchmarks
+    EXPECT_EQ( selector.select( "test<float>", 600, false, bench ), frnn::SIMD_SERIAL );
+    EXPECT_EQ( calls, 12u );
+
+    // The choice is written by save, and read back from the file
+    selector.save();
+    selector.clear();
+    selector.setFile( path );
+    EXPECT_EQ( selector.select( "test<float>", 1000, false, bench ), frnn::SIMD_SERIAL );
+    EXPECT_EQ( calls, 12u );
+
+    selector.setFile( "" );
+    selector.clear();
+    std::remove( path.c_str() );
+}
+
+TEST( frnnKernelSelector, UsesTheSizeThresholdWhileABucketIsBenchmarked ) {
+    frnn::KernelSelector& selector = frnn::KernelSelector::instance();
+    frnn::KernelChoices&  choices  = selector.choices( "nested<float>" );
+    size_t                inner    = 0;
+
+    // A call for the same bucket during the benchmarks (as another thread would make) does not benchmark
+    auto inner_bench = [&]( frnn::kernelVariant, size_t ) { inner++; };
+    auto bench       = [&]( frnn::kernelVariant, size_t ) {
+        EXPECT_EQ( selector.select( choices, 1000, false, inner_bench ), frnn::SIMD_SERIAL );
+    };
+
+    selector.clear();
+    selector.select( choices, 1000, false, bench );
+    EXPECT_EQ( inner, 0u );
+    EXPECT_GE( choices.variants[ frnn::KernelSelector::bucket( 1000 ) ].load(), 0 );
+    selector.clear();
+}
+
@@ -0,0 +1,373 @@
+/*
+ *  Header file for the fastRNN kernel selector, which benchmarks the variants of a function (scalar, SIMD,
+ *  multithreaded and accelerator) for each size of input the first time the size is used, and then routes
+ *  each call of the function to the fastest variant.
+ *
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FRNN_KERNEL_SELECTOR_
+#define _FRNN_KERNEL_SELECTOR_
+
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "cpu_features.h"
+#include "elementwise_cpu.h"
+
+/*
+ * =========================================== NOTES ========================================================
+ *
+ * 1. Sizes are grouped into buckets of powers of two, and the first call of a function with a size in a
+ *    bucket runs a benchmark of each variant of the function on an input of 2^bucket elements. The
+ *    fastest variant is then used for every call in the bucket. Buckets above maxBenchmarkBucket() use the
+ *    choice for maxBenchmarkBucket(), so that the benchmarks are short and never need much memory. While
+ *    one thread benchmarks a bucket, the other threads use the size threshold (see 3) rather than wait.
+ *
+ * 2. The choices of a function are an array of atomics, one for each bucket (KernelChoices), which callers
+ *    look up once by name and keep, so a call with a choice is one atomic load, without a lock. 
+ *
+ * 3. The choices are written to the file given by the FRNN_TUNING_FILE environment variable (when it is
+ *    set) by save(), and when the program exits, and are read from it when the selector is created, so
+ *    the benchmarks only run once for each host. The file records the instruction set and the number of
+ *    threads of the host, and is ignored if they do not match.
+ *
+ * 4. Setting FRNN_TUNING=off turns the benchmarks off, in which case SIMD_PARALLEL is used from
+ *    mathParallelSize() elements and SIMD_SERIAL below it, which is the behaviour without the selector.
+ * ==========================================================================================================
+ */
+
+namespace frnn {
+
+/*
+ * ==========================================================================================================
+ * Enum         : kernelVariant
+ *
+ * Description  : Enumerator for the variants of a function which the kernel selector chooses between
+ *
+ *                SCALAR_SERIAL     : No SIMD instructions, on the calling thread
+ *                SIMD_SERIAL       : The widest instruction set, on the calling thread
+ *                SIMD_PARALLEL     : The widest instruction set, on all the OpenMP threads
+ *                ACCELERATOR       : The GPU version of the function (if there is one and a GPU is present)
+ * ==========================================================================================================
+ */
+enum kernelVariant : int {
+    SCALAR_SERIAL   = 0,
+    SIMD_SERIAL     = 1,
+    SIMD_PARALLEL   = 2,
+    ACCELERATOR     = 3
+};
+
+namespace cpu {
+
+/*
+ * ==========================================================================================================
+ * Class        : ScopedVariant
+ *
+ * Description  : Makes the CPU functions which are called from the calling thread use a variant for as long
+ *                as the instance exists, by limiting the instruction set and setting the number of threads
+ *                for the calling thread. ACCELERATOR does not change anything, since it does not use the
+ *                CPU functions.
+ * ==========================================================================================================
+ */
+class ScopedVariant {
+public:
+    explicit ScopedVariant( kernelVariant variant )
+    : isa_limit( detail::threadIsaLimit() ), threads( detail::threadsOverride() ) {
+        if ( variant == SCALAR_SERIAL )                             detail::threadIsaLimit()  = SCALAR;
+        if ( variant == SCALAR_SERIAL || variant == SIMD_SERIAL )   detail::threadsOverride() = 1;
+        if ( variant == SIMD_PARALLEL )                             detail::threadsOverride() = omp_get_max_threads();
+    }
+
+    ~ScopedVariant() {
+        detail::threadIsaLimit()  = isa_limit;
+        detail::threadsOverride() = threads;
+    }
+
+    ScopedVariant( const ScopedVariant& )            = delete;
+    ScopedVariant& operator=( const ScopedVariant& ) = delete;
+private:
+    int isa_limit;                  // The limits for the thread before the instance was created
+    int threads;
+};
+
+}   // Namespace cpu
+
+/*
+ * ==========================================================================================================
+ * Struct       : KernelChoices
+ *
+ * Description  : The variants which have been chosen for a function, one for each size bucket (up to and
+ *                including KernelSelector::maxBenchmarkBucket()), which can be read without a lock
+ * ==========================================================================================================
+ */
+struct KernelChoices {
+    static constexpr size_t buckets      = 19;     // Largest benchmark of 256K elements
+    static constexpr int    unchosen     = -1;     // There is no choice for the bucket
+    static constexpr int    benchmarking = -2;     // A thread is benchmarking the bucket
+
+    std::atomic<int> variants[ buckets ];
+
+    KernelChoices() { clear(); }
+
+    void clear() {
+        for ( size_t b = 0; b < buckets; b++ ) variants[ b ].store( unchosen, std::memory_order_relaxed );
+    }
+};
+
+/*
+ * ==========================================================================================================
+ * Class        : KernelSelector
+ *
+ * Description  : Records the fastest variant of each function for each size bucket (see the notes above).
+ *                There is a single instance, which is safe to use from multiple threads.
+ * ==========================================================================================================
+ */
+class KernelSelector {
+public:
+    /*
+     * ======================================================================================================
+     * Function     : instance
+     *
+     * Description  : Gets the selector, which reads FRNN_TUNING_FILE and FRNN_TUNING when it is created
+     *
+     * Outputs      : A reference to the selector
+     * ======================================================================================================
+     */
+    static KernelSelector& instance() {
+        static KernelSelector selector;
+        return selector;
+    }
+
+    // Largest bucket which is benchmarked
+    static constexpr size_t maxBenchmarkBucket() { return KernelChoices::buckets - 1; }
+
+    // Gets the bucket for N elements, floor( log2( N ) )
+    static size_t bucket( size_t N ) {
+        return N > 1 ? 63 - __builtin_clzll( static_cast<unsigned long long>( N ) ) : 0;
+    }
+
+    /*
+     * ======================================================================================================
+     * Function     : choices
+     *
+     * Description  : Gets the choices of a function, which are created the first time the function is
+     *                used, and which the caller can keep for as long as the program runs
+     *
+     * Inputs       : op        : The name of the function (which includes the data type)
+     *
+     * Outputs      : A reference to the choices of the function
+     * ======================================================================================================
+     */
+    KernelChoices& choices( const std::string& op ) {
+        std::lock_guard<std::mutex> lock( mutex );
+        return choicesOf( op );
+    }
+
+    /*
+     * ======================================================================================================
+     * Function     : select
+     *
+     * Description  : Gets the variant of a function to use for N elements, running the benchmarks if there
+     *                is no choice for the bucket of N yet (and no other thread is running them)
+     *
+     * Inputs       : choices       : The choices of the function (see choices())
+     *              : N             : The number of elements the function is called with
+     *              : accelerator   : If the function has an ACCELERATOR variant which can be used
+     *              : bench         : A function of ( variant, n ) which runs the variant on n elements
+     *
+     * Outputs      : The variant to use
+     *
+     * Params       : Bench         : The type of the benchmark function
+     * ======================================================================================================
+     */
+    template <typename Bench>
+    kernelVariant select( KernelChoices& choices, size_t N, bool accelerator, Bench bench ) {
+        const size_t b      = std::min( bucket( N ), maxBenchmarkBucket() );
+        int          chosen = choices.variants[ b ].load( std::memory_order_acquire );
+        if ( chosen >= 0 ) return static_cast<kernelVariant>( chosen );
+
+        chosen = KernelChoices::unchosen;
+        if ( !tuning || !choices.variants[ b ].compare_exchange_strong( chosen, KernelChoices::benchmarking ) ) {
+            return N >= cpu::detail::mathParallelSize() ? SIMD_PARALLEL : SIMD_SERIAL;
+        }
+
+        const size_t  n          = size_t( 1 ) << b;
+        const int     candidates = accelerator ? ACCELERATOR + 1 : ACCELERATOR;
+        double        best_time  = std::numeric_limits<double>::max();
+        kernelVariant variant    = SIMD_SERIAL;
+        for ( int v = SCALAR_SERIAL; v < candidates; v++ ) {
+            bench( static_cast<kernelVariant>( v ), n );                // Warm up (and allocate)
+            double time = std::numeric_limits<double>::max();
+            for ( int rep = 0; rep < 3; rep++ ) {
+                const auto start = std::chrono::steady_clock::now();
+                bench( static_cast<kernelVariant>( v ), n );
+                time = std::min( time, std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() );
+            }
+            if ( time < best_time ) { best_time = time; variant = static_cast<kernelVariant>( v ); }
+        }
+        choices.variants[ b ].store( variant, std::memory_order_release );
+        changed = true;
+        return variant;
+    }
+
+    // Gets the variant of a function by name (which looks up its choices, see above)
+    template <typename Bench>
+    kernelVariant select( const std::string& op, size_t N, bool accelerator, Bench bench ) {
+        return select( choices( op ), N, accelerator, bench );
+    }
+
+    /*
+     * ======================================================================================================
+     * Function     : lookup
+     *
+     * Description  : Gets the variant which has been chosen for a function and bucket
+     *
+     * Inputs       : op        : The name of the function
+     *              : b         : The bucket
+     *
+     * Outputs      : variant   : The variant, if there is one
+     *              : If there is a variant for the function and bucket
+     * ======================================================================================================
+     */
+    bool lookup( const std::string& op, size_t b, kernelVariant& variant ) {
+        const int chosen = choices( op ).variants[ std::min( b, maxBenchmarkBucket() ) ].load();
+        if ( chosen < 0 ) return false;
+        variant = static_cast<kernelVariant>( chosen );
+        return true;
+    }
+
+    /*
+     * ======================================================================================================
+     * Function     : record
+     *
+     * Description  : Sets the variant to use for a function and bucket (which replaces a previous choice).
+     *                The choice is written to the tuning file by the next save().
+     *
+     * Inputs       : op        : The name of the function
+     *              : b         : The bucket
+     *              : variant   : The variant to use
+     * ======================================================================================================
+     */
+    void record( const std::string& op, size_t b, kernelVariant variant ) {
+        choices( op ).variants[ std::min( b, maxBenchmarkBucket() ) ].store( variant );
+        changed = true;
+    }
+
+    // Removes all the choices (but not the tuning file)
+    void clear() {
+        std::lock_guard<std::mutex> lock( mutex );
+        for ( auto& op : ops ) op.second->clear();
+    }
+
+    // Turns the benchmarks on or off (see the notes above)
+    void setTuning( bool on ) { tuning = on; }
+
+    /*
+     * ======================================================================================================
+     * Function     : setFile
+     *
+     * Description  : Sets the file the choices are written to and reads the choices in it (if there are
+     *                any for this host), which replace the existing choices for the same functions and
+     *                buckets
+     *
+     * Inputs       : path      : The path of the file (empty to stop writing the choices)
+     * ======================================================================================================
+     */
+    void setFile( const std::string& path ) {
+        std::lock_guard<std::mutex> lock( mutex );
+        file = path;
+        if ( !file.empty() ) read( file );
+    }
+
+    // Writes the choices to the tuning file, if there is one and there are new choices
+    void save() {
+        std::lock_guard<std::mutex> lock( mutex );
+        if ( !file.empty() && changed.exchange( false ) ) write( file );
+    }
+
+    ~KernelSelector() { save(); }
+
+private:
+    typedef std::map<std::string, std::unique_ptr<KernelChoices>> op_map;
+
+    std::mutex          mutex;              // Protects ops and file
+    op_map              ops;                // Choices of each function, by name
+    std::string         file;               // The tuning file
+    std::atomic<bool>   tuning;             // If the benchmarks can run
+    std::atomic<bool>   changed;            // If there are choices which are not in the tuning file
+
+    KernelSelector() : tuning( true ), changed( false ) {
+        const char* on   = std::getenv( "FRNN_TUNING" );
+        const char* path = std::getenv( "FRNN_TUNING_FILE" );
+        if ( on != NULL && std::strcmp( on, "off" ) == 0 ) tuning = false;
+        if ( path != NULL ) setFile( path );
+    }
+
+    // Gets the choices of a function, creating them if there are none (the mutex must be held)
+    KernelChoices& choicesOf( const std::string& op ) {
+        std::unique_ptr<KernelChoices>& op_choices = ops[ op ];
+        if ( !op_choices ) op_choices.reset( new KernelChoices() );
+        return *op_choices;
+    }
+
+    // The first line of the tuning file, which identifies the host
+    static std::string hostLine() {
+        std::ostringstream line;
+        line << "frnn-kernels isa=" << cpu::supportedIsa() << " threads=" << omp_get_max_threads();
+        return line.str();
+    }
+
+    void read( const std::string& path ) {
+        std::ifstream in( path.c_str() );
+        std::string   line;
+        if ( !std::getline( in, line ) || line != hostLine() ) return;
+        std::string op; size_t b; int variant;
+        while ( in >> op >> b >> variant ) {
+            if ( variant >= SCALAR_SERIAL && variant <= ACCELERATOR && b <= maxBenchmarkBucket() ) {
+                choicesOf( op ).variants[ b ].store( variant );
+            }
+        }
+    }
+
+    void write( const std::string& path ) const {
+        std::ofstream out( path.c_str(), std::ios::trunc );
+        out << hostLine() << "\n";
+        for ( const auto& op : ops ) {
+            for ( size_t b = 0; b < KernelChoices::buckets; b++ ) {
+                const int variant = op.second->variants[ b ].load();
+                if ( variant >= 0 ) out << op.first << " " << b << " " << variant << "\n";
+            }
+        }
+    }
+};
+
+}   // Namespace frnn
+
+#endif
@@ -23,7 +23,9 @@
 
 // Other frnn types
 #include "vectorized_types_cpu.h"
+#ifndef FRNN_CPU_ONLY
 #include "vectorized_types_gpu.h"
+#endif
 
 // Change if necessary
 #define MAX_BLOCKS          65536
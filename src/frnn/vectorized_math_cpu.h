@@ -0,0 +1,418 @@
+/*
+ *  Header file for fastRNN CPU vectorized math functions, which are SIMD approximations of the
+ *  transcendental functions (exp, log, sigmoid and tanh) used by the activations and softmax, built on
+ *  the vectorized instructions so that they are compiled for each instruction set.
+ *
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FRNN_VECTORIZED_MATH_CPU_
+#define _FRNN_VECTORIZED_MATH_CPU_
+
+#include <algorithm>
+#include <limits>
+
+#include "vectorized_types_cpu.h"
+#include "elementwise_cpu.h"
+
+/*
+ * =========================================== NOTES ========================================================
+ *
+ * 1. exp reduces x to x = n * ln(2) + r with |r| <= ln(2) / 2, approximates exp(r) with a polynomial and
+ *    then scales by 2^n. log splits x into 2^e * m with m in [sqrt(0.5), sqrt(2)) and uses the series
+ *    log(m) = 2 * atanh(s), s = (m - 1) / (m + 1). sigmoid and tanh are computed from exp (tanh from
+ *    exp(x) - 1, so that there is no cancellation for small x).
+ *
+ * 2. There are two accuracy tiers, which use different polynomial degrees. The maximum errors (in units in
+ *    the last place, measured against the correctly rounded result over the whole input range for every
+ *    instruction set) are :
+ *
+ *                          float               double
+ *                      FAST    ACCURATE    FAST        ACCURATE
+ *          exp         40      2           1.8e6       2
+ *          log         44      1           1.3e7       1
+ *          sigmoid     40      3           1.8e6       3
+ *          tanh        110     4           4.8e6       3
+ *
+ *    (1.8e6 ulp for double is a relative error of about 4e-10, and 40 ulp for float about 5e-6). FAST is
+ *    intended for activations during training, where the error is far below the noise of the gradients.
+ *
+ * 3. Infinities and NaNs are handled (exp(-inf) = 0, log(0) = -inf, log(x < 0) = NaN, NaN gives NaN), and
+ *    so are denormal inputs and outputs.
+ *
+ * 4. The functions are force inlined and use the vectorized instructions for a single instruction set, so
+ *    as for any other kernel they must be used inside a kernel which is called through cpu::dispatch.
+ *    The bulk functions at the end of the file (vexp, vlog, vsigmoid and vtanh) do the dispatch, through
+ *    the elementwise engine.
+ * ==========================================================================================================
+ */
+
+namespace frnn {
+
+/*
+ * ==========================================================================================================
+ * Enum         : accuracy
+ *
+ * Description  : Enumerator for the accuracy tiers of the vectorized math functions (see the notes above)
+ *
+ *                FAST      : Lower degree polynomials, for activations
+ *                ACCURATE  : Close to correctly rounded
+ * ==========================================================================================================
+ */
+enum accuracy : int {
+    FAST        = 0,
+    ACCURATE    = 1
+};
+
+namespace detail {
+
+/*
+ * ==========================================================================================================
+ * Struct       : MathConstantsCpu
+ *
+ * Description  : The constants for the vectorized math functions for a type and accuracy tier : the
+ *                degree of the exp polynomial, the number of terms in the log series, the split values of
+ *                ln(2) and the range of exp.
+ *
+ * Params       : dType     : The type of data
+ *              : acc       : The accuracy tier
+ * ==========================================================================================================
+ */
+template <typename dType, accuracy acc> struct MathConstantsCpu;
+
+template <accuracy acc> struct MathConstantsCpu<float, acc> {
+    static constexpr int    expDegree()     { return acc == FAST ? 5 : 7; }
+    static constexpr int    logTerms()      { return acc == FAST ? 2 : 4; }
+    static constexpr float  expLn2Hi()      { return 6.93359375e-1f; }          // Few bits, so n * hi is exact
+    static constexpr float  expLn2Lo()      { return -2.12194440e-4f; }
+    static constexpr float  logLn2Hi()      { return 6.9313812256e-1f; }
+    static constexpr float  logLn2Lo()      { return 9.0580006145e-6f; }
+    static constexpr float  expMin()        { return -103.972084f; }            // exp underflows to 0 below
+    static constexpr float  expMax()        { return 88.7228391f; }             // exp overflows to inf above
+    static constexpr float  tanhMax()       { return 20.0f; }                   // tanh(x / 2) rounds to 1 above
+    static constexpr float  denormalScale() { return 16777216.0f; }             // 2^24
+    static constexpr float  denormalExp()   { return 24.0f; }
+};
+
+template <accuracy acc> struct MathConstantsCpu<double, acc> {
+    static constexpr int    expDegree()     { return acc == FAST ? 8 : 13; }
+    static constexpr int    logTerms()      { return acc == FAST ? 4 : 10; }
+    static constexpr double expLn2Hi()      { return 6.93145751953125e-1; }
+    static constexpr double expLn2Lo()      { return 1.42860682030941723212e-6; }
+    static constexpr double logLn2Hi()      { return 6.93147180369123816490e-1; }
+    static constexpr double logLn2Lo()      { return 1.90821492927058770002e-10; }
+    static constexpr double expMin()        { return -745.13321910194122; }
+    static constexpr double expMax()        { return 709.782712893384; }
+    static constexpr double tanhMax()       { return 40.0; }
+    static constexpr double denormalScale() { return 18014398509481984.0; }     // 2^54
+    static constexpr double denormalExp()   { return 54.0; }
+};
+
+// 1 / k!, which the compiler folds since the polynomial loops have constant bounds
+template <typename dType> constexpr dType inverseFactorial( int k ) {
+    return k <= 1 ? dType( 1 ) : inverseFactorial<dType>( k - 1 ) / dType( k );
+}
+
+}   // Namespace detail
+
+/*
+ * ==========================================================================================================
+ * Struct       : VectorizedMathCpu
+ *
+ * Description  : Vectorized approximations of exp, expm1, log, sigmoid and tanh for an instruction set,
+ *                with the error bounds given in the notes above.
+ *
+ * Params       : dType     : The type of data (float or double)
+ *              : level     : The instruction set
+ *              : acc       : The accuracy tier
+ * ==========================================================================================================
+ */
+template <typename dType, isa level, accuracy acc = ACCURATE>
+struct VectorizedMathCpu {
+public:
+    typedef VectorizedInstructionsCpu<dType, level>     vect_ins;
+    typedef typename vect_ins::vect_type                vect_type;
+    typedef detail::MathConstantsCpu<dType, acc>        constants;
+
+    /*
+     * ======================================================================================================
+     * Function     : mm_exp_p
+     *
+     * Description  : Computes exp for each element of a vector
+     *
+     * Inputs       : x     : The vector to exponentiate
+     *
+     * Outputs      : The exponential of each element of x
+     * ======================================================================================================
+     */
+    FRNN_FORCE_INLINE static vect_type mm_exp_p( vect_type x ) {
+        vect_type n, q;
+        reduceExp( x, n, q );
+        vect_type result = vect_ins::mm_ldexp_p( vect_ins::mm_add_p( vect_ins::mm_set1( dType( 1 ) ), q ), n );
+        return handleExpRange( x, result, vect_ins::mm_zero() );
+    }
+
+    /*
+     * ======================================================================================================
+     * Function     : mm_expm1_p
+     *
+     * Description  : Computes exp - 1 for each element of a vector, without cancellation for small elements
+     *
+     * Inputs       : x     : The vector to exponentiate
+     *
+     * Outputs      : exp - 1 of each element of x
+     * ======================================================================================================
+     */
+    FRNN_FORCE_INLINE static vect_type mm_expm1_p( vect_type x ) {
+        const vect_type one = vect_ins::mm_set1( dType( 1 ) );
+        vect_type n, q;
+        reduceExp( x, n, q );
+        // 2^n * ( 1 + q ) - 1 = 2^n * q + ( 2^n - 1 ), where 2^n - 1 is exact when n is small
+        vect_type result = vect_ins::mm_add_p( vect_ins::mm_ldexp_p( q, n ),
+                                               vect_ins::mm_sub_p( vect_ins::mm_ldexp_p( one, n ), one ) );
+        return handleExpRange( x, result, vect_ins::mm_set1( dType( -1 ) ) );
+    }
+
+    /*
+     * ======================================================================================================
+     * Function     : mm_log_p
+     *
+     * Description  : Computes the natural logarithm of each element of a vector
+     *
+     * Inputs       : x     : The vector to compute the logarithm of
+     *
+     * Outputs      : The logarithm of each element of x
+     * ======================================================================================================
+     */
+    FRNN_FORCE_INLINE static vect_type mm_log_p( vect_type x ) {
+        const vect_type zero = vect_ins::mm_zero();
+        const vect_type one  = vect_ins::mm_set1( dType( 1 ) );
+        const vect_type half = vect_ins::mm_set1( dType( 0.5 ) );
+
+        // Scale denormals so that the exponent and mantissa can be read from the bits
+        const vect_type min_normal = vect_ins::mm_set1( std::numeric_limits<dType>::min() );
+        const auto      denormal   = vect_ins::mm_cmplt_p( x, min_normal );
+        const vect_type scale      = vect_ins::mm_set1( constants::denormalScale() );
+        const vect_type scaled     = vect_ins::mm_blend_p( x, vect_ins::mm_mul_p( x, scale ), denormal );
+        const vect_type shift      = vect_ins::mm_blend_p( zero, vect_ins::mm_set1( constants::denormalExp() ), denormal );
+        vect_type       e          = vect_ins::mm_sub_p( vect_ins::mm_getexp_p( scaled ), shift );
+        vect_type       m          = vect_ins::mm_getmant_p( scaled );
+
+        // Move m into [sqrt(0.5), sqrt(2))
+        const auto      big = vect_ins::mm_cmpgt_p( m, vect_ins::mm_set1( dType( 1.41421356237309504880 ) ) );
+        m = vect_ins::mm_blend_p( m, vect_ins::mm_mul_p( m, half ), big );
+        e = vect_ins::mm_blend_p( e, vect_ins::mm_add_p( e, one ), big );
+
+        // log(1 + f) = f - hfsq + s * ( hfsq + R ), R = 2 * ( z / 3 + z^2 / 5 + ... ), as in fdlibm
+        const vect_type f    = vect_ins::mm_sub_p( m, one );
+        const vect_type two  = vect_ins::mm_set1( dType( 2 ) );
+        const vect_type s    = vect_ins::mm_div_p( f, vect_ins::mm_add_p( f, two ) );
+        const vect_type z    = vect_ins::mm_mul_p( s, s );
+        const vect_type hfsq = vect_ins::mm_mul_p( half, vect_ins::mm_mul_p( f, f ) );
+        vect_type       R    = vect_ins::mm_set1( dType( 2 ) / dType( 2 * constants::logTerms() + 1 ) );
+        for ( int k = constants::logTerms() - 1; k >= 1; k-- ) {
+            R = vect_ins::mm_fmadd_p( R, z, vect_ins::mm_set1( dType( 2 ) / dType( 2 * k + 1 ) ) );
+        }
+        R = vect_ins::mm_mul_p( R, z );
+
+        // e * ln2_hi - ( ( hfsq - ( s * ( hfsq + R ) + e * ln2_lo ) ) - f )
+        const vect_type low    = vect_ins::mm_fmadd_p( e, vect_ins::mm_set1( constants::logLn2Lo() ),
+                                                       vect_ins::mm_mul_p( s, vect_ins::mm_add_p( hfsq, R ) ) );
+        vect_type       result = vect_ins::mm_fmadd_p( e, vect_ins::mm_set1( constants::logLn2Hi() ),
+                                    vect_ins::mm_sub_p( f, vect_ins::mm_sub_p( hfsq, low ) ) );
+
+        // log(0) = -inf, log(x < 0) = NaN, log(inf) = inf, log(NaN) = NaN
+        result = vect_ins::mm_blend_p( result, vect_ins::mm_set1( -std::numeric_limits<dType>::infinity() ),
+                                       vect_ins::mm_cmpeq_p( x, zero ) );
+        result = vect_ins::mm_blend_p( result, vect_ins::mm_set1( std::numeric_limits<dType>::quiet_NaN() ),
+                                       vect_ins::mm_cmplt_p( x, zero ) );
+        result = vect_ins::mm_blend_p( result, x,
+                    vect_ins::mm_cmpeq_p( x, vect_ins::mm_set1( std::numeric_limits<dType>::infinity() ) ) );
+        return vect_ins::mm_blend_p( x, result, vect_ins::mm_cmpeq_p( x, x ) );
+    }
+
+    /*
+     * ======================================================================================================
+     * Function     : mm_sigmoid_p
+     *
+     * Description  : Computes the sigmoid, 1 / ( 1 + exp( -x ) ), of each element of a vector, using
+     *                exp( x ) / ( 1 + exp( x ) ) for negative x so that small results do not underflow early
+     *
+     * Inputs       : x     : The vector to compute the sigmoid of
+     *
+     * Outputs      : The sigmoid of each element of x
+     * ======================================================================================================
+     */
+    FRNN_FORCE_INLINE static vect_type mm_sigmoid_p( vect_type x ) {
+        const vect_type zero     = vect_ins::mm_zero();
+        const vect_type one      = vect_ins::mm_set1( dType( 1 ) );
+        const auto      negative = vect_ins::mm_cmplt_p( x, zero );
+        const vect_type absolute = vect_ins::mm_max_p( x, vect_ins::mm_sub_p( zero, x ) );
+        const vect_type e        = mm_exp_p( vect_ins::mm_sub_p( zero, absolute ) );
+        return vect_ins::mm_div_p( vect_ins::mm_blend_p( one, e, negative ), vect_ins::mm_add_p( one, e ) );
+    }
+
+    /*
+     * ======================================================================================================
+     * Function     : mm_tanh_p
+     *
+     * Description  : Computes tanh of each element of a vector, as expm1( 2|x| ) / ( expm1( 2|x| ) + 2 ) with
+     *                the sign of x
+     *
+     * Inputs       : x     : The vector to compute tanh of
+     *
+     * Outputs      : tanh of each element of x
+     * ======================================================================================================
+     */
+    FRNN_FORCE_INLINE static vect_type mm_tanh_p( vect_type x ) {
+        const vect_type zero     = vect_ins::mm_zero();
+        const auto      negative = vect_ins::mm_cmplt_p( x, zero );
+        const vect_type absolute = vect_ins::mm_max_p( x, vect_ins::mm_sub_p( zero, x ) );
+        const vect_type twice    = vect_ins::mm_min_p( vect_ins::mm_add_p( absolute, absolute ),
+                                                       vect_ins::mm_set1( constants::tanhMax() ) );
+        const vect_type em1      = mm_expm1_p( twice );
+        const vect_type two      = vect_ins::mm_set1( dType( 2 ) );
+        vect_type       result   = vect_ins::mm_div_p( em1, vect_ins::mm_add_p( em1, two ) );
+
+        result = vect_ins::mm_blend_p( result, vect_ins::mm_sub_p( zero, result ), negative );
+        return vect_ins::mm_blend_p( x, result, vect_ins::mm_cmpeq_p( x, x ) );
+    }
+
+private:
+    /*
+     * ======================================================================================================
+     * Function     : reduceExp
+     *
+     * Description  : Reduces x so that exp( x ) = 2^n * ( 1 + q ), where q = exp( r ) - 1 is given by the
+     *                polynomial r + r^2 / 2! + ... for r = x - n * ln(2)
+     *
+     * Inputs       : x     : The vector to exponentiate
+     *
+     * Outputs      : n     : The power of 2 for each element
+     *              : q     : exp( r ) - 1 for each element
+     * ======================================================================================================
+     */
+    FRNN_FORCE_INLINE static void reduceExp( vect_type x, vect_type& n, vect_type& q ) {
+        const vect_type lower   = vect_ins::mm_set1( constants::expMin() );
+        const vect_type upper   = vect_ins::mm_set1( constants::expMax() );
+        const vect_type clamped = vect_ins::mm_min_p( vect_ins::mm_max_p( x, lower ), upper );
+        const vect_type log2e   = vect_ins::mm_set1( dType( 1.44269504088896340736 ) );
+        n = vect_ins::mm_round_p( vect_ins::mm_mul_p( clamped, log2e ) );
+
+        vect_type r = vect_ins::mm_fmadd_p( n, vect_ins::mm_set1( -constants::expLn2Hi() ), clamped );
+        r           = vect_ins::mm_fmadd_p( n, vect_ins::mm_set1( -constants::expLn2Lo() ), r );
+
+        vect_type p = vect_ins::mm_set1( detail::inverseFactorial<dType>( constants::expDegree() ) );
+        for ( int k = constants::expDegree() - 1; k >= 1; k-- ) {
+            p = vect_ins::mm_fmadd_p( p, r, vect_ins::mm_set1( detail::inverseFactorial<dType>( k ) ) );
+        }
+        q = vect_ins::mm_mul_p( p, r );
+    }
+
+    /*
+     * ======================================================================================================
+     * Function     : handleExpRange
+     *
+     * Description  : Fixes the result of exp or expm1 for inputs outside the range which reduceExp handles,
+     *                and for NaN inputs
+     *
+     * Inputs       : x         : The input to exp or expm1
+     *              : result    : The result of the polynomial approximation
+     *              : lower     : The limit of the function as x tends to -inf
+     *
+     * Outputs      : The result with the out of range elements replaced
+     * ======================================================================================================
+     */
+    FRNN_FORCE_INLINE static vect_type handleExpRange( vect_type x, vect_type result, vect_type lower ) {
+        const vect_type below = vect_ins::mm_set1( constants::expMin() );
+        result = vect_ins::mm_blend_p( result, lower, vect_ins::mm_cmplt_p( x, below ) );
+        result = vect_ins::mm_blend_p( result, vect_ins::mm_set1( std::numeric_limits<dType>::infinity() ),
+                                       vect_ins::mm_cmpgt_p( x, vect_ins::mm_set1( constants::expMax() ) ) );
+        return vect_ins::mm_blend_p( x, result, vect_ins::mm_cmpeq_p( x, x ) );
+    }
+};
+
+namespace cpu    {
+namespace detail {
+
+// Operations for the bulk functions
+template <accuracy acc> struct ExpOp {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static typename VectorizedInstructionsCpu<dType, level>::vect_type
+    packet( const typename VectorizedInstructionsCpu<dType, level>::vect_type& x ) {
+        return VectorizedMathCpu<dType, level, acc>::mm_exp_p( x );
+    }
+};
+
+template <accuracy acc> struct LogOp {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static typename VectorizedInstructionsCpu<dType, level>::vect_type
+    packet( const typename VectorizedInstructionsCpu<dType, level>::vect_type& x ) {
+        return VectorizedMathCpu<dType, level, acc>::mm_log_p( x );
+    }
+};
+
+template <accuracy acc> struct SigmoidOp {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static typename VectorizedInstructionsCpu<dType, level>::vect_type
+    packet( const typename VectorizedInstructionsCpu<dType, level>::vect_type& x ) {
+        return VectorizedMathCpu<dType, level, acc>::mm_sigmoid_p( x );
+    }
+};
+
+template <accuracy acc> struct TanhOp {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static typename VectorizedInstructionsCpu<dType, level>::vect_type
+    packet( const typename VectorizedInstructionsCpu<dType, level>::vect_type& x ) {
+        return VectorizedMathCpu<dType, level, acc>::mm_tanh_p( x );
+    }
+};
+
+}   // Namespace detail
+
+/*
+ * ==========================================================================================================
+ * Function     : vexp, vlog, vsigmoid, vtanh
+ *
+ * Description  : Bulk versions of the vectorized math functions, which apply the function to each element
+ *                of an array using the widest instruction set which the host supports
+ *
+ * Inputs       : x     : The array to apply the function to
+ *              : N     : The number of elements in the array
+ *
+ * Outputs      : out   : The results (which may be x)
+ *
+ * Params       : acc   : The accuracy tier
+ *              : dType : The type of data in the arrays (float or double)
+ * ==========================================================================================================
+ */
+template <accuracy acc = ACCURATE, typename dType>
+void vexp( const dType* x, dType* out, size_t N ) { elementwise( detail::ExpOp<acc>(), out, N, x ); }
+
+template <accuracy acc = ACCURATE, typename dType>
+void vlog( const dType* x, dType* out, size_t N ) { elementwise( detail::LogOp<acc>(), out, N, x ); }
+
+template <accuracy acc = ACCURATE, typename dType>
+void vsigmoid( const dType* x, dType* out, size_t N ) { elementwise( detail::SigmoidOp<acc>(), out, N, x ); }
+
+template <accuracy acc = ACCURATE, typename dType>
+void vtanh( const dType* x, dType* out, size_t N ) { elementwise( detail::TanhOp<acc>(), out, N, x ); }
+
+}   // Namespace cpu
+}   // Namespace frnn
+
+#endif
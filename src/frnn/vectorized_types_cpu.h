@@ -26,7 +26,43 @@
 #ifndef _FRNN_VECTORIZED_TYPES_CPU_
 #define _FRNN_VECTORIZED_TYPES_CPU_
 
-#include <emmintrin.h>          // SSE vectorized types
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+#include "cpu_features.h"
+
+#if FRNN_X86
+#include <immintrin.h>          // SSE, AVX and AVX-512 vectorized types
+#endif
+
+/*
+ * =========================================== NOTES ========================================================
+ *
+ * 1. The vectorized types and instructions are given for each instruction set (isa), and SSE2 is used if
+ *    the instruction set is not given, so VectorizedInstructionsCpu<float> is the 128 bit version.
+ *
+ * 2. Kernels which should use the widest instruction set the host supports are written once, as a static
+ *    member function template (apply) of a struct which takes the instruction set as its first template
+ *    parameter, and are then called through cpu::dispatch, which picks the instruction set at runtime :
+ *
+ *      struct ScaleKernel {
+ *          template <frnn::isa level, typename dType>
+ *          FRNN_FORCE_INLINE static void apply( dType* x, size_t N, dType a ) {
+ *              typedef frnn::VectorizedInstructionsCpu<dType, level> vect_ins;
+ *              ...
+ *          }
+ *      };
+ *
+ *      frnn::cpu::dispatch<ScaleKernel>( x, N, a );
+ *
+ *    The kernel is compiled once for each instruction set, and vector types never cross the boundary of
+ *    the function compiled for an instruction set (which would change the ABI). The kernel must not use
+ *    OpenMP inside apply, since the outlined parallel region is not compiled for the instruction set,
+ *    rather the kernel should be dispatched from inside the parallel region.
+ *
+ * ==========================================================================================================
+ */
 
 namespace frnn {
     
@@ -34,68 +70,680 @@ namespace frnn {
  * ==========================================================================================================
  * Struct       : VectorizedTypeCpu
  * 
- * Description  : Gets a vectorized (v4) version of a type for sse instructions.
+ * Description  : Gets a vectorized version of a type for an instruction set.
  * 
  * Params       : dType     : The type of data (float, double, int )
+ *              : level     : The instruction set (SSE2 by default)
  * 
- * Example      : Calling frnn::vectorizedTypeCpu<float>::vectType will then use the __m128 type
+ * Example      : Calling frnn::vectorizedTypeCpu<float>::vectType will then use the __m128 type, and 
+ *                frnn::vectorizedTypeCpu<float, frnn::AVX2>::vectType will use the __m256 type
  * ==========================================================================================================
  */
-template <typename dType> struct VectorizedTypeCpu;
+template <typename dType, isa level = SSE2> struct VectorizedTypeCpu;
+
+template <typename dType> struct VectorizedTypeCpu<dType, SCALAR> { typedef dType vect_type; };
+
+#if FRNN_X86
+template <> struct VectorizedTypeCpu<int   , SSE2>   { typedef __m128i vect_type; };
+template <> struct VectorizedTypeCpu<char  , SSE2>   { typedef __m128i vect_type; };
+template <> struct VectorizedTypeCpu<float , SSE2>   { typedef __m128  vect_type; };
+template <> struct VectorizedTypeCpu<double, SSE2>   { typedef __m128d vect_type; };
+template <> struct VectorizedTypeCpu<float*, SSE2>   { typedef __m128* vect_type; };
 
-template <> struct VectorizedTypeCpu<int>    { typedef __m128i vect_type; };
-template <> struct VectorizedTypeCpu<char>   { typedef __m128i vect_type; };
-template <> struct VectorizedTypeCpu<float>  { typedef __m128  vect_type; };
-template <> struct VectorizedTypeCpu<double> { typedef __m128d vect_type; };
-template <> struct VectorizedTypeCpu<float*> { typedef __m128* vect_type; };
+template <> struct VectorizedTypeCpu<int   , AVX2>   { typedef __m256i vect_type; };
+template <> struct VectorizedTypeCpu<char  , AVX2>   { typedef __m256i vect_type; };
+template <> struct VectorizedTypeCpu<float , AVX2>   { typedef __m256  vect_type; };
+template <> struct VectorizedTypeCpu<double, AVX2>   { typedef __m256d vect_type; };
+
+template <> struct VectorizedTypeCpu<int   , AVX512> { typedef __m512i vect_type; };
+template <> struct VectorizedTypeCpu<char  , AVX512> { typedef __m512i vect_type; };
+template <> struct VectorizedTypeCpu<float , AVX512> { typedef __m512  vect_type; };
+template <> struct VectorizedTypeCpu<double, AVX512> { typedef __m512d vect_type; };
+#endif
 
 /*
  * ==========================================================================================================
  * Struct       : VectorizedInstructions 
  * 
- * Description  : Provides general names for the SIMD instructions for any type instance of the class. The
- *                function pointers allow the functions to be called without an instance of the struct
+ * Description  : Provides general names for the SIMD instructions for any type instance of the class, for
+ *                an instruction set. The functions are static so they can be called without an instance of 
+ *                the struct, and each is compiled for its instruction set so they must only be used from 
+ *                kernels which are dispatched for the same instruction set (see the notes above).
+ *
+ *                Every specification (float, double and int for each instruction set) provides :
+ *
+ *                vect_type, mask_type      : The vector type and the type of the result of a comparison
+ *                typeSize()                : The number of elements in a vector
+ *                mm_zero, mm_set1          : A vector of zeros, and a vector with every element set to a value
+ *                mm_load_u, mm_load_a      : Unaligned and aligned loads
+ *                mm_load_n                 : Loads the first n elements (the rest are zero), for loop tails
+ *                mm_store_u, mm_store_p    : Unaligned and aligned stores
+ *                mm_store_n                : Stores the first n elements, for loop tails
+ *                mm_stream_p, mm_fence     : Aligned store which bypasses the cache, and the fence which must 
+ *                                            follow a series of them before the data is read
+ *                mm_add_p, mm_sub_p        : Elementwise addition and subtraction
+ *                mm_mul_p, mm_div_p        : Elementwise multiplication and division (no division for int)
+ *                mm_fmadd_p                : a * b + c (fused when the instruction set has FMA)
+ *                mm_max_p, mm_min_p        : Elementwise maximum and minimum
+ *                mm_cmplt_p, mm_cmpgt_p,   
+ *                mm_cmpeq_p                : Elementwise comparisons, giving a mask
+ *                mm_blend_p                : Selects the elements of b where the mask is set, otherwise a
+ *                mm_hsum, mm_hmax          : The sum and the maximum of the elements of a vector
+ *
+ *                and float and double additionally provide the building blocks for the functions in
+ *                vectorized_math_cpu.h :
+ *
+ *                mm_round_p                : Rounds to the nearest integer (for |a| < 2^31)
+ *                mm_ldexp_p                : a * 2^n, where n holds integers (for |n| < 2^31, so the result
+ *                                            can be a denormal or infinity)
+ *                mm_getexp_p               : The exponent of a, floor( log2( a ) ), for normal a
+ *                mm_getmant_p              : The mantissa of a, in [1, 2), for positive normal a
  *                
  * Params       : dType     : The type of data 
+ *              : level     : The instruction set (SSE2 by default)
  * ==========================================================================================================
  */
+template <typename dType, isa level = SSE2> struct VectorizedInstructionsCpu;
 
-template <typename dType> struct VectorizedInstructionsCpu;
-
-// Size functions for float and double
+// Size functions for float and double (SSE2)
 constexpr size_t sizeFloatVectorized()  { return 4; }
 constexpr size_t sizeDoubleVectorized() { return 2; }
 
-// Float specification
-template <> struct VectorizedInstructionsCpu<float> {
+// Scalar specification, for hosts without SIMD instructions
+template <typename dType> struct VectorizedInstructionsCpu<dType, SCALAR> {
     
-    static constexpr auto typeSize = &sizeFloatVectorized;
+    typedef dType vect_type;
+    typedef bool  mask_type;
     
-    typedef __m128 (*load)( const float* );
-    static constexpr load mm_load_u = &_mm_loadu_ps;
+    static constexpr size_t typeSize() { return 1; }
     
-    typedef __m128 (*sub)( __m128, __m128 );
-    static constexpr sub mm_sub_p = &_mm_sub_ps;
+    static dType mm_zero()                                          { return dType( 0 ); }
+    static dType mm_set1( dType a )                                 { return a; }
+    static dType mm_load_u( const dType* x )                        { return *x; }
+    static dType mm_load_a( const dType* x )                        { return *x; }
+    static dType mm_load_n( const dType* x, size_t n )              { return n > 0 ? *x : dType( 0 ); }
+    static void  mm_store_u( dType* x, dType a )                    { *x = a; }
+    static void  mm_store_p( dType* x, dType a )                    { *x = a; }
+    static void  mm_stream_p( dType* x, dType a )                   { *x = a; }
+    static void  mm_fence()                                         {}
+    static void  mm_store_n( dType* x, dType a, size_t n )          { if ( n > 0 ) *x = a; }
+    static dType mm_add_p( dType a, dType b )                       { return a + b; }
+    static dType mm_sub_p( dType a, dType b )                       { return a - b; }
+    static dType mm_mul_p( dType a, dType b )                       { return a * b; }
+    static dType mm_div_p( dType a, dType b )                       { return a / b; }
+    static dType mm_fmadd_p( dType a, dType b, dType c )            { return a * b + c; }
+    static dType mm_max_p( dType a, dType b )                       { return a > b ? a : b; }
+    static dType mm_min_p( dType a, dType b )                       { return a < b ? a : b; }
+    static bool  mm_cmplt_p( dType a, dType b )                     { return a < b; }
+    static bool  mm_cmpgt_p( dType a, dType b )                     { return a > b; }
+    static bool  mm_cmpeq_p( dType a, dType b )                     { return a == b; }
+    static dType mm_blend_p( dType a, dType b, bool mask )          { return mask ? b : a; }
+    static dType mm_hsum( dType a )                                 { return a; }
+    static dType mm_hmax( dType a )                                 { return a; }
+    static dType mm_round_p( dType a )                              { return std::nearbyint( a ); }
+    static dType mm_ldexp_p( dType a, dType n )                     { return std::ldexp( a, static_cast<int>( n ) ); }
+    static dType mm_getexp_p( dType a )                             { return dType( std::ilogb( a ) ); }
+    static dType mm_getmant_p( dType a )                            { return std::ldexp( a, -std::ilogb( a ) ); }
+};
+
+#if FRNN_X86
+
+// Float specification
+template <> struct VectorizedInstructionsCpu<float, SSE2> {
+    
+    typedef __m128 vect_type;
+    typedef __m128 mask_type;
+    
+    static constexpr size_t typeSize() { return sizeFloatVectorized(); }
     
-    typedef void (*store)( float*, __m128 );
-    static constexpr store mm_store_p = &_mm_store_ps;
+    FRNN_TARGET_SSE2 static __m128 mm_zero()                                { return _mm_setzero_ps(); }
+    FRNN_TARGET_SSE2 static __m128 mm_set1( float a )                       { return _mm_set1_ps( a ); }
+    FRNN_TARGET_SSE2 static __m128 mm_load_u( const float* x )              { return _mm_loadu_ps( x ); }
+    FRNN_TARGET_SSE2 static __m128 mm_load_a( const float* x )              { return _mm_load_ps( x ); }
+    FRNN_TARGET_SSE2 static __m128 mm_load_n( const float* x, size_t n ) {
+        float part[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for ( size_t i = 0; i < n && i < 4; i++ ) part[ i ] = x[ i ];
+        return _mm_loadu_ps( part );
+    }
+    FRNN_TARGET_SSE2 static void   mm_store_u( float* x, __m128 a )         { _mm_storeu_ps( x, a ); }
+    FRNN_TARGET_SSE2 static void   mm_store_p( float* x, __m128 a )         { _mm_store_ps( x, a ); }
+    FRNN_TARGET_SSE2 static void   mm_stream_p( float* x, __m128 a )        { _mm_stream_ps( x, a ); }
+    FRNN_TARGET_SSE2 static void   mm_fence()                               { _mm_sfence(); }
+    FRNN_TARGET_SSE2 static void   mm_store_n( float* x, __m128 a, size_t n ) {
+        float part[ 4 ];
+        _mm_storeu_ps( part, a );
+        for ( size_t i = 0; i < n && i < 4; i++ ) x[ i ] = part[ i ];
+    }
+    FRNN_TARGET_SSE2 static __m128 mm_add_p( __m128 a, __m128 b )           { return _mm_add_ps( a, b ); }
+    FRNN_TARGET_SSE2 static __m128 mm_sub_p( __m128 a, __m128 b )           { return _mm_sub_ps( a, b ); }
+    FRNN_TARGET_SSE2 static __m128 mm_mul_p( __m128 a, __m128 b )           { return _mm_mul_ps( a, b ); }
+    FRNN_TARGET_SSE2 static __m128 mm_div_p( __m128 a, __m128 b )           { return _mm_div_ps( a, b ); }
+    FRNN_TARGET_SSE2 static __m128 mm_fmadd_p( __m128 a, __m128 b, __m128 c ) { return _mm_add_ps( _mm_mul_ps( a, b ), c ); }
+    FRNN_TARGET_SSE2 static __m128 mm_max_p( __m128 a, __m128 b )           { return _mm_max_ps( a, b ); }
+    FRNN_TARGET_SSE2 static __m128 mm_min_p( __m128 a, __m128 b )           { return _mm_min_ps( a, b ); }
+    FRNN_TARGET_SSE2 static __m128 mm_cmplt_p( __m128 a, __m128 b )         { return _mm_cmplt_ps( a, b ); }
+    FRNN_TARGET_SSE2 static __m128 mm_cmpgt_p( __m128 a, __m128 b )         { return _mm_cmpgt_ps( a, b ); }
+    FRNN_TARGET_SSE2 static __m128 mm_cmpeq_p( __m128 a, __m128 b )         { return _mm_cmpeq_ps( a, b ); }
+    FRNN_TARGET_SSE2 static __m128 mm_blend_p( __m128 a, __m128 b, __m128 mask ) {
+        return _mm_or_ps( _mm_and_ps( mask, b ), _mm_andnot_ps( mask, a ) );
+    }
+    FRNN_TARGET_SSE2 static float  mm_hsum( __m128 a ) {
+        a = _mm_add_ps( a, _mm_movehl_ps( a, a ) );
+        return _mm_cvtss_f32( _mm_add_ss( a, _mm_shuffle_ps( a, a, 1 ) ) );
+    }
+    FRNN_TARGET_SSE2 static float  mm_hmax( __m128 a ) {
+        a = _mm_max_ps( a, _mm_movehl_ps( a, a ) );
+        return _mm_cvtss_f32( _mm_max_ss( a, _mm_shuffle_ps( a, a, 1 ) ) );
+    }
+    FRNN_TARGET_SSE2 static __m128 mm_round_p( __m128 a )                   { return _mm_cvtepi32_ps( _mm_cvtps_epi32( a ) ); }
+    FRNN_TARGET_SSE2 static __m128 mm_ldexp_p( __m128 a, __m128 n ) {       // Two steps, so 2^n need not be normal
+        const __m128i n_int  = _mm_cvtps_epi32( n );
+        const __m128i n_half = _mm_srai_epi32( n_int, 1 );
+        return _mm_mul_ps( _mm_mul_ps( a, pow2( n_half ) ), pow2( _mm_sub_epi32( n_int, n_half ) ) );
+    }
+    FRNN_TARGET_SSE2 static __m128 mm_getexp_p( __m128 a ) {
+        const __m128i biased = _mm_and_si128( _mm_srli_epi32( _mm_castps_si128( a ), 23 ), _mm_set1_epi32( 0xFF ) );
+        return _mm_cvtepi32_ps( _mm_sub_epi32( biased, _mm_set1_epi32( 127 ) ) );
+    }
+    FRNN_TARGET_SSE2 static __m128 mm_getmant_p( __m128 a ) {
+        return _mm_castsi128_ps( _mm_or_si128( _mm_and_si128( _mm_castps_si128( a ), _mm_set1_epi32( 0x007FFFFF ) ),
+                                               _mm_set1_epi32( 0x3F800000 )                                      ) );
+    }
+private:
+    // 2^n for integers n in the normal exponent range
+    FRNN_TARGET_SSE2 static __m128 pow2( __m128i n ) {
+        return _mm_castsi128_ps( _mm_slli_epi32( _mm_add_epi32( n, _mm_set1_epi32( 127 ) ), 23 ) );
+    }
 };
 
 // Double specification
-template <> struct VectorizedInstructionsCpu<double> {
+template <> struct VectorizedInstructionsCpu<double, SSE2> {
    
-    static constexpr auto typeSize = &sizeDoubleVectorized;
+    typedef __m128d vect_type;
+    typedef __m128d mask_type;
+    
+    static constexpr size_t typeSize() { return sizeDoubleVectorized(); }
+
+    FRNN_TARGET_SSE2 static __m128d mm_zero()                               { return _mm_setzero_pd(); }
+    FRNN_TARGET_SSE2 static __m128d mm_set1( double a )                     { return _mm_set1_pd( a ); }
+    FRNN_TARGET_SSE2 static __m128d mm_load_u( const double* x )            { return _mm_loadu_pd( x ); }
+    FRNN_TARGET_SSE2 static __m128d mm_load_a( const double* x )            { return _mm_load_pd( x ); }
+    FRNN_TARGET_SSE2 static __m128d mm_load_n( const double* x, size_t n ) {
+        return n >= 2 ? _mm_loadu_pd( x ) : n == 1 ? _mm_load_sd( x ) : _mm_setzero_pd();
+    }
+    FRNN_TARGET_SSE2 static void    mm_store_u( double* x, __m128d a )      { _mm_storeu_pd( x, a ); }
+    FRNN_TARGET_SSE2 static void    mm_store_p( double* x, __m128d a )      { _mm_store_pd( x, a ); }
+    FRNN_TARGET_SSE2 static void    mm_stream_p( double* x, __m128d a )     { _mm_stream_pd( x, a ); }
+    FRNN_TARGET_SSE2 static void    mm_fence()                              { _mm_sfence(); }
+    FRNN_TARGET_SSE2 static void    mm_store_n( double* x, __m128d a, size_t n ) {
+        if      ( n >= 2 ) _mm_storeu_pd( x, a );
+        else if ( n == 1 ) _mm_store_sd( x, a );
+    }
+    FRNN_TARGET_SSE2 static __m128d mm_add_p( __m128d a, __m128d b )        { return _mm_add_pd( a, b ); }
+    FRNN_TARGET_SSE2 static __m128d mm_sub_p( __m128d a, __m128d b )        { return _mm_sub_pd( a, b ); }
+    FRNN_TARGET_SSE2 static __m128d mm_mul_p( __m128d a, __m128d b )        { return _mm_mul_pd( a, b ); }
+    FRNN_TARGET_SSE2 static __m128d mm_div_p( __m128d a, __m128d b )        { return _mm_div_pd( a, b ); }
+    FRNN_TARGET_SSE2 static __m128d mm_fmadd_p( __m128d a, __m128d b, __m128d c ) { return _mm_add_pd( _mm_mul_pd( a, b ), c ); }
+    FRNN_TARGET_SSE2 static __m128d mm_max_p( __m128d a, __m128d b )        { return _mm_max_pd( a, b ); }
+    FRNN_TARGET_SSE2 static __m128d mm_min_p( __m128d a, __m128d b )        { return _mm_min_pd( a, b ); }
+    FRNN_TARGET_SSE2 static __m128d mm_cmplt_p( __m128d a, __m128d b )      { return _mm_cmplt_pd( a, b ); }
+    FRNN_TARGET_SSE2 static __m128d mm_cmpgt_p( __m128d a, __m128d b )      { return _mm_cmpgt_pd( a, b ); }
+    FRNN_TARGET_SSE2 static __m128d mm_cmpeq_p( __m128d a, __m128d b )      { return _mm_cmpeq_pd( a, b ); }
+    FRNN_TARGET_SSE2 static __m128d mm_blend_p( __m128d a, __m128d b, __m128d mask ) {
+        return _mm_or_pd( _mm_and_pd( mask, b ), _mm_andnot_pd( mask, a ) );
+    }
+    FRNN_TARGET_SSE2 static double  mm_hsum( __m128d a ) { return _mm_cvtsd_f64( _mm_add_sd( a, _mm_unpackhi_pd( a, a ) ) ); }
+    FRNN_TARGET_SSE2 static double  mm_hmax( __m128d a ) { return _mm_cvtsd_f64( _mm_max_sd( a, _mm_unpackhi_pd( a, a ) ) ); }
+    FRNN_TARGET_SSE2 static __m128d mm_round_p( __m128d a )                 { return _mm_cvtepi32_pd( _mm_cvtpd_epi32( a ) ); }
+    FRNN_TARGET_SSE2 static __m128d mm_ldexp_p( __m128d a, __m128d n ) {    // Two steps, so 2^n need not be normal
+        const __m128i n_int  = _mm_cvtpd_epi32( n );
+        const __m128i n_half = _mm_srai_epi32( n_int, 1 );
+        return _mm_mul_pd( _mm_mul_pd( a, pow2( n_half ) ), pow2( _mm_sub_epi32( n_int, n_half ) ) );
+    }
+    FRNN_TARGET_SSE2 static __m128d mm_getexp_p( __m128d a ) {
+        const __m128i biased = _mm_and_si128( _mm_srli_epi64( _mm_castpd_si128( a ), 52 ), _mm_set1_epi64x( 0x7FF ) );
+        const __m128i packed = _mm_shuffle_epi32( biased, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        return _mm_cvtepi32_pd( _mm_sub_epi32( packed, _mm_set1_epi32( 1023 ) ) );
+    }
+    FRNN_TARGET_SSE2 static __m128d mm_getmant_p( __m128d a ) {
+        return _mm_castsi128_pd( _mm_or_si128( _mm_and_si128( _mm_castpd_si128( a ), 
+                                                              _mm_set1_epi64x( 0x000FFFFFFFFFFFFFll ) ),
+                                               _mm_set1_epi64x( 0x3FF0000000000000ll )                    ) );
+    }
+private:
+    // 2^n for integers n (in the low two 32 bit elements) in the normal exponent range
+    FRNN_TARGET_SSE2 static __m128d pow2( __m128i n ) {
+        const __m128i biased = _mm_add_epi32( n, _mm_set1_epi32( 1023 ) );
+        return _mm_castsi128_pd( _mm_slli_epi64( _mm_unpacklo_epi32( _mm_setzero_si128(), biased ), 20 ) );
+    }
+};
+
+// Int specification
+template <> struct VectorizedInstructionsCpu<int, SSE2> {
+    
+    typedef __m128i vect_type;
+    typedef __m128i mask_type;
+    
+    static constexpr size_t typeSize() { return 4; }
+    
+    FRNN_TARGET_SSE2 static __m128i mm_zero()                               { return _mm_setzero_si128(); }
+    FRNN_TARGET_SSE2 static __m128i mm_set1( int a )                        { return _mm_set1_epi32( a ); }
+    FRNN_TARGET_SSE2 static __m128i mm_load_u( const int* x )               { return _mm_loadu_si128( reinterpret_cast<const __m128i*>( x ) ); }
+    FRNN_TARGET_SSE2 static __m128i mm_load_a( const int* x )               { return _mm_load_si128( reinterpret_cast<const __m128i*>( x ) ); }
+    FRNN_TARGET_SSE2 static __m128i mm_load_n( const int* x, size_t n ) {
+        int part[ 4 ] = { 0, 0, 0, 0 };
+        for ( size_t i = 0; i < n && i < 4; i++ ) part[ i ] = x[ i ];
+        return mm_load_u( part );
+    }
+    FRNN_TARGET_SSE2 static void    mm_store_u( int* x, __m128i a )         { _mm_storeu_si128( reinterpret_cast<__m128i*>( x ), a ); }
+    FRNN_TARGET_SSE2 static void    mm_store_p( int* x, __m128i a )         { _mm_store_si128( reinterpret_cast<__m128i*>( x ), a ); }
+    FRNN_TARGET_SSE2 static void    mm_stream_p( int* x, __m128i a )        { _mm_stream_si128( reinterpret_cast<__m128i*>( x ), a ); }
+    FRNN_TARGET_SSE2 static void    mm_fence()                              { _mm_sfence(); }
+    FRNN_TARGET_SSE2 static void    mm_store_n( int* x, __m128i a, size_t n ) {
+        int part[ 4 ];
+        mm_store_u( part, a );
+        for ( size_t i = 0; i < n && i < 4; i++ ) x[ i ] = part[ i ];
+    }
+    FRNN_TARGET_SSE2 static __m128i mm_add_p( __m128i a, __m128i b )        { return _mm_add_epi32( a, b ); }
+    FRNN_TARGET_SSE2 static __m128i mm_sub_p( __m128i a, __m128i b )        { return _mm_sub_epi32( a, b ); }
+    FRNN_TARGET_SSE2 static __m128i mm_mul_p( __m128i a, __m128i b ) {      // No 32 bit multiply in SSE2
+        const __m128i even = _mm_mul_epu32( a, b );
+        const __m128i odd  = _mm_mul_epu32( _mm_srli_si128( a, 4 ), _mm_srli_si128( b, 4 ) );
+        return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+                                   _mm_shuffle_epi32( odd , _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+    }
+    FRNN_TARGET_SSE2 static __m128i mm_fmadd_p( __m128i a, __m128i b, __m128i c ) { return _mm_add_epi32( mm_mul_p( a, b ), c ); }
+    FRNN_TARGET_SSE2 static __m128i mm_cmplt_p( __m128i a, __m128i b )      { return _mm_cmplt_epi32( a, b ); }
+    FRNN_TARGET_SSE2 static __m128i mm_cmpgt_p( __m128i a, __m128i b )      { return _mm_cmpgt_epi32( a, b ); }
+    FRNN_TARGET_SSE2 static __m128i mm_cmpeq_p( __m128i a, __m128i b )      { return _mm_cmpeq_epi32( a, b ); }
+    FRNN_TARGET_SSE2 static __m128i mm_blend_p( __m128i a, __m128i b, __m128i mask ) {
+        return _mm_or_si128( _mm_and_si128( mask, b ), _mm_andnot_si128( mask, a ) );
+    }
+    FRNN_TARGET_SSE2 static __m128i mm_max_p( __m128i a, __m128i b )        { return mm_blend_p( b, a, _mm_cmpgt_epi32( a, b ) ); }
+    FRNN_TARGET_SSE2 static __m128i mm_min_p( __m128i a, __m128i b )        { return mm_blend_p( b, a, _mm_cmplt_epi32( a, b ) ); }
+    FRNN_TARGET_SSE2 static int     mm_hsum( __m128i a ) {
+        a = _mm_add_epi32( a, _mm_shuffle_epi32( a, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+        return _mm_cvtsi128_si32( _mm_add_epi32( a, _mm_shuffle_epi32( a, _MM_SHUFFLE( 2, 3, 0, 1 ) ) ) );
+    }
+    FRNN_TARGET_SSE2 static int     mm_hmax( __m128i a ) {
+        a = mm_max_p( a, _mm_shuffle_epi32( a, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+        return _mm_cvtsi128_si32( mm_max_p( a, _mm_shuffle_epi32( a, _MM_SHUFFLE( 2, 3, 0, 1 ) ) ) );
+    }
+};
+
+// Float AVX2 specification
+template <> struct VectorizedInstructionsCpu<float, AVX2> {
+    
+    typedef __m256 vect_type;
+    typedef __m256 mask_type;
+    
+    static constexpr size_t typeSize() { return 8; }
+    
+    FRNN_TARGET_AVX2 static __m256 mm_zero()                                { return _mm256_setzero_ps(); }
+    FRNN_TARGET_AVX2 static __m256 mm_set1( float a )                       { return _mm256_set1_ps( a ); }
+    FRNN_TARGET_AVX2 static __m256 mm_load_u( const float* x )              { return _mm256_loadu_ps( x ); }
+    FRNN_TARGET_AVX2 static __m256 mm_load_a( const float* x )              { return _mm256_load_ps( x ); }
+    FRNN_TARGET_AVX2 static __m256 mm_load_n( const float* x, size_t n )    { return _mm256_maskload_ps( x, countMask( n ) ); }
+    FRNN_TARGET_AVX2 static void   mm_store_u( float* x, __m256 a )         { _mm256_storeu_ps( x, a ); }
+    FRNN_TARGET_AVX2 static void   mm_store_p( float* x, __m256 a )         { _mm256_store_ps( x, a ); }
+    FRNN_TARGET_AVX2 static void   mm_stream_p( float* x, __m256 a )        { _mm256_stream_ps( x, a ); }
+    FRNN_TARGET_AVX2 static void   mm_fence()                               { _mm_sfence(); }
+    FRNN_TARGET_AVX2 static void   mm_store_n( float* x, __m256 a, size_t n ) { _mm256_maskstore_ps( x, countMask( n ), a ); }
+    FRNN_TARGET_AVX2 static __m256 mm_add_p( __m256 a, __m256 b )           { return _mm256_add_ps( a, b ); }
+    FRNN_TARGET_AVX2 static __m256 mm_sub_p( __m256 a, __m256 b )           { return _mm256_sub_ps( a, b ); }
+    FRNN_TARGET_AVX2 static __m256 mm_mul_p( __m256 a, __m256 b )           { return _mm256_mul_ps( a, b ); }
+    FRNN_TARGET_AVX2 static __m256 mm_div_p( __m256 a, __m256 b )           { return _mm256_div_ps( a, b ); }
+    FRNN_TARGET_AVX2 static __m256 mm_fmadd_p( __m256 a, __m256 b, __m256 c ) { return _mm256_fmadd_ps( a, b, c ); }
+    FRNN_TARGET_AVX2 static __m256 mm_max_p( __m256 a, __m256 b )           { return _mm256_max_ps( a, b ); }
+    FRNN_TARGET_AVX2 static __m256 mm_min_p( __m256 a, __m256 b )           { return _mm256_min_ps( a, b ); }
+    FRNN_TARGET_AVX2 static __m256 mm_cmplt_p( __m256 a, __m256 b )         { return _mm256_cmp_ps( a, b, _CMP_LT_OQ ); }
+    FRNN_TARGET_AVX2 static __m256 mm_cmpgt_p( __m256 a, __m256 b )         { return _mm256_cmp_ps( a, b, _CMP_GT_OQ ); }
+    FRNN_TARGET_AVX2 static __m256 mm_cmpeq_p( __m256 a, __m256 b )         { return _mm256_cmp_ps( a, b, _CMP_EQ_OQ ); }
+    FRNN_TARGET_AVX2 static __m256 mm_blend_p( __m256 a, __m256 b, __m256 mask ) { return _mm256_blendv_ps( a, b, mask ); }
+    FRNN_TARGET_AVX2 static float  mm_hsum( __m256 a ) {
+        return VectorizedInstructionsCpu<float, SSE2>::mm_hsum( _mm_add_ps( _mm256_castps256_ps128( a ), 
+                                                                            _mm256_extractf128_ps( a, 1 ) ) );
+    }
+    FRNN_TARGET_AVX2 static float  mm_hmax( __m256 a ) {
+        return VectorizedInstructionsCpu<float, SSE2>::mm_hmax( _mm_max_ps( _mm256_castps256_ps128( a ), 
+                                                                            _mm256_extractf128_ps( a, 1 ) ) );
+    }
+    FRNN_TARGET_AVX2 static __m256 mm_round_p( __m256 a )                   { return _mm256_round_ps( a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC ); }
+    FRNN_TARGET_AVX2 static __m256 mm_ldexp_p( __m256 a, __m256 n ) {       // Two steps, so 2^n need not be normal
+        const __m256i n_int  = _mm256_cvtps_epi32( n );
+        const __m256i n_half = _mm256_srai_epi32( n_int, 1 );
+        return _mm256_mul_ps( _mm256_mul_ps( a, pow2( n_half ) ), pow2( _mm256_sub_epi32( n_int, n_half ) ) );
+    }
+    FRNN_TARGET_AVX2 static __m256 mm_getexp_p( __m256 a ) {
+        const __m256i biased = _mm256_and_si256( _mm256_srli_epi32( _mm256_castps_si256( a ), 23 ), 
+                                                 _mm256_set1_epi32( 0xFF )                          );
+        return _mm256_cvtepi32_ps( _mm256_sub_epi32( biased, _mm256_set1_epi32( 127 ) ) );
+    }
+    FRNN_TARGET_AVX2 static __m256 mm_getmant_p( __m256 a ) {
+        return _mm256_castsi256_ps( _mm256_or_si256( _mm256_and_si256( _mm256_castps_si256( a ), 
+                                                                       _mm256_set1_epi32( 0x007FFFFF ) ),
+                                                     _mm256_set1_epi32( 0x3F800000 )                     ) );
+    }
+private:
+    // Mask which selects the first n elements
+    FRNN_TARGET_AVX2 static __m256i countMask( size_t n ) {
+        return _mm256_cmpgt_epi32( _mm256_set1_epi32( static_cast<int>( n < 8 ? n : 8 ) ),
+                                   _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 )              );
+    }
+    // 2^n for integers n in the normal exponent range
+    FRNN_TARGET_AVX2 static __m256 pow2( __m256i n ) {
+        return _mm256_castsi256_ps( _mm256_slli_epi32( _mm256_add_epi32( n, _mm256_set1_epi32( 127 ) ), 23 ) );
+    }
+};
+
+// Double AVX2 specification
+template <> struct VectorizedInstructionsCpu<double, AVX2> {
+    
+    typedef __m256d vect_type;
+    typedef __m256d mask_type;
+    
+    static constexpr size_t typeSize() { return 4; }
+    
+    FRNN_TARGET_AVX2 static __m256d mm_zero()                               { return _mm256_setzero_pd(); }
+    FRNN_TARGET_AVX2 static __m256d mm_set1( double a )                     { return _mm256_set1_pd( a ); }
+    FRNN_TARGET_AVX2 static __m256d mm_load_u( const double* x )            { return _mm256_loadu_pd( x ); }
+    FRNN_TARGET_AVX2 static __m256d mm_load_a( const double* x )            { return _mm256_load_pd( x ); }
+    FRNN_TARGET_AVX2 static __m256d mm_load_n( const double* x, size_t n )  { return _mm256_maskload_pd( x, countMask( n ) ); }
+    FRNN_TARGET_AVX2 static void    mm_store_u( double* x, __m256d a )      { _mm256_storeu_pd( x, a ); }
+    FRNN_TARGET_AVX2 static void    mm_store_p( double* x, __m256d a )      { _mm256_store_pd( x, a ); }
+    FRNN_TARGET_AVX2 static void    mm_stream_p( double* x, __m256d a )     { _mm256_stream_pd( x, a ); }
+    FRNN_TARGET_AVX2 static void    mm_fence()                              { _mm_sfence(); }
+    FRNN_TARGET_AVX2 static void    mm_store_n( double* x, __m256d a, size_t n ) { _mm256_maskstore_pd( x, countMask( n ), a ); }
+    FRNN_TARGET_AVX2 static __m256d mm_add_p( __m256d a, __m256d b )        { return _mm256_add_pd( a, b ); }
+    FRNN_TARGET_AVX2 static __m256d mm_sub_p( __m256d a, __m256d b )        { return _mm256_sub_pd( a, b ); }
+    FRNN_TARGET_AVX2 static __m256d mm_mul_p( __m256d a, __m256d b )        { return _mm256_mul_pd( a, b ); }
+    FRNN_TARGET_AVX2 static __m256d mm_div_p( __m256d a, __m256d b )        { return _mm256_div_pd( a, b ); }
+    FRNN_TARGET_AVX2 static __m256d mm_fmadd_p( __m256d a, __m256d b, __m256d c ) { return _mm256_fmadd_pd( a, b, c ); }
+    FRNN_TARGET_AVX2 static __m256d mm_max_p( __m256d a, __m256d b )        { return _mm256_max_pd( a, b ); }
+    FRNN_TARGET_AVX2 static __m256d mm_min_p( __m256d a, __m256d b )        { return _mm256_min_pd( a, b ); }
+    FRNN_TARGET_AVX2 static __m256d mm_cmplt_p( __m256d a, __m256d b )      { return _mm256_cmp_pd( a, b, _CMP_LT_OQ ); }
+    FRNN_TARGET_AVX2 static __m256d mm_cmpgt_p( __m256d a, __m256d b )      { return _mm256_cmp_pd( a, b, _CMP_GT_OQ ); }
+    FRNN_TARGET_AVX2 static __m256d mm_cmpeq_p( __m256d a, __m256d b )      { return _mm256_cmp_pd( a, b, _CMP_EQ_OQ ); }
+    FRNN_TARGET_AVX2 static __m256d mm_blend_p( __m256d a, __m256d b, __m256d mask ) { return _mm256_blendv_pd( a, b, mask ); }
+    FRNN_TARGET_AVX2 static double  mm_hsum( __m256d a ) {
+        return VectorizedInstructionsCpu<double, SSE2>::mm_hsum( _mm_add_pd( _mm256_castpd256_pd128( a ), 
+                                                                             _mm256_extractf128_pd( a, 1 ) ) );
+    }
+    FRNN_TARGET_AVX2 static double  mm_hmax( __m256d a ) {
+        return VectorizedInstructionsCpu<double, SSE2>::mm_hmax( _mm_max_pd( _mm256_castpd256_pd128( a ), 
+                                                                             _mm256_extractf128_pd( a, 1 ) ) );
+    }
+    FRNN_TARGET_AVX2 static __m256d mm_round_p( __m256d a )                 { return _mm256_round_pd( a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC ); }
+    FRNN_TARGET_AVX2 static __m256d mm_ldexp_p( __m256d a, __m256d n ) {    // Two steps, so 2^n need not be normal
+        const __m128i n_int  = _mm256_cvtpd_epi32( n );
+        const __m128i n_half = _mm_srai_epi32( n_int, 1 );
+        return _mm256_mul_pd( _mm256_mul_pd( a, pow2( n_half ) ), pow2( _mm_sub_epi32( n_int, n_half ) ) );
+    }
+    FRNN_TARGET_AVX2 static __m256d mm_getexp_p( __m256d a ) {
+        const __m256i biased = _mm256_and_si256( _mm256_srli_epi64( _mm256_castpd_si256( a ), 52 ), 
+                                                 _mm256_set1_epi64x( 0x7FF )                        );
+        const __m256i packed = _mm256_permutevar8x32_epi32( biased, _mm256_setr_epi32( 0, 2, 4, 6, 1, 3, 5, 7 ) );
+        return _mm256_cvtepi32_pd( _mm_sub_epi32( _mm256_castsi256_si128( packed ), _mm_set1_epi32( 1023 ) ) );
+    }
+    FRNN_TARGET_AVX2 static __m256d mm_getmant_p( __m256d a ) {
+        return _mm256_castsi256_pd( _mm256_or_si256( _mm256_and_si256( _mm256_castpd_si256( a ), 
+                                                                       _mm256_set1_epi64x( 0x000FFFFFFFFFFFFFll ) ),
+                                                     _mm256_set1_epi64x( 0x3FF0000000000000ll )                     ) );
+    }
+private:
+    // Mask which selects the first n elements
+    FRNN_TARGET_AVX2 static __m256i countMask( size_t n ) {
+        return _mm256_cmpgt_epi64( _mm256_set1_epi64x( static_cast<long long>( n < 4 ? n : 4 ) ),
+                                   _mm256_setr_epi64x( 0, 1, 2, 3 )                             );
+    }
+    // 2^n for integers n in the normal exponent range
+    FRNN_TARGET_AVX2 static __m256d pow2( __m128i n ) {
+        const __m256i biased = _mm256_cvtepi32_epi64( _mm_add_epi32( n, _mm_set1_epi32( 1023 ) ) );
+        return _mm256_castsi256_pd( _mm256_slli_epi64( biased, 52 ) );
+    }
+};
+
+// Int AVX2 specification
+template <> struct VectorizedInstructionsCpu<int, AVX2> {
+    
+    typedef __m256i vect_type;
+    typedef __m256i mask_type;
+    
+    static constexpr size_t typeSize() { return 8; }
+    
+    FRNN_TARGET_AVX2 static __m256i mm_zero()                               { return _mm256_setzero_si256(); }
+    FRNN_TARGET_AVX2 static __m256i mm_set1( int a )                        { return _mm256_set1_epi32( a ); }
+    FRNN_TARGET_AVX2 static __m256i mm_load_u( const int* x )               { return _mm256_loadu_si256( reinterpret_cast<const __m256i*>( x ) ); }
+    FRNN_TARGET_AVX2 static __m256i mm_load_a( const int* x )               { return _mm256_load_si256( reinterpret_cast<const __m256i*>( x ) ); }
+    FRNN_TARGET_AVX2 static __m256i mm_load_n( const int* x, size_t n )     { return _mm256_maskload_epi32( x, countMask( n ) ); }
+    FRNN_TARGET_AVX2 static void    mm_store_u( int* x, __m256i a )         { _mm256_storeu_si256( reinterpret_cast<__m256i*>( x ), a ); }
+    FRNN_TARGET_AVX2 static void    mm_store_p( int* x, __m256i a )         { _mm256_store_si256( reinterpret_cast<__m256i*>( x ), a ); }
+    FRNN_TARGET_AVX2 static void    mm_stream_p( int* x, __m256i a )        { _mm256_stream_si256( reinterpret_cast<__m256i*>( x ), a ); }
+    FRNN_TARGET_AVX2 static void    mm_fence()                              { _mm_sfence(); }
+    FRNN_TARGET_AVX2 static void    mm_store_n( int* x, __m256i a, size_t n ) { _mm256_maskstore_epi32( x, countMask( n ), a ); }
+    FRNN_TARGET_AVX2 static __m256i mm_add_p( __m256i a, __m256i b )        { return _mm256_add_epi32( a, b ); }
+    FRNN_TARGET_AVX2 static __m256i mm_sub_p( __m256i a, __m256i b )        { return _mm256_sub_epi32( a, b ); }
+    FRNN_TARGET_AVX2 static __m256i mm_mul_p( __m256i a, __m256i b )        { return _mm256_mullo_epi32( a, b ); }
+    FRNN_TARGET_AVX2 static __m256i mm_fmadd_p( __m256i a, __m256i b, __m256i c ) { return _mm256_add_epi32( _mm256_mullo_epi32( a, b ), c ); }
+    FRNN_TARGET_AVX2 static __m256i mm_max_p( __m256i a, __m256i b )        { return _mm256_max_epi32( a, b ); }
+    FRNN_TARGET_AVX2 static __m256i mm_min_p( __m256i a, __m256i b )        { return _mm256_min_epi32( a, b ); }
+    FRNN_TARGET_AVX2 static __m256i mm_cmplt_p( __m256i a, __m256i b )      { return _mm256_cmpgt_epi32( b, a ); }
+    FRNN_TARGET_AVX2 static __m256i mm_cmpgt_p( __m256i a, __m256i b )      { return _mm256_cmpgt_epi32( a, b ); }
+    FRNN_TARGET_AVX2 static __m256i mm_cmpeq_p( __m256i a, __m256i b )      { return _mm256_cmpeq_epi32( a, b ); }
+    FRNN_TARGET_AVX2 static __m256i mm_blend_p( __m256i a, __m256i b, __m256i mask ) { return _mm256_blendv_epi8( a, b, mask ); }
+    FRNN_TARGET_AVX2 static int     mm_hsum( __m256i a ) {
+        __m128i s = _mm_add_epi32( _mm256_castsi256_si128( a ), _mm256_extracti128_si256( a, 1 ) );
+        s = _mm_add_epi32( s, _mm_shuffle_epi32( s, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+        return _mm_cvtsi128_si32( _mm_add_epi32( s, _mm_shuffle_epi32( s, _MM_SHUFFLE( 2, 3, 0, 1 ) ) ) );
+    }
+    FRNN_TARGET_AVX2 static int     mm_hmax( __m256i a ) {
+        __m128i m = _mm_max_epi32( _mm256_castsi256_si128( a ), _mm256_extracti128_si256( a, 1 ) );
+        m = _mm_max_epi32( m, _mm_shuffle_epi32( m, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+        return _mm_cvtsi128_si32( _mm_max_epi32( m, _mm_shuffle_epi32( m, _MM_SHUFFLE( 2, 3, 0, 1 ) ) ) );
+    }
+private:
+    // Mask which selects the first n elements
+    FRNN_TARGET_AVX2 static __m256i countMask( size_t n ) {
+        return _mm256_cmpgt_epi32( _mm256_set1_epi32( static_cast<int>( n < 8 ? n : 8 ) ),
+                                   _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 )              );
+    }
+};
 
-    typedef __m128d (*load)( const double* );
-    static constexpr load mm_load_u = &_mm_loadu_pd;
+// Float AVX-512 specification
+template <> struct VectorizedInstructionsCpu<float, AVX512> {
+    
+    typedef __m512    vect_type;
+    typedef __mmask16 mask_type;
+    
+    static constexpr size_t typeSize() { return 16; }
+    
+    FRNN_TARGET_AVX512 static __m512 mm_zero()                              { return _mm512_setzero_ps(); }
+    FRNN_TARGET_AVX512 static __m512 mm_set1( float a )                     { return _mm512_set1_ps( a ); }
+    FRNN_TARGET_AVX512 static __m512 mm_load_u( const float* x )            { return _mm512_loadu_ps( x ); }
+    FRNN_TARGET_AVX512 static __m512 mm_load_a( const float* x )            { return _mm512_load_ps( x ); }
+    FRNN_TARGET_AVX512 static __m512 mm_load_n( const float* x, size_t n )  { return _mm512_maskz_loadu_ps( countMask( n ), x ); }
+    FRNN_TARGET_AVX512 static void   mm_store_u( float* x, __m512 a )       { _mm512_storeu_ps( x, a ); }
+    FRNN_TARGET_AVX512 static void   mm_store_p( float* x, __m512 a )       { _mm512_store_ps( x, a ); }
+    FRNN_TARGET_AVX512 static void   mm_stream_p( float* x, __m512 a )      { _mm512_stream_ps( x, a ); }
+    FRNN_TARGET_AVX512 static void   mm_fence()                             { _mm_sfence(); }
+    FRNN_TARGET_AVX512 static void   mm_store_n( float* x, __m512 a, size_t n ) { _mm512_mask_storeu_ps( x, countMask( n ), a ); }
+    FRNN_TARGET_AVX512 static __m512 mm_add_p( __m512 a, __m512 b )         { return _mm512_add_ps( a, b ); }
+    FRNN_TARGET_AVX512 static __m512 mm_sub_p( __m512 a, __m512 b )         { return _mm512_sub_ps( a, b ); }
+    FRNN_TARGET_AVX512 static __m512 mm_mul_p( __m512 a, __m512 b )         { return _mm512_mul_ps( a, b ); }
+    FRNN_TARGET_AVX512 static __m512 mm_div_p( __m512 a, __m512 b )         { return _mm512_div_ps( a, b ); }
+    FRNN_TARGET_AVX512 static __m512 mm_fmadd_p( __m512 a, __m512 b, __m512 c ) { return _mm512_fmadd_ps( a, b, c ); }
+    FRNN_TARGET_AVX512 static __m512 mm_max_p( __m512 a, __m512 b )         { return _mm512_max_ps( a, b ); }
+    FRNN_TARGET_AVX512 static __m512 mm_min_p( __m512 a, __m512 b )         { return _mm512_min_ps( a, b ); }
+    FRNN_TARGET_AVX512 static __mmask16 mm_cmplt_p( __m512 a, __m512 b )    { return _mm512_cmp_ps_mask( a, b, _CMP_LT_OQ ); }
+    FRNN_TARGET_AVX512 static __mmask16 mm_cmpgt_p( __m512 a, __m512 b )    { return _mm512_cmp_ps_mask( a, b, _CMP_GT_OQ ); }
+    FRNN_TARGET_AVX512 static __mmask16 mm_cmpeq_p( __m512 a, __m512 b )    { return _mm512_cmp_ps_mask( a, b, _CMP_EQ_OQ ); }
+    FRNN_TARGET_AVX512 static __m512 mm_blend_p( __m512 a, __m512 b, __mmask16 mask ) { return _mm512_mask_blend_ps( mask, a, b ); }
+    FRNN_TARGET_AVX512 static float  mm_hsum( __m512 a )                    { return _mm512_reduce_add_ps( a ); }
+    FRNN_TARGET_AVX512 static float  mm_hmax( __m512 a )                    { return _mm512_reduce_max_ps( a ); }
+    FRNN_TARGET_AVX512 static __m512 mm_round_p( __m512 a )                 { return _mm512_roundscale_ps( a, _MM_FROUND_TO_NEAREST_INT ); }
+    FRNN_TARGET_AVX512 static __m512 mm_ldexp_p( __m512 a, __m512 n )       { return _mm512_scalef_ps( a, n ); }
+    FRNN_TARGET_AVX512 static __m512 mm_getexp_p( __m512 a )                { return _mm512_getexp_ps( a ); }
+    FRNN_TARGET_AVX512 static __m512 mm_getmant_p( __m512 a )               { return _mm512_getmant_ps( a, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src ); }
+private:
+    // Mask which selects the first n elements
+    static __mmask16 countMask( size_t n ) { return n >= 16 ? 0xFFFF : static_cast<__mmask16>( ( 1u << n ) - 1 ); }
+};
+
+// Double AVX-512 specification
+template <> struct VectorizedInstructionsCpu<double, AVX512> {
+    
+    typedef __m512d  vect_type;
+    typedef __mmask8 mask_type;
     
-    typedef __m128d (*sub)( __m128d, __m128d );
-    static constexpr sub mm_sub_p = &_mm_sub_pd;
+    static constexpr size_t typeSize() { return 8; }
     
-    typedef void (*store)( double*, __m128d );
-    static constexpr store mm_store_p = &_mm_store_pd;
+    FRNN_TARGET_AVX512 static __m512d mm_zero()                             { return _mm512_setzero_pd(); }
+    FRNN_TARGET_AVX512 static __m512d mm_set1( double a )                   { return _mm512_set1_pd( a ); }
+    FRNN_TARGET_AVX512 static __m512d mm_load_u( const double* x )          { return _mm512_loadu_pd( x ); }
+    FRNN_TARGET_AVX512 static __m512d mm_load_a( const double* x )          { return _mm512_load_pd( x ); }
+    FRNN_TARGET_AVX512 static __m512d mm_load_n( const double* x, size_t n ) { return _mm512_maskz_loadu_pd( countMask( n ), x ); }
+    FRNN_TARGET_AVX512 static void    mm_store_u( double* x, __m512d a )    { _mm512_storeu_pd( x, a ); }
+    FRNN_TARGET_AVX512 static void    mm_store_p( double* x, __m512d a )    { _mm512_store_pd( x, a ); }
+    FRNN_TARGET_AVX512 static void    mm_stream_p( double* x, __m512d a )   { _mm512_stream_pd( x, a ); }
+    FRNN_TARGET_AVX512 static void    mm_fence()                            { _mm_sfence(); }
+    FRNN_TARGET_AVX512 static void    mm_store_n( double* x, __m512d a, size_t n ) { _mm512_mask_storeu_pd( x, countMask( n ), a ); }
+    FRNN_TARGET_AVX512 static __m512d mm_add_p( __m512d a, __m512d b )      { return _mm512_add_pd( a, b ); }
+    FRNN_TARGET_AVX512 static __m512d mm_sub_p( __m512d a, __m512d b )      { return _mm512_sub_pd( a, b ); }
+    FRNN_TARGET_AVX512 static __m512d mm_mul_p( __m512d a, __m512d b )      { return _mm512_mul_pd( a, b ); }
+    FRNN_TARGET_AVX512 static __m512d mm_div_p( __m512d a, __m512d b )      { return _mm512_div_pd( a, b ); }
+    FRNN_TARGET_AVX512 static __m512d mm_fmadd_p( __m512d a, __m512d b, __m512d c ) { return _mm512_fmadd_pd( a, b, c ); }
+    FRNN_TARGET_AVX512 static __m512d mm_max_p( __m512d a, __m512d b )      { return _mm512_max_pd( a, b ); }
+    FRNN_TARGET_AVX512 static __m512d mm_min_p( __m512d a, __m512d b )      { return _mm512_min_pd( a, b ); }
+    FRNN_TARGET_AVX512 static __mmask8 mm_cmplt_p( __m512d a, __m512d b )   { return _mm512_cmp_pd_mask( a, b, _CMP_LT_OQ ); }
+    FRNN_TARGET_AVX512 static __mmask8 mm_cmpgt_p( __m512d a, __m512d b )   { return _mm512_cmp_pd_mask( a, b, _CMP_GT_OQ ); }
+    FRNN_TARGET_AVX512 static __mmask8 mm_cmpeq_p( __m512d a, __m512d b )   { return _mm512_cmp_pd_mask( a, b, _CMP_EQ_OQ ); }
+    FRNN_TARGET_AVX512 static __m512d mm_blend_p( __m512d a, __m512d b, __mmask8 mask ) { return _mm512_mask_blend_pd( mask, a, b ); }
+    FRNN_TARGET_AVX512 static double  mm_hsum( __m512d a )                  { return _mm512_reduce_add_pd( a ); }
+    FRNN_TARGET_AVX512 static double  mm_hmax( __m512d a )                  { return _mm512_reduce_max_pd( a ); }
+    FRNN_TARGET_AVX512 static __m512d mm_round_p( __m512d a )               { return _mm512_roundscale_pd( a, _MM_FROUND_TO_NEAREST_INT ); }
+    FRNN_TARGET_AVX512 static __m512d mm_ldexp_p( __m512d a, __m512d n )    { return _mm512_scalef_pd( a, n ); }
+    FRNN_TARGET_AVX512 static __m512d mm_getexp_p( __m512d a )              { return _mm512_getexp_pd( a ); }
+    FRNN_TARGET_AVX512 static __m512d mm_getmant_p( __m512d a )             { return _mm512_getmant_pd( a, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src ); }
+private:
+    // Mask which selects the first n elements
+    static __mmask8 countMask( size_t n ) { return n >= 8 ? 0xFF : static_cast<__mmask8>( ( 1u << n ) - 1 ); }
+};
+
+// Int AVX-512 specification
+template <> struct VectorizedInstructionsCpu<int, AVX512> {
+    
+    typedef __m512i   vect_type;
+    typedef __mmask16 mask_type;
+    
+    static constexpr size_t typeSize() { return 16; }
+    
+    FRNN_TARGET_AVX512 static __m512i mm_zero()                             { return _mm512_setzero_si512(); }
+    FRNN_TARGET_AVX512 static __m512i mm_set1( int a )                      { return _mm512_set1_epi32( a ); }
+    FRNN_TARGET_AVX512 static __m512i mm_load_u( const int* x )             { return _mm512_loadu_si512( x ); }
+    FRNN_TARGET_AVX512 static __m512i mm_load_a( const int* x )             { return _mm512_load_si512( x ); }
+    FRNN_TARGET_AVX512 static __m512i mm_load_n( const int* x, size_t n )   { return _mm512_maskz_loadu_epi32( countMask( n ), x ); }
+    FRNN_TARGET_AVX512 static void    mm_store_u( int* x, __m512i a )       { _mm512_storeu_si512( x, a ); }
+    FRNN_TARGET_AVX512 static void    mm_store_p( int* x, __m512i a )       { _mm512_store_si512( x, a ); }
+    FRNN_TARGET_AVX512 static void    mm_stream_p( int* x, __m512i a )      { _mm512_stream_si512( reinterpret_cast<__m512i*>( x ), a ); }
+    FRNN_TARGET_AVX512 static void    mm_fence()                            { _mm_sfence(); }
+    FRNN_TARGET_AVX512 static void    mm_store_n( int* x, __m512i a, size_t n ) { _mm512_mask_storeu_epi32( x, countMask( n ), a ); }
+    FRNN_TARGET_AVX512 static __m512i mm_add_p( __m512i a, __m512i b )      { return _mm512_add_epi32( a, b ); }
+    FRNN_TARGET_AVX512 static __m512i mm_sub_p( __m512i a, __m512i b )      { return _mm512_sub_epi32( a, b ); }
+    FRNN_TARGET_AVX512 static __m512i mm_mul_p( __m512i a, __m512i b )      { return _mm512_mullo_epi32( a, b ); }
+    FRNN_TARGET_AVX512 static __m512i mm_fmadd_p( __m512i a, __m512i b, __m512i c ) { return _mm512_add_epi32( _mm512_mullo_epi32( a, b ), c ); }
+    FRNN_TARGET_AVX512 static __m512i mm_max_p( __m512i a, __m512i b )      { return _mm512_max_epi32( a, b ); }
+    FRNN_TARGET_AVX512 static __m512i mm_min_p( __m512i a, __m512i b )      { return _mm512_min_epi32( a, b ); }
+    FRNN_TARGET_AVX512 static __mmask16 mm_cmplt_p( __m512i a, __m512i b )  { return _mm512_cmplt_epi32_mask( a, b ); }
+    FRNN_TARGET_AVX512 static __mmask16 mm_cmpgt_p( __m512i a, __m512i b )  { return _mm512_cmpgt_epi32_mask( a, b ); }
+    FRNN_TARGET_AVX512 static __mmask16 mm_cmpeq_p( __m512i a, __m512i b )  { return _mm512_cmpeq_epi32_mask( a, b ); }
+    FRNN_TARGET_AVX512 static __m512i mm_blend_p( __m512i a, __m512i b, __mmask16 mask ) { return _mm512_mask_blend_epi32( mask, a, b ); }
+    FRNN_TARGET_AVX512 static int     mm_hsum( __m512i a )                  { return _mm512_reduce_add_epi32( a ); }
+    FRNN_TARGET_AVX512 static int     mm_hmax( __m512i a )                  { return _mm512_reduce_max_epi32( a ); }
+private:
+    // Mask which selects the first n elements
+    static __mmask16 countMask( size_t n ) { return n >= 16 ? 0xFFFF : static_cast<__mmask16>( ( 1u << n ) - 1 ); }
+};
+
+#endif
+
+namespace cpu {
+    
+/*
+ * ==========================================================================================================
+ * Struct       : IsaTarget
+ * 
+ * Description  : Calls a kernel for an instruction set from a function which is compiled for the instruction 
+ *                set, so that the kernel (which must be force inlined) and the vectorized instructions it 
+ *                uses are compiled for the instruction set.
+ *                
+ * Params       : level     : The instruction set
+ * ==========================================================================================================
+ */
+template <isa level> struct IsaTarget;
+
+template <> struct IsaTarget<SCALAR> {
+    template <typename Kernel, typename... Args>
+    static auto run( Args&&... args ) 
+    -> decltype( Kernel::template apply<SCALAR>( std::forward<Args>( args )... ) ) {
+        return Kernel::template apply<SCALAR>( std::forward<Args>( args )... );
+    }
+};
+
+#if FRNN_X86
+template <> struct IsaTarget<SSE2> {
+    template <typename Kernel, typename... Args>
+    FRNN_TARGET_SSE2 static auto run( Args&&... args ) 
+    -> decltype( Kernel::template apply<SSE2>( std::forward<Args>( args )... ) ) {
+        return Kernel::template apply<SSE2>( std::forward<Args>( args )... );
+    }
+};
+
+template <> struct IsaTarget<AVX2> {
+    template <typename Kernel, typename... Args>
+    FRNN_TARGET_AVX2 static auto run( Args&&... args ) 
+    -> decltype( Kernel::template apply<AVX2>( std::forward<Args>( args )... ) ) {
+        return Kernel::template apply<AVX2>( std::forward<Args>( args )... );
+    }
+};
+
+template <> struct IsaTarget<AVX512> {
+    template <typename Kernel, typename... Args>
+    FRNN_TARGET_AVX512 static auto run( Args&&... args ) 
+    -> decltype( Kernel::template apply<AVX512>( std::forward<Args>( args )... ) ) {
+        return Kernel::template apply<AVX512>( std::forward<Args>( args )... );
+    }
 };
+#endif
+
+/*
+ * ==========================================================================================================
+ * Function     : dispatch
+ * 
+ * Description  : Calls the version of a kernel for the widest instruction set which the host supports (see
+ *                activeIsa), which is determined once, so the only cost of the dispatch is a switch.
+ *                
+ * Inputs       : args      : The arguments for the kernel
+ * 
+ * Outputs      : The result of the kernel
+ *
+ * Params       : Kernel    : The kernel to call (a struct with a static apply<isa> function template)
+ *              : Args      : The types of the arguments for the kernel
+ * ==========================================================================================================
+ */
+template <typename Kernel, typename... Args>
+auto dispatch( Args&&... args ) 
+-> decltype( Kernel::template apply<SCALAR>( std::forward<Args>( args )... ) ) {
+    switch ( activeIsa() ) {
+#if FRNN_X86
+        case AVX512 : return IsaTarget<AVX512>::template run<Kernel>( std::forward<Args>( args )... );
+        case AVX2   : return IsaTarget<AVX2  >::template run<Kernel>( std::forward<Args>( args )... );
+        case SSE2   : return IsaTarget<SSE2  >::template run<Kernel>( std::forward<Args>( args )... );
+#endif
+        default     : return IsaTarget<SCALAR>::template run<Kernel>( std::forward<Args>( args )... );
+    }
+}
 
+}   // Namespace cpu
 }   // Namespace frnn
 
 
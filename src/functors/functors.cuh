@@ -26,11 +26,22 @@
 #include <math.h>
 #include <cmath>
 
+#include "../frnn/host_device.h"
+#ifndef __CUDA_ARCH__
+#include "../frnn/vectorized_math_cpu.h"
+#endif
+
 namespace frnn {
 namespace functors {
    
 // Note : Whike functors are technically structs, they behave as functions and hence the naming conventions of
 //        functions are used for functors (camel case, start with lowercase letter) 
+//
+//        Functors which have a vectorized CPU version provide a static packet function, which applies the 
+//        operation to each element of a vector for an instruction set (see frnn/vectorized_math_cpu.h), so 
+//        that they can be used in CPU kernels which are called through cpu::dispatch, and with the
+//        elementwise engine (see frnn/elementwise_cpu.h). The packet functions (and the SIMD headers) are
+//        left out of the device compilation of CUDA files.
 
 /*
  * ==========================================================================================================
@@ -57,6 +68,30 @@ struct sigmoid {
     __host__ __device__ dType operator() ( const dType& x ) const {
         return ( dType( 1 ) / ( dType( 1 ) + std::exp( dType( -1 ) * x ) ) );
     }
+
+#ifndef __CUDA_ARCH__
+    /*
+     * ======================================================================================================
+     * Function     : packet
+     * 
+     * Description  : Provides the sigmoid operation for each element of a vector on the CPU, using the
+     *                vectorized approximation with the given accuracy
+     * 
+     * Inputs       : x     : The vector on which the sigmoid operation should operate
+     * 
+     * Outputs      : The results of applying the sigmoid operation to each element of the input
+     * 
+     * Params       : level : The instruction set
+     *              : dType : The type of data to use
+     *              : acc   : The accuracy of the approximation
+     * ======================================================================================================
+     */
+    template <isa level, typename dType, accuracy acc = ACCURATE>
+    FRNN_FORCE_INLINE static typename VectorizedInstructionsCpu<dType, level>::vect_type
+    packet( const typename VectorizedInstructionsCpu<dType, level>::vect_type& x ) {
+        return VectorizedMathCpu<dType, level, acc>::mm_sigmoid_p( x );
+    }
+#endif
 };
 
 /*
@@ -111,6 +146,237 @@ struct exp {
 	__host__ __device__ dType operator() ( const dType& value ) {
 		return std::exp( value );
 	}
+
+#ifndef __CUDA_ARCH__
+	/*
+	 * ======================================================================================================
+	 * Function	 : packet
+	 * 
+	 * Description  : Provides the exp operation for each element of a vector on the CPU, using the vectorized
+	 *				approximation with the given accuracy
+	 * 
+	 * Inputs	   : x	 : The vector on which the exp operation should operate
+	 * 
+	 * Outputs	  : The results of applying the exp operation to each element of the input
+	 * 
+	 * Params	   : level : The instruction set
+	 *			  : dType : The type of data to use
+	 *			  : acc   : The accuracy of the approximation
+	 * ======================================================================================================
+	 */
+	template <isa level, typename dType, accuracy acc = ACCURATE>
+	FRNN_FORCE_INLINE static typename VectorizedInstructionsCpu<dType, level>::vect_type
+	packet( const typename VectorizedInstructionsCpu<dType, level>::vect_type& x ) {
+		return VectorizedMathCpu<dType, level, acc>::mm_exp_p( x );
+	}
+#endif
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : log
+ *
+ * Description  : Functor which provides the natural logarithm operation
+ * ==========================================================================================================
+ */
+struct log {
+    /*
+     * ======================================================================================================
+     * Function     : operator()
+     *
+     * Description  : Overloads the () operator to provide the natural logarithm
+     *
+     * Inputs       : value     : The value to compute the logarithm of
+     *
+     * Outputs      : The natural logarithm of the input
+     *
+     * Params       : dType     : Type of data of the input
+     * ======================================================================================================
+     */
+    template <typename dType>
+    __host__ __device__ dType operator() ( const dType& value ) const {
+        return std::log( value );
+    }
+
+#ifndef __CUDA_ARCH__
+    /*
+     * ======================================================================================================
+     * Function     : packet
+     * 
+     * Description  : Provides the log operation for each element of a vector on the CPU, using the
+     *                vectorized approximation with the given accuracy
+     * 
+     * Inputs       : x     : The vector on which the log operation should operate
+     * 
+     * Outputs      : The results of applying the log operation to each element of the input
+     * 
+     * Params       : level : The instruction set
+     *              : dType : The type of data to use
+     *              : acc   : The accuracy of the approximation
+     * ======================================================================================================
+     */
+    template <isa level, typename dType, accuracy acc = ACCURATE>
+    FRNN_FORCE_INLINE static typename VectorizedInstructionsCpu<dType, level>::vect_type
+    packet( const typename VectorizedInstructionsCpu<dType, level>::vect_type& x ) {
+        return VectorizedMathCpu<dType, level, acc>::mm_log_p( x );
+    }
+#endif
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : tanh
+ *
+ * Description  : Functor which provides the hyperbolic tangent operation
+ * ==========================================================================================================
+ */
+struct tanh {
+    /*
+     * ======================================================================================================
+     * Function     : operator()
+     *
+     * Description  : Overloads the () operator to provide the hyperbolic tangent
+     *
+     * Inputs       : value     : The value to compute tanh of
+     *
+     * Outputs      : The hyperbolic tangent of the input
+     *
+     * Params       : dType     : Type of data of the input
+     * ======================================================================================================
+     */
+    template <typename dType>
+    __host__ __device__ dType operator() ( const dType& value ) const {
+        return std::tanh( value );
+    }
+
+#ifndef __CUDA_ARCH__
+    /*
+     * ======================================================================================================
+     * Function     : packet
+     * 
+     * Description  : Provides the tanh operation for each element of a vector on the CPU, using the
+     *                vectorized approximation with the given accuracy
+     * 
+     * Inputs       : x     : The vector on which the tanh operation should operate
+     * 
+     * Outputs      : The results of applying the tanh operation to each element of the input
+     * 
+     * Params       : level : The instruction set
+     *              : dType : The type of data to use
+     *              : acc   : The accuracy of the approximation
+     * ======================================================================================================
+     */
+    template <isa level, typename dType, accuracy acc = ACCURATE>
+    FRNN_FORCE_INLINE static typename VectorizedInstructionsCpu<dType, level>::vect_type
+    packet( const typename VectorizedInstructionsCpu<dType, level>::vect_type& x ) {
+        return VectorizedMathCpu<dType, level, acc>::mm_tanh_p( x );
+    }
+#endif
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : minus
+ *
+ * Description  : Functor which provides the subtraction of two values
+ * ==========================================================================================================
+ */
+struct minus {
+    /*
+     * ======================================================================================================
+     * Function     : operator()
+     *
+     * Description  : Overloads the () operator to provide x - y
+     *
+     * Inputs       : x         : The value to subtract from
+     *              : y         : The value to subtract
+     *
+     * Outputs      : x - y
+     *
+     * Params       : dType     : Type of data of the inputs
+     * ======================================================================================================
+     */
+    template <typename dType>
+    __host__ __device__ dType operator() ( const dType& x, const dType& y ) const {
+        return x - y;
+    }
+
+#ifndef __CUDA_ARCH__
+    /*
+     * ======================================================================================================
+     * Function     : packet
+     * 
+     * Description  : Provides x - y for each element of two vectors on the CPU
+     * 
+     * Inputs       : x     : The vector to subtract from
+     *              : y     : The vector to subtract
+     * 
+     * Outputs      : The elementwise differences
+     * 
+     * Params       : level : The instruction set
+     *              : dType : The type of data to use
+     * ======================================================================================================
+     */
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static typename VectorizedInstructionsCpu<dType, level>::vect_type
+    packet( const typename VectorizedInstructionsCpu<dType, level>::vect_type& x ,
+            const typename VectorizedInstructionsCpu<dType, level>::vect_type& y ) {
+        return VectorizedInstructionsCpu<dType, level>::mm_sub_p( x, y );
+    }
+#endif
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : hadamard
+ *
+ * Description  : Functor which provides the product of two values, for the elementwise (Hadamard) product
+ *                of vectors
+ * ==========================================================================================================
+ */
+struct hadamard {
+    /*
+     * ======================================================================================================
+     * Function     : operator()
+     *
+     * Description  : Overloads the () operator to provide x * y
+     *
+     * Inputs       : x         : The first value
+     *              : y         : The second value
+     *
+     * Outputs      : x * y
+     *
+     * Params       : dType     : Type of data of the inputs
+     * ======================================================================================================
+     */
+    template <typename dType>
+    __host__ __device__ dType operator() ( const dType& x, const dType& y ) const {
+        return x * y;
+    }
+
+#ifndef __CUDA_ARCH__
+    /*
+     * ======================================================================================================
+     * Function     : packet
+     * 
+     * Description  : Provides x * y for each element of two vectors on the CPU
+     * 
+     * Inputs       : x     : The first vector
+     *              : y     : The second vector
+     * 
+     * Outputs      : The elementwise products
+     * 
+     * Params       : level : The instruction set
+     *              : dType : The type of data to use
+     * ======================================================================================================
+     */
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static typename VectorizedInstructionsCpu<dType, level>::vect_type
+    packet( const typename VectorizedInstructionsCpu<dType, level>::vect_type& x ,
+            const typename VectorizedInstructionsCpu<dType, level>::vect_type& y ) {
+        return VectorizedInstructionsCpu<dType, level>::mm_mul_p( x, y );
+    }
+#endif
 };
 
 /*
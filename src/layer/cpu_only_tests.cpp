@@ -0,0 +1,80 @@
+/*
+ *  Test file for the fastRNN CPU only build, which is compiled by the host compiler alone (with 
+ *  FRNN_CPU_ONLY defined and without cuda), to check that the CPU math and layers do not need cuda.
+ *
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FRNN_CPU_ONLY
+#error "The CPU only tests must be compiled with FRNN_CPU_ONLY defined"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "../math/math.hpp"
+#include "layer.hpp"
+#include "types/softmax_policy.hpp"
+#include "types/embedding_policy.hpp"
+#include "types/lstm_policy.hpp"
+
+typedef frnn::Layer<double,                            // Data type
+                     frnn::device::CPU,                // Device type
+                     10, 20, 1,                         // Size
+                     frnn::ltype::SoftmaxPolicy>  frnnLayerSmaxdCpuOnly;
+
+typedef frnn::Layer<double,                            // Data type
+                     frnn::device::CPU,                // Device type
+                     5, 7, 2,                           // Size
+                     frnn::ltype::LstmPolicy>  frnnLayerLstmdCpuOnly;
+
+TEST(frnnCpuOnly, MathFunctionsComputeCorrectly) {
+    frnn::frnnError error;
+    std::vector<double> x = {1.0, 2.0, 3.0, 4.0}, y = {4.0, 3.0, 2.0, 1.0}, val;
+
+    frnn::math<double, frnn::device::CPU>::softmax(error, x, val);
+    EXPECT_NEAR( 1.0, (frnn::math<double, frnn::device::CPU>::sum(error, val)), 1e-12 );
+    EXPECT_EQ( 4.0, (frnn::math<double, frnn::device::CPU>::max(error, x)) );
+
+    frnn::math<double, frnn::device::CPU>::xmy(x, y, val);
+    for (size_t i = 0; i < x.size(); i++) EXPECT_EQ( x[i] - y[i], val[i] );
+}
+
+TEST(frnnCpuOnly, LayerCanForwardPass) {
+    frnnLayerLstmdCpuOnly lstmLayer;
+    frnn::ExecutionContext ctx(2, 37);
+    std::vector<double> ins(7, 0.5), outs;
+
+    lstmLayer.initializeWeights(ctx, -0.5, 0.5);
+    lstmLayer.forward(ctx, ins, outs);
+
+    ASSERT_EQ( 5, outs.size() );
+    for (size_t n = 0; n < outs.size(); n++) EXPECT_LT( std::abs(outs[n]), 1.0 );
+}
+
+TEST(frnnCpuOnly, SoftmaxLayerCanForwardPass) {
+    frnnLayerSmaxdCpuOnly softmaxLayer;
+    frnn::ExecutionContext ctx(2, 41);
+    std::vector<double> ins(20, 0.25), outs;
+
+    softmaxLayer.initializeWeights(ctx, -1.0, 1.0);
+    softmaxLayer.forward(ctx, ins, outs);
+
+    ASSERT_EQ( 10, outs.size() );
+    double sum = 0.0;
+    for (size_t n = 0; n < outs.size(); n++) sum += outs[n];
+    EXPECT_NEAR( 1.0, sum, 1e-12 );
+}
@@ -24,7 +24,9 @@
 #include <omp.h>
 
 #include "../tensor/tensor.cuh"
+#include "../new_tensor/tensor.h"
 #include "../math/math.hpp"
+#include "../math/execution_context.hpp"
 
 namespace frnn {
 
@@ -73,25 +75,76 @@ class Layer : public TypePolicy<dType, dev, _nodes, _inputs, _depth> {
          * Function     : initializeWeights
          * 
          * Description  : Initialzes the weights between a certain range (by default the weights are
-         *                initialized to 0 during construction).
+         *                initialized to 0 during construction). Every column of a page before the last two
+         *                (which are the biases and activations) is a weight, whatever the layout of the type
+         *                policy. The pages of the wba tensor are split between the threads of the context,
+         *                and each page is filled with the generator of the thread which fills it.
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : min   : The minimum value for the weights
+         *              : max   : The maximum value for the weights
+         * ==================================================================================================
+         */
+        inline void initializeWeights(ExecutionContext& ctx, dType min, dType max) {
+            const size_t num_elements = this->wba.x() * (this->wba.y() - 2);
+
+            ctx.forEach(depth, [&](size_t page, int thread_id) {
+                // CPU version is a lot faster at the moment due to CPU-GPU transfer, so use CPU
+                randCpu(ctx.generator(thread_id), &this->wba(0, 0, page, 0), num_elements, min, max);
+            });
+            this->weightsChanged();
+        }
+
+        /*
+         * ==================================================================================================
+         * Function     : initializeWeights
+         * 
+         * Description  : Initialzes the weights between a certain range, using the context of the calling
+         *                thread.
          *
          * Inputs       : min   : The minimum value for the weights
          *              : max   : The maximum value for the weights
          * ==================================================================================================
          */
         inline void initializeWeights(dType min, dType max) {
-            // For each page in the tensor, use a thread to initialize the weights
-            #pragma omp parallel num_threads (depth)
-            {
-                int thread_id       = omp_get_thread_num();
-                dType* weight_start = &this->wba(0, 0, thread_id, 0);
-                size_t num_elements = num_nodes * std::max(num_nodes, num_inputs);
-                
-                // CPU version is a lot faster at the moment due to CPU-GPU transfer, so use CPU
-                frnn::math<dType, frnn::device::CPU>::rand(weight_start, num_elements, min, max);
-            }
+            initializeWeights(ExecutionContext::threadDefault(), min, max);
         }
         
+        /*
+         * ==================================================================================================
+         * Function     : forwardSequence
+         * 
+         * Description  : Forward propogates a whole sequence through the layer. The input projections
+         *                (W*x + b) do not depend on the recurrence, so the type policy determines them for
+         *                every timestep at once, as one large GEMM (projectSequence), and then only the part
+         *                which depends on the previous timestep is done for each timestep in order
+         *                (sequenceStep). If the type policy is not recurrent the timesteps are independent,
+         *                so they are split between the threads of the context instead.
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : ins   : The inputs of the sequence, an [inputs x T] tensor (one timestep per column)
+         *
+         * Outputs      : outs  : The outputs of the sequence, a [nodes x T] tensor (one timestep per column)
+         * ==================================================================================================
+         */
+        void forwardSequence(ExecutionContext& ctx, const Tensor<dType, 2>& ins, Tensor<dType, 2>& outs) {
+            typedef TypePolicy<dType, dev, _nodes, _inputs, _depth> policy;
+
+            if (!this->projectSequence(ctx, ins, outs)) return;
+
+            const size_t steps = outs.size(1);
+            if (policy::recurrent) {
+                for (size_t t = 0; t < steps; t++) this->sequenceStep(ctx, t, outs);
+            } else {
+                ctx.forEach(steps, [&](size_t t, int) { this->sequenceStep(ctx, t, outs); });
+            }
+        }
+
+        // Forward propogates a whole sequence using the context of the calling thread
+        void forwardSequence(const Tensor<dType, 2>& ins, Tensor<dType, 2>& outs) {
+            forwardSequence(ExecutionContext::threadDefault(), ins, outs);
+        }
+
         /*
          * ==================================================================================================
          * Function     : getWBA
@@ -125,12 +178,13 @@ class Layer : public TypePolicy<dType, dev, _nodes, _inputs, _depth> {
          *
          * Description  : Retuns a pointer to the errors of the layer
          *
-         * Outputs      : A constant pointer to the errors of the layer
+         * Outputs      : A constant pointer to the errors of the layer, which is NULL when the layer has 
+         *                no errors (an embedding layer before its first backward pass)
          * ==================================================================================================
          */
         inline const dType* getErrors() const {
-            // Errors vector in typepolicy base
-            return &(this->errors[0]); 
+            // Errors vector in typepolicy base, which may be empty
+            return this->errors.empty() ? NULL : this->errors.data(); 
         }
 };
 
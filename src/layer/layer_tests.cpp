@@ -23,6 +23,8 @@
 
 #include "layer.hpp"
 #include "types/softmax_policy.hpp"
+#include "types/embedding_policy.hpp"
+#include "types/lstm_policy.hpp"
 #include "../frnn/frnn.h"
 
 const size_t    INPUTS      = 6000;
@@ -35,6 +37,57 @@ typedef frnn::Layer<float,                             // Data type
                      NODES, INPUTS, DEPTH,              // Size
                      frnn::ltype::SoftmaxPolicy>  frnnLayerSmaxf;        
 
+typedef frnn::Layer<double,                            // Data type
+                     frnn::device::CPU,                // Device type
+                     NODES, INPUTS, 2,                  // Size (two pages to check they are summed)
+                     frnn::ltype::SoftmaxPolicy>  frnnLayerSmaxdCpu;
+
+typedef frnn::Layer<double,                            // Data type
+                     frnn::device::CPU,                // Device type
+                     16, 100, 2,                        // Size (embeddings of 16 for 100 tokens, two pages)
+                     frnn::ltype::EmbeddingPolicy>  frnnLayerEmbeddCpu;
+
+typedef frnn::Layer<double,                            // Data type
+                     frnn::device::CPU,                // Device type
+                     5, 7, 2,                           // Size (5 nodes so the gates have a SIMD tail)
+                     frnn::ltype::LstmPolicy>  frnnLayerLstmdCpu;
+
+// Scalar lstm timestep, with the gates stacked as in the wba tensor of the lstm policy
+void lstmReferenceStep(const frnn::Tensor4<double>& wba, const double* x, std::vector<double>& h,
+                       std::vector<double>& c) {
+    const uint N = 5, I = 7;
+    std::vector<double> a(4 * N, 0.0);
+    for (uint page = 0; page < 2; page++) {
+        for (uint r = 0; r < 4 * N; r++) {
+            a[r] += wba(r, I + N, page, 0);
+            for (uint i = 0; i < I; i++) a[r] += wba(r, i, page, 0) * x[i];
+            for (uint n = 0; n < N; n++) a[r] += wba(r, I + n, page, 0) * h[n];
+        }
+    }
+    for (uint n = 0; n < N; n++) {
+        const double i_gate = 1.0 / (1.0 + std::exp(-a[n]));
+        const double f_gate = 1.0 / (1.0 + std::exp(-a[N + n]));
+        const double g_gate = std::tanh(a[2 * N + n]);
+        const double o_gate = 1.0 / (1.0 + std::exp(-a[3 * N + n]));
+        c[n] = f_gate * c[n] + i_gate * g_gate;
+        h[n] = o_gate * std::tanh(c[n]);
+    }
+}
+
+// Loss which is a weighted sum of the outputs of a sequence, whose gradients are the weights
+double lstmSequenceLoss(frnnLayerLstmdCpu& layer, frnn::ExecutionContext& ctx, const frnn::Tensor<double, 2>& ins,
+                        const frnn::Tensor<double, 2>& coefs) {
+    frnn::Tensor<double, 2> outs;
+    layer.resetState();
+    layer.forwardSequence(ctx, ins, outs);
+
+    double loss = 0.0;
+    for (size_t t = 0; t < outs.size(1); t++) {
+        for (uint n = 0; n < 5; n++) loss += coefs.data()[t * 5 + n] * outs(n, t);
+    }
+    return loss;
+}
+
 TEST(frnnLayer, CanCreateSoftmaxLayerCorrectly) {
     frnnLayerSmaxf softmaxLayer;
 
@@ -112,3 +165,415 @@ TEST(frnnLayer, SoftmaxLayerCanBackpropCorrectly) {
         EXPECT_EQ( outs[i] - targets[i], errs[i] );
     }
 }
+
+TEST(frnnLayer, SparseForwardPassMatchesDenseForwardPass) {
+    frnnLayerSmaxf softmaxLayer;
+
+    std::vector<float>        ins(INPUTS, 0.0f), outs_dense, outs_sparse;
+    frnn::SparseTensor<float, 1> ins_sparse = {INPUTS};
+
+    // One-hot input
+    ins[INPUTS / 2] = 1.0f;
+    ins_sparse.insert(INPUTS / 2, 1.0f);
+
+    softmaxLayer.initializeWeights(0.0f, 1.0f);
+
+    softmaxLayer.forward(ins, outs_dense);
+    softmaxLayer.forward(ins_sparse, outs_sparse);
+    
+    for (uint i = 0; i < NODES; i++) {
+        EXPECT_NEAR( outs_dense[i], outs_sparse[i], TOLERANCE );
+    }
+}
+
+TEST(frnnLayer, CpuForwardPassMatchesReference) {
+    frnnLayerSmaxdCpu softmaxLayer;
+
+    std::vector<double> ins, outs, logits(NODES, 0.0);
+
+    // Large inputs so that the logits would overflow exp without subtracting the maximum
+    for (uint i = 0; i < INPUTS; i++) {
+        ins.push_back(static_cast<double>(i % 13));
+    }
+    softmaxLayer.initializeWeights(0.0, 1.0);
+    softmaxLayer.forward(ins, outs);
+
+    const frnn::Tensor4<double>& wba = softmaxLayer.getWBA();
+    double max_logit = -1e300, sum = 0.0;
+    for (uint n = 0; n < NODES; n++) {
+        for (uint page = 0; page < 2; page++) {
+            logits[n] += wba(n, INPUTS, page, 0);
+            for (uint i = 0; i < INPUTS; i++) logits[n] += wba(n, i, page, 0) * ins[i];
+        }
+        max_logit = std::max(max_logit, logits[n]);
+    }
+    for (uint n = 0; n < NODES; n++) sum += exp(logits[n] - max_logit);
+
+    ASSERT_EQ( outs.size(), NODES );
+    for (uint n = 0; n < NODES; n++) {
+        EXPECT_NEAR( exp(logits[n] - max_logit) / sum, outs[n], 1e-9 );
+    }
+}
+
+TEST(frnnLayer, CpuForwardPassWithContextMatchesForwardPass) {
+    frnnLayerSmaxdCpu softmaxLayer;
+    frnn::ExecutionContext ctx(2, 7);
+
+    std::vector<double> ins, outs, ctx_outs;
+    for (uint i = 0; i < INPUTS; i++) {
+        ins.push_back(static_cast<double>(i % 5) / 5.0);
+    }
+    softmaxLayer.initializeWeights(ctx, -1.0, 1.0);
+    softmaxLayer.forward(ins, outs);
+
+    // Twice, so the second pass reuses the scratch memory of the first
+    for (int pass = 0; pass < 2; pass++) {
+        softmaxLayer.forward(ctx, ins, ctx_outs);
+        ASSERT_EQ( outs.size(), ctx_outs.size() );
+        for (uint n = 0; n < NODES; n++) EXPECT_NEAR( outs[n], ctx_outs[n], 1e-12 );
+    }
+}
+
+TEST(frnnLayer, CpuBatchedPassesMatchPassesOfEachSample) {
+    frnnLayerSmaxdCpu softmaxLayer;
+    frnn::ExecutionContext ctx(2, 11);
+    const int BATCH = 5;
+
+    frnn::Tensor<double, 2> ins = {INPUTS, BATCH}, targets = {NODES, BATCH}, outs;
+    for (int b = 0; b < BATCH; b++) {
+        for (uint i = 0; i < INPUTS; i++) ins(i, b) = static_cast<double>((i + 3 * b) % 7) / 7.0;
+        for (uint n = 0; n < NODES; n++) targets(n, b) = n == static_cast<uint>(b) ? 1.0 : 0.0;
+    }
+    softmaxLayer.initializeWeights(ctx, -0.1, 0.1);
+    softmaxLayer.forward(ctx, ins, outs);
+    softmaxLayer.backward(outs, targets);
+
+    ASSERT_EQ( NODES, outs.size(0) );
+    ASSERT_EQ( BATCH, outs.size(1) );
+    std::vector<double> batch_errors(softmaxLayer.getErrors(), softmaxLayer.getErrors() + NODES * BATCH);
+
+    for (int b = 0; b < BATCH; b++) {
+        std::vector<double> sample_ins(&ins(0, b), &ins(0, b) + INPUTS), sample_outs;
+        std::vector<double> sample_targets(&targets(0, b), &targets(0, b) + NODES);
+        softmaxLayer.forward(ctx, sample_ins, sample_outs);
+        for (uint n = 0; n < NODES; n++) EXPECT_NEAR( sample_outs[n], outs(n, b), 1e-12 );
+
+        // The errors only depend on the outputs, so they are identical for the same outputs
+        std::vector<double> batch_outs(&outs(0, b), &outs(0, b) + NODES);
+        softmaxLayer.backward(batch_outs, sample_targets);
+        for (uint n = 0; n < NODES; n++) EXPECT_EQ( softmaxLayer.getErrors()[n], batch_errors[b * NODES + n] );
+    }
+}
+
+TEST(frnnLayer, CpuPackedWeightsAreRepackedWhenTheWeightsChange) {
+    frnnLayerSmaxdCpu softmaxLayer;
+    frnn::ExecutionContext ctx(2, 13);
+    const int BATCH = 4;
+
+    frnn::Tensor<double, 2> ins = {INPUTS, BATCH}, outs, unpacked_outs;
+    for (int b = 0; b < BATCH; b++) {
+        for (uint i = 0; i < INPUTS; i++) ins(i, b) = static_cast<double>((i + b) % 5) / 5.0;
+    }
+    softmaxLayer.initializeWeights(ctx, -1.0, 1.0);
+    softmaxLayer.forward(ctx, ins, outs);
+
+    // New weights, which the next pass must use rather than the packed copy of the old weights
+    softmaxLayer.initializeWeights(ctx, 0.0, 0.1);
+    softmaxLayer.forward(ctx, ins, outs);
+    frnn::softmaxForwardBatchCpu(ctx, ins, softmaxLayer.getWBA(), INPUTS, unpacked_outs);
+
+    for (int b = 0; b < BATCH; b++) {
+        for (uint n = 0; n < NODES; n++) EXPECT_NEAR( unpacked_outs(n, b), outs(n, b), 1e-12 );
+    }
+}
+
+TEST(frnnLayer, CpuForwardBackwardMatchesSeparatePasses) {
+    frnnLayerSmaxdCpu softmaxLayer;
+    frnn::ExecutionContext ctx(2, 23);
+    const int BATCH = 3;
+
+    frnn::Tensor<double, 2> ins = {INPUTS, BATCH};
+    std::vector<int> targets = {4, NODES - 1, 4};
+    for (int b = 0; b < BATCH; b++) {
+        for (uint i = 0; i < INPUTS; i++) ins(i, b) = static_cast<double>((i + 2 * b) % 9) / 9.0;
+    }
+    softmaxLayer.initializeWeights(ctx, -0.1, 0.1);
+    const double batch_loss = softmaxLayer.forwardBackward(ctx, ins, targets);
+    std::vector<double> batch_errors(softmaxLayer.getErrors(), softmaxLayer.getErrors() + NODES * BATCH);
+
+    double loss = 0.0;
+    for (int b = 0; b < BATCH; b++) {
+        std::vector<double> sample_ins(&ins(0, b), &ins(0, b) + INPUTS), outs, one_hot(NODES, 0.0);
+        one_hot[targets[b]] = 1.0;
+        softmaxLayer.forward(ctx, sample_ins, outs);
+        softmaxLayer.backward(outs, one_hot);
+        std::vector<double> errors(softmaxLayer.getErrors(), softmaxLayer.getErrors() + NODES);
+
+        const double sample_loss = softmaxLayer.forwardBackward(ctx, sample_ins, targets[b]);
+        EXPECT_NEAR( -log(outs[targets[b]]), sample_loss, 1e-9 );
+        for (uint n = 0; n < NODES; n++) {
+            EXPECT_NEAR( errors[n], softmaxLayer.getErrors()[n], 1e-12 );
+            EXPECT_NEAR( errors[n], batch_errors[b * NODES + n], 1e-12 );
+        }
+        loss += sample_loss;
+    }
+    EXPECT_NEAR( loss, batch_loss, 1e-9 );
+}
+
+TEST(frnnLayer, CpuUpdateWbaStepsAlongTheOuterProductGradientWithMomentum) {
+    frnnLayerSmaxdCpu softmaxLayer;
+    frnn::ExecutionContext ctx(2, 29);
+    const double rate = 0.1, momentum = 0.5;
+    const frnn::Tensor4<double>& wba = softmaxLayer.getWBA();
+
+    frnn::Tensor4<double> acts(INPUTS, 1, 2, 1);
+    std::vector<double> ins(INPUTS), outs, targets(NODES, 0.0);
+    for (uint page = 0; page < 2; page++) {
+        for (uint i = 0; i < INPUTS; i++) acts(i, 0, page, 0) = static_cast<double>((i + page) % 11) / 11.0;
+    }
+    for (uint i = 0; i < INPUTS; i++) ins[i] = acts(i, 0, 0, 0);
+    targets[3] = 1.0;
+
+    softmaxLayer.initializeWeights(ctx, -0.1, 0.1);
+    softmaxLayer.setTrainingParameters(rate, momentum);
+    softmaxLayer.forward(ctx, ins, outs);
+    softmaxLayer.backward(outs, targets);
+    const std::vector<double> errors(softmaxLayer.getErrors(), softmaxLayer.getErrors() + NODES);
+
+    // Weights (a sample of them), then the biases, of both pages
+    std::vector<double> before;
+    for (uint page = 0; page < 2; page++) {
+        for (uint i = 0; i <= INPUTS; i += 7) {
+            for (uint n = 0; n < NODES; n += 13) before.push_back(wba(n, i, page, 0));
+        }
+    }
+
+    // The second update has the momentum of the first, so it moves 1.5 times as far
+    softmaxLayer.updateWba(ctx, acts);
+    softmaxLayer.updateWba(ctx, acts);
+
+    size_t k = 0;
+    for (uint page = 0; page < 2; page++) {
+        for (uint i = 0; i <= INPUTS; i += 7) {
+            const double x = i < INPUTS ? acts(i, 0, page, 0) : 1.0;
+            for (uint n = 0; n < NODES; n += 13, k++) {
+                EXPECT_NEAR( before[k] - 2.5 * rate * errors[n] * x, wba(n, i, page, 0), 1e-12 );
+            }
+        }
+    }
+}
+
+TEST(frnnLayer, CpuUpdateWbaSumsTheGradientsOfABatch) {
+    frnnLayerSmaxdCpu softmaxLayer;
+    frnn::ExecutionContext ctx(2, 30);
+    const double rate = 0.1;
+    const int BATCH = 3;
+    const frnn::Tensor4<double>& wba = softmaxLayer.getWBA();
+
+    // Both pages are given the same inputs, since the batch forward pass gives them to every page
+    frnn::Tensor<double, 2> ins = {INPUTS, BATCH};
+    frnn::Tensor4<double> acts(INPUTS, BATCH, 2, 1);
+    std::vector<int> targets = {1, 5, NODES - 2};
+    for (int b = 0; b < BATCH; b++) {
+        for (uint i = 0; i < INPUTS; i++) {
+            ins(i, b) = static_cast<double>((i + 3 * b) % 7) / 7.0;
+            for (uint page = 0; page < 2; page++) acts(i, b, page, 0) = ins(i, b);
+        }
+    }
+
+    softmaxLayer.initializeWeights(ctx, -0.1, 0.1);
+    softmaxLayer.setTrainingParameters(rate, 0.0);
+    softmaxLayer.forwardBackward(ctx, ins, targets);
+    const std::vector<double> errors(softmaxLayer.getErrors(), softmaxLayer.getErrors() + NODES * BATCH);
+
+    std::vector<double> before;
+    for (uint page = 0; page < 2; page++) {
+        for (uint i = 0; i <= INPUTS; i += 7) {
+            for (uint n = 0; n < NODES; n += 13) before.push_back(wba(n, i, page, 0));
+        }
+    }
+    softmaxLayer.updateWba(ctx, acts);
+
+    size_t k = 0;
+    for (uint page = 0; page < 2; page++) {
+        for (uint i = 0; i <= INPUTS; i += 7) {
+            for (uint n = 0; n < NODES; n += 13, k++) {
+                double gradient = 0.0;
+                for (int b = 0; b < BATCH; b++) {
+                    gradient += errors[b * NODES + n] * (i < INPUTS ? acts(i, b, page, 0) : 1.0);
+                }
+                EXPECT_NEAR( before[k] - rate * gradient, wba(n, i, page, 0), 1e-12 );
+            }
+        }
+    }
+}
+
+TEST(frnnLayer, CpuSequenceForwardPassMatchesPassesOfEachTimestep) {
+    frnnLayerSmaxdCpu softmaxLayer;
+    frnn::ExecutionContext ctx(2, 31);
+    const int STEPS = 6;
+
+    frnn::Tensor<double, 2> ins = {INPUTS, STEPS}, outs;
+    for (int t = 0; t < STEPS; t++) {
+        for (uint i = 0; i < INPUTS; i++) ins(i, t) = static_cast<double>((i * (t + 1)) % 13) / 13.0;
+    }
+    softmaxLayer.initializeWeights(ctx, -0.1, 0.1);
+    softmaxLayer.forwardSequence(ctx, ins, outs);
+
+    ASSERT_EQ( NODES, outs.size(0) );
+    ASSERT_EQ( STEPS, outs.size(1) );
+    for (int t = 0; t < STEPS; t++) {
+        std::vector<double> step_ins(&ins(0, t), &ins(0, t) + INPUTS), step_outs;
+        softmaxLayer.forward(ctx, step_ins, step_outs);
+        for (uint n = 0; n < NODES; n++) EXPECT_NEAR( step_outs[n], outs(n, t), 1e-12 );
+    }
+}
+
+TEST(frnnLayer, EmbeddingForwardPassMatchesOneHotProduct) {
+    frnnLayerEmbeddCpu embeddingLayer;
+    frnn::ExecutionContext ctx(2, 17);
+    const frnn::Tensor4<double>& wba = embeddingLayer.getWBA();
+
+    // More tokens than the prefetch distance, with repeated ids
+    std::vector<int> ids = {3, 99, 0, 3, 42, 7, 7, 15, 64, 1, 3, 88, 50};
+    frnn::Tensor<double, 2> outs;
+    embeddingLayer.initializeWeights(ctx, -1.0, 1.0);
+    embeddingLayer.forward(ctx, ids, outs);
+
+    ASSERT_EQ( 16, outs.size(0) );
+    ASSERT_EQ( ids.size(), outs.size(1) );
+    for (size_t b = 0; b < ids.size(); b++) {
+        for (uint n = 0; n < 16; n++) {
+            // W*x + b for a one-hot x, summed over the pages
+            double expected = 0.0;
+            for (uint page = 0; page < 2; page++) {
+                for (uint i = 0; i < 100; i++) expected += wba(n, i, page, 0) * (static_cast<int>(i) == ids[b]);
+                expected += wba(n, 100, page, 0);
+            }
+            EXPECT_NEAR( expected, outs(n, b), 1e-12 );
+        }
+    }
+}
+
+TEST(frnnLayer, EmbeddingBackwardPassOnlyUpdatesGatheredColumns) {
+    frnnLayerEmbeddCpu embeddingLayer;
+    frnn::ExecutionContext ctx(2, 19);
+    const frnn::Tensor4<double>& wba = embeddingLayer.getWBA();
+
+    std::vector<int> ids = {5, 9, 5};
+    frnn::Tensor<double, 2> outs, grads = {16, 3};
+    for (int b = 0; b < 3; b++) {
+        for (uint n = 0; n < 16; n++) grads(n, b) = static_cast<double>(b + 1);
+    }
+    embeddingLayer.initializeWeights(ctx, -1.0, 1.0);
+    std::vector<double> before(&wba(0, 0, 0, 0), &wba(0, 0, 0, 0) + 16 * 102);
+    EXPECT_TRUE( embeddingLayer.getErrors() == NULL );  // No gradients have been accumulated yet
+
+    embeddingLayer.forward(ctx, ids, outs);
+    embeddingLayer.backward(ids, grads);
+
+    // Tokens with the same id share a row of gradients
+    ASSERT_EQ( 2, embeddingLayer.gradientIds().size() );
+    EXPECT_EQ( 5, embeddingLayer.gradientIds()[0] );
+    EXPECT_EQ( 9, embeddingLayer.gradientIds()[1] );
+    for (uint n = 0; n < 16; n++) {
+        EXPECT_EQ( 4.0, embeddingLayer.getErrors()[n] );
+        EXPECT_EQ( 2.0, embeddingLayer.getErrors()[16 + n] );
+    }
+
+    embeddingLayer.updateWba(0.5);
+    EXPECT_EQ( 0, embeddingLayer.gradientIds().size() );
+    for (uint i = 0; i < 100; i++) {
+        const double step = i == 5 ? 2.0 : i == 9 ? 1.0 : 0.0;
+        for (uint n = 0; n < 16; n++) EXPECT_EQ( before[i * 16 + n] - step, wba(n, i, 0, 0) );
+    }
+    for (uint n = 0; n < 16; n++) EXPECT_EQ( before[100 * 16 + n] - 3.0, wba(n, 100, 0, 0) );
+}
+
+TEST(frnnLayer, LstmForwardPassMatchesReference) {
+    frnnLayerLstmdCpu lstmLayer;
+    frnn::ExecutionContext ctx(2, 37);
+    const frnn::Tensor4<double>& wba = lstmLayer.getWBA();
+
+    lstmLayer.initializeWeights(ctx, -0.5, 0.5);
+    EXPECT_NE( 0.0, wba(19, 11, 1, 0) );                // The last recurrent weight is initialized too
+
+    // The state is kept between calls, so the timesteps continue one sequence
+    std::vector<double> h(5, 0.0), c(5, 0.0), ins(7), outs;
+    for (int t = 0; t < 4; t++) {
+        for (uint i = 0; i < 7; i++) ins[i] = static_cast<double>((i * 3 + t) % 5) / 5.0 - 0.4;
+        lstmLayer.forward(ctx, ins, outs);
+        lstmReferenceStep(wba, &ins[0], h, c);
+
+        ASSERT_EQ( 5, outs.size() );
+        for (uint n = 0; n < 5; n++) EXPECT_NEAR( h[n], outs[n], 1e-12 );
+    }
+}
+
+TEST(frnnLayer, LstmSequenceForwardPassMatchesPassesOfEachTimestep) {
+    frnnLayerLstmdCpu lstmLayer;
+    frnn::ExecutionContext ctx(2, 41);
+    const int STEPS = 6;
+
+    frnn::Tensor<double, 2> ins = {7, STEPS}, outs;
+    for (int t = 0; t < STEPS; t++) {
+        for (uint i = 0; i < 7; i++) ins(i, t) = static_cast<double>((i * (t + 2)) % 11) / 11.0 - 0.5;
+    }
+    lstmLayer.initializeWeights(ctx, -0.5, 0.5);
+    lstmLayer.forwardSequence(ctx, ins, outs);
+
+    ASSERT_EQ( 5, outs.size(0) );
+    ASSERT_EQ( STEPS, outs.size(1) );
+    lstmLayer.resetState();
+    for (int t = 0; t < STEPS; t++) {
+        std::vector<double> step_ins(&ins(0, t), &ins(0, t) + 7), step_outs;
+        lstmLayer.forward(ctx, step_ins, step_outs);
+        for (uint n = 0; n < 5; n++) EXPECT_NEAR( step_outs[n], outs(n, t), 1e-12 );
+    }
+}
+
+TEST(frnnLayer, LstmBackwardPassMatchesFiniteDifferences) {
+    frnnLayerLstmdCpu lstmLayer;
+    frnn::ExecutionContext ctx(2, 43);
+    const frnn::Tensor4<double>& wba = lstmLayer.getWBA();
+    const int    STEPS = 5;
+    const double EPS   = 1e-6;
+
+    frnn::Tensor<double, 2> ins = {7, STEPS}, coefs = {5, STEPS};
+    for (int t = 0; t < STEPS; t++) {
+        for (uint i = 0; i < 7; i++) ins(i, t)   = static_cast<double>((i * 5 + t) % 9) / 9.0 - 0.5;
+        for (uint n = 0; n < 5; n++) coefs(n, t) = static_cast<double>((n + 2 * t) % 7) / 7.0 - 0.3;
+    }
+    lstmLayer.initializeWeights(ctx, -0.5, 0.5);
+    const double loss = lstmSequenceLoss(lstmLayer, ctx, ins, coefs);
+    lstmLayer.backward(ctx, coefs);
+
+    // The errors are the gradients of the loss with respect to the inputs
+    for (int t = 0; t < STEPS; t++) {
+        for (uint i = 0; i < 7; i++) {
+            frnn::Tensor<double, 2> shifted = ins;
+            shifted(i, t) += EPS;
+            const double difference = (lstmSequenceLoss(lstmLayer, ctx, shifted, coefs) - loss) / EPS;
+            EXPECT_NEAR( difference, lstmLayer.getErrors()[t * 7 + i], 1e-5 );
+        }
+    }
+
+    // A step of rate r along the gradients g changes the loss by about -r * |g|^2 (summed over the pages), 
+    // where the step of each weight is -r * g
+    const double rate = 1e-6;
+    std::vector<double> before(&wba(0, 0, 0, 0), &wba(0, 0, 0, 0) + 20 * 14 * 2);
+    lstmLayer.setTrainingParameters(rate, 0.0);
+    lstmLayer.updateWba(ctx);
+
+    double expected = 0.0;
+    for (uint page = 0; page < 2; page++) {
+        for (uint col = 0; col < 13; col++) {
+            for (uint r = 0; r < 20; r++) {
+                const double step = wba(r, col, page, 0) - before[page * 20 * 14 + col * 20 + r];
+                expected -= step * step / rate;
+            }
+        }
+    }
+    EXPECT_GT( 0.0, expected );
+    EXPECT_NEAR( expected, lstmSequenceLoss(lstmLayer, ctx, ins, coefs) - loss, 1e-3 * std::abs(expected) );
+}
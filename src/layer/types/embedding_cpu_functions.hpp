@@ -0,0 +1,229 @@
+/*
+ *  Header file for fastRNN embedding layer cpu kernels.
+ *
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FRNN_EMBEDDING_KERNELS_CPU_
+#define _FRNN_EMBEDDING_KERNELS_CPU_
+
+#include <algorithm>
+#include <vector>
+
+#include "../../frnn/types.h"
+#include "../../util/errors.h"
+#include "../../math/execution_context.hpp"
+#include "../../tensor/tensor.cuh"
+#include "../../new_tensor/tensor.h"
+
+namespace frnn {
+namespace detail {
+
+// Number of tokens ahead of the one being gathered whose embeddings are prefetched
+constexpr size_t embeddingPrefetchDistance() { return 8; }
+
+// Checks that every id is a column of the weights, [0, num_inputs)
+inline bool embeddingIdsValid( const std::vector<int>& ids, uint num_inputs ) {
+    for ( size_t b = 0; b < ids.size(); b++ ) {
+        if ( ids[ b ] < 0 || static_cast<uint>( ids[ b ] ) >= num_inputs ) return false;
+    }
+    return true;
+}
+
+}   // Namespace detail
+
+/*
+ * ==========================================================================================================
+ * Function     : embeddingForwardCpu
+ *
+ * Description  : Forward propogates a batch of token ids through an embedding layer on the CPU. The output
+ *                of a token is column id of the weights of each page (plus the biases), summed over the
+ *                pages, which is the same as W*x + b for a one-hot x, but costs O(nodes) per token rather
+ *                than O(nodes * inputs). The columns of the tokens a few places ahead are prefetched while
+ *                a column is gathered, since the ids are random accesses into a (usually) large table.
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : ids           : The ids of the tokens, each in [0, num_inputs)
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer (the size of the vocabulary)
+ *
+ * Outputs      : outs          : The outputs of the layer, a [nodes x batch] tensor (one token per column,
+ *                                resized if the dimensions are wrong)
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void embeddingForwardCpu( ExecutionContext&         ctx       ,
+                          const std::vector<int>&   ids       ,
+                          const Tensor4<dType>&     wba       ,
+                          uint                      num_inputs ,
+                          Tensor<dType, 2>&         outs      ) {
+
+    frnnError    error;
+    const size_t nodes = wba.x(), batch = ids.size();
+
+    if ( !detail::embeddingIdsValid( ids, num_inputs ) ) {
+        frnn::err::dimError( error, stringify( ids ), stringify( num_inputs ) );
+        return;
+    }
+    if ( outs.size( 0 ) != nodes || outs.size( 1 ) != batch ) {
+        outs = Tensor<dType, 2>( { static_cast<int>( nodes ), static_cast<int>( batch ) } );
+    }
+    if ( batch == 0 ) return;
+
+    dType*       out      = outs.data().data();
+    const size_t distance = detail::embeddingPrefetchDistance();
+    const size_t lines    = ( nodes * sizeof( dType ) + 63 ) / 64;
+    const size_t chunks   = std::min( batch, static_cast<size_t>( ctx.threads() ) );
+
+    // Each thread gathers a contiguous range of the tokens
+    ctx.forEach( chunks, [&]( size_t chunk, int ) {
+        const size_t start = batch * chunk / chunks, end = batch * ( chunk + 1 ) / chunks;
+        for ( size_t b = start; b < end; b++ ) {
+            // The column of the token is on every page (the biases are reused, so they stay in cache)
+            if ( b + distance < end ) {
+                for ( uint page = 0; page < wba.z(); page++ ) {
+                    const char* ahead = reinterpret_cast<const char*>( &wba( 0, ids[ b + distance ], page, 0 ) );
+                    for ( size_t line = 0; line < lines; line++ ) __builtin_prefetch( ahead + line * 64 );
+                }
+            }
+
+            dType* column = out + b * nodes;
+            std::fill( column, column + nodes, dType( 0 ) );
+            for ( uint page = 0; page < wba.z(); page++ ) {
+                const dType* weights = &wba( 0, ids[ b ]  , page, 0 );
+                const dType* biases  = &wba( 0, num_inputs, page, 0 );
+                for ( size_t n = 0; n < nodes; n++ ) column[ n ] += weights[ n ] + biases[ n ];
+            }
+        }
+    } );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : embeddingBackwardCpu
+ *
+ * Description  : Accumulates the gradients of a batch of tokens for an embedding layer. Only the columns of
+ *                the weights which were gathered have a gradient, so the gradients are kept as a list of
+ *                the ids which have one and a row of gradients for each of those ids, and tokens with the
+ *                same id add to the same row. The gradients are added to the existing ones, so that many
+ *                batches can be accumulated before they are applied by embeddingUpdateCpu.
+ *
+ * Inputs       : ids           : The ids of the tokens the forward pass was given
+ *              : grads         : The gradients of the outputs, a [nodes x batch] tensor
+ *              : num_inputs    : The number of inputs to the layer (the size of the vocabulary)
+ *
+ * Outputs      : slots         : The index in grad_ids of each id which has a gradient (-1 for the others),
+ *                                which must have num_inputs elements
+ *              : grad_ids      : The ids which have a gradient
+ *              : grad_rows     : The gradients of the columns of grad_ids, nodes elements for each
+ *              : grad_biases   : The gradients of the biases
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void embeddingBackwardCpu( const std::vector<int>&   ids         ,
+                           const Tensor<dType, 2>&   grads       ,
+                           uint                      num_inputs  ,
+                           std::vector<int>&         slots       ,
+                           std::vector<int>&         grad_ids    ,
+                           std::vector<dType>&       grad_rows   ,
+                           std::vector<dType>&       grad_biases ) {
+
+    frnnError    error;
+    const size_t nodes = grads.size( 0 ), batch = ids.size();
+
+    if ( grads.size( 1 ) != batch ) {
+        frnn::err::dimError( error, stringify( grads ), stringify( ids ) );
+        return;
+    }
+    if ( !detail::embeddingIdsValid( ids, num_inputs ) || slots.size() != num_inputs ) {
+        frnn::err::dimError( error, stringify( ids ), stringify( num_inputs ) );
+        return;
+    }
+    if ( grad_biases.size() != nodes ) grad_biases.assign( nodes, dType( 0 ) );
+
+    const dType* grad = grads.data().data();
+    for ( size_t b = 0; b < batch; b++ ) {
+        if ( slots[ ids[ b ] ] < 0 ) {
+            slots[ ids[ b ] ] = static_cast<int>( grad_ids.size() );
+            grad_ids.push_back( ids[ b ] );
+            grad_rows.resize( grad_rows.size() + nodes, dType( 0 ) );
+        }
+        dType*       row    = &grad_rows[ slots[ ids[ b ] ] * nodes ];
+        const dType* column = grad + b * nodes;
+        for ( size_t n = 0; n < nodes; n++ ) {
+            row[ n ]         += column[ n ];
+            grad_biases[ n ] += column[ n ];
+        }
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : embeddingUpdateCpu
+ *
+ * Description  : Applies the accumulated gradients of an embedding layer to the weights and biases of each
+ *                page (only the columns which have a gradient are written), and then clears the gradients.
+ *
+ * Inputs       : rate          : The learning rate
+ *              : num_inputs    : The number of inputs to the layer (the size of the vocabulary)
+ *              : slots         : The slots of the ids which have a gradient (see embeddingBackwardCpu)
+ *              : grad_ids      : The ids which have a gradient
+ *              : grad_rows     : The gradients of the columns of grad_ids
+ *              : grad_biases   : The gradients of the biases
+ *
+ * Outputs      : wba           : The weights, biases, and activations tensor of the layer, with
+ *                                W[:, id] -= rate * grad_row and b -= rate * grad_biases on each page
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void embeddingUpdateCpu( dType                     rate        ,
+                         uint                      num_inputs  ,
+                         std::vector<int>&         slots       ,
+                         std::vector<int>&         grad_ids    ,
+                         std::vector<dType>&       grad_rows   ,
+                         std::vector<dType>&       grad_biases ,
+                         Tensor4<dType>&           wba         ) {
+
+    const size_t nodes = wba.x();
+    for ( uint page = 0; page < wba.z(); page++ ) {
+        for ( size_t k = 0; k < grad_ids.size(); k++ ) {
+            dType*       weights = &wba( 0, grad_ids[ k ], page, 0 );
+            const dType* row     = &grad_rows[ k * nodes ];
+            for ( size_t n = 0; n < nodes; n++ ) weights[ n ] -= rate * row[ n ];
+        }
+        if ( grad_biases.size() == nodes ) {
+            dType* biases = &wba( 0, num_inputs, page, 0 );
+            for ( size_t n = 0; n < nodes; n++ ) biases[ n ] -= rate * grad_biases[ n ];
+        }
+    }
+
+    // Only the slots which were used need to be reset, which is O(ids) rather than O(inputs)
+    for ( size_t k = 0; k < grad_ids.size(); k++ ) slots[ grad_ids[ k ] ] = -1;
+    grad_ids.clear();
+    grad_rows.clear();
+    std::fill( grad_biases.begin(), grad_biases.end(), dType( 0 ) );
+}
+
+}   // Namespace frnn
+
+#endif
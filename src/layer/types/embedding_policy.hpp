@@ -0,0 +1,152 @@
+/*
+ *  Header file for fastRNN embedding policy class.
+ *
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FRNN_EMBEDDING_POLICY_
+#define _FRNN_EMBEDDING_POLICY_
+
+#include <vector>
+
+#include "../../tensor/tensor.cuh"
+#include "../../new_tensor/tensor.h"
+#include "../../frnn/frnn.h"
+#include "embedding_cpu_functions.hpp"
+
+namespace frnn {
+namespace ltype {
+
+/*
+ * ==========================================================================================================
+ * Class        : EmbeddingPolicy
+ *
+ * Desription   : Policy class for an embedding (input) layer, which takes the ids of tokens rather than
+ *                one-hot vectors, and gathers the column of the weights for each id, rather than doing a
+ *                GEMV with a one-hot vector.
+ *
+ * Params       : dType     : The type of data for the network
+ *              : device    : The device type to use (CPU or GPU)
+ *              : nodes     : The number of nodes for the layer (the size of each embedding)
+ *              : inputs    : The number of inputs to the layer (the size of the vocabulary)
+ *              : depth     : The number of pages of weights, whose embeddings are summed
+ *
+ * Note         : The wba tensor has the same layout as for the SoftmaxPolicy, so the embedding of token id
+ *                is column id of the weights of each page (which is contiguous), and the biases follow
+ *                the weights. A gather costs O(nodes) and is the same for both devices, so both use the CPU
+ *                functions (moving a batch of embeddings to the GPU would cost more than the gather).
+ * ==========================================================================================================
+ */
+template <typename          dType,
+          frnn::device      dev,
+          uint              nodes,
+          uint              inputs,
+          uint              depth>
+class EmbeddingPolicy {
+
+    public:
+        /*
+         * ==================================================================================================
+         * Function     : EmbeddingPolicy
+         *
+         * Description  : Constructor for the embeddingPolicy. Sets the tensor (wba) which holds the weights
+         *                and biases, and the number of inputs for the layer.
+         * ==================================================================================================
+         */
+        explicit EmbeddingPolicy() :
+            wba(nodes, std::max(inputs, nodes) + 2, depth, 1, numa::placement::FIRST_TOUCH), 
+            num_inputs(inputs), grad_slots(inputs, -1) {}
+
+        /*
+         * ==================================================================================================
+         * Function     : forward
+         *
+         * Description  : Forward propogates a batch of token ids through the layer, gathering the embedding
+         *                of each token.
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : ids   : The ids of the tokens, each in [0, inputs)
+         *
+         * Outputs      : outs  : The embeddings, a [nodes x batch] tensor (one token per column)
+         * ==================================================================================================
+         */
+        void forward(ExecutionContext& ctx, const std::vector<int>& ids, Tensor<dType, 2>& outs) {
+            embeddingForwardCpu(ctx, ids, wba, num_inputs, outs);
+        }
+
+        // Forward propogates a batch of token ids using the context of the calling thread
+        void forward(const std::vector<int>& ids, Tensor<dType, 2>& outs) {
+            forward(ExecutionContext::threadDefault(), ids, outs);
+        }
+
+        /*
+         * ==================================================================================================
+         * Function     : backward
+         *
+         * Description  : Accumulates the gradients of a batch of tokens, which are only kept for the ids in
+         *                the batch, until they are applied by updateWba.
+         *
+         * Inputs       : ids       : The ids of the tokens the forward pass was given
+         *              : grads     : The gradients of the outputs, a [nodes x batch] tensor
+         *
+         * Outputs      : The gradients of the columns of the ids are added to the errors vector, with the
+         *                gradients of gradientIds()[k] starting at k * nodes
+         * ==================================================================================================
+         */
+        void backward(const std::vector<int>& ids, const Tensor<dType, 2>& grads) {
+            embeddingBackwardCpu(ids, grads, num_inputs, grad_slots, grad_ids, errors, grad_biases);
+        }
+
+        /*
+         * ==================================================================================================
+         * Function     : updateWba
+         *
+         * Description  : Applies the accumulated gradients to the weights and biases (only the columns of
+         *                the ids which have a gradient are changed), and clears the gradients
+         *
+         * Inputs       : rate  : The learning rate
+         * ==================================================================================================
+         */
+        void updateWba(dType rate) {
+            embeddingUpdateCpu(rate, num_inputs, grad_slots, grad_ids, errors, grad_biases, wba);
+        }
+
+        // The ids which have an accumulated gradient, in the order of their gradients in the errors
+        const std::vector<int>& gradientIds() const { return grad_ids; }
+
+        /*
+         * ==================================================================================================
+         * Function     : weightsChanged
+         *
+         * Description  : Tells the layer that the weights in wba have changed (the embeddings are always
+         *                read from wba, so there is nothing to do).
+         * ==================================================================================================
+         */
+        void weightsChanged() {}
+
+    protected:
+        Tensor4<dType>      wba;             // Tensor for weights and biases
+        std::vector<dType>  errors;          // Accumulated gradients of the columns of grad_ids
+        uint                num_inputs;      // Number of inputs for the layer
+        std::vector<int>    grad_slots;      // Index of each id in grad_ids (-1 if it has no gradient)
+        std::vector<int>    grad_ids;        // Ids which have an accumulated gradient
+        std::vector<dType>  grad_biases;     // Accumulated gradients of the biases
+};
+
+}   // Namepsace ltype
+}   // Namepsace frnn
+#endif
@@ -0,0 +1,506 @@
+/*
+ *  Header file for fastRNN lstm layer cpu kernels.
+ *
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FRNN_LSTM_KERNELS_CPU_
+#define _FRNN_LSTM_KERNELS_CPU_
+
+#include <algorithm>
+#include <vector>
+
+#include "../../frnn/types.h"
+#include "../../frnn/vectorized_math_cpu.h"
+#include "../../util/errors.h"
+#include "../../math/math.hpp"
+#include "../../math/blas/frnn_blas.h"
+#include "../../math/execution_context.hpp"
+#include "../../tensor/tensor.cuh"
+#include "../../new_tensor/tensor.h"
+
+/*
+ * =========================================== NOTES ========================================================
+ *
+ * 1. The weights of the four gates (input, forget, cell and output) are stacked into one matrix, so the
+ *    wba tensor of an lstm layer with N nodes and I inputs is [4N x (I + N + 2) x depth x 1] :
+ *
+ *      | W_xi  W_hi  b_i |     rows [ 0N, 1N ) : input gate
+ *      | W_xf  W_hf  b_f |     rows [ 1N, 2N ) : forget gate
+ *      | W_xg  W_hg  b_g |     rows [ 2N, 3N ) : cell gate
+ *      | W_xo  W_ho  b_o |     rows [ 3N, 4N ) : output gate
+ *
+ *    where columns [ 0, I ) multiply the inputs, columns [ I, I + N ) multiply the outputs of the previous
+ *    timestep, and column I + N is the biases. The pre-activations of all of the gates are then one GEMV
+ *    (or GEMM for many timesteps) with the stacked inputs [ x; h ], and the nonlinearities and the cell
+ *    update are one pass over the pre-activations (LstmCellKernel). The pages are summed, as for the
+ *    other layer types.
+ *
+ * 2. The gates of timestep t are stored (after the nonlinearities) as column t of a [4N x T] tensor, and
+ *    the cells and outputs as column t + 1 of [N x (T + 1)] tensors whose first column is the state the
+ *    sequence started from, so the backward pass has everything it needs without any recomputation, and
+ *    the outputs of the previous timesteps are a contiguous [N x T] matrix for the weight gradients.
+ * ==========================================================================================================
+ */
+
+namespace frnn   {
+namespace cpu    {
+namespace detail {
+
+/*
+ * ==========================================================================================================
+ * Struct       : LstmCellKernel
+ *
+ * Description  : Kernel which applies the gate nonlinearities and the cell update of an lstm layer, for
+ *                each node, in one pass :
+ *
+ *                i = sigmoid( a_i ), f = sigmoid( a_f ), g = tanh( a_g ), o = sigmoid( a_o )
+ *                c = f * c_prev + i * g
+ *                h = o * tanh( c )
+ *
+ * Inputs       : gates     : The pre-activations of the gates, [ a_i; a_f; a_g; a_o ] (N elements each)
+ *              : c_prev    : The cells of the previous timestep
+ *              : N         : The number of nodes
+ *
+ * Outputs      : gates     : The gates, [ i; f; g; o ], which replace the pre-activations
+ *              : c         : The cells
+ *              : h         : The outputs
+ * ==========================================================================================================
+ */
+struct LstmCellKernel {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static void apply( dType* gates, const dType* c_prev, dType* c, dType* h, size_t N ) {
+        const size_t step = VectorizedInstructionsCpu<dType, level>::typeSize();
+        size_t i = 0;
+        for ( ; i + step <= N; i += step ) cell<level>( gates + i, c_prev + i, c + i, h + i, N, step );
+        if ( i < N ) cell<level>( gates + i, c_prev + i, c + i, h + i, N, N - i );
+    }
+
+private:
+    // Updates n <= typeSize() nodes (fewer only for the tail)
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static void cell( dType* gates, const dType* c_prev, dType* c, dType* h, size_t N,
+                                        size_t n ) {
+        typedef VectorizedInstructionsCpu<dType, level> vect_ins;
+        typedef VectorizedMathCpu<dType, level>         vect_math;
+        typedef typename vect_ins::vect_type            vect_type;
+
+        const vect_type i_gate = vect_math::mm_sigmoid_p( vect_ins::mm_load_n( gates        , n ) );
+        const vect_type f_gate = vect_math::mm_sigmoid_p( vect_ins::mm_load_n( gates + N    , n ) );
+        const vect_type g_gate = vect_math::mm_tanh_p(    vect_ins::mm_load_n( gates + 2 * N, n ) );
+        const vect_type o_gate = vect_math::mm_sigmoid_p( vect_ins::mm_load_n( gates + 3 * N, n ) );
+        const vect_type cells  = vect_ins::mm_fmadd_p( f_gate, vect_ins::mm_load_n( c_prev, n ),
+                                                       vect_ins::mm_mul_p( i_gate, g_gate ) );
+
+        vect_ins::mm_store_n( gates        , i_gate, n );
+        vect_ins::mm_store_n( gates + N    , f_gate, n );
+        vect_ins::mm_store_n( gates + 2 * N, g_gate, n );
+        vect_ins::mm_store_n( gates + 3 * N, o_gate, n );
+        vect_ins::mm_store_n( c, cells, n );
+        vect_ins::mm_store_n( h, vect_ins::mm_mul_p( o_gate, vect_math::mm_tanh_p( cells ) ), n );
+    }
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : LstmCellBackwardKernel
+ *
+ * Description  : Kernel which determines the gradients of the pre-activations of the gates of an lstm
+ *                layer for one timestep, from the gradients of its outputs and cells, in one pass :
+ *
+ *                dc      = dc + dh * o * ( 1 - tanh( c )^2 )
+ *                da_i    = dc * g * i * ( 1 - i )
+ *                da_f    = dc * c_prev * f * ( 1 - f )
+ *                da_g    = dc * i * ( 1 - g^2 )
+ *                da_o    = dh * tanh( c ) * o * ( 1 - o )
+ *                dc_prev = dc * f
+ *
+ * Inputs       : gates     : The gates of the timestep, [ i; f; g; o ]
+ *              : c_prev    : The cells of the previous timestep
+ *              : c         : The cells of the timestep
+ *              : dh        : The gradients of the outputs of the timestep
+ *              : dc        : The gradients of the cells of the timestep from the next timestep
+ *              : N         : The number of nodes
+ *
+ * Outputs      : dc        : The gradients of the cells of the previous timestep
+ *              : dgates    : The gradients of the pre-activations of the gates, [ da_i; da_f; da_g; da_o ]
+ * ==========================================================================================================
+ */
+struct LstmCellBackwardKernel {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static void apply( const dType* gates, const dType* c_prev, const dType* c,
+                                         const dType* dh, dType* dc, dType* dgates, size_t N ) {
+        const size_t step = VectorizedInstructionsCpu<dType, level>::typeSize();
+        size_t i = 0;
+        for ( ; i + step <= N; i += step ) {
+            cell<level>( gates + i, c_prev + i, c + i, dh + i, dc + i, dgates + i, N, step );
+        }
+        if ( i < N ) cell<level>( gates + i, c_prev + i, c + i, dh + i, dc + i, dgates + i, N, N - i );
+    }
+
+private:
+    // Determines the gradients of n <= typeSize() nodes (fewer only for the tail)
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static void cell( const dType* gates, const dType* c_prev, const dType* c,
+                                        const dType* dh, dType* dc, dType* dgates, size_t N, size_t n ) {
+        typedef VectorizedInstructionsCpu<dType, level> vect_ins;
+        typedef VectorizedMathCpu<dType, level>         vect_math;
+        typedef typename vect_ins::vect_type            vect_type;
+
+        const vect_type one    = vect_ins::mm_set1( dType( 1 ) );
+        const vect_type i_gate = vect_ins::mm_load_n( gates        , n );
+        const vect_type f_gate = vect_ins::mm_load_n( gates + N    , n );
+        const vect_type g_gate = vect_ins::mm_load_n( gates + 2 * N, n );
+        const vect_type o_gate = vect_ins::mm_load_n( gates + 3 * N, n );
+        const vect_type grad_h = vect_ins::mm_load_n( dh, n );
+        const vect_type tanh_c = vect_math::mm_tanh_p( vect_ins::mm_load_n( c, n ) );
+
+        // The derivatives of the nonlinearities, s * ( 1 - s ) and 1 - t^2
+        const vect_type d_tanh_c = vect_ins::mm_sub_p( one, vect_ins::mm_mul_p( tanh_c, tanh_c ) );
+        const vect_type d_i      = vect_ins::mm_mul_p( i_gate, vect_ins::mm_sub_p( one, i_gate ) );
+        const vect_type d_f      = vect_ins::mm_mul_p( f_gate, vect_ins::mm_sub_p( one, f_gate ) );
+        const vect_type d_g      = vect_ins::mm_sub_p( one, vect_ins::mm_mul_p( g_gate, g_gate ) );
+        const vect_type d_o      = vect_ins::mm_mul_p( o_gate, vect_ins::mm_sub_p( one, o_gate ) );
+
+        const vect_type grad_c = vect_ins::mm_fmadd_p( vect_ins::mm_mul_p( grad_h, o_gate ), d_tanh_c,
+                                                       vect_ins::mm_load_n( dc, n ) );
+
+        vect_ins::mm_store_n( dgates        , vect_ins::mm_mul_p( vect_ins::mm_mul_p( grad_c, g_gate ), d_i ), n );
+        vect_ins::mm_store_n( dgates + N    , vect_ins::mm_mul_p( vect_ins::mm_mul_p( grad_c,
+                                                  vect_ins::mm_load_n( c_prev, n ) ), d_f ), n );
+        vect_ins::mm_store_n( dgates + 2 * N, vect_ins::mm_mul_p( vect_ins::mm_mul_p( grad_c, i_gate ), d_g ), n );
+        vect_ins::mm_store_n( dgates + 3 * N, vect_ins::mm_mul_p( vect_ins::mm_mul_p( grad_h, tanh_c ), d_o ), n );
+        vect_ins::mm_store_n( dc, vect_ins::mm_mul_p( grad_c, f_gate ), n );
+    }
+};
+
+}   // Namespace detail
+}   // Namespace cpu
+
+/*
+ * ==========================================================================================================
+ * Function     : lstmForwardCpu
+ *
+ * Description  : Forward propogates one timestep through an lstm layer on the CPU. The inputs and the
+ *                outputs of the previous timestep are stacked, so the pre-activations of all four gates are
+ *                one GEMV of the stacked weights of each page, which is followed by one fused pass for the
+ *                nonlinearities and the cell update (see the notes above).
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : ins           : The inputs of the timestep, num_inputs elements
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *              : h_prev        : The outputs of the previous timestep
+ *              : c_prev        : The cells of the previous timestep
+ *
+ * Outputs      : gates         : The gates of the timestep, 4 * nodes elements
+ *              : c             : The cells of the timestep
+ *              : h             : The outputs of the timestep
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void lstmForwardCpu( ExecutionContext&         ctx        ,
+                     const dType*              ins        ,
+                     const Tensor4<dType>&     wba        ,
+                     uint                      num_inputs ,
+                     const dType*              h_prev     ,
+                     const dType*              c_prev     ,
+                     dType*                    gates      ,
+                     dType*                    c          ,
+                     dType*                    h          ) {
+
+    const dType  one   = dType( 1 );
+    const size_t rows  = wba.x(), nodes = rows / 4;
+    dType*       stack = ctx.scratch<dType>( num_inputs + nodes );
+
+    std::copy( ins, ins + num_inputs, stack );
+    std::copy( h_prev, h_prev + nodes, stack + num_inputs );
+    std::fill( gates, gates + rows, dType( 0 ) );
+
+    for ( uint page = 0; page < wba.z(); page++ ) {
+        const dType* biases = &wba( 0, num_inputs + nodes, page, 0 );
+        for ( size_t r = 0; r < rows; r++ ) gates[ r ] += biases[ r ];
+
+        frnn::blas::functions<dType, device::CPU>::gemv(
+                ctx.blasHandle(), blas::BLAS_OP_N, rows, num_inputs + nodes, &one, &wba( 0, 0, page, 0 ),
+                rows            , stack          , 1   , &one              , gates, 1                     );
+    }
+    frnn::cpu::dispatch<frnn::cpu::detail::LstmCellKernel>( gates, c_prev, c, h, nodes );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : lstmProjectCpu
+ *
+ * Description  : Determines the input projections (W_x * x + b) of the gates of an lstm layer for every
+ *                timestep of a sequence at once. They do not depend on the recurrence, so each page is one
+ *                GEMM for the whole sequence, and each timestep then only needs the GEMV of the outputs of
+ *                the previous timestep (see lstmStepCpu).
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : ins           : The inputs of the sequence, an [inputs x T] tensor (one timestep per column)
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *
+ * Outputs      : gates         : The projections, a [4 * nodes x T] tensor (resized if the dimensions are
+ *                                wrong)
+ *              : If the projections were determined (the inputs have the right size)
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+bool lstmProjectCpu( ExecutionContext&         ctx        ,
+                     const Tensor<dType, 2>&   ins        ,
+                     const Tensor4<dType>&     wba        ,
+                     uint                      num_inputs ,
+                     Tensor<dType, 2>&         gates      ) {
+
+    frnnError    error;
+    const dType  one   = dType( 1 );
+    const size_t rows  = wba.x(), nodes = rows / 4, steps = ins.size( 1 );
+
+    if ( ins.size( 0 ) != num_inputs ) {
+        frnn::err::dimError( error, stringify( ins ), stringify( num_inputs ) );
+        return false;
+    }
+    if ( gates.size( 0 ) != rows || gates.size( 1 ) != steps ) {
+        gates = Tensor<dType, 2>( { static_cast<int>( rows ), static_cast<int>( steps ) } );
+    }
+
+    dType*       projections = gates.data().data();
+    const dType* x           = ins.data().data();
+    std::fill( projections, projections + rows * steps, dType( 0 ) );
+
+    for ( uint page = 0; page < wba.z(); page++ ) {
+        const dType* biases = &wba( 0, num_inputs + nodes, page, 0 );
+        for ( size_t t = 0; t < steps; t++ ) {
+            for ( size_t r = 0; r < rows; r++ ) projections[ t * rows + r ] += biases[ r ];
+        }
+
+        if ( steps == 1 ) {
+            frnn::blas::functions<dType, device::CPU>::gemv(
+                    ctx.blasHandle(), blas::BLAS_OP_N, rows, num_inputs, &one, &wba( 0, 0, page, 0 ),
+                    rows            , x              , 1   , &one      , projections, 1               );
+        } else {
+            frnn::blas::functions<dType, device::CPU>::gemm(
+                    ctx.blasHandle(), blas::BLAS_OP_N, blas::BLAS_OP_N, rows, steps, num_inputs, &one,
+                    &wba( 0, 0, page, 0 ), rows, x, num_inputs, &one, projections, rows                );
+        }
+    }
+    return true;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : lstmStepCpu
+ *
+ * Description  : Forward propogates one timestep of a sequence through an lstm layer on the CPU, whose input
+ *                projections were determined by lstmProjectCpu, by adding W_h * h_prev of each page to the
+ *                projections and then applying the fused gate and cell pass.
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *              : h_prev        : The outputs of the previous timestep
+ *              : c_prev        : The cells of the previous timestep
+ *              : gates         : The input projections of the timestep, 4 * nodes elements
+ *
+ * Outputs      : gates         : The gates of the timestep, which replace the projections
+ *              : c             : The cells of the timestep
+ *              : h             : The outputs of the timestep
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void lstmStepCpu( ExecutionContext&         ctx        ,
+                  const Tensor4<dType>&     wba        ,
+                  uint                      num_inputs ,
+                  const dType*              h_prev     ,
+                  const dType*              c_prev     ,
+                  dType*                    gates      ,
+                  dType*                    c          ,
+                  dType*                    h          ) {
+
+    const dType  one  = dType( 1 );
+    const size_t rows = wba.x(), nodes = rows / 4;
+
+    for ( uint page = 0; page < wba.z(); page++ ) {
+        frnn::blas::functions<dType, device::CPU>::gemv(
+                ctx.blasHandle(), blas::BLAS_OP_N, rows, nodes, &one, &wba( 0, num_inputs, page, 0 ),
+                rows            , h_prev         , 1   , &one , gates, 1                              );
+    }
+    frnn::cpu::dispatch<frnn::cpu::detail::LstmCellKernel>( gates, c_prev, c, h, nodes );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : lstmBackwardCpu
+ *
+ * Description  : Backward propogates the gradients of the outputs of a sequence through an lstm layer on the
+ *                CPU (backpropogation through time, from the start of the sequence). Only the gradients of
+ *                the gates depend on the next timestep, so they are determined in reverse order, with the
+ *                fused backward pass and a GEMV of the transposed recurrent weights for each timestep, and
+ *                then the gradients of all of the weights, and the errors of the inputs, are GEMMs for the
+ *                whole sequence. The pages are summed in the forward pass, so they all have the same
+ *                gradients, which are only determined once, and are added to the existing gradients, so
+ *                that many sequences can be accumulated before they are applied by lstmUpdateWbaCpu.
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : grads         : The gradients of the outputs, a [nodes x T] tensor
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *              : ins           : The inputs of the sequence, an [inputs x T] tensor
+ *              : gates         : The gates of the sequence, a [4 * nodes x T] tensor
+ *              : cells         : The cells of the sequence, a [nodes x (T + 1)] tensor (see the notes)
+ *              : hidden        : The outputs of the sequence, a [nodes x (T + 1)] tensor (see the notes)
+ *
+ * Outputs      : wba_grads     : The gradients of the weights and biases, a [4 * nodes x (inputs + nodes + 2)
+ *                                x 1 x 1] tensor with the layout of one page of wba, which are added to
+ *              : errors        : The errors of the inputs, inputs elements for each timestep
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void lstmBackwardCpu( ExecutionContext&         ctx        ,
+                      const Tensor<dType, 2>&   grads      ,
+                      const Tensor4<dType>&     wba        ,
+                      uint                      num_inputs ,
+                      const Tensor<dType, 2>&   ins        ,
+                      const Tensor<dType, 2>&   gates      ,
+                      const Tensor<dType, 2>&   cells      ,
+                      const Tensor<dType, 2>&   hidden     ,
+                      Tensor4<dType>&           wba_grads  ,
+                      std::vector<dType>&       errors     ) {
+
+    frnnError    error;
+    const dType  one   = dType( 1 ), zero = dType( 0 );
+    const size_t rows  = wba.x(), nodes = rows / 4, steps = gates.size( 1 );
+
+    if ( grads.size( 0 ) != nodes || grads.size( 1 ) != steps || steps == 0 ) {
+        frnn::err::dimError( error, stringify( grads ), stringify( gates ) );
+        return;
+    }
+
+    // Gradients of the gates of every timestep, then of the outputs and the cells of one timestep
+    dType* dgates = ctx.scratch<dType>( rows * steps + 2 * nodes );
+    dType* dh     = dgates + rows * steps;
+    dType* dc     = dh + nodes;
+    std::fill( dh, dh + 2 * nodes, dType( 0 ) );
+
+    const dType* grad = grads.data().data();
+    const dType* gate = gates.data().data();
+    const dType* cell = cells.data().data();
+    for ( size_t t = steps; t-- > 0; ) {
+        for ( size_t n = 0; n < nodes; n++ ) dh[ n ] += grad[ t * nodes + n ];
+
+        frnn::cpu::dispatch<frnn::cpu::detail::LstmCellBackwardKernel>(
+                gate + t * rows, cell + t * nodes, cell + ( t + 1 ) * nodes, dh, dc, dgates + t * rows, nodes );
+        if ( t == 0 ) break;
+
+        // dh_prev = W_h^T * dgates, summed over the pages
+        for ( uint page = 0; page < wba.z(); page++ ) {
+            frnn::blas::functions<dType, device::CPU>::gemv(
+                    ctx.blasHandle(), blas::BLAS_OP_T, rows, nodes, &one, &wba( 0, num_inputs, page, 0 ),
+                    rows            , dgates + t * rows, 1   , page == 0 ? &zero : &one, dh, 1           );
+        }
+    }
+
+    // dW_x += dgates * X^T, dW_h += dgates * H_prev^T, where the previous outputs are the first T columns
+    frnn::blas::functions<dType, device::CPU>::gemm(
+            ctx.blasHandle(), blas::BLAS_OP_N, blas::BLAS_OP_T, rows, num_inputs, steps, &one, dgates, rows,
+            ins.data().data(), num_inputs, &one, &wba_grads( 0, 0, 0, 0 ), rows                            );
+    frnn::blas::functions<dType, device::CPU>::gemm(
+            ctx.blasHandle(), blas::BLAS_OP_N, blas::BLAS_OP_T, rows, nodes, steps, &one, dgates, rows,
+            hidden.data().data(), nodes, &one, &wba_grads( 0, num_inputs, 0, 0 ), rows                          );
+
+    dType* grad_biases = &wba_grads( 0, num_inputs + nodes, 0, 0 );
+    for ( size_t t = 0; t < steps; t++ ) {
+        for ( size_t r = 0; r < rows; r++ ) grad_biases[ r ] += dgates[ t * rows + r ];
+    }
+
+    // errors = W_x^T * dgates, summed over the pages
+    errors.resize( num_inputs * steps );
+    for ( uint page = 0; page < wba.z(); page++ ) {
+        frnn::blas::functions<dType, device::CPU>::gemm(
+                ctx.blasHandle(), blas::BLAS_OP_T, blas::BLAS_OP_N, num_inputs, steps, rows, &one,
+                &wba( 0, 0, page, 0 ), rows, dgates, rows, page == 0 ? &zero : &one, &errors[ 0 ], num_inputs );
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : lstmUpdateWbaCpu
+ *
+ * Description  : Applies the accumulated gradients of an lstm layer to the weights and biases of every page,
+ *                by gradient descent with momentum, and then clears the gradients. The weights and the
+ *                biases of a page are contiguous (the rows are all of the gates), so each page is one pass
+ *                of the gradient step kernel, which is split into blocks between the threads of the context
+ *                when there are enough weights.
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : num_inputs    : The number of inputs to the layer
+ *              : learn_rate    : The learning rate
+ *              : momentum      : The momentum
+ *
+ * Outputs      : wba_grads     : The accumulated gradients (see lstmBackwardCpu), which are cleared
+ *              : wba           : The weights, biases, and activations tensor of the layer, updated in place
+ *              : deltas        : The steps of the previous update for each weight and bias (with the same
+ *                                layout as wba), which are replaced by the steps of this update
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void lstmUpdateWbaCpu( ExecutionContext&         ctx        ,
+                       uint                      num_inputs ,
+                       dType                     learn_rate ,
+                       dType                     momentum   ,
+                       Tensor4<dType>&           wba_grads  ,
+                       Tensor4<dType>&           wba        ,
+                       Tensor4<dType>&           deltas     ) {
+
+    namespace kernels = frnn::cpu::detail;
+    const size_t rows     = wba.x(), nodes = rows / 4;
+    const size_t elements = rows * ( num_inputs + nodes + 1 );
+    const size_t block    = kernels::mathBlockSize();
+    const size_t blocks   = ( elements + block - 1 ) / block;
+    dType*       grads    = &wba_grads( 0, 0, 0, 0 );
+
+    auto update_block = [&]( size_t index, int ) {
+        const uint   page  = index / blocks;
+        const size_t start = ( index % blocks ) * block;
+        frnn::cpu::dispatch<kernels::GradientStepKernel>( &wba( 0, 0, page, 0 ) + start,
+                &deltas( 0, 0, page, 0 ) + start, grads + start, -learn_rate, momentum,
+                std::min( block, elements - start ) );
+    };
+
+    if ( elements * wba.z() < kernels::mathParallelSize() ) {
+        for ( size_t index = 0; index < blocks * wba.z(); index++ ) update_block( index, 0 );
+    } else {
+        ctx.forEach( blocks * wba.z(), update_block );
+    }
+    std::fill( grads, grads + elements, dType( 0 ) );
+}
+
+}   // Namespace frnn
+
+#endif
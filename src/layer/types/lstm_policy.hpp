@@ -0,0 +1,269 @@
+/*
+ *  Header file for fastRNN lstm policy class.
+ *
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FRNN_LSTM_POLICY_
+#define _FRNN_LSTM_POLICY_
+
+#include <vector>
+
+#include "../../tensor/tensor.cuh"
+#include "../../new_tensor/tensor.h"
+#include "../../frnn/frnn.h"
+#include "lstm_cpu_functions.hpp"
+
+namespace frnn {
+namespace ltype {
+
+/*
+ * ==========================================================================================================
+ * Class        : LstmPolicy
+ *
+ * Desription   : Policy class for an lstm layer, which defines the forward and backward propogations. The
+ *                layer keeps its outputs and cells between calls, so consecutive calls continue the same
+ *                sequence until resetState is called.
+ *
+ * Params       : dType     : The type of data for the network
+ *              : device    : The device type to use (CPU or GPU)
+ *              : nodes     : The number of nodes for the layer
+ *              : inputs    : The number of inputs to the layer
+ *              : depth     : The number of pages of weights, whose pre-activations are summed
+ *
+ * Note         : The weights of the four gates are stacked into one [4 * nodes x (inputs + nodes)] matrix
+ *                for each page, followed by the biases (see the notes in lstm_cpu_functions.hpp), so a
+ *                timestep is one GEMV and one fused pass for the gates and the cells. The timesteps of a
+ *                sequence must be done in order, and each one is too small to be worth moving to the GPU,
+ *                so both devices use the CPU functions.
+ * ==========================================================================================================
+ */
+template <typename          dType,
+          frnn::device      dev,
+          uint              nodes,
+          uint              inputs,
+          uint              depth>
+class LstmPolicy {
+
+    public:
+        // Each timestep depends on the previous one
+        static constexpr bool recurrent = true;
+
+        /*
+         * ==================================================================================================
+         * Function     : LstmPolicy
+         *
+         * Description  : Constructor for the lstmPolicy. Sets the tensor (wba) which holds the weights
+         *                and biases of the four gates, and the number of inputs for the layer.
+         * ==================================================================================================
+         */
+        explicit LstmPolicy() :
+            wba(4 * nodes, inputs + nodes + 2, depth, 1, numa::placement::FIRST_TOUCH),
+            wba_prev(4 * nodes, inputs + nodes + 2, depth, 1, numa::placement::FIRST_TOUCH),
+            wba_grads(4 * nodes, inputs + nodes + 2, 1, 1), num_inputs(inputs), learn_rate(0.01),
+            momentum(0), state_h(nodes, 0), state_c(nodes, 0) {}
+
+        /*
+         * ==================================================================================================
+         * Function     : forward
+         *
+         * Description  : Forward propogates one timestep through the layer, continuing from the state of
+         *                the previous call. The timestep is kept as a sequence of one timestep for backward.
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : ins   : The inputs to the layer, inputs elements
+         *
+         * Outputs      : outs  : The outputs of the layer, nodes elements
+         * ==================================================================================================
+         */
+        void forward(ExecutionContext& ctx, const std::vector<dType>& ins, std::vector<dType>& outs) {
+            frnnError error;
+            if (ins.size() != num_inputs) {
+                frnn::err::dimError(error, stringify(ins), stringify(num_inputs));
+                return;
+            }
+
+            // The tensors of a timestep are only sized again after a longer sequence has been run
+            if (seq_ins.size(1) != 1) seq_ins = Tensor<dType, 2>({static_cast<int>(num_inputs), 1});
+            if (gates.size(1) != 1)   gates   = Tensor<dType, 2>({4 * static_cast<int>(nodes), 1});
+            startSequence(1);
+            std::copy(ins.begin(), ins.end(), &seq_ins(0, 0));
+
+            lstmForwardCpu(ctx, &ins[0], wba, num_inputs, &hidden(0, 0), &cells(0, 0), &gates(0, 0),
+                           &cells(0, 1), &hidden(0, 1));
+            outs.assign(&hidden(0, 1), &hidden(0, 1) + nodes);
+            endSequence();
+        }
+
+        // Forward propogates one timestep using the context of the calling thread
+        void forward(const std::vector<dType>& ins, std::vector<dType>& outs) {
+            forward(ExecutionContext::threadDefault(), ins, outs);
+        }
+
+        /*
+         * ==================================================================================================
+         * Function     : projectSequence
+         *
+         * Description  : Determines the input projections of the gates for every timestep of a sequence
+         *                (one GEMM for each page), and keeps the inputs for the backward pass.
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : ins   : The inputs of the sequence, an [inputs x T] tensor
+         *
+         * Outputs      : outs  : The outputs of the sequence, resized to [nodes x T]
+         *              : If the projections were determined (the inputs have the right size)
+         * ==================================================================================================
+         */
+        bool projectSequence(ExecutionContext& ctx, const Tensor<dType, 2>& ins, Tensor<dType, 2>& outs) {
+            if (!lstmProjectCpu(ctx, ins, wba, num_inputs, gates)) return false;
+
+            const size_t steps = ins.size(1);
+            if (outs.size(0) != nodes || outs.size(1) != steps) {
+                outs = Tensor<dType, 2>({static_cast<int>(nodes), static_cast<int>(steps)});
+            }
+            seq_ins = ins;
+            startSequence(steps);
+            return true;
+        }
+
+        /*
+         * ==================================================================================================
+         * Function     : sequenceStep
+         *
+         * Description  : Forward propogates timestep t of the sequence given to projectSequence, which
+         *                must follow timestep t - 1.
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : t     : The timestep
+         *
+         * Outputs      : outs  : The outputs of the sequence, of which column t is written
+         * ==================================================================================================
+         */
+        void sequenceStep(ExecutionContext& ctx, size_t t, Tensor<dType, 2>& outs) {
+            lstmStepCpu(ctx, wba, num_inputs, &hidden(0, t), &cells(0, t), &gates(0, t), &cells(0, t + 1),
+                        &hidden(0, t + 1));
+            std::copy(&hidden(0, t + 1), &hidden(0, t + 1) + nodes, &outs(0, t));
+            if (t + 1 == gates.size(1)) endSequence();
+        }
+
+        /*
+         * ==================================================================================================
+         * Function     : backward
+         *
+         * Description  : Backward propogates the gradients of the outputs of the last sequence (or
+         *                timestep) through the layer, and accumulates the gradients of the weights until
+         *                they are applied by updateWba.
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : grads : The gradients of the outputs, a [nodes x T] tensor
+         *
+         * Outputs      : The errors of the inputs are stored in the errors vector, with the errors of
+         *                timestep t starting at t * inputs
+         * ==================================================================================================
+         */
+        void backward(ExecutionContext& ctx, const Tensor<dType, 2>& grads) {
+            lstmBackwardCpu(ctx, grads, wba, num_inputs, seq_ins, gates, cells, hidden, wba_grads, errors);
+        }
+
+        // Backward propogates the gradients using the context of the calling thread
+        void backward(const Tensor<dType, 2>& grads) {
+            backward(ExecutionContext::threadDefault(), grads);
+        }
+
+        /*
+         * ==================================================================================================
+         * Function     : updateWba
+         *
+         * Description  : Applies the accumulated gradients to the weights and biases of every page by
+         *                gradient descent with momentum, and clears the gradients. The steps of the update
+         *                are kept in wba_prev for the momentum of the next update.
+         *
+         * Inputs       : ctx   : The execution context to use
+         * ==================================================================================================
+         */
+        void updateWba(ExecutionContext& ctx) {
+            lstmUpdateWbaCpu(ctx, num_inputs, learn_rate, momentum, wba_grads, wba, wba_prev);
+        }
+
+        // Updates the weights and biases using the context of the calling thread
+        void updateWba() { updateWba(ExecutionContext::threadDefault()); }
+
+        /*
+         * ==================================================================================================
+         * Function     : setTrainingParameters
+         *
+         * Description  : Sets the parameters of the weight updates (by default the learning rate is 0.01
+         *                and there is no momentum)
+         *
+         * Inputs       : rate      : The learning rate
+         *              : mom       : The momentum
+         * ==================================================================================================
+         */
+        void setTrainingParameters(dType rate, dType mom) { learn_rate = rate; momentum = mom; }
+
+        // Clears the outputs and cells, so that the next call starts a new sequence
+        void resetState() {
+            std::fill(state_h.begin(), state_h.end(), dType(0));
+            std::fill(state_c.begin(), state_c.end(), dType(0));
+        }
+
+        /*
+         * ==================================================================================================
+         * Function     : weightsChanged
+         *
+         * Description  : Tells the layer that the weights in wba have changed (the weights are always
+         *                read from wba, so there is nothing to do).
+         * ==================================================================================================
+         */
+        void weightsChanged() {}
+
+    protected:
+        // Sizes the cells and outputs of a sequence, and starts them from the state of the layer
+        void startSequence(size_t steps) {
+            if (cells.size(1) != steps + 1) {
+                cells  = Tensor<dType, 2>({static_cast<int>(nodes), static_cast<int>(steps + 1)});
+                hidden = Tensor<dType, 2>({static_cast<int>(nodes), static_cast<int>(steps + 1)});
+            }
+            std::copy(state_h.begin(), state_h.end(), &hidden(0, 0));
+            std::copy(state_c.begin(), state_c.end(), &cells(0, 0));
+        }
+
+        // Keeps the outputs and cells of the last timestep as the state of the layer
+        void endSequence() {
+            const size_t last = cells.size(1) - 1;
+            state_h.assign(&hidden(0, last), &hidden(0, last) + nodes);
+            state_c.assign(&cells(0, last), &cells(0, last) + nodes);
+        }
+
+        Tensor4<dType>      wba;             // Tensor for weights and biases of the stacked gates
+        Tensor4<dType>      wba_prev;        // Steps of the previous update of the weights and biases
+        Tensor4<dType>      wba_grads;       // Accumulated gradients of the weights and biases (one page)
+        std::vector<dType>  errors;          // Errors of the inputs of the last sequence
+        uint                num_inputs;      // Number of inputs for the layer
+        dType               learn_rate;      // Learning rate for the weight updates
+        dType               momentum;        // Momentum for the weight updates
+        std::vector<dType>  state_h;         // Outputs of the last timestep
+        std::vector<dType>  state_c;         // Cells of the last timestep
+        Tensor<dType, 2>    seq_ins;         // Inputs of the last sequence
+        Tensor<dType, 2>    gates;           // Gates of each timestep of the last sequence
+        Tensor<dType, 2>    cells;           // Cells of the last sequence, from the starting state
+        Tensor<dType, 2>    hidden;          // Outputs of the last sequence, from the starting state
+};
+
+}   // Namepsace ltype
+}   // Namepsace frnn
+#endif
@@ -24,6 +24,11 @@
 #include "../../frnn/types.h"
 #include "../../util/errors.h"
 #include "../../math/math.hpp"
+#include "../../math/blas/frnn_blas.h"
+#include "../../math/execution_context.hpp"
+#include "../../tensor/tensor.cuh"
+#include "../../new_tensor/tensor.h"
+#include "../../new_tensor/tensor_sparse.h"
 
 namespace frnn {
     
@@ -43,6 +48,579 @@ void softmaxBackwardCpu( std::vector<dType>& outs, std::vector<dType>& targets,
     frnn::math<dType, device::CPU>::xmy( outs, targets, errors );
 }
 
+/*
+ * ==========================================================================================================
+ * Function     : softmaxBackwardBatchCpu
+ *
+ * Description  : Backward propogates the errors of a batch of samples through a softmax layer on the CPU,
+ *                which is the difference between the outputs and the targets of each sample.
+ *
+ * Inputs       : outs      : The outputs of the layer, a [nodes x batch] tensor (one sample per column)
+ *              : targets   : The targets for the outputs, with the same dimensions as outs
+ *
+ * Outputs      : errors    : The errors of the batch, where the errors of sample b start at b * nodes
+ *
+ * Params       : dType     : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void softmaxBackwardBatchCpu( const Tensor<dType, 2>& outs, const Tensor<dType, 2>& targets, 
+                              std::vector<dType>& errors ) {
+    frnnError error;
+    if ( outs.dimSizes() != targets.dimSizes() ) {
+        frnn::err::dimError( error, stringify( outs ), stringify( targets ) );
+        return;
+    }
+    if ( errors.size() != outs.size() ) errors.resize( outs.size(), 0 );
+    if ( outs.size() == 0 ) return;
+
+    frnn::cpu::elementwise( frnn::functors::minus(), &errors[ 0 ], outs.size(), outs.data().data(), 
+                            targets.data().data() );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxLogitsSparseCpu
+ *
+ * Description  : Determines W*x + b for each page of the wba tensor and sums the results of the pages, for a
+ *                sparse (for example one-hot) input x. Only the columns of W for the non-zero inputs are
+ *                used, so the cost is O(nodes * nnz) per page rather than O(nodes * inputs).
+ *
+ * Inputs       : ins           : The sparse inputs to the layer
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *
+ * Outputs      : logits        : The sum over the pages of W*x + b, which softmax must still be applied to
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void softmaxLogitsSparseCpu( const SparseTensor<dType, 1>& ins       ,
+                             const Tensor4<dType>&         wba       ,
+                             uint                          num_inputs ,
+                             std::vector<dType>&           logits    ) {
+
+    frnnError error;
+    if ( ins.size() != num_inputs ) {
+        frnn::err::dimError( error, stringify( ins ), stringify( num_inputs ) );
+        return;
+    }
+    logits.assign( wba.x(), dType( 0 ) );
+
+    for ( uint page = 0; page < wba.z(); page++ ) {
+        const dType* weights = &wba( 0, 0         , page, 0 );
+        const dType* biases  = &wba( 0, num_inputs, page, 0 );
+
+        for ( uint n = 0; n < wba.x(); n++ ) logits[ n ] += biases[ n ];
+        frnn::math<dType, device::CPU>::spmv( weights, wba.x(), wba.x(), ins.indices(), ins.values(), &logits[ 0 ] );
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxPackWeightsCpu
+ *
+ * Description  : Packs the weights of each page of the wba tensor for the CPU matrix multiplication kernel
+ *                (see math/blas/frnn_blas_cpu.h), so that the batched forward passes do not need to pack
+ *                them
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *
+ * Outputs      : packed        : The packed weights of each page
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void softmaxPackWeightsCpu( ExecutionContext&                         ctx       ,
+                            const Tensor4<dType>&                     wba       ,
+                            uint                                      num_inputs ,
+                            std::vector<blas::packedMatrixCpu<dType>>& packed    ) {
+    packed.resize( wba.z() );
+    for ( uint page = 0; page < wba.z(); page++ ) {
+        blas::gemmPackCpu( ctx.blasHandle(), blas::BLAS_OP_N, wba.x(), num_inputs, &wba( 0, 0, page, 0 ), wba.x(),
+                           packed[ page ] );
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxLogitsCpu
+ *
+ * Description  : Determines the logits of a softmax layer on the CPU, W*x + b for each page of the wba
+ *                tensor summed over the pages (the rows of W are split between the threads of the context by
+ *                gemv), in the scratch arena of the context.
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : ins           : The inputs to the layer
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *
+ * Outputs      : A pointer to the logits (wba.x() elements in the scratch arena of thread 0), or NULL if the
+ *                inputs have the wrong size
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+dType* softmaxLogitsCpu( ExecutionContext&         ctx       ,
+                         const std::vector<dType>& ins       ,
+                         const Tensor4<dType>&     wba       ,
+                         uint                      num_inputs ) {
+
+    frnnError          error;
+    const dType        one = dType( 1 );
+
+    if ( ins.size() != num_inputs ) {
+        frnn::err::dimError( error, stringify( ins ), stringify( num_inputs ) );
+        return NULL;
+    }
+
+    dType* logits = ctx.scratch<dType>( wba.x() );
+    std::fill( logits, logits + wba.x(), dType( 0 ) );
+
+    for ( uint page = 0; page < wba.z(); page++ ) {
+        const dType* biases = &wba( 0, num_inputs, page, 0 );
+        for ( uint n = 0; n < wba.x(); n++ ) logits[ n ] += biases[ n ];
+
+        // logits = W*x + logits, so the pages accumulate
+        frnn::blas::functions<dType, device::CPU>::gemv( 
+                ctx.blasHandle(), blas::BLAS_OP_N, wba.x(), num_inputs, &one  , &wba( 0, 0, page, 0 ), 
+                wba.x()         , &ins[ 0 ]      , 1      , &one      , logits, 1                      );
+    }
+    return logits;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxForwardCpu
+ *
+ * Description  : Forward propogates the inputs through a softmax layer on the CPU, which is the softmax of
+ *                the logits from softmaxLogitsCpu.
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : ins           : The inputs to the layer
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *
+ * Outputs      : outs          : The outputs of the layer, softmax( sum over pages( W*x + b ) )
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void softmaxForwardCpu( ExecutionContext&         ctx       ,
+                        const std::vector<dType>& ins       ,
+                        const Tensor4<dType>&     wba       ,
+                        uint                      num_inputs ,
+                        std::vector<dType>&       outs      ) {
+
+    frnnError    error;
+    const dType* logits = softmaxLogitsCpu( ctx, ins, wba, num_inputs );
+    if ( logits == NULL ) return;
+
+    if ( outs.size() < wba.x() ) outs.resize( wba.x(), 0 );
+    softmaxCpu( error, logits, wba.x(), &outs[ 0 ] );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxLossCpu
+ *
+ * Description  : Forward and backward propogates one sample through a softmax layer with a cross entropy
+ *                loss on the CPU. The loss and the errors are determined together from the logits (see
+ *                softmaxCrossEntropyCpu), so the outputs are never stored, and the target is an index
+ *                rather than a one-hot vector.
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : ins           : The inputs to the layer
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *              : target        : The index of the target node
+ *
+ * Outputs      : errors        : The errors of the layer, softmax( logits ) - onehot( target ) (resized if 
+ *                                it is too small)
+ *              : The cross entropy loss, -log( softmax( logits )[ target ] )
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+dType softmaxLossCpu( ExecutionContext&         ctx       ,
+                      const std::vector<dType>& ins       ,
+                      const Tensor4<dType>&     wba       ,
+                      uint                      num_inputs ,
+                      size_t                    target    ,
+                      std::vector<dType>&       errors    ) {
+
+    frnnError    error;
+    const dType* logits = softmaxLogitsCpu( ctx, ins, wba, num_inputs );
+    if ( logits == NULL ) return dType( 0 );
+
+    if ( errors.size() < wba.x() ) errors.resize( wba.x(), 0 );
+    return softmaxCrossEntropyCpu( error, logits, wba.x(), target, &errors[ 0 ] );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxLogitsBatchCpu
+ *
+ * Description  : Determines the logits of a batch of inputs for a softmax layer on the CPU. The inputs of
+ *                every sample are multiplied by the weights of a page at once, so each page is a GEMM
+ *                rather than a GEMV per sample, and the weights are read once for the whole batch rather 
+ *                than once for each sample. The logits of each sample are the same as from 
+ *                softmaxLogitsCpu (up to rounding, since the products are summed by a different kernel).
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : ins           : The inputs to the layer, an [inputs x batch] tensor (one sample per column)
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *              : packed        : The weights of each page packed by softmaxPackWeightsCpu, which the GEMMs
+ *                                use rather than the weights in wba if they are given
+ *
+ * Outputs      : logits        : The logits of the batch, nodes elements for each sample
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void softmaxLogitsBatchCpu( ExecutionContext&         ctx       ,
+                            const Tensor<dType, 2>&   ins       ,
+                            const Tensor4<dType>&     wba       ,
+                            uint                      num_inputs ,
+                            dType*                    logits    ,
+                            const std::vector<blas::packedMatrixCpu<dType>>* packed = NULL ) {
+
+    const dType        one   = dType( 1 );
+    const size_t       nodes = wba.x(), batch = ins.size( 1 );
+    const dType*       x     = ins.data().data();
+    std::fill( logits, logits + nodes * batch, dType( 0 ) );
+
+    for ( uint page = 0; page < wba.z(); page++ ) {
+        const dType* biases = &wba( 0, num_inputs, page, 0 );
+        for ( size_t b = 0; b < batch; b++ ) {
+            for ( size_t n = 0; n < nodes; n++ ) logits[ b * nodes + n ] += biases[ n ];
+        }
+
+        // logits = W*X + logits, so the pages accumulate
+        if ( packed != NULL && batch > 1 ) {
+            blas::gemmPackedCpu( ctx.blasHandle(), blas::BLAS_OP_N, batch, &one, ( *packed )[ page ], x, 
+                                 num_inputs, &one, logits, nodes );
+        } else if ( batch == 1 ) {
+            frnn::blas::functions<dType, device::CPU>::gemv( 
+                    ctx.blasHandle(), blas::BLAS_OP_N, nodes, num_inputs, &one  , &wba( 0, 0, page, 0 ), 
+                    nodes           , x              , 1    , &one      , logits, 1                      );
+        } else {
+            frnn::blas::functions<dType, device::CPU>::gemm( 
+                    ctx.blasHandle(), blas::BLAS_OP_N, blas::BLAS_OP_N, nodes, batch, num_inputs, &one, 
+                    &wba( 0, 0, page, 0 ), nodes, x, num_inputs, &one, logits, nodes                    );
+        }
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxLogitsBatchCpu
+ *
+ * Description  : Determines the logits of a batch of inputs for a softmax layer on the CPU into a tensor
+ *                (see above)
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : ins           : The inputs to the layer, an [inputs x batch] tensor (one sample per column)
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *              : packed        : The packed weights of each page, if there are any (see above)
+ *
+ * Outputs      : logits        : The logits, a [nodes x batch] tensor (resized if the dimensions are wrong)
+ *              : If the logits were determined (the inputs have the right size)
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+bool softmaxLogitsBatchCpu( ExecutionContext&         ctx       ,
+                            const Tensor<dType, 2>&   ins       ,
+                            const Tensor4<dType>&     wba       ,
+                            uint                      num_inputs ,
+                            Tensor<dType, 2>&         logits    ,
+                            const std::vector<blas::packedMatrixCpu<dType>>* packed = NULL ) {
+
+    frnnError          error;
+    const size_t       nodes = wba.x(), batch = ins.size( 1 );
+
+    if ( ins.size( 0 ) != num_inputs ) {
+        frnn::err::dimError( error, stringify( ins ), stringify( num_inputs ) );
+        return false;
+    }
+    if ( logits.size( 0 ) != nodes || logits.size( 1 ) != batch ) {
+        logits = Tensor<dType, 2>( { static_cast<int>( nodes ), static_cast<int>( batch ) } );
+    }
+    if ( batch > 0 ) softmaxLogitsBatchCpu( ctx, ins, wba, num_inputs, logits.data().data(), packed );
+    return true;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxForwardBatchCpu
+ *
+ * Description  : Forward propogates a batch of inputs through a softmax layer on the CPU, which is the
+ *                softmax of each sample of the logits from softmaxLogitsBatchCpu. The outputs of each sample
+ *                are the same as from softmaxForwardCpu (up to rounding).
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : ins           : The inputs to the layer, an [inputs x batch] tensor (one sample per column)
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *              : packed        : The packed weights of each page, if there are any (see above)
+ *
+ * Outputs      : outs          : The outputs of the layer, a [nodes x batch] tensor (resized if the
+ *                                dimensions are wrong)
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void softmaxForwardBatchCpu( ExecutionContext&         ctx       ,
+                             const Tensor<dType, 2>&   ins       ,
+                             const Tensor4<dType>&     wba       ,
+                             uint                      num_inputs ,
+                             Tensor<dType, 2>&         outs      ,
+                             const std::vector<blas::packedMatrixCpu<dType>>* packed = NULL ) {
+
+    frnnError          error;
+    const size_t       nodes = wba.x();
+    if ( !softmaxLogitsBatchCpu( ctx, ins, wba, num_inputs, outs, packed ) ) return;
+
+    // The softmax of each sample is independent, so the samples are split between the threads
+    dType* logits = outs.data().data();
+    ctx.forEach( outs.size( 1 ), [&]( size_t b, int ) {
+        softmaxCpu( error, logits + b * nodes, nodes, logits + b * nodes );
+    } );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxLossBatchCpu
+ *
+ * Description  : Forward and backward propogates a batch of samples through a softmax layer with a cross
+ *                entropy loss on the CPU. The logits of the batch are determined in the errors, and the
+ *                loss and errors of each sample are then determined from them in place (see 
+ *                softmaxLossCpu).
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : ins           : The inputs to the layer, an [inputs x batch] tensor (one sample per column)
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *              : targets       : The index of the target node of each sample
+ *              : packed        : The packed weights of each page, if there are any (see above)
+ *
+ * Outputs      : errors        : The errors of the batch, where the errors of sample b start at b * nodes
+ *              : The sum of the cross entropy losses of the samples
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+dType softmaxLossBatchCpu( ExecutionContext&         ctx       ,
+                           const Tensor<dType, 2>&   ins       ,
+                           const Tensor4<dType>&     wba       ,
+                           uint                      num_inputs ,
+                           const std::vector<int>&   targets   ,
+                           std::vector<dType>&       errors    ,
+                           const std::vector<blas::packedMatrixCpu<dType>>* packed = NULL ) {
+
+    frnnError          error;
+    const size_t       nodes = wba.x(), batch = ins.size( 1 );
+
+    if ( ins.size( 0 ) != num_inputs ) {
+        frnn::err::dimError( error, stringify( ins ), stringify( num_inputs ) );
+        return dType( 0 );
+    }
+    if ( targets.size() != batch ) {
+        frnn::err::dimError( error, stringify( targets ), stringify( ins ) );
+        return dType( 0 );
+    }
+    if ( errors.size() != nodes * batch ) errors.resize( nodes * batch, 0 );
+    if ( batch == 0 ) return dType( 0 );
+
+    dType* logits = &errors[ 0 ];
+    softmaxLogitsBatchCpu( ctx, ins, wba, num_inputs, logits, packed );
+
+    // The losses are summed in order, so the result does not depend on the number of threads
+    std::vector<dType> losses( batch );
+    ctx.forEach( batch, [&]( size_t b, int ) {
+        losses[ b ] = softmaxCrossEntropyCpu( error, logits + b * nodes, nodes, targets[ b ], logits + b * nodes );
+    } );
+    dType loss = dType( 0 );
+    for ( size_t b = 0; b < batch; b++ ) loss += losses[ b ];
+    return loss;
+}
+
+namespace detail {
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxUpdateWbaBatchCpu
+ *
+ * Description  : Updates the weights and biases of every page of a softmax layer for a batch of samples
+ *                (see softmaxUpdateWbaCpu, which checks the arguments). The gradient of weight (n, i) is the 
+ *                sum over the batch of errors[ b ][ n ] * acts[ i ][ b ], so the gradients of a tile of
+ *                columns are one GEMM (E * A^T for the columns of the tile), into the scratch memory of the 
+ *                context, and each column of the tile is then stepped along by the gradient step kernel. 
+ *                The gradients of the biases (the sums of the errors over the batch) are the same for every
+ *                page, so they are only determined once.
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : errors        : The errors of the layer, nodes elements for each sample of the batch
+ *              : acts          : The inputs of each page, an [inputs x batch x depth x 1] tensor
+ *              : num_inputs    : The number of inputs to the layer
+ *              : learn_rate    : The learning rate
+ *              : momentum      : The momentum
+ *
+ * Outputs      : wba           : The weights, biases, and activations tensor of the layer, updated in place
+ *              : deltas        : The steps of the previous update, which are replaced by those of this update
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void softmaxUpdateWbaBatchCpu( ExecutionContext&         ctx        ,
+                               const std::vector<dType>& errors     ,
+                               const Tensor4<dType>&     acts       ,
+                               uint                      num_inputs ,
+                               dType                     learn_rate ,
+                               dType                     momentum   ,
+                               Tensor4<dType>&           wba        ,
+                               Tensor4<dType>&           deltas     ) {
+
+    namespace kernels = frnn::cpu::detail;
+    const dType  one       = dType( 1 ), zero = dType( 0 );
+    const size_t nodes     = wba.x(), batch = acts.y();
+    const size_t tile_cols = std::max( size_t( 1 ), kernels::mathParallelSize() / nodes );
+    dType*       grads     = ctx.scratch<dType>( nodes * ( tile_cols + 1 ) );
+    dType*       grad_bias = grads + nodes * tile_cols;
+
+    std::fill( grad_bias, grad_bias + nodes, dType( 0 ) );
+    for ( size_t b = 0; b < batch; b++ ) {
+        for ( size_t n = 0; n < nodes; n++ ) grad_bias[ n ] += errors[ b * nodes + n ];
+    }
+
+    for ( uint page = 0; page < wba.z(); page++ ) {
+        for ( size_t col = 0; col < num_inputs; col += tile_cols ) {
+            const size_t cols = std::min( tile_cols, num_inputs - col );
+
+            // grads = E * A^T for the columns [col, col + cols) of the page
+            frnn::blas::functions<dType, device::CPU>::gemm( 
+                    ctx.blasHandle(), blas::BLAS_OP_N, blas::BLAS_OP_T, nodes, cols, batch, &one, &errors[ 0 ],
+                    nodes, &acts( col, 0, page, 0 ), acts.x(), &zero, grads, nodes                             );
+            for ( size_t i = 0; i < cols; i++ ) {
+                frnn::cpu::dispatch<kernels::GradientStepKernel>( &wba( 0, col + i, page, 0 ), 
+                        &deltas( 0, col + i, page, 0 ), grads + i * nodes, -learn_rate, momentum, nodes );
+            }
+        }
+        frnn::cpu::dispatch<kernels::GradientStepKernel>( &wba( 0, num_inputs, page, 0 ), 
+                &deltas( 0, num_inputs, page, 0 ), grad_bias, -learn_rate, momentum, nodes );
+    }
+}
+
+}   // Namespace detail
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxUpdateWbaCpu
+ *
+ * Description  : Updates the weights and biases of every page of a softmax layer on the CPU, by gradient 
+ *                descent with momentum. The gradient of weight (n, i) of page p is errors[ n ] * acts[ i ] 
+ *                (the outer product of the errors and the inputs the page was given), and of bias n is
+ *                errors[ n ]. The gradients are never stored : each weight is updated as its gradient is
+ *                determined, in one pass over the weights and the steps. The weights are split into tiles
+ *                of a few columns and at most mathBlockSize() rows, so that the errors of the tile stay in
+ *                the cache while its columns are updated, and the tiles are split between the threads of 
+ *                the context. For a batch of samples the gradients are summed over the batch, so a tile of
+ *                the gradients is one GEMM of the errors and the inputs of the tile's columns, which is then
+ *                stepped along (see softmaxUpdateWbaBatchCpu).
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : errors        : The errors of the layer (from the backward pass), nodes elements for each 
+ *                                sample of the batch
+ *              : acts          : The inputs of each page, an [inputs x batch x depth x 1] tensor
+ *              : num_inputs    : The number of inputs to the layer
+ *              : learn_rate    : The learning rate
+ *              : momentum      : The momentum
+ *
+ * Outputs      : wba           : The weights, biases, and activations tensor of the layer, updated in place
+ *              : deltas        : The steps of the previous update for each weight and bias (with the same
+ *                                layout as wba), which are replaced by the steps of this update
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void softmaxUpdateWbaCpu( ExecutionContext&         ctx        ,
+                          const std::vector<dType>& errors     ,
+                          const Tensor4<dType>&     acts       ,
+                          uint                      num_inputs ,
+                          dType                     learn_rate ,
+                          dType                     momentum   ,
+                          Tensor4<dType>&           wba        ,
+                          Tensor4<dType>&           deltas     ) {
+
+    namespace kernels = frnn::cpu::detail;
+    frnnError    error;
+    const size_t nodes = wba.x();
+
+    if ( acts.x() != num_inputs || acts.z() != wba.z() ) {
+        frnn::err::dimError( error, stringify( acts ), stringify( wba ) );
+        return;
+    }
+    if ( errors.size() != nodes * acts.y() ) {
+        frnn::err::dimError( error, stringify( errors ), stringify( acts ) );
+        return;
+    }
+    if ( acts.y() > 1 ) {
+        detail::softmaxUpdateWbaBatchCpu( ctx, errors, acts, num_inputs, learn_rate, momentum, wba, deltas );
+        return;
+    }
+
+    // Tiles of about mathBlockSize() weights, where the bias is an extra column (with an input of one)
+    const size_t columns    = num_inputs + 1;
+    const size_t tile_rows  = std::min( nodes, kernels::mathBlockSize() );
+    const size_t tile_cols  = std::max( size_t( 1 ), kernels::mathBlockSize() / tile_rows );
+    const size_t row_tiles  = ( nodes + tile_rows - 1 ) / tile_rows;
+    const size_t col_tiles  = ( columns + tile_cols - 1 ) / tile_cols;
+    const size_t page_tiles = row_tiles * col_tiles;
+
+    auto update_tile = [&]( size_t tile, int ) {
+        const uint   page  = tile / page_tiles;
+        const size_t row   = ( tile % page_tiles ) % row_tiles * tile_rows;
+        const size_t col   = ( tile % page_tiles ) / row_tiles * tile_cols;
+        const size_t rows  = std::min( tile_rows, nodes - row );
+        const dType* input = &acts( 0, 0, page, 0 );
+
+        for ( size_t i = col; i < std::min( col + tile_cols, columns ); i++ ) {
+            const dType x = i < num_inputs ? input[ i ] : dType( 1 );
+            frnn::cpu::dispatch<kernels::GradientStepKernel>( &wba( row, i, page, 0 ), &deltas( row, i, page, 0 ),
+                                                              &errors[ row ], -learn_rate * x, momentum, rows );
+        }
+    };
+
+    const size_t tiles = page_tiles * wba.z();
+    if ( nodes * columns * wba.z() < kernels::mathParallelSize() ) {
+        for ( size_t tile = 0; tile < tiles; tile++ ) update_tile( tile, 0 );
+    } else {
+        ctx.forEach( tiles, update_tile );
+    }
+}
+
+template <typename dType>
+void softmaxForwardCpu( const std::vector<dType>& ins, const Tensor4<dType>& wba, uint num_inputs, 
+                        std::vector<dType>& outs ) {
+    softmaxForwardCpu( ExecutionContext::threadDefault(), ins, wba, num_inputs, outs );
+}
+
 }   // Namespace frnn
 
 #endif
@@ -26,14 +26,37 @@
 #include <cublas_v2.h>
 
 #include "../../tensor/tensor.cuh"
+#include "../../new_tensor/tensor.h"
+#include "../../math/math.hpp"
 #include "../../util/errors.h"
 #include "../../frnn/frnn.h"
 #include "../../math/blas/frnn_blas.h"
+#include "../../math/execution_context.hpp"
 
 namespace frnn {
     
+/*
+ * ==========================================================================================================
+ * Function     : softmaxForwardGpu
+ *
+ * Description  : Forward propogates the inputs through a softmax layer on the GPU. W*x + b is determined for
+ *                each page of the wba tensor (the pages are split between the threads of the context, and
+ *                each thread uses its own cublas handle and stream), the results of the pages are summed,
+ *                and the softmax of the sum is taken.
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : ins           : The inputs to the layer
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *
+ * Outputs      : outs          : The outputs of the layer, softmax( sum over pages( W*x + b ) )
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
 template <typename dType>
-void softmaxForwardGpu( std::vector<dType>& ins       , 
+void softmaxForwardGpu( ExecutionContext&   ctx       ,
+                        std::vector<dType>& ins       , 
                         Tensor4<dType>&     wba       ,
                         uint                num_inputs ,
                         std::vector<dType>& outs      ) {         
@@ -43,16 +66,11 @@ void softmaxForwardGpu( std::vector<dType>& ins       ,
 
     // Statuses
     frnnError      error;
-    cublasHandle_t  handle;
-    cublasStatus_t  status;
-
-    status = cublasCreate( &handle );
-    cublasSetPointerMode( handle, CUBLAS_POINTER_MODE_HOST );
 
     // Device pointers : For each page (wba.z) we need a pointer for :
     //      inputs, weights, biases
     std::vector<dType*> d_pointers( 3 * wba.z(), 0 );
-    dType*              results_h[ wba.z() ];           // Pointers to results of W*x + b on host
+    std::vector<dType*> results_h( wba.z(), 0 );        // Pointers to results of W*x + b on host
     dType**             results_d;                      // Pointers to results of W*x + b on device
     functors::exp       exp_op;                         // Exp operation for softmax
 
@@ -64,10 +82,12 @@ void softmaxForwardGpu( std::vector<dType>& ins       ,
         return;
     }
 
-    // Each page is done by a separate kernel
-    #pragma omp parallel num_threads( wba.z() )
-    {
-        int thread_id      = omp_get_thread_num();
+    // Each page is done by a separate kernel, on the threads of the context
+    ctx.forEach( wba.z(), [&]( size_t page, int thread ) {
+        cublasHandle_t handle = ctx.cublasHandle( thread );
+        cublasSetPointerMode( handle, CUBLAS_POINTER_MODE_HOST );
+
+        int thread_id      = page;
         int in_offset      = 3 * thread_id;
         int weight_offset  = 3 * thread_id + 1;
         int bias_offset    = 3 * thread_id + 2;
@@ -97,19 +117,20 @@ void softmaxForwardGpu( std::vector<dType>& ins       ,
 
         // Multiply inputs and weights (column-wise) and add biases { W^(T)*x + b }
         dType alpha = 1; dType beta = 1;
-        status = frnn::blas::functions<dType>::gemv( 
+        frnn::blas::functions<dType>::gemv( 
                 handle , CUBLAS_OP_N            , wba.x(), num_inputs, &alpha                   , d_pointers[ weight_offset ]  , 
                 wba.x(), d_pointers[ in_offset ], 1      , &beta      , d_pointers[ bias_offset ], 1                            );
+        cudaStreamSynchronize( ctx.cudaStream( thread ) );      // The kernels below use the default stream
         
         // Assign results to results pointer array
         results_h[ thread_id ] = d_pointers[ bias_offset ];
-    }
+    } );
 
     // Allocate space and copy the pointers to the resuls to host memory
     if ( cudaMalloc( (void**)&results_d, wba.z() * sizeof( dType* ) ) != cudaSuccess ) {
         frnn::err::allocError( error, stringify( results_h ) );
     }
-    if ( cudaMemcpy( results_d, results_h, wba.z() * sizeof( dType* ), cudaMemcpyHostToDevice ) != cudaSuccess ) {
+    if ( cudaMemcpy( results_d, &results_h[ 0 ], wba.z() * sizeof( dType* ), cudaMemcpyHostToDevice ) != cudaSuccess ) {
         frnn::err::copyError( error, stringify( results_d ) );
     }
 
@@ -154,12 +175,135 @@ void softmaxForwardGpu( std::vector<dType>& ins       ,
         frnn::err::copyError( error, stringify( outs ) );
     }
 
-    cublasDestroy( handle );
- 
     for ( int i = 0; i < d_pointers.size(); i++ ) cudaFree( d_pointers[i] );
     cudaFree( results_d ); cudaFree( acts );
 }
+
+template <typename dType>
+void softmaxForwardGpu( std::vector<dType>& ins, Tensor4<dType>& wba, uint num_inputs, std::vector<dType>& outs ) {
+    softmaxForwardGpu( ExecutionContext::threadDefault(), ins, wba, num_inputs, outs );
+}
  
+/*
+ * ==========================================================================================================
+ * Function     : softmaxLogitsBatchGpu
+ *
+ * Description  : Determines the logits of a batch of inputs for a softmax layer, with W*X + b for each page
+ *                done as a single cublas GEMM for the whole batch. The inputs are copied to the device once,
+ *                and the logits of every page accumulate on the device.
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : ins           : The inputs to the layer, an [inputs x batch] tensor (one sample per column)
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *
+ * Outputs      : outs          : The logits, a [nodes x batch] tensor (resized if the dimensions are wrong)
+ *              : If the logits were determined (the inputs have the right size)
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+bool softmaxLogitsBatchGpu( ExecutionContext&       ctx       ,
+                            const Tensor<dType, 2>& ins       ,
+                            Tensor4<dType>&         wba       ,
+                            uint                    num_inputs ,
+                            Tensor<dType, 2>&       outs      ) {
+
+    frnnError       error;
+    const dType     one   = dType( 1 );
+    const size_t    nodes = wba.x(), batch = ins.size( 1 );
+    dType          *d_ins = 0, *d_weights = 0, *d_logits = 0;
+
+    if ( ins.size( 0 ) != num_inputs ) {
+        frnn::err::dimError( error, stringify( ins ), stringify( num_inputs ) );
+        return false;
+    }
+    if ( outs.size( 0 ) != nodes || outs.size( 1 ) != batch ) {
+        outs = Tensor<dType, 2>( { static_cast<int>( nodes ), static_cast<int>( batch ) } );
+    }
+    if ( batch == 0 ) return true;
+
+    // Start the logits of each sample from the sum of the biases of the pages
+    dType* logits = outs.data().data();
+    std::fill( logits, logits + nodes, dType( 0 ) );
+    for ( uint page = 0; page < wba.z(); page++ ) {
+        for ( size_t n = 0; n < nodes; n++ ) logits[ n ] += wba( n, num_inputs, page, 0 );
+    }
+    for ( size_t b = 1; b < batch; b++ ) std::copy( logits, logits + nodes, logits + b * nodes );
+
+    if ( cudaMalloc( (void**)&d_ins, ins.size() * sizeof( dType ) ) != cudaSuccess ) {
+        frnn::err::allocError( error, stringify( d_ins ) );
+    }
+    if ( cudaMalloc( (void**)&d_weights, nodes * num_inputs * sizeof( dType ) ) != cudaSuccess ) {
+        frnn::err::allocError( error, stringify( d_weights ) );
+    }
+    if ( cudaMalloc( (void**)&d_logits, outs.size() * sizeof( dType ) ) != cudaSuccess ) {
+        frnn::err::allocError( error, stringify( d_logits ) );
+    }
+    if ( cudaMemcpy( d_ins, ins.data().data(), ins.size() * sizeof( dType ), cudaMemcpyHostToDevice ) != cudaSuccess ) {
+        frnn::err::copyError( error, stringify( d_ins ) );
+    }
+    if ( cudaMemcpy( d_logits, logits, outs.size() * sizeof( dType ), cudaMemcpyHostToDevice ) != cudaSuccess ) {
+        frnn::err::copyError( error, stringify( d_logits ) );
+    }
+
+    cublasHandle_t handle = ctx.cublasHandle();
+    cublasSetPointerMode( handle, CUBLAS_POINTER_MODE_HOST );
+
+    // logits = W*X + logits for each page, so the pages accumulate
+    for ( uint page = 0; page < wba.z(); page++ ) {
+        if ( cudaMemcpy( d_weights, &wba( 0, 0, page, 0 ), nodes * num_inputs * sizeof( dType ), 
+                         cudaMemcpyHostToDevice ) != cudaSuccess ) {
+            frnn::err::copyError( error, stringify( weights ) );
+        }
+        frnn::blas::functions<dType>::gemm( handle, CUBLAS_OP_N, CUBLAS_OP_N, nodes, batch, num_inputs, &one, 
+                                            d_weights, nodes, d_ins, num_inputs, &one, d_logits, nodes );
+    }
+
+    if ( cudaMemcpy( logits, d_logits, outs.size() * sizeof( dType ), cudaMemcpyDeviceToHost ) != cudaSuccess ) {
+        frnn::err::copyError( error, stringify( outs ) );
+    }
+    cudaFree( d_ins ); cudaFree( d_weights ); cudaFree( d_logits );
+    return true;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxForwardBatchGpu
+ *
+ * Description  : Forward propogates a batch of inputs through a softmax layer. The logits are determined on
+ *                the device (see softmaxLogitsBatchGpu), and the softmax of each sample is then taken on the
+ *                CPU (since each sample only has as many elements as the layer has nodes).
+ *
+ * Inputs       : ctx           : The execution context to use
+ *              : ins           : The inputs to the layer, an [inputs x batch] tensor (one sample per column)
+ *              : wba           : The weights, biases, and activations tensor of the layer
+ *              : num_inputs    : The number of inputs to the layer
+ *
+ * Outputs      : outs          : The outputs of the layer, a [nodes x batch] tensor (resized if the
+ *                                dimensions are wrong)
+ *
+ * Params       : dType         : The type of data used by the layer
+ * ==========================================================================================================
+ */
+template <typename dType>
+void softmaxForwardBatchGpu( ExecutionContext&       ctx       ,
+                             const Tensor<dType, 2>& ins       ,
+                             Tensor4<dType>&         wba       ,
+                             uint                    num_inputs ,
+                             Tensor<dType, 2>&       outs      ) {
+
+    frnnError    error;
+    const size_t nodes = wba.x();
+    if ( !softmaxLogitsBatchGpu( ctx, ins, wba, num_inputs, outs ) ) return;
+
+    dType* logits = outs.data().data();
+    ctx.forEach( outs.size( 1 ), [&]( size_t b, int ) {
+        softmaxCpu( error, logits + b * nodes, nodes, logits + b * nodes );
+    } );
+}
+
 template <typename dType>
 void softmaxUpadateWbaGpu( Tensor4<dType>& prev_wba, uint act_start, size_t N, 
                            Tensor4<dType>& curr_wba, uint err_start, size_t M ) {
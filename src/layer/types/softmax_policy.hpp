@@ -24,9 +24,12 @@
 #include <vector>
 
 #include "../../tensor/tensor.cuh"
+#include "../../new_tensor/tensor.h"
 #include "../../frnn/frnn.h"
 #include "softmax_cpu_functions.hpp"
+#ifndef FRNN_CPU_ONLY
 #include "softmax_gpu_functions.cuh"
+#endif
 
 namespace frnn {
 namespace ltype {
@@ -58,6 +61,7 @@ template <typename          dType,
          uint               depth>
 class SoftmaxPolicy;
 
+#ifndef FRNN_CPU_ONLY
 /* ============================================== GPU Definitions ========================================  */
 
 template <typename          dType, 
@@ -73,12 +77,15 @@ class SoftmaxPolicy<dType, frnn::device::GPU, nodes, inputs, depth> {
          *
          * Description  : Constructor for the softmaxPolicy. Sets the tensor (wba) which holds the weights,
          *                biases, and activations (using the forst 2 dimensions of the tensor), and the number
-         *                of inputs for the layer.
+         *                of inputs for the layer. Each page of the tensors is placed on the NUMA node of 
+         *                the thread which computes on that page.
          * ==================================================================================================
          */
         explicit SoftmaxPolicy() :
-            wba(nodes, std::max(inputs, nodes) + 2, depth, 1), num_inputs(inputs), errors(nodes, 0),
-            wba_prev(nodes, std::max(inputs, nodes) + 2, depth, 1) {}
+            wba(nodes, std::max(inputs, nodes) + 2, depth, 1, numa::placement::FIRST_TOUCH), 
+            num_inputs(inputs), errors(nodes, 0),
+            wba_prev(nodes, std::max(inputs, nodes) + 2, depth, 1, numa::placement::FIRST_TOUCH), 
+            learn_rate(0.01), momentum(0) {}
 
         /*
          * ==================================================================================================
@@ -95,6 +102,93 @@ class SoftmaxPolicy<dType, frnn::device::GPU, nodes, inputs, depth> {
          */
         void forward(std::vector<dType>& ins, std::vector<dType>& outs);
 
+        /*
+         * ==================================================================================================
+         * Function     : forward
+         *
+         * Description  : Forward propogates the inputs through the layer using the threads, scratch memory
+         *                and library handles of an execution context, so that nothing is set up per call.
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : ins   : The inputs to the layer.
+         *
+         * Outputs      : outs  : The outputs of the layer after performing softmax( W*x + b ) on the inputs.
+         * ==================================================================================================
+         */
+        void forward(ExecutionContext& ctx, std::vector<dType>& ins, std::vector<dType>& outs);
+
+        /*
+         * ==================================================================================================
+         * Function     : forward
+         *
+         * Description  : Forward propogates a batch of inputs through the layer, so that the weights of each
+         *                page are multiplied by the inputs of every sample at once (a GEMM rather than a GEMV
+         *                for each sample).
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : ins   : The inputs to the layer, an [inputs x batch] tensor (one sample per column)
+         *
+         * Outputs      : outs  : The outputs of the layer, a [nodes x batch] tensor (one sample per column)
+         * ==================================================================================================
+         */
+        void forward(ExecutionContext& ctx, const Tensor<dType, 2>& ins, Tensor<dType, 2>& outs);
+
+        // Forward propogates a batch of inputs using the context of the calling thread
+        void forward(const Tensor<dType, 2>& ins, Tensor<dType, 2>& outs) {
+            forward(ExecutionContext::threadDefault(), ins, outs);
+        }
+
+        // The outputs of a timestep do not depend on the previous timesteps (see Layer::forwardSequence)
+        static constexpr bool recurrent = false;
+
+        /*
+         * ==================================================================================================
+         * Function     : projectSequence
+         *
+         * Description  : Determines the logits of every timestep of a sequence, as a single GEMM for each
+         *                page (see Layer::forwardSequence).
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : ins   : The inputs of the sequence, an [inputs x T] tensor
+         *
+         * Outputs      : outs  : The logits of each timestep, a [nodes x T] tensor
+         *              : If the logits were determined (the inputs have the right size)
+         * ==================================================================================================
+         */
+        bool projectSequence(ExecutionContext& ctx, const Tensor<dType, 2>& ins, Tensor<dType, 2>& outs);
+
+        /*
+         * ==================================================================================================
+         * Function     : sequenceStep
+         *
+         * Description  : Turns the logits of a timestep into its outputs (see Layer::forwardSequence).
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : t     : The timestep
+         *
+         * Outputs      : outs  : The outputs of the layer, where column t has the softmax of its logits
+         * ==================================================================================================
+         */
+        void sequenceStep(ExecutionContext& ctx, size_t t, Tensor<dType, 2>& outs) {
+            frnnError error;
+            dType*    column = outs.data().data() + t * nodes;
+            softmaxCpu(error, column, nodes, column);
+        }
+
+        /*
+         * ==================================================================================================
+         * Function     : forward
+         *
+         * Description  : Forward propogates sparse (for example one-hot) inputs through the layer. Only the
+         *                columns of the weights for the non-zero inputs are used, so W*x is a column gather.
+         *
+         * Inputs       : ins   : The sparse inputs to the layer.
+         *
+         * Outputs      : outs  : The outputs of the layer after performing softmax( W*x + b ) on the inputs.
+         * ==================================================================================================
+         */
+        void forward(const SparseTensor<dType, 1>& ins, std::vector<dType>& outs);
+
         /*
          * ==================================================================================================
          * Function     : backward 
@@ -111,23 +205,76 @@ class SoftmaxPolicy<dType, frnn::device::GPU, nodes, inputs, depth> {
          */
         void backward(std::vector<dType>& outs, std::vector<dType>& targets);
 
+        /*
+         * ==================================================================================================
+         * Function     : backward 
+         * 
+         * Description  : Backward propogates the errors of a batch of samples through the layer.
+         * 
+         * Inputs       : outs      : The outputs of the layer, a [nodes x batch] tensor
+         *              : targets   : The targets for each of the outputs of the layer, [nodes x batch]
+         *              
+         * Outputs      : The results are stored in the errors vector, with the errors of sample b starting
+         *                at b * nodes
+         * ==================================================================================================
+         */
+        void backward(const Tensor<dType, 2>& outs, const Tensor<dType, 2>& targets);
+
         /* 
          * ==================================================================================================
          * Function     : updateWba 
          * 
-         * Description  : Updates the weights, biases and activations
+         * Description  : Updates the weights and biases of every page by gradient descent with momentum,
+         *                using the errors from the last backward pass (see softmaxUpdateWbaCpu), which are
+         *                summed over the samples if the pass was for a batch. The steps of the update are
+         *                kept in wba_prev for the momentum of the next update.
          * 
-         * Inputs       : prevLayerActs   : The activations (outputs) of the nodes in the previous layer
+         * Inputs       : ctx             : The execution context to use
+         *              : prevLayerActs   : The activations (outputs) of the nodes in the previous layer which
+         *                                  each page was given, an [inputs x batch x depth x 1] tensor (the
+         *                                  batch of the last backward pass)
+         * ==================================================================================================
+         */
+        void updateWba(ExecutionContext& ctx, const frnn::Tensor4<dType>& prevLayerActs);
+
+        // Updates the weights and biases using the context of the calling thread
+        void updateWba(const frnn::Tensor4<dType>& prevLayerActs) {
+            updateWba(ExecutionContext::threadDefault(), prevLayerActs);
+        }
+
+        /*
+         * ==================================================================================================
+         * Function     : setTrainingParameters
+         *
+         * Description  : Sets the parameters of the weight updates (by default the learning rate is 0.01
+         *                and there is no momentum)
+         *
+         * Inputs       : rate      : The learning rate
+         *              : mom       : The momentum
+         * ==================================================================================================
+         */
+        void setTrainingParameters(dType rate, dType mom) { learn_rate = rate; momentum = mom; }
+        
+
+        /*
+         * ==================================================================================================
+         * Function     : weightsChanged
+         *
+         * Description  : Tells the layer that the weights in wba have changed (the GPU version does not keep
+         *                any copies of the weights, so there is nothing to do).
          * ==================================================================================================
          */
-        void updateWba(const frnn::Tensor4<dType>& prevLayerActs);
+        void weightsChanged() {}
         
     protected:
         Tensor4<dType>      wba;             // Tensor for weights, biases, and activations
-        Tensor4<dType>      wba_prev;        // Tensor for weights, biases, and activations from the previous timestep
+        Tensor4<dType>      wba_prev;        // Steps of the previous update of the weights and biases (momentum)
         std::vector<dType>  errors;          // Errors for the layer
         uint                num_inputs;      // Number of inputs for the layer
+        dType               learn_rate;      // Learning rate for the weight updates
+        dType               momentum;        // Momentum for the weight updates
 };
+#endif
 
 /* =============================================== CPU Definitions ======================================== */
 
@@ -144,12 +291,15 @@ class SoftmaxPolicy<dType, frnn::device::CPU, nodes, inputs, depth> {
          *
          * Description  : Constructor for the softmaxPolicy. Sets the tensor (wba) which holds the weights,
          *                biases, and activations (using the forst 2 dimensions of the tensor), and the number
-         *                of inputs for the layer.
+         *                of inputs for the layer. Each page of the tensors is placed on the NUMA node of 
+         *                the thread which computes on that page.
          * ==================================================================================================
          */
         explicit SoftmaxPolicy() :
-            wba(nodes, std::max(inputs, nodes) + 2, depth, 1), num_inputs(inputs), errors(nodes, 0),
-            wba_prev(nodes, std::max(inputs, nodes) + 2, depth, 1) {}
+            wba(nodes, std::max(inputs, nodes) + 2, depth, 1, numa::placement::FIRST_TOUCH), 
+            num_inputs(inputs), errors(nodes, 0),
+            wba_prev(nodes, std::max(inputs, nodes) + 2, depth, 1, numa::placement::FIRST_TOUCH), 
+            learn_rate(0.01), momentum(0) {}
 
         /*
          * ==================================================================================================
@@ -166,6 +316,93 @@ class SoftmaxPolicy<dType, frnn::device::CPU, nodes, inputs, depth> {
          */
         void forward(std::vector<dType>& ins, std::vector<dType>& outs);
 
+        /*
+         * ==================================================================================================
+         * Function     : forward
+         *
+         * Description  : Forward propogates the inputs through the layer using the threads, scratch memory
+         *                and library handles of an execution context, so that nothing is set up per call.
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : ins   : The inputs to the layer.
+         *
+         * Outputs      : outs  : The outputs of the layer after performing softmax( W*x + b ) on the inputs.
+         * ==================================================================================================
+         */
+        void forward(ExecutionContext& ctx, std::vector<dType>& ins, std::vector<dType>& outs);
+
+        /*
+         * ==================================================================================================
+         * Function     : forward
+         *
+         * Description  : Forward propogates a batch of inputs through the layer, so that the weights of each
+         *                page are multiplied by the inputs of every sample at once (a GEMM rather than a GEMV
+         *                for each sample).
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : ins   : The inputs to the layer, an [inputs x batch] tensor (one sample per column)
+         *
+         * Outputs      : outs  : The outputs of the layer, a [nodes x batch] tensor (one sample per column)
+         * ==================================================================================================
+         */
+        void forward(ExecutionContext& ctx, const Tensor<dType, 2>& ins, Tensor<dType, 2>& outs);
+
+        // Forward propogates a batch of inputs using the context of the calling thread
+        void forward(const Tensor<dType, 2>& ins, Tensor<dType, 2>& outs) {
+            forward(ExecutionContext::threadDefault(), ins, outs);
+        }
+
+        // The outputs of a timestep do not depend on the previous timesteps (see Layer::forwardSequence)
+        static constexpr bool recurrent = false;
+
+        /*
+         * ==================================================================================================
+         * Function     : projectSequence
+         *
+         * Description  : Determines the logits of every timestep of a sequence, as a single GEMM for each
+         *                page (see Layer::forwardSequence).
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : ins   : The inputs of the sequence, an [inputs x T] tensor
+         *
+         * Outputs      : outs  : The logits of each timestep, a [nodes x T] tensor
+         *              : If the logits were determined (the inputs have the right size)
+         * ==================================================================================================
+         */
+        bool projectSequence(ExecutionContext& ctx, const Tensor<dType, 2>& ins, Tensor<dType, 2>& outs);
+
+        /*
+         * ==================================================================================================
+         * Function     : sequenceStep
+         *
+         * Description  : Turns the logits of a timestep into its outputs (see Layer::forwardSequence).
+         *
+         * Inputs       : ctx   : The execution context to use
+         *              : t     : The timestep
+         *
+         * Outputs      : outs  : The outputs of the layer, where column t has the softmax of its logits
+         * ==================================================================================================
+         */
+        void sequenceStep(ExecutionContext& ctx, size_t t, Tensor<dType, 2>& outs) {
+            frnnError error;
+            dType*    column = outs.data().data() + t * nodes;
+            softmaxCpu(error, column, nodes, column);
+        }
+
+        /*
+         * ==================================================================================================
+         * Function     : forward
+         *
+         * Description  : Forward propogates sparse (for example one-hot) inputs through the layer. Only the
+         *                columns of the weights for the non-zero inputs are used, so W*x is a column gather.
+         *
+         * Inputs       : ins   : The sparse inputs to the layer.
+         *
+         * Outputs      : outs  : The outputs of the layer after performing softmax( W*x + b ) on the inputs.
+         * ==================================================================================================
+         */
+        void forward(const SparseTensor<dType, 1>& ins, std::vector<dType>& outs);
+
         /*
          * ==================================================================================================
          * Function     : backward 
@@ -182,24 +419,134 @@ class SoftmaxPolicy<dType, frnn::device::CPU, nodes, inputs, depth> {
          */
         void backward(std::vector<dType>& outs, std::vector<dType>&targets);
 
+        /*
+         * ==================================================================================================
+         * Function     : backward 
+         * 
+         * Description  : Backward propogates the errors of a batch of samples through the layer.
+         * 
+         * Inputs       : outs      : The outputs of the layer, a [nodes x batch] tensor
+         *              : targets   : The targets for each of the outputs of the layer, [nodes x batch]
+         *              
+         * Outputs      : The results are stored in the errors vector, with the errors of sample b starting
+         *                at b * nodes
+         * ==================================================================================================
+         */
+        void backward(const Tensor<dType, 2>& outs, const Tensor<dType, 2>& targets);
+
+        /*
+         * ==================================================================================================
+         * Function     : forwardBackward
+         * 
+         * Description  : Forward and backward propogates one sample through the layer with a cross entropy
+         *                loss, which determines the loss and the errors together from the logits, so the
+         *                outputs are never stored and the target is an index rather than a one-hot vector.
+         * 
+         * Inputs       : ctx       : The execution context to use
+         *              : ins       : The inputs to the layer
+         *              : target    : The index of the target node
+         *              
+         * Outputs      : The errors are stored in the errors vector
+         *              : The cross entropy loss of the sample
+         * ==================================================================================================
+         */
+        dType forwardBackward(ExecutionContext& ctx, const std::vector<dType>& ins, size_t target);
+
+        /*
+         * ==================================================================================================
+         * Function     : forwardBackward
+         * 
+         * Description  : Forward and backward propogates a batch of samples through the layer with a cross
+         *                entropy loss (see above).
+         * 
+         * Inputs       : ctx       : The execution context to use
+         *              : ins       : The inputs to the layer, an [inputs x batch] tensor
+         *              : targets   : The index of the target node of each sample
+         *              
+         * Outputs      : The errors are stored in the errors vector, with the errors of sample b starting
+         *                at b * nodes
+         *              : The sum of the cross entropy losses of the samples
+         * ==================================================================================================
+         */
+        dType forwardBackward(ExecutionContext& ctx, const Tensor<dType, 2>& ins, const std::vector<int>& targets);
+
         /* 
          * ==================================================================================================
          * Function     : updateWba 
          * 
-         * Description  : Updates the weights, biases and activations
+         * Description  : Updates the weights and biases of every page by gradient descent with momentum,
+         *                using the errors from the last backward pass (see softmaxUpdateWbaCpu), which are
+         *                summed over the samples if the pass was for a batch. The steps of the update are
+         *                kept in wba_prev for the momentum of the next update.
          * 
-         * Inputs       : prevLayerActs   : The activations (outputs) of the nodes in the previous layer
+         * Inputs       : ctx             : The execution context to use
+         *              : prevLayerActs   : The activations (outputs) of the nodes in the previous layer which
+         *                                  each page was given, an [inputs x batch x depth x 1] tensor (the
+         *                                  batch of the last backward pass)
+         * ==================================================================================================
+         */
+        void updateWba(ExecutionContext& ctx, const frnn::Tensor4<dType>& prevLayerActs);
+
+        // Updates the weights and biases using the context of the calling thread
+        void updateWba(const frnn::Tensor4<dType>& prevLayerActs) {
+            updateWba(ExecutionContext::threadDefault(), prevLayerActs);
+        }
+
+        /*
+         * ==================================================================================================
+         * Function     : setTrainingParameters
+         *
+         * Description  : Sets the parameters of the weight updates (by default the learning rate is 0.01
+         *                and there is no momentum)
+         *
+         * Inputs       : rate      : The learning rate
+         *              : mom       : The momentum
+         * ==================================================================================================
+         */
+        void setTrainingParameters(dType rate, dType mom) { learn_rate = rate; momentum = mom; }
+        
+
+        /*
+         * ==================================================================================================
+         * Function     : weightsChanged
+         *
+         * Description  : Tells the layer that the weights in wba have changed, so that the packed copy of the
+         *                weights is packed again before it is next used.
          * ==================================================================================================
          */
-        void updateWba(const frnn::Tensor4<dType>& prevLayerActs);
+        void weightsChanged() { packed_weights.clear(); }
         
     protected:
+        /*
+         * ==================================================================================================
+         * Function     : packedWeights
+         *
+         * Description  : Gets the packed copy of the weights of each page for the batched forward passes, 
+         *                which packs them when they are first used after they have changed (or when they 
+         *                were packed for a different instruction set than gemmPackCpu will pack for now).
+         *
+         * Inputs       : ctx   : The execution context to pack with
+         *
+         * Outputs      : A pointer to the packed weights of each page
+         * ==================================================================================================
+         */
+        const std::vector<blas::packedMatrixCpu<dType>>* packedWeights(ExecutionContext& ctx) {
+            if (packed_weights.empty() || packed_weights[0].level != blas::gemmPackLevelCpu()) {
+                softmaxPackWeightsCpu(ctx, wba, num_inputs, packed_weights);
+            }
+            return &packed_weights;
+        }
+
         Tensor4<dType>      wba;             // Tensor for weights, biases, and activations
-        Tensor4<dType>      wba_prev;        // Tensor for weights, biases, and activations from the previous timestep
+        Tensor4<dType>      wba_prev;        // Steps of the previous update of the weights and biases (momentum)
         std::vector<dType>  errors;          // Errors for the layer
         uint                num_inputs;      // Number of inputs for the layer
+        dType               learn_rate;      // Learning rate for the weight updates
+        dType               momentum;        // Momentum for the weight updates
+        std::vector<blas::packedMatrixCpu<dType>> packed_weights;   // Weights of each page packed for gemm
 };
 
+#ifndef FRNN_CPU_ONLY
 /* ======================================= GPU IMPLEMENTATIONS ============================================ */
 
 template <typename dType, uint nds, uint ipts, uint dth>
@@ -209,41 +556,131 @@ void SoftmaxPolicy<dType, device::GPU, nds, ipts, dth>::forward (
     softmaxForwardGpu(ins, wba, num_inputs, outs);
 }
 
+template <typename dType, uint nds, uint ipts, uint dth>
+void SoftmaxPolicy<dType, device::GPU, nds, ipts, dth>::forward (
+        ExecutionContext& ctx, std::vector<dType>& ins, std::vector<dType>& outs) {
+    softmaxForwardGpu(ctx, ins, wba, num_inputs, outs);
+}
+
 template <typename dType, uint nds, uint ipts, uint dth>
 void SoftmaxPolicy<dType, device::GPU, nds, ipts, dth>::backward(
         std::vector<dType>& outs, std::vector<dType>& targets) {
     // Even though this is the GPU version, 
     // the CPU version is faster, so use that
+    errors.resize(nds);                         // May hold the errors of a batch
     softmaxBackwardCpu(outs, targets, errors);
 }
 
-// NOT DONE
+template <typename dType, uint nds, uint ipts, uint dth>
+void SoftmaxPolicy<dType, device::GPU, nds, ipts, dth>::forward(
+        ExecutionContext& ctx, const Tensor<dType, 2>& ins, Tensor<dType, 2>& outs) {
+    softmaxForwardBatchGpu(ctx, ins, wba, num_inputs, outs);
+}
+
+template <typename dType, uint nds, uint ipts, uint dth>
+void SoftmaxPolicy<dType, device::GPU, nds, ipts, dth>::backward(
+        const Tensor<dType, 2>& outs, const Tensor<dType, 2>& targets) {
+    softmaxBackwardBatchCpu(outs, targets, errors);
+}
+
+template <typename dType, uint nds, uint ipts, uint dth>
+bool SoftmaxPolicy<dType, device::GPU, nds, ipts, dth>::projectSequence(
+        ExecutionContext& ctx, const Tensor<dType, 2>& ins, Tensor<dType, 2>& outs) {
+    return softmaxLogitsBatchGpu(ctx, ins, wba, num_inputs, outs);
+}
+
 template <typename dType, uint nds, uint ipts, uint dth>
 void SoftmaxPolicy<dType, device::GPU, nds, ipts, dth>::updateWba( 
-        const frnn::Tensor4<dType>& prev_layer_acts) {
+        ExecutionContext& ctx, const frnn::Tensor4<dType>& prev_layer_acts) {
+    // The weights are kept on the host, and the update reads each weight
+    // once, so moving them to the GPU would take longer than the update
+    softmaxUpdateWbaCpu(ctx, errors, prev_layer_acts, num_inputs, learn_rate, momentum, wba, wba_prev);
+}
+
+template <typename dType, uint nds, uint ipts, uint dth>
+void SoftmaxPolicy<dType, device::GPU, nds, ipts, dth>::forward (
+        const SparseTensor<dType, 1>& ins, std::vector<dType>& outs) {
+    // Gathering the columns is O(nodes) per non-zero input, which is
+    // far less work than moving the whole wba page to the GPU
+    frnnError          error;
+    std::vector<dType> logits;
+    softmaxLogitsSparseCpu(ins, wba, num_inputs, logits);
+    frnn::math<dType, device::GPU>::softmax(error, logits, outs);
 }
+#endif
 
 /* ======================================= CPU IMPLEMENTATIONS  =========================================== */
 
-// NOT DONE
 template <typename dType, uint nds, uint ipts, uint dth>
 void SoftmaxPolicy<dType, device::CPU, nds, ipts, dth>::forward( 
         std::vector<dType>& ins, std::vector<dType>& outs) {
-    // CPU implementation not done yet, use gpu
-    softmaxForwardGpu(ins, wba, num_inputs, outs);
+    // Call softmax forward cpu version
+    forward(ExecutionContext::threadDefault(), ins, outs);
+}
+
+template <typename dType, uint nds, uint ipts, uint dth>
+void SoftmaxPolicy<dType, device::CPU, nds, ipts, dth>::forward( 
+        const SparseTensor<dType, 1>& ins, std::vector<dType>& outs) {
+    frnnError          error;
+    std::vector<dType> logits;
+    softmaxLogitsSparseCpu(ins, wba, num_inputs, logits);
+    frnn::math<dType, device::CPU>::softmax(error, logits, outs);
+}
+
+template <typename dType, uint nds, uint ipts, uint dth>
+void SoftmaxPolicy<dType, device::CPU, nds, ipts, dth>::forward (
+        ExecutionContext& ctx, std::vector<dType>& ins, std::vector<dType>& outs) {
+    softmaxForwardCpu(ctx, ins, wba, num_inputs, outs);
 }
 
 template <typename dType, uint nds, uint ipts, uint dth>
 void SoftmaxPolicy<dType, device::CPU, nds, ipts, dth>::backward( 
         std::vector<dType>& outs, std::vector<dType>& targets) {
     // Call softmax backward cpu kernel
+    errors.resize(nds);                         // May hold the errors of a batch
     softmaxBackwardCpu(outs, targets, errors);
 }
 
-// NOT DONE
+template <typename dType, uint nds, uint ipts, uint dth>
+void SoftmaxPolicy<dType, device::CPU, nds, ipts, dth>::forward(
+        ExecutionContext& ctx, const Tensor<dType, 2>& ins, Tensor<dType, 2>& outs) {
+    // Only the gemm of a batch uses the packed weights (a single sample uses gemv on wba)
+    softmaxForwardBatchCpu(ctx, ins, wba, num_inputs, outs, ins.size(1) > 1 ? packedWeights(ctx) : NULL);
+}
+
+template <typename dType, uint nds, uint ipts, uint dth>
+void SoftmaxPolicy<dType, device::CPU, nds, ipts, dth>::backward(
+        const Tensor<dType, 2>& outs, const Tensor<dType, 2>& targets) {
+    softmaxBackwardBatchCpu(outs, targets, errors);
+}
+
+template <typename dType, uint nds, uint ipts, uint dth>
+dType SoftmaxPolicy<dType, device::CPU, nds, ipts, dth>::forwardBackward(
+        ExecutionContext& ctx, const std::vector<dType>& ins, size_t target) {
+    errors.resize(nds);                         // May hold the errors of a batch
+    return softmaxLossCpu(ctx, ins, wba, num_inputs, target, errors);
+}
+
+template <typename dType, uint nds, uint ipts, uint dth>
+dType SoftmaxPolicy<dType, device::CPU, nds, ipts, dth>::forwardBackward(
+        ExecutionContext& ctx, const Tensor<dType, 2>& ins, const std::vector<int>& targets) {
+    return softmaxLossBatchCpu(ctx, ins, wba, num_inputs, targets, errors, 
+                               ins.size(1) > 1 ? packedWeights(ctx) : NULL);
+}
+
+template <typename dType, uint nds, uint ipts, uint dth>
+bool SoftmaxPolicy<dType, device::CPU, nds, ipts, dth>::projectSequence(
+        ExecutionContext& ctx, const Tensor<dType, 2>& ins, Tensor<dType, 2>& outs) {
+    return softmaxLogitsBatchCpu(ctx, ins, wba, num_inputs, outs, ins.size(1) > 1 ? packedWeights(ctx) : NULL);
+}
+
 template <typename dType, uint nds, uint ipts, uint dth>
 void SoftmaxPolicy<dType, device::CPU, nds, ipts, dth>::updateWba( 
-        const frnn::Tensor4<dType>& prev_layer_acts) {
+        ExecutionContext& ctx, const frnn::Tensor4<dType>& prev_layer_acts) {
+    softmaxUpdateWbaCpu(ctx, errors, prev_layer_acts, num_inputs, learn_rate, momentum, wba, wba_prev);
+
+    // The weights have changed, so the packed copy is packed again when a batch next uses it
+    weightsChanged();
 }
 
 }   // Namepsace ltype
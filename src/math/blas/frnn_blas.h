@@ -1,7 +1,8 @@
 /*
  *  Header file for fastRNN blas functions, whicha are simply structs
- *  with function pointers that call cublas functions, but can determine
- *  if the float or double version of the cublas functions should be called.
+ *  with function pointers that call cublas functions (or the native CPU
+ *  blas functions), but can determine if the float or double version of 
+ *  the functions should be called.
  *
  *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
  *
@@ -23,14 +24,23 @@
 #ifndef _FRNN_BLAS_
 #define _FRNN_BLAS_
 
+#include "../../frnn/types.h"
+#include "frnn_blas_cpu.h"
+
+#ifndef FRNN_CPU_ONLY
 #include <cuda_runtime.h>
 #include <cublas_v2.h>
+#endif
 
 /*
  * ========================================= NOTES ==========================================================
- * 1. The functions in this namespace are simply 'wrappers' that allow the cublas functions to be called in
- *    templated functions in other part of the fastRNN library, they are not my own implementation of these
- *    functions
+ * 1. The GPU functions in this namespace are simply 'wrappers' that allow the cublas functions to be called 
+ *    in templated functions in other part of the fastRNN library, they are not my own implementation of 
+ *    these functions
+ *
+ * 2. The CPU functions are in frnn_blas_cpu.h and have the same arguments as the cublas functions, with a 
+ *    blasHandleCpu, blasOperation and blasStatus in place of the cublas types, so that code can use either 
+ *    device with the same calls. Define FRNN_CPU_ONLY to use only the CPU functions (without cublas).
  * ==========================================================================================================
  */
 
@@ -40,22 +50,77 @@ namespace blas  {
  * ==========================================================================================================
  * Struct       : functions 
  *
- * Description  : Struct that holds function pointer to cublas functions for different data types
+ * Description  : Struct that holds function pointer to cublas (or CPU blas) functions for different data 
+ *                types
  * 
  * Params       : dType     : The type of data the function must use
+ *              : dev       : The device to use (CPU | GPU), GPU by default
  * ==========================================================================================================
  */
-template <typename dType> struct functions;
+template <typename dType, frnn::device dev = frnn::device::GPU> struct functions;
+
+// Partial specification for single precision CPU blas functions
+template <> struct functions<float, frnn::device::CPU> {
+
+    // Matix vector multiplication
+    typedef blasStatus (*fpgemv)( blasHandleCpu   , blasOperation      , int     , int           ,
+                                  const float*    , const float*       , int     , const float*  ,
+                                  int             , const float*       , float*  , int           );
+    static constexpr fpgemv gemv = &gemvCpu<float>;
+
+    // Matrix matrix multiplication
+    typedef blasStatus (*fpgemm)( blasHandleCpu   , blasOperation      , blasOperation  , int     ,
+                                  int             , int                , const float*   , const float*  ,
+                                  int             , const float*       , int            , const float*  ,
+                                  float*          , int                                                 );
+    static constexpr fpgemm gemm = &gemmCpu<float>;
+
+    // A*X plus Y
+    typedef blasStatus (*fpaxpy)( blasHandleCpu   , int     , const float*  , const float*  ,
+                                  int             , float*  , int                           );
+    static constexpr fpaxpy axpy = &axpyCpu<float>;
+};
+
+// Partial specification for double precision CPU blas functions
+template <> struct functions<double, frnn::device::CPU> {
+
+    // Matix vector multiplication
+    typedef blasStatus (*fpgemv)( blasHandleCpu   , blasOperation      , int     , int           ,
+                                  const double*   , const double*      , int     , const double* ,
+                                  int             , const double*      , double* , int           );
+    static constexpr fpgemv gemv = &gemvCpu<double>;
+
+    // Matrix matrix multiplication
+    typedef blasStatus (*fpgemm)( blasHandleCpu   , blasOperation      , blasOperation  , int     ,
+                                  int             , int                , const double*  , const double* ,
+                                  int             , const double*      , int            , const double* ,
+                                  double*         , int                                                 );
+    static constexpr fpgemm gemm = &gemmCpu<double>;
+
+    // A*X plus Y
+    typedef blasStatus (*fpaxpy)( blasHandleCpu   , int     , const double*  , const double*    ,
+                                  int             , double* , int                               );
+    static constexpr fpaxpy axpy = &axpyCpu<double>;
+};
+
+#ifndef FRNN_CPU_ONLY
 
 // Partial specification for single precision cublas functions 
 // (See cublas API reference for details)
-template <> struct functions<float> {
+template <> struct functions<float, frnn::device::GPU> {
     
     // Matix vector multiplication
     typedef cublasStatus_t (*fpgemv)( cublasHandle_t  , cublasOperation_t  , int     , int           ,   
                                       const float*    , const float*       , int     , const float*  ,
                                       int             , const float*       , float*  , int           );
     static constexpr fpgemv gemv = &cublasSgemv;
+
+    // Matrix matrix multiplication
+    typedef cublasStatus_t (*fpgemm)( cublasHandle_t  , cublasOperation_t  , cublasOperation_t  , int      ,
+                                      int             , int                , const float*       , const float*  ,
+                                      int             , const float*       , int                , const float*  ,
+                                      float*          , int                                                     );
+    static constexpr fpgemm gemm = &cublasSgemm;
     
     // A*X plus Y
     typedef cublasStatus_t (*fpaxpy)( cublasHandle_t  , int     , const float*  , const float*  ,
@@ -65,13 +130,20 @@ template <> struct functions<float> {
 };
 
 // Partial specification for double precision cublas functions
-template <> struct functions<double> {
+template <> struct functions<double, frnn::device::GPU> {
 
     // Matix vector multiplication
     typedef cublasStatus_t (*fpgemv)( cublasHandle_t  , cublasOperation_t  , int     , int           ,   
                                       const double*   , const double*      , int     , const double* ,
                                       int             , const double*      , double* , int           );
     static constexpr fpgemv gemv = &cublasDgemv;
+
+    // Matrix matrix multiplication
+    typedef cublasStatus_t (*fpgemm)( cublasHandle_t  , cublasOperation_t  , cublasOperation_t  , int      ,
+                                      int             , int                , const double*      , const double* ,
+                                      int             , const double*      , int                , const double* ,
+                                      double*         , int                                                     );
+    static constexpr fpgemm gemm = &cublasDgemm;
     
     // A*X plus Y
     typedef cublasStatus_t (*fpaxpy)( cublasHandle_t  , int     , const double*  , const double*    ,
@@ -79,6 +151,8 @@ template <> struct functions<double> {
     static constexpr fpaxpy axpy = &cublasDaxpy;
 };
 
+#endif
+
 }
 }
 
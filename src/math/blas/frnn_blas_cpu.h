@@ -0,0 +1,974 @@
+/*
+ *  Header file for fastRNN CPU blas functions. These have the same interface as the cublas functions
+ *  (column major matrices, leading dimensions, increments and scalars passed by pointer) so that the
+ *  frnn::blas::functions table can be used in the same way for the CPU and the GPU.
+ *
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FRNN_BLAS_CPU_
+#define _FRNN_BLAS_CPU_
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "../../frnn/vectorized_types_cpu.h"
+#include "../../frnn/elementwise_cpu.h"
+#include "../../containers/buffer_pool.h"
+
+/*
+ * ========================================= NOTES ==========================================================
+ * 1. Matrix multiplication is done as in GotoBLAS : op(B) is packed into panels of NR columns (for a block
+ *    of KC x NC elements), op(A) is packed into panels of MR rows (for a block of MC x KC elements), and
+ *    then a micro-kernel computes each MR x NR tile of C from a pair of panels, keeping the tile in
+ *    registers. The packed blocks stay in the caches while all the tiles which use them are computed, and
+ *    the tiles of a block are shared between the OpenMP threads.
+ *
+ * 2. Each kernel is compiled for each instruction set (see frnn/cpu_features.h), with the vector width and
+ *    the tile sizes for the instruction set, and the widest version which the host supports is used. The
+ *    vector operations are the ones from VectorizedInstructionsCpu (see frnn/vectorized_types_cpu.h).
+ *    Vector types only ever exist inside the functions for a specific instruction set, the drivers (which
+ *    do the packing and OpenMP work sharing) only pass pointers to them.
+ *
+ * 3. A matrix which is multiplied many times without changing (for example the weights of a layer) can be
+ *    packed once with gemmPackCpu, into the MR row panels of every KC block of columns, and then used by
+ *    gemmPackedCpu, which skips the packing of A. The panel for rows i to i + MR of the block of columns
+ *    from p starts at p * m_padded + i * kc, where m_padded is m rounded up to a multiple of MR (the
+ *    padding rows are zero) and kc is the number of columns in the block. gemv does not pack A (it reads
+ *    the columns of A with unit stride already), so it has no packed version.
+ * ==========================================================================================================
+ */
+
+namespace frnn {
+namespace blas  {
+
+/*
+ * ==========================================================================================================
+ * Enum         : blasOperation
+ *
+ * Description  : Enumerator for the operation to apply to a matrix before it is used (as cublasOperation_t)
+ * ==========================================================================================================
+ */
+enum blasOperation {
+    BLAS_OP_N = 0,                  // Use the matrix
+    BLAS_OP_T = 1                   // Use the transpose of the matrix
+};
+
+/*
+ * ==========================================================================================================
+ * Enum         : blasStatus
+ *
+ * Description  : Enumerator for the status returned by the CPU blas functions (as cublasStatus_t)
+ * ==========================================================================================================
+ */
+enum blasStatus {
+    BLAS_STATUS_SUCCESS         = 0,
+    BLAS_STATUS_INVALID_VALUE   = 7
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : blasContextCpu
+ *
+ * Description  : Context for the CPU blas functions (as the cublas handle). A NULL handle uses the defaults.
+ * ==========================================================================================================
+ */
+struct blasContextCpu {
+    int num_threads;                // Number of OpenMP threads to use, 0 for the OpenMP default
+};
+
+typedef blasContextCpu* blasHandleCpu;
+
+/*
+ * ==========================================================================================================
+ * Struct       : packedMatrixCpu
+ *
+ * Description  : A matrix which has been packed by gemmPackCpu into the panels the matrix multiplication
+ *                kernel of an instruction set uses (see note 3), so that a matrix which is multiplied many
+ *                times is only packed once
+ *
+ * Params       : dType     : The type of data in the matrix
+ * ==========================================================================================================
+ */
+template <typename dType> struct packedMatrixCpu {
+    isa                 level;          // The instruction set the matrix was packed for
+    size_t              m;              // Number of rows of op(A)
+    size_t              k;              // Number of columns of op(A)
+    std::vector<dType>  panels;         // The packed panels
+
+    packedMatrixCpu() : level( SCALAR ), m( 0 ), k( 0 ) {}
+};
+
+namespace detail {
+
+// Blocking sizes (in elements), MC is a multiple of every MR
+constexpr size_t gemmMc() { return 128;  }
+constexpr size_t gemmKc() { return 256;  }
+constexpr size_t gemmNc() { return 4096; }
+
+// Minimum number of multiply adds for the functions to use more than one thread
+constexpr size_t parallelWork() { return 1 << 16; }
+
+/*
+ * ==========================================================================================================
+ * Struct       : GemmTileShape
+ *
+ * Description  : The shape of the micro-kernel tile for an instruction set, as the number of vectors in a
+ *                column of the tile (so MR = mv * the vector width) and the number of columns (NR), chosen so
+ *                that the tile and a column of A fit in the registers of the instruction set.
+ *
+ * Params       : level     : The instruction set
+ * ==========================================================================================================
+ */
+template <isa level> struct GemmTileShape           { static constexpr size_t mv = 2, nr = 4; };
+template <>          struct GemmTileShape<SCALAR>   { static constexpr size_t mv = 4, nr = 4; };
+template <>          struct GemmTileShape<AVX2>     { static constexpr size_t mv = 2, nr = 6; };
+template <>          struct GemmTileShape<AVX512>   { static constexpr size_t mv = 2, nr = 8; };
+
+/*
+ * ==========================================================================================================
+ * Function     : gemmTile
+ *
+ * Description  : Micro-kernel which computes C = C + alpha * A * B for a single MR x NR tile of C, from a
+ *                packed panel of MR rows of A and a packed panel of NR columns of B. The tile is accumulated
+ *                in registers, and only written to C once all kc products have been added.
+ *
+ * Inputs       : kc        : The number of columns of the A panel (rows of the B panel)
+ *              : a         : The packed panel of A (kc groups of MR elements)
+ *              : b         : The packed panel of B (kc groups of NR elements)
+ *              : alpha     : The scalar to multiply the product by
+ *              : ldc       : The leading dimension of C
+ *              : m_r       : The number of rows of the tile which are inside C
+ *              : n_r       : The number of columns of the tile which are inside C
+ *
+ * Outputs      : c         : A pointer to the first element of the tile in C
+ *
+ * Params       : level     : The instruction set
+ *              : dType     : The type of data in the matrices
+ * ==========================================================================================================
+ */
+template <isa level, typename dType>
+FRNN_FORCE_INLINE void gemmTile( size_t kc, const dType* a, const dType* b, dType alpha, dType* c, size_t ldc,
+                                 size_t m_r, size_t n_r ) {
+    typedef VectorizedInstructionsCpu<dType, level> V;
+    typedef typename V::vect_type                   vec;
+    constexpr size_t W = V::typeSize(), MV = GemmTileShape<level>::mv, NR = GemmTileShape<level>::nr, MR = W * MV;
+
+    vec acc[ NR ][ MV ];
+    for ( size_t col = 0; col < NR; col++ )
+        for ( size_t v = 0; v < MV; v++ ) acc[ col ][ v ] = V::mm_zero();
+
+    for ( size_t p = 0; p < kc; p++ ) {
+        vec a_vec[ MV ];
+        for ( size_t v = 0; v < MV; v++ ) a_vec[ v ] = V::mm_load_u( a + v * W );
+        for ( size_t col = 0; col < NR; col++ ) {
+            const vec b_vec = V::mm_set1( b[ col ] );
+            for ( size_t v = 0; v < MV; v++ ) acc[ col ][ v ] = V::mm_fmadd_p( a_vec[ v ], b_vec, acc[ col ][ v ] );
+        }
+        a += MR; b += NR;
+    }
+
+    const vec alpha_vec = V::mm_set1( alpha );
+    if ( m_r == MR && n_r == NR ) {                                     // Full tile, update C directly
+        for ( size_t col = 0; col < NR; col++ ) {
+            for ( size_t v = 0; v < MV; v++ ) {
+                dType* c_vec = c + col * ldc + v * W;
+                V::mm_store_u( c_vec, V::mm_fmadd_p( acc[ col ][ v ], alpha_vec, V::mm_load_u( c_vec ) ) );
+            }
+        }
+    } else {                                                            // Edge tile, only the part inside C
+        dType tile[ MR * NR ];
+        for ( size_t col = 0; col < NR; col++ )
+            for ( size_t v = 0; v < MV; v++ ) V::mm_store_u( tile + col * MR + v * W, acc[ col ][ v ] );
+        for ( size_t col = 0; col < n_r; col++ )
+            for ( size_t row = 0; row < m_r; row++ ) c[ col * ldc + row ] += alpha * tile[ col * MR + row ];
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : gemvRows
+ *
+ * Description  : Computes out = alpha * A * x + beta * out for the rows i0 to i1 of a column major matrix
+ *                A. Four columns are done at a time so that each load and store of out is shared by four
+ *                columns, and the block of out stays in L1 cache. When beta is zero out is not read.
+ *
+ * Inputs       : i0, i1    : The first and one past the last row to compute
+ *              : n         : The number of columns of A
+ *              : alpha     : The scalar to multiply A * x by
+ *              : A         : The matrix
+ *              : lda       : The leading dimension of A
+ *              : x         : The (contiguous) vector to multiply with
+ *              : beta      : The scalar to multiply out by
+ *
+ * Outputs      : out       : The result, element i for row i
+ *
+ * Params       : level     : The instruction set
+ *              : dType     : The type of data in the matrix and vectors
+ * ==========================================================================================================
+ */
+template <isa level, typename dType>
+FRNN_FORCE_INLINE void gemvRows( size_t i0, size_t i1, size_t n, dType alpha, const dType* A, size_t lda,
+                                 const dType* x, dType beta, dType* out ) {
+    typedef VectorizedInstructionsCpu<dType, level> V;
+    typedef typename V::vect_type                   vec;
+    constexpr size_t W = V::typeSize();
+
+    if ( beta == dType( 0 ) ) {
+        std::fill( out + i0, out + i1, dType( 0 ) );
+    } else if ( beta != dType( 1 ) ) {
+        for ( size_t i = i0; i < i1; i++ ) out[ i ] *= beta;
+    }
+
+    // alpha is applied to x, so that the columns accumulate straight into out
+    size_t j = 0;
+    for ( ; j + 4 <= n; j += 4 ) {
+        const dType* a0 = A + j * lda;       const dType* a1 = a0 + lda;
+        const dType* a2 = a1 + lda;          const dType* a3 = a2 + lda;
+        const dType  s0 = alpha * x[ j ], s1 = alpha * x[ j + 1 ], s2 = alpha * x[ j + 2 ], s3 = alpha * x[ j + 3 ];
+        const vec    x0 = V::mm_set1( s0 ), x1 = V::mm_set1( s1 );
+        const vec    x2 = V::mm_set1( s2 ), x3 = V::mm_set1( s3 );
+
+        size_t i = i0;
+        for ( ; i + W <= i1; i += W ) {
+            vec acc = V::mm_load_u( out + i );
+            acc = V::mm_fmadd_p( V::mm_load_u( a0 + i ), x0, acc );
+            acc = V::mm_fmadd_p( V::mm_load_u( a1 + i ), x1, acc );
+            acc = V::mm_fmadd_p( V::mm_load_u( a2 + i ), x2, acc );
+            acc = V::mm_fmadd_p( V::mm_load_u( a3 + i ), x3, acc );
+            V::mm_store_u( out + i, acc );
+        }
+        for ( ; i < i1; i++ ) out[ i ] += a0[ i ] * s0 + a1[ i ] * s1 + a2[ i ] * s2 + a3[ i ] * s3;
+    }
+    for ( ; j < n; j++ ) {
+        const dType* a0 = A + j * lda;
+        const dType  s0 = alpha * x[ j ];
+        const vec    x0 = V::mm_set1( s0 );
+        size_t i = i0;
+        for ( ; i + W <= i1; i += W ) V::mm_store_u( out + i, V::mm_fmadd_p( V::mm_load_u( a0 + i ), x0, V::mm_load_u( out + i ) ) );
+        for ( ; i < i1; i++ ) out[ i ] += a0[ i ] * s0;
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : gemvCols
+ *
+ * Description  : Computes out = alpha * A^T * x + beta * out for the columns j0 to j1 of a column major
+ *                matrix A, where each element of A^T * x is the dot product of a column of A and x. Four
+ *                columns are done at a time so that each load of x is shared by four columns. When beta is
+ *                zero out is not read.
+ *
+ * Inputs       : j0, j1    : The first and one past the last column to compute
+ *              : m         : The number of rows of A
+ *              : alpha     : The scalar to multiply A^T * x by
+ *              : A         : The matrix
+ *              : lda       : The leading dimension of A
+ *              : x         : The (contiguous) vector to multiply with
+ *              : beta      : The scalar to multiply out by
+ *
+ * Outputs      : out       : The result, element j for column j
+ *
+ * Params       : level     : The instruction set
+ *              : dType     : The type of data in the matrix and vectors
+ * ==========================================================================================================
+ */
+template <isa level, typename dType>
+FRNN_FORCE_INLINE void gemvCols( size_t j0, size_t j1, size_t m, dType alpha, const dType* A, size_t lda,
+                                 const dType* x, dType beta, dType* out ) {
+    typedef VectorizedInstructionsCpu<dType, level> V;
+    typedef typename V::vect_type                   vec;
+    constexpr size_t W = V::typeSize();
+
+    auto store = [=]( dType& out_j, dType dot ) {
+        out_j = beta == dType( 0 ) ? alpha * dot : alpha * dot + beta * out_j;
+    };
+
+    size_t j = j0;
+    for ( ; j + 4 <= j1; j += 4 ) {
+        const dType* a0 = A + j * lda;       const dType* a1 = a0 + lda;
+        const dType* a2 = a1 + lda;          const dType* a3 = a2 + lda;
+        vec acc0 = V::mm_zero(), acc1 = V::mm_zero(), acc2 = V::mm_zero(), acc3 = V::mm_zero();
+
+        size_t i = 0;
+        for ( ; i + W <= m; i += W ) {
+            const vec x_vec = V::mm_load_u( x + i );
+            acc0 = V::mm_fmadd_p( V::mm_load_u( a0 + i ), x_vec, acc0 );
+            acc1 = V::mm_fmadd_p( V::mm_load_u( a1 + i ), x_vec, acc1 );
+            acc2 = V::mm_fmadd_p( V::mm_load_u( a2 + i ), x_vec, acc2 );
+            acc3 = V::mm_fmadd_p( V::mm_load_u( a3 + i ), x_vec, acc3 );
+        }
+        dType dot0 = V::mm_hsum( acc0 ), dot1 = V::mm_hsum( acc1 ), dot2 = V::mm_hsum( acc2 ), dot3 = V::mm_hsum( acc3 );
+        for ( ; i < m; i++ ) {
+            dot0 += a0[ i ] * x[ i ]; dot1 += a1[ i ] * x[ i ]; dot2 += a2[ i ] * x[ i ]; dot3 += a3[ i ] * x[ i ];
+        }
+        store( out[ j ], dot0 ); store( out[ j + 1 ], dot1 ); store( out[ j + 2 ], dot2 ); store( out[ j + 3 ], dot3 );
+    }
+    for ( ; j < j1; j++ ) {
+        const dType* a0  = A + j * lda;
+        vec          acc = V::mm_zero();
+        size_t i = 0;
+        for ( ; i + W <= m; i += W ) acc = V::mm_fmadd_p( V::mm_load_u( a0 + i ), V::mm_load_u( x + i ), acc );
+        dType dot = V::mm_hsum( acc );
+        for ( ; i < m; i++ ) dot += a0[ i ] * x[ i ];
+        store( out[ j ], dot );
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : axpyRange
+ *
+ * Description  : Computes y = alpha * x + y for elements i0 to i1 of contiguous vectors, with a scalar loop
+ *                for the elements which do not fill a vector.
+ *
+ * Inputs       : i0, i1    : The first and one past the last element to compute
+ *              : alpha     : The scalar to multiply x by
+ *              : x         : The vector to add
+ *
+ * Outputs      : y         : The vector to add to
+ *
+ * Params       : level     : The instruction set
+ *              : dType     : The type of data in the vectors
+ * ==========================================================================================================
+ */
+template <isa level, typename dType>
+FRNN_FORCE_INLINE void axpyRange( size_t i0, size_t i1, dType alpha, const dType* x, dType* y ) {
+    typedef VectorizedInstructionsCpu<dType, level> V;
+    typedef typename V::vect_type                   vec;
+    constexpr size_t W = V::typeSize();
+
+    const vec alpha_vec = V::mm_set1( alpha );
+    size_t i = i0;
+    for ( ; i + W <= i1; i += W ) {
+        V::mm_store_u( y + i, V::mm_fmadd_p( V::mm_load_u( x + i ), alpha_vec, V::mm_load_u( y + i ) ) );
+    }
+    for ( ; i < i1; i++ ) y[ i ] += alpha * x[ i ];
+}
+
+/*
+ * ==========================================================================================================
+ * Struct       : CpuKernels
+ *
+ * Description  : The kernels compiled for a specific instruction set, and the tile sizes for the instruction
+ *                set. Each function is compiled with the target attribute for the instruction set so that
+ *                the width generic kernels above are inlined with the instruction set's vector operations.
+ *
+ * Params       : dType     : The type of data the kernels use
+ *              : level     : The instruction set
+ * ==========================================================================================================
+ */
+template <typename dType, isa level> struct CpuKernels;
+
+#define FRNN_BLAS_CPU_KERNELS( LEVEL, TARGET )                                                              \
+template <typename dType> struct CpuKernels<dType, LEVEL> {                                                 \
+    static constexpr size_t mr = VectorizedInstructionsCpu<dType, LEVEL>::typeSize() *                      \
+                                 GemmTileShape<LEVEL>::mv;                                                  \
+    static constexpr size_t nr = GemmTileShape<LEVEL>::nr;                                                  \
+                                                                                                            \
+    TARGET static void gemmTile( size_t kc, const dType* a, const dType* b, dType alpha, dType* c,          \
+                                 size_t ldc, size_t m_r, size_t n_r ) {                                     \
+        detail::gemmTile<LEVEL>( kc, a, b, alpha, c, ldc, m_r, n_r );                                     \
+    }                                                                                                       \
+    TARGET static void gemvRows( size_t i0, size_t i1, size_t n, dType alpha, const dType* A, size_t lda,   \
+                                 const dType* x, dType beta, dType* out ) {                                 \
+        detail::gemvRows<LEVEL>( i0, i1, n, alpha, A, lda, x, beta, out );                                \
+    }                                                                                                       \
+    TARGET static void gemvCols( size_t j0, size_t j1, size_t m, dType alpha, const dType* A, size_t lda,   \
+                                 const dType* x, dType beta, dType* out ) {                                 \
+        detail::gemvCols<LEVEL>( j0, j1, m, alpha, A, lda, x, beta, out );                                \
+    }                                                                                                       \
+    TARGET static void axpy( size_t i0, size_t i1, dType alpha, const dType* x, dType* y ) {                 \
+        detail::axpyRange<LEVEL>( i0, i1, alpha, x, y );                                                  \
+    }                                                                                                       \
+};
+
+FRNN_BLAS_CPU_KERNELS( SCALAR, )
+#if FRNN_X86
+FRNN_BLAS_CPU_KERNELS( SSE2  , FRNN_TARGET_SSE2   )
+FRNN_BLAS_CPU_KERNELS( AVX2  , FRNN_TARGET_AVX2   )
+FRNN_BLAS_CPU_KERNELS( AVX512, FRNN_TARGET_AVX512 )
+#endif
+
+#undef FRNN_BLAS_CPU_KERNELS
+
+/*
+ * ==========================================================================================================
+ * Function     : numThreads
+ *
+ * Description  : Gets the number of threads to use for a blas function
+ *
+ * Inputs       : handle    : The context for the function, which may be NULL
+ *
+ * Outputs      : The number of threads to use
+ * ==========================================================================================================
+ */
+inline int numThreads( blasHandleCpu handle ) {
+    if ( handle != NULL && handle->num_threads > 0 ) return handle->num_threads;
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : stridedIndex
+ *
+ * Description  : Gets the index of element i of a blas vector with an increment, where a negative increment
+ *                means that the vector is stored backwards (as in the reference blas)
+ *
+ * Inputs       : i         : The element of the vector
+ *              : n         : The number of elements in the vector
+ *              : inc       : The increment of the vector
+ *
+ * Outputs      : The index of element i in memory
+ * ==========================================================================================================
+ */
+inline size_t stridedIndex( size_t i, size_t n, int inc ) {
+    return inc > 0 ? i * inc : ( n - 1 - i ) * static_cast<size_t>( -inc );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : packPanel
+ *
+ * Description  : Packs a panel of MR rows and kc columns of op(A), with the MR elements of each column next
+ *                to each other and zeros for the rows outside of op(A)
+ *
+ * Inputs       : transa    : The operation to apply to A
+ *              : A         : The matrix
+ *              : lda       : The leading dimension of A
+ *              : i0        : The first row of the panel in op(A)
+ *              : rows      : The number of rows of the panel which are inside op(A)
+ *              : p0        : The first column of the panel in op(A)
+ *              : kc        : The number of columns in the panel
+ *
+ * Outputs      : panel     : The packed panel (kc groups of MR elements)
+ *
+ * Params       : MR        : The number of rows in a panel
+ *              : dType     : The type of data in the matrix
+ * ==========================================================================================================
+ */
+template <size_t MR, typename dType>
+void packPanel( blasOperation transa, const dType* A, size_t lda, size_t i0, size_t rows, size_t p0, size_t kc,
+                dType* panel ) {
+    for ( size_t p = 0; p < kc; p++ ) {
+        for ( size_t row = 0; row < MR; row++ ) {
+            const size_t i = i0 + row;
+            panel[ p * MR + row ] = row >= rows ? dType( 0 ) : transa == BLAS_OP_N
+                                  ? A[ i + ( p0 + p ) * lda ] : A[ ( p0 + p ) + i * lda ];
+        }
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : gemmBlocked
+ *
+ * Description  : Driver for the blocked matrix multiplication C = alpha * op(A) * op(B) + beta * C, which
+ *                packs the blocks of A and B and shares the tiles of each block between the OpenMP threads.
+ *                The arguments are as for gemmCpu (after they have been checked), and packed_a is the
+ *                packed form of op(A) (see note 3), or NULL if A must be packed.
+ *
+ * Params       : K         : The kernels for the instruction set to use
+ *              : dType     : The type of data in the matrices
+ * ==========================================================================================================
+ */
+template <typename K, typename dType>
+void gemmBlocked( blasHandleCpu handle, blasOperation transa, blasOperation transb, size_t m, size_t n,
+                  size_t k, dType alpha, const dType* A, size_t lda, const dType* B, size_t ldb, dType beta,
+                  dType* C, size_t ldc, const dType* packed_a = NULL ) {
+    constexpr size_t MR = K::mr, NR = K::nr;
+    const size_t     MC = gemmMc(), KC = gemmKc(), NC = gemmNc();
+    const size_t     m_padded = ( m + MR - 1 ) / MR * MR;
+    const bool       parallel = m * n * k >= parallelWork();
+    const bool       multiply = alpha != dType( 0 ) && k > 0;
+
+    PooledBuffer<dType> a_pack;
+    PooledBuffer<dType> b_pack = BufferPool::instance().acquire<dType>( { KC, ( NC + NR - 1 ) / NR * NR } );
+    if ( packed_a == NULL ) a_pack = BufferPool::instance().acquire<dType>( { MC, KC } );
+    dType*              a_data = a_pack.data();
+    dType*              b_data = b_pack.data();
+
+    #pragma omp parallel num_threads( numThreads( handle ) ) if ( parallel )
+    {
+        if ( beta != dType( 1 ) ) {                                             // C = beta * C
+            #pragma omp for schedule( static )
+            for ( long j = 0; j < static_cast<long>( n ); j++ ) {
+                dType* c_col = C + j * ldc;
+                if ( beta == dType( 0 ) ) std::fill( c_col, c_col + m, dType( 0 ) );
+                else for ( size_t i = 0; i < m; i++ ) c_col[ i ] *= beta;
+            }
+        }
+
+        for ( size_t jc = 0; multiply && jc < n; jc += NC ) {
+            const size_t nc       = std::min( NC, n - jc );
+            const size_t n_panels = ( nc + NR - 1 ) / NR;
+
+            for ( size_t pc = 0; pc < k; pc += KC ) {
+                const size_t kc = std::min( KC, k - pc );
+
+                #pragma omp for schedule( static )                              // Pack B into NR panels
+                for ( long q = 0; q < static_cast<long>( n_panels ); q++ ) {
+                    dType* panel = b_data + q * NR * kc;
+                    for ( size_t col = 0; col < NR; col++ ) {
+                        const size_t j = jc + q * NR + col;
+                        for ( size_t p = 0; p < kc; p++ ) {
+                            panel[ p * NR + col ] = j >= jc + nc ? dType( 0 ) : transb == BLAS_OP_N
+                                                  ? B[ ( pc + p ) + j * ldb ] : B[ j + ( pc + p ) * ldb ];
+                        }
+                    }
+                }
+
+                for ( size_t ic = 0; ic < m; ic += MC ) {
+                    const size_t mc       = std::min( MC, m - ic );
+                    const size_t m_panels = ( mc + MR - 1 ) / MR;
+                    const dType* a_block  = packed_a != NULL ? packed_a + pc * m_padded + ic * kc : a_data;
+
+                    if ( packed_a == NULL ) {
+                        #pragma omp for schedule( static )                      // Pack A into MR panels
+                        for ( long q = 0; q < static_cast<long>( m_panels ); q++ ) {
+                            packPanel<MR>( transa, A, lda, ic + q * MR, std::min( MR, mc - q * MR ), pc, kc,
+                                           a_data + q * MR * kc );
+                        }
+                    }
+
+                    #pragma omp for schedule( static )                          // Tiles of the block
+                    for ( long t = 0; t < static_cast<long>( m_panels * n_panels ); t++ ) {
+                        const size_t ir = t % m_panels, jr = t / m_panels;
+                        K::gemmTile( kc, a_block + ir * MR * kc, b_data + jr * NR * kc, alpha,
+                                     C + ( ic + ir * MR ) + ( jc + jr * NR ) * ldc, ldc,
+                                     std::min( MR, mc - ir * MR ), std::min( NR, nc - jr * NR ) );
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : packBlocked
+ *
+ * Description  : Driver which packs all of op(A) into the panels of every block of columns (see note 3),
+ *                sharing the panels between the OpenMP threads. The arguments are as for gemmPackCpu, and
+ *                packed is resized to hold the panels.
+ *
+ * Params       : K         : The kernels for the instruction set to pack for
+ *              : dType     : The type of data in the matrix
+ * ==========================================================================================================
+ */
+template <typename K, typename dType>
+void packBlocked( blasHandleCpu handle, blasOperation transa, size_t m, size_t k, const dType* A, size_t lda,
+                  std::vector<dType>& packed ) {
+    constexpr size_t MR = K::mr;
+    const size_t     KC = gemmKc();
+    const size_t     m_panels = ( m + MR - 1 ) / MR, k_blocks = ( k + KC - 1 ) / KC;
+
+    packed.resize( m_panels * MR * k );
+    dType* panels = packed.data();
+
+    #pragma omp parallel for num_threads( numThreads( handle ) ) schedule( static ) if ( m * k >= parallelWork() )
+    for ( long t = 0; t < static_cast<long>( m_panels * k_blocks ); t++ ) {
+        const size_t q = t % m_panels, pc = ( t / m_panels ) * KC, kc = std::min( KC, k - pc );
+        packPanel<MR>( transa, A, lda, q * MR, std::min( MR, m - q * MR ), pc, kc,
+                       panels + pc * m_panels * MR + q * MR * kc );
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : gemvBlocked
+ *
+ * Description  : Driver for the matrix vector multiplication y = alpha * op(A) * x + beta * y, which splits
+ *                the rows (or columns for the transpose) of A between the OpenMP threads. The kernels apply
+ *                alpha and beta and write straight into a contiguous y, and only a strided y is computed in
+ *                a buffer and then scattered. The arguments are as for gemvCpu (after they have been
+ *                checked).
+ *
+ * Params       : K         : The kernels for the instruction set to use
+ *              : dType     : The type of data in the matrix and vectors
+ * ==========================================================================================================
+ */
+template <typename K, typename dType>
+void gemvBlocked( blasHandleCpu handle, blasOperation trans, size_t m, size_t n, dType alpha, const dType* A,
+                  size_t lda, const dType* x, int incx, dType beta, dType* y, int incy ) {
+    const size_t len_x    = trans == BLAS_OP_N ? n : m;
+    const size_t len_y    = trans == BLAS_OP_N ? m : n;
+    const bool   parallel = m * n >= parallelWork();
+
+    if ( alpha == dType( 0 ) || len_x == 0 ) {                              // Only y = beta * y
+        for ( size_t i = 0; i < len_y; i++ ) {
+            dType& y_i = y[ stridedIndex( i, len_y, incy ) ];
+            y_i = beta == dType( 0 ) ? dType( 0 ) : beta * y_i;
+        }
+        return;
+    }
+
+    PooledBuffer<dType> x_contiguous;
+    if ( incx != 1 ) {                                                      // Kernels need a contiguous x
+        x_contiguous = BufferPool::instance().acquire<dType>( { len_x } );
+        for ( size_t i = 0; i < len_x; i++ ) x_contiguous[ i ] = x[ stridedIndex( i, len_x, incx ) ];
+        x = x_contiguous.data();
+    }
+
+    // A strided y is computed in a contiguous buffer (so beta is applied when it is scattered)
+    PooledBuffer<dType> y_contiguous;
+    dType*              out      = y;
+    dType               out_beta = beta;
+    if ( incy != 1 ) {
+        y_contiguous = BufferPool::instance().acquire<dType>( { len_y } );
+        out          = y_contiguous.data();
+        out_beta     = dType( 0 );
+    }
+
+    if ( trans == BLAS_OP_N ) {
+        const size_t block  = 512;                                          // Rows, so that out stays in L1
+        const long   blocks = static_cast<long>( ( m + block - 1 ) / block );
+        #pragma omp parallel for num_threads( numThreads( handle ) ) schedule( static ) if ( parallel )
+        for ( long b = 0; b < blocks; b++ ) {
+            K::gemvRows( b * block, std::min( m, ( b + 1 ) * block ), n, alpha, A, lda, x, out_beta, out );
+        }
+    } else {
+        const size_t block  = 16;                                           // Columns
+        const long   blocks = static_cast<long>( ( n + block - 1 ) / block );
+        #pragma omp parallel for num_threads( numThreads( handle ) ) schedule( static ) if ( parallel )
+        for ( long b = 0; b < blocks; b++ ) {
+            K::gemvCols( b * block, std::min( n, ( b + 1 ) * block ), m, alpha, A, lda, x, out_beta, out );
+        }
+    }
+
+    if ( incy != 1 ) {
+        for ( size_t i = 0; i < len_y; i++ ) {
+            dType& y_i = y[ stridedIndex( i, len_y, incy ) ];
+            y_i = beta == dType( 0 ) ? out[ i ] : out[ i ] + beta * y_i;
+        }
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : axpyBlocked
+ *
+ * Description  : Driver for y = alpha * x + y. Contiguous vectors are split into blocks between the OpenMP
+ *                threads (when they are large enough). The arguments are as for axpyCpu (after they have
+ *                been checked).
+ *
+ * Params       : K         : The kernels for the instruction set (CpuKernels)
+ *              : dType     : The type of data in the vectors
+ * ==========================================================================================================
+ */
+template <typename K, typename dType>
+void axpyBlocked( blasHandleCpu handle, size_t n, dType alpha, const dType* x, int incx, dType* y, int incy ) {
+    if ( incx != 1 || incy != 1 ) {
+        for ( size_t i = 0; i < n; i++ ) y[ stridedIndex( i, n, incy ) ] += alpha * x[ stridedIndex( i, n, incx ) ];
+        return;
+    }
+    const size_t block  = cpu::detail::mathBlockSize();
+    const long   blocks = static_cast<long>( ( n + block - 1 ) / block );
+    const int    used   = cpu::detail::parallelThreads( n, numThreads( handle ) );
+    #pragma omp parallel for num_threads( used ) schedule( static ) if ( used > 1 )
+    for ( long b = 0; b < blocks; b++ ) {
+        K::axpy( b * block, std::min( n, ( b + 1 ) * block ), alpha, x, y );
+    }
+}
+
+}   // Namespace detail
+
+/*
+ * ==========================================================================================================
+ * Function     : gemvCpu
+ *
+ * Description  : Performs y = alpha * op(A) * x + beta * y on the CPU, where A is an m x n column major
+ *                matrix, using the widest instruction set the host supports. When beta is zero y does not
+ *                need to be initialized.
+ *
+ * Inputs       : handle    : The context for the function (may be NULL)
+ *              : trans     : The operation to apply to A (BLAS_OP_N or BLAS_OP_T)
+ *              : m, n      : The number of rows and columns of A
+ *              : alpha     : A pointer to the scalar to multiply op(A) * x by
+ *              : A         : The matrix
+ *              : lda       : The leading dimension of A
+ *              : x, incx   : The vector to multiply with and its increment
+ *              : beta      : A pointer to the scalar to multiply y by
+ *              : incy      : The increment of y
+ *
+ * Outputs      : y         : The result vector
+ *              : The status of the function, BLAS_STATUS_INVALID_VALUE if an argument is invalid
+ *
+ * Params       : dType     : The type of data in the matrix and vectors
+ * ==========================================================================================================
+ */
+template <typename dType>
+blasStatus gemvCpu( blasHandleCpu handle, blasOperation trans, int m, int n, const dType* alpha, const dType* A,
+                    int lda, const dType* x, int incx, const dType* beta, dType* y, int incy ) {
+    if ( m < 0 || n < 0 || lda < std::max( 1, m ) || incx == 0 || incy == 0 ) return BLAS_STATUS_INVALID_VALUE;
+    if ( m == 0 || n == 0 ) return BLAS_STATUS_SUCCESS;
+
+    switch ( cpu::activeIsa() ) {
+#if FRNN_X86
+        case AVX512:
+            detail::gemvBlocked<detail::CpuKernels<dType, AVX512>>( handle, trans, m, n, *alpha, A, lda, x, incx,
+                                                                   *beta, y, incy );
+            break;
+        case AVX2:
+            detail::gemvBlocked<detail::CpuKernels<dType, AVX2>>( handle, trans, m, n, *alpha, A, lda, x, incx,
+                                                                 *beta, y, incy );
+            break;
+        case SSE2:
+            detail::gemvBlocked<detail::CpuKernels<dType, SSE2>>( handle, trans, m, n, *alpha, A, lda, x, incx,
+                                                                 *beta, y, incy );
+            break;
+#endif
+        default:
+            detail::gemvBlocked<detail::CpuKernels<dType, SCALAR>>( handle, trans, m, n, *alpha, A, lda, x, incx,
+                                                                   *beta, y, incy );
+    }
+    return BLAS_STATUS_SUCCESS;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : gemmCpu
+ *
+ * Description  : Performs C = alpha * op(A) * op(B) + beta * C on the CPU, where op(A) is m x k, op(B) is
+ *                k x n and all matrices are column major, using the widest instruction set the host
+ *                supports. When beta is zero C does not need to be initialized.
+ *
+ * Inputs       : handle    : The context for the function (may be NULL)
+ *              : transa    : The operation to apply to A (BLAS_OP_N or BLAS_OP_T)
+ *              : transb    : The operation to apply to B (BLAS_OP_N or BLAS_OP_T)
+ *              : m, n, k   : The dimensions of the multiplication
+ *              : alpha     : A pointer to the scalar to multiply op(A) * op(B) by
+ *              : A, lda    : The first matrix and its leading dimension
+ *              : B, ldb    : The second matrix and its leading dimension
+ *              : beta      : A pointer to the scalar to multiply C by
+ *              : ldc       : The leading dimension of C
+ *
+ * Outputs      : C         : The result matrix
+ *              : The status of the function, BLAS_STATUS_INVALID_VALUE if an argument is invalid
+ *
+ * Params       : dType     : The type of data in the matrices
+ * ==========================================================================================================
+ */
+template <typename dType>
+blasStatus gemmCpu( blasHandleCpu handle, blasOperation transa, blasOperation transb, int m, int n, int k,
+                    const dType* alpha, const dType* A, int lda, const dType* B, int ldb, const dType* beta,
+                    dType* C, int ldc ) {
+    if ( m < 0 || n < 0 || k < 0                                                 ||
+         lda < std::max( 1, transa == BLAS_OP_N ? m : k )                        ||
+         ldb < std::max( 1, transb == BLAS_OP_N ? k : n ) || ldc < std::max( 1, m ) ) {
+        return BLAS_STATUS_INVALID_VALUE;
+    }
+    if ( m == 0 || n == 0 ) return BLAS_STATUS_SUCCESS;
+
+    switch ( cpu::activeIsa() ) {
+#if FRNN_X86
+        case AVX512:
+            detail::gemmBlocked<detail::CpuKernels<dType, AVX512>>( handle, transa, transb, m, n, k, *alpha,
+                                                                   A, lda, B, ldb, *beta, C, ldc );
+            break;
+        case AVX2:
+            detail::gemmBlocked<detail::CpuKernels<dType, AVX2>>( handle, transa, transb, m, n, k, *alpha,
+                                                                 A, lda, B, ldb, *beta, C, ldc );
+            break;
+        case SSE2:
+            detail::gemmBlocked<detail::CpuKernels<dType, SSE2>>( handle, transa, transb, m, n, k, *alpha,
+                                                                 A, lda, B, ldb, *beta, C, ldc );
+            break;
+#endif
+        default:
+            detail::gemmBlocked<detail::CpuKernels<dType, SCALAR>>( handle, transa, transb, m, n, k, *alpha,
+                                                                   A, lda, B, ldb, *beta, C, ldc );
+    }
+    return BLAS_STATUS_SUCCESS;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : gemmPackLevelCpu
+ *
+ * Description  : Gets the instruction set which gemmPackCpu packs matrices for on this host, so that a
+ *                packed copy of a matrix can be checked against it before it is used.
+ *
+ * Outputs      : The instruction set which matrices are packed for
+ * ==========================================================================================================
+ */
+inline isa gemmPackLevelCpu() {
+#if FRNN_X86
+    return cpu::activeIsa();
+#else
+    return SCALAR;
+#endif
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : gemmPackCpu
+ *
+ * Description  : Packs op(A) for gemmPackedCpu, for the widest instruction set the host supports (see
+ *                note 3). The packed matrix is a copy, so it must be packed again when A
+ *                changes.
+ *
+ * Inputs       : handle    : The context for the function (may be NULL)
+ *              : transa    : The operation to apply to A (BLAS_OP_N or BLAS_OP_T)
+ *              : m, k      : The number of rows and columns of op(A)
+ *              : A         : The matrix
+ *              : lda       : The leading dimension of A
+ *
+ * Outputs      : packed    : The packed form of op(A)
+ *              : The status of the function, BLAS_STATUS_INVALID_VALUE if an argument is invalid
+ *
+ * Params       : dType     : The type of data in the matrix
+ * ==========================================================================================================
+ */
+template <typename dType>
+blasStatus gemmPackCpu( blasHandleCpu handle, blasOperation transa, int m, int k, const dType* A, int lda,
+                        packedMatrixCpu<dType>& packed ) {
+    if ( m < 0 || k < 0 || lda < std::max( 1, transa == BLAS_OP_N ? m : k ) ) return BLAS_STATUS_INVALID_VALUE;
+
+    packed.level = gemmPackLevelCpu();
+    packed.m     = m;
+    packed.k     = k;
+    switch ( packed.level ) {
+#if FRNN_X86
+        case AVX512:
+            detail::packBlocked<detail::CpuKernels<dType, AVX512>>( handle, transa, m, k, A, lda, packed.panels );
+            break;
+        case AVX2:
+            detail::packBlocked<detail::CpuKernels<dType, AVX2>>( handle, transa, m, k, A, lda, packed.panels );
+            break;
+        case SSE2:
+            detail::packBlocked<detail::CpuKernels<dType, SSE2>>( handle, transa, m, k, A, lda, packed.panels );
+            break;
+#endif
+        default:
+            detail::packBlocked<detail::CpuKernels<dType, SCALAR>>( handle, transa, m, k, A, lda, packed.panels );
+    }
+    return BLAS_STATUS_SUCCESS;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : gemmPackedCpu
+ *
+ * Description  : Performs C = alpha * op(A) * op(B) + beta * C on the CPU, as gemmCpu, for an op(A) which
+ *                has been packed by gemmPackCpu (which determines m and k). The kernels for the instruction
+ *                set the matrix was packed for are used.
+ *
+ * Inputs       : handle    : The context for the function (may be NULL)
+ *              : transb    : The operation to apply to B (BLAS_OP_N or BLAS_OP_T)
+ *              : n         : The number of columns of op(B) and C
+ *              : alpha     : A pointer to the scalar to multiply op(A) * op(B) by
+ *              : A         : The packed matrix
+ *              : B         : The second matrix
+ *              : ldb       : The leading dimension of B
+ *              : beta      : A pointer to the scalar to multiply C by
+ *              : ldc       : The leading dimension of C
+ *
+ * Outputs      : C         : The result matrix
+ *              : The status of the function, BLAS_STATUS_INVALID_VALUE if an argument is invalid
+ *
+ * Params       : dType     : The type of data in the matrices
+ * ==========================================================================================================
+ */
+template <typename dType>
+blasStatus gemmPackedCpu( blasHandleCpu handle, blasOperation transb, int n, const dType* alpha, 
+                          const packedMatrixCpu<dType>& A, const dType* B, int ldb, const dType* beta, dType* C, 
+                          int ldc ) {
+    const int m = static_cast<int>( A.m ), k = static_cast<int>( A.k );
+    if ( n < 0 || ldb < std::max( 1, transb == BLAS_OP_N ? k : n ) || ldc < std::max( 1, m ) ) {
+        return BLAS_STATUS_INVALID_VALUE;
+    }
+    if ( m == 0 || n == 0 ) return BLAS_STATUS_SUCCESS;
+
+    const dType* panels = A.panels.data();
+    switch ( A.level ) {
+#if FRNN_X86
+        case AVX512:
+            detail::gemmBlocked<detail::CpuKernels<dType, AVX512>>( handle, BLAS_OP_N, transb, m, n, k, *alpha,
+                                                                   panels, m, B, ldb, *beta, C, ldc, panels );
+            break;
+        case AVX2:
+            detail::gemmBlocked<detail::CpuKernels<dType, AVX2>>( handle, BLAS_OP_N, transb, m, n, k, *alpha,
+                                                                 panels, m, B, ldb, *beta, C, ldc, panels );
+            break;
+        case SSE2:
+            detail::gemmBlocked<detail::CpuKernels<dType, SSE2>>( handle, BLAS_OP_N, transb, m, n, k, *alpha,
+                                                                 panels, m, B, ldb, *beta, C, ldc, panels );
+            break;
+#endif
+        default:
+            detail::gemmBlocked<detail::CpuKernels<dType, SCALAR>>( handle, BLAS_OP_N, transb, m, n, k, *alpha,
+                                                                   panels, m, B, ldb, *beta, C, ldc, panels );
+    }
+    return BLAS_STATUS_SUCCESS;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : axpyCpu
+ *
+ * Description  : Performs y = alpha * x + y on the CPU, using the widest instruction set the host supports.
+ *
+ * Inputs       : handle    : The context for the function (may be NULL)
+ *              : n         : The number of elements in the vectors
+ *              : alpha     : A pointer to the scalar to multiply x by
+ *              : x, incx   : The vector to add and its increment
+ *              : incy      : The increment of y
+ *
+ * Outputs      : y         : The vector to add to
+ *              : The status of the function, BLAS_STATUS_INVALID_VALUE if an argument is invalid
+ *
+ * Params       : dType     : The type of data in the vectors
+ * ==========================================================================================================
+ */
+template <typename dType>
+blasStatus axpyCpu( blasHandleCpu handle, int n, const dType* alpha, const dType* x, int incx, dType* y,
+                    int incy ) {
+    if ( n < 0 || incx == 0 || incy == 0 ) return BLAS_STATUS_INVALID_VALUE;
+    if ( n == 0 || *alpha == dType( 0 ) ) return BLAS_STATUS_SUCCESS;
+
+    switch ( cpu::activeIsa() ) {
+#if FRNN_X86
+        case AVX512:
+            detail::axpyBlocked<detail::CpuKernels<dType, AVX512>>( handle, n, *alpha, x, incx, y, incy );
+            break;
+        case AVX2:
+            detail::axpyBlocked<detail::CpuKernels<dType, AVX2>>( handle, n, *alpha, x, incx, y, incy );
+            break;
+        case SSE2:
+            detail::axpyBlocked<detail::CpuKernels<dType, SSE2>>( handle, n, *alpha, x, incx, y, incy );
+            break;
+#endif
+        default:
+            detail::axpyBlocked<detail::CpuKernels<dType, SCALAR>>( handle, n, *alpha, x, incx, y, incy );
+    }
+    return BLAS_STATUS_SUCCESS;
+}
+
+}   // Namespace blas
+}   // Namespace frnn
+
+#endif
@@ -0,0 +1,238 @@
+/*
+ *  Header file for the fastRNN execution context, which owns the resources the math functions and layers
+ *  use on every call (the thread team, scratch memory, random number generators and library handles), so
+ *  that they are created once rather than for each call.
+ *
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FRNN_EXECUTION_CONTEXT_
+#define _FRNN_EXECUTION_CONTEXT_
+
+#include <omp.h>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "blas/frnn_blas.h"
+
+/*
+ * =========================================== NOTES ========================================================
+ *
+ * 1. The thread team is the OpenMP team of the context, which always has threads() threads. OpenMP keeps
+ *    the threads of a team alive between parallel regions of the same size, so running every parallel
+ *    loop of a timestep with forEach (rather than with a team sized by the work, for example one thread
+ *    for each page of a wba tensor) means the threads are created once and then only woken up.
+ *
+ * 2. Each thread of the team has a scratch arena, a random number generator and a cublas handle (with its
+ *    own stream), which are indexed by the number of the thread in the team (the second argument of the
+ *    function given to forEach). The generators are seeded once, from the seed of the context and the
+ *    number of the thread, so a context with a given seed and number of threads always generates the same
+ *    numbers. A cublas handle must not be used by more than one thread at once, so the threads of a forEach
+ *    loop must each use the handle of their own number.
+ *
+ * 3. A context must only be used by one thread at a time (outside of its own forEach loops). Each thread
+ *    which does not create its own context can use threadDefault().
+ * ==========================================================================================================
+ */
+
+namespace frnn {
+
+/*
+ * ==========================================================================================================
+ * Class        : ExecutionContext
+ *
+ * Description  : Owns the thread team, the scratch arenas and random number generators for each thread of
+ *                the team, and the CPU and GPU blas handles, which the math functions and layers which take
+ *                a context use rather than creating their own for each call (see the notes above)
+ * ==========================================================================================================
+ */
+class ExecutionContext {
+public:
+    /*
+     * ======================================================================================================
+     * Function     : ExecutionContext
+     *
+     * Description  : Creates the context, with generators which are seeded from a random device
+     *
+     * Inputs       : num_threads   : The number of threads in the team, 0 for the OpenMP default
+     * ======================================================================================================
+     */
+    explicit ExecutionContext( int num_threads = 0 )
+    : ExecutionContext( num_threads, std::random_device()() ) {}
+
+    /*
+     * ======================================================================================================
+     * Function     : ExecutionContext
+     *
+     * Description  : Creates the context, with generators which are seeded from the given seed
+     *
+     * Inputs       : num_threads   : The number of threads in the team, 0 for the OpenMP default
+     *              : seed          : The seed for the generators
+     * ======================================================================================================
+     */
+    ExecutionContext( int num_threads, unsigned int seed )
+    : team( num_threads > 0 ? num_threads : std::max( 1, omp_get_max_threads() ) ), arenas( team )
+    {
+        blas_context.num_threads = team;
+        for ( int thread = 0; thread < team; thread++ ) {
+            std::seed_seq sequence{ seed, static_cast<unsigned int>( thread ) };
+            arenas[ thread ].generator.seed( sequence );
+        }
+    }
+
+    ~ExecutionContext() {
+        for ( auto& arena : arenas ) {
+            std::free( arena.memory );
+#ifndef FRNN_CPU_ONLY
+            if ( arena.cublas_created ) {
+                cublasDestroy( arena.cublas );
+                cudaStreamDestroy( arena.stream );
+            }
+#endif
+        }
+    }
+
+    ExecutionContext( const ExecutionContext& )            = delete;
+    ExecutionContext& operator=( const ExecutionContext& ) = delete;
+
+    /*
+     * ======================================================================================================
+     * Function     : threadDefault
+     *
+     * Description  : Gets the context of the calling thread, which the functions without a context argument
+     *                use, and which is created the first time the thread uses it
+     *
+     * Outputs      : A reference to the context of the thread
+     * ======================================================================================================
+     */
+    static ExecutionContext& threadDefault() {
+        static thread_local ExecutionContext context;
+        return context;
+    }
+
+    // Number of threads in the team
+    int threads() const { return team; }
+
+    // Handle for the CPU blas functions, which uses the threads of the team
+    blas::blasHandleCpu blasHandle() { return &blas_context; }
+
+    // Random number generator of a thread of the team
+    std::mt19937& generator( int thread ) { return arenas[ thread ].generator; }
+
+#ifndef FRNN_CPU_ONLY
+    // Handle for cublas of a thread of the team, which is created (with its stream) the first time it is used
+    cublasHandle_t cublasHandle( int thread = 0 ) {
+        Arena& arena = arenas[ thread ];
+        if ( !arena.cublas_created && cublasCreate( &arena.cublas ) == CUBLAS_STATUS_SUCCESS ) {
+            cudaStreamCreate( &arena.stream );
+            cublasSetStream( arena.cublas, arena.stream );
+            arena.cublas_created = true;
+        }
+        return arena.cublas;
+    }
+
+    // Stream of the cublas handle of a thread of the team
+    cudaStream_t cudaStream( int thread = 0 ) {
+        cublasHandle( thread );
+        return arenas[ thread ].stream;
+    }
+#endif
+
+    /*
+     * ======================================================================================================
+     * Function     : scratch
+     *
+     * Description  : Gets the scratch arena of a thread of the team, with space for at least N elements.
+     *                The arena only grows, and its contents are not kept when it does, so the memory is
+     *                only valid until the next call for the same thread.
+     *
+     * Inputs       : N         : The number of elements which are needed
+     *              : thread    : The number of the thread in the team
+     *
+     * Outputs      : A pointer to the (uninitialized) memory, aligned to a cache line
+     *
+     * Params       : T         : The type of the elements
+     * ======================================================================================================
+     */
+    template <typename T>
+    T* scratch( size_t N, int thread = 0 ) {
+        Arena&       arena = arenas[ thread ];
+        const size_t bytes = std::max( N * sizeof( T ), size_t( 1 ) );
+        if ( bytes > arena.bytes ) {
+            const size_t size   = std::max( bytes, 2 * arena.bytes );
+            void*        memory = NULL;
+            if ( posix_memalign( &memory, 64, size ) != 0 ) throw std::bad_alloc();
+            std::free( arena.memory );
+            arena.memory = static_cast<char*>( memory );
+            arena.bytes  = size;
+        }
+        return reinterpret_cast<T*>( arena.memory );
+    }
+
+    /*
+     * ======================================================================================================
+     * Function     : forEach
+     *
+     * Description  : Runs a function for each index in [0, count) on the team, with index i run by thread
+     *                i % threads(). A single index is run on the calling thread (as thread 0).
+     *
+     * Inputs       : count     : The number of indices
+     *              : f         : The function, which is called as f( index, thread )
+     *
+     * Params       : F         : The type of the function
+     * ======================================================================================================
+     */
+    template <typename F>
+    void forEach( size_t count, F f ) {
+        const int threads = team;
+        #pragma omp parallel num_threads( threads ) if ( threads > 1 && count > 1 )
+        {
+            const int thread = omp_get_thread_num();
+            for ( size_t i = thread; i < count; i += omp_get_num_threads() ) f( i, thread );
+        }
+    }
+
+private:
+    // Resources for one thread of the team
+    struct Arena {
+        std::mt19937    generator;
+        char*           memory;
+        size_t          bytes;
+#ifndef FRNN_CPU_ONLY
+        cublasHandle_t  cublas;             // Handle for cublas
+        cudaStream_t    stream;             // Stream of the cublas handle
+        bool            cublas_created;     // If the cublas handle (and stream) have been created
+#endif
+
+        Arena() : memory( NULL ), bytes( 0 )
+#ifndef FRNN_CPU_ONLY
+        , cublas( 0 ), stream( 0 ), cublas_created( false )
+#endif
+        {}
+    };
+
+    int                 team;               // Number of threads in the team
+    std::vector<Arena>  arenas;             // Resources for each thread of the team
+    blas::blasContextCpu blas_context;      // Context for the CPU blas functions
+};
+
+}   // Namespace frnn
+
+#endif
@@ -28,7 +28,9 @@
 
 #include "../frnn/types.h"
 #include "math_cpu.hpp"
+#ifndef FRNN_CPU_ONLY
 #include "math_gpu.hpp"
+#endif
 
 namespace frnn {
  
@@ -51,13 +53,72 @@ template <typename dType> struct math<dType, frnn::device::CPU> {
     // X minus Y function
     typedef void (*x_minus_y_cpu)( std::vector<dType>&, std::vector<dType>&, std::vector<dType>& );
     static constexpr x_minus_y_cpu xmy = &xmyCpu;
+
+    // X plus N other vectors function
+    typedef void (*x_plus_n_y_cpu)( const dType* const*, size_t, size_t, dType* );
+    static constexpr x_plus_n_y_cpu xpny = &xpnyCpu;
+
+    // Elementwise (Hadamard) product function
+    typedef void (*hadamard_cpu)( const std::vector<dType>&, const std::vector<dType>&, std::vector<dType>& );
+    static constexpr hadamard_cpu hadamard = &hadamardCpu;
     
     // Rand function
     typedef void (*rand_cpu)( dType*, size_t, dType, dType );
-    static constexpr rand_cpu rand = &randCpu; 
+    static constexpr rand_cpu rand = &randCpu;
+
+    // Dense matrix sparse vector multiplication
+    typedef void (*sparse_mv_cpu)( const dType*, size_t, size_t, const std::vector<size_t>&,
+                                   const std::vector<dType>&, dType* );
+    static constexpr sparse_mv_cpu spmv = &spmvCpu;
+
+    // Dense matrix sparse (CSR) matrix multiplication
+    typedef void (*sparse_mm_cpu)( const dType*, size_t, size_t, const std::vector<size_t>&,
+                                   const std::vector<size_t>&, const std::vector<dType>&, dType*, size_t );
+    static constexpr sparse_mm_cpu spmm = &spmmCpu;
+
+    // Softmax function
+    typedef void (*softmax_cpu)( frnnError&, const std::vector<dType>&, std::vector<dType>& );
+    static constexpr softmax_cpu softmax = &softmaxCpu;
+
+    // Log softmax function
+    typedef void (*log_softmax_cpu)( frnnError&, const std::vector<dType>&, std::vector<dType>& );
+    static constexpr log_softmax_cpu logSoftmax = &logSoftmaxCpu;
+
+    // Log of the sum of the exponentials function
+    typedef dType (*log_sum_exp_cpu)( frnnError&, const std::vector<dType>& );
+    static constexpr log_sum_exp_cpu logSumExp = &logSumExpCpu;
+
+    // Fused softmax cross entropy loss and gradient function
+    typedef dType (*softmax_cross_entropy_cpu)( frnnError&, const dType*, size_t, size_t, dType* );
+    static constexpr softmax_cross_entropy_cpu softmaxCrossEntropy = &softmaxCrossEntropyCpu;
+
+    // Sum function
+    typedef dType (*sum_cpu)( frnnError&, const std::vector<dType>& );
+    static constexpr sum_cpu sum = &sumCpu;
+
+    // Sum vectorized function
+    typedef void (*sum_vectorized_cpu)( frnnError&, const std::vector<dType>&, std::vector<dType>& );
+    static constexpr sum_vectorized_cpu sumVectorized = &sumVectorizedCpu;
+
+    // Max function
+    typedef dType (*max_cpu)( frnnError&, const std::vector<dType>& );
+    static constexpr max_cpu max = &maxCpu;
+
+    // Argmax function
+    typedef size_t (*argmax_cpu)( frnnError&, const std::vector<dType>& );
+    static constexpr argmax_cpu argmax = &argmaxCpu;
+
+    // Dot product function
+    typedef dType (*dot_cpu)( frnnError&, const std::vector<dType>&, const std::vector<dType>& );
+    static constexpr dot_cpu dot = &dotCpu;
+
+    // L2 norm function
+    typedef dType (*norm_cpu)( frnnError&, const std::vector<dType>& );
+    static constexpr norm_cpu norm = &normCpu;
 
 };
 
+#ifndef FRNN_CPU_ONLY
 // Specify for GPU
 template <typename dType> struct math<dType, frnn::device::GPU> {
     
@@ -82,6 +143,7 @@ template <typename dType> struct math<dType, frnn::device::GPU> {
     static constexpr sum_vectorized_gpu sumVectorized = &sumVectorizedGpu;
     
 };
+#endif
 
 }
 #endif 
@@ -0,0 +1,188 @@
+/*
+ *  Header file for the fastRNN automatically routed math functions, which use the kernel selector to run
+ *  each call on the fastest variant (scalar, SIMD, multithreaded or GPU) for the size of its inputs.
+ *
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FRNN_MATH_AUTO_
+#define _FRNN_MATH_AUTO_
+
+#include <string>
+#include <vector>
+
+#include "../frnn/kernel_selector.h"
+#include "math.hpp"
+
+namespace frnn {
+namespace detail {
+
+// Names of the data types, for the names of the functions in the kernel selector
+template <typename dType> struct typeName;
+template <> struct typeName<float>  { static const char* value() { return "float";  } };
+template <> struct typeName<double> { static const char* value() { return "double"; } };
+template <> struct typeName<int>    { static const char* value() { return "int";    } };
+
+/*
+ * ==========================================================================================================
+ * Function     : acceleratorPresent
+ *
+ * Description  : Determines if there is a GPU which the ACCELERATOR variants can use (which is checked once)
+ *
+ * Outputs      : If there is a GPU
+ * ==========================================================================================================
+ */
+inline bool acceleratorPresent() {
+#ifndef FRNN_CPU_ONLY
+    static const bool present = [] {
+        int count = 0;
+        return cudaGetDeviceCount( &count ) == cudaSuccess && count > 0;
+    }();
+    return present;
+#else
+    return false;
+#endif
+}
+
+}   // Namespace detail
+
+/*
+ * ==========================================================================================================
+ * Struct       : mathAuto
+ *
+ * Description  : Provides the math functions with the same signatures as math<dType, dev>, but rather than
+ *                using a fixed device, each call is routed by the kernel selector to the fastest variant
+ *                for the size of its inputs (see frnn/kernel_selector.h). The names of the functions in the
+ *                selector are the function name and the data type, for example sum<float>.
+ *
+ * Params       : dType     : The type of data the functions use
+ * ==========================================================================================================
+ */
+template <typename dType> struct mathAuto {
+
+    // Sum function (CPU or GPU)
+    static dType sum( frnnError& error, const std::vector<dType>& x ) {
+        std::vector<dType> data;
+        static KernelChoices& choices = KernelSelector::instance().choices( name( "sum" ) );
+        const kernelVariant   variant = select( choices, x.size(), true, [&]( kernelVariant v, size_t n ) {
+            frnnError e;
+            if ( data.size() != n ) data.assign( n, dType( 1 ) );
+            sumWith( v, e, data );
+        } );
+        return sumWith( variant, error, x );
+    }
+
+    // Sum vectorized function (CPU or GPU)
+    static void sumVectorized( frnnError& error, const std::vector<dType>& x, std::vector<dType>& val ) {
+        std::vector<dType> data, results;
+        static KernelChoices& choices = KernelSelector::instance().choices( name( "sumVectorized" ) );
+        const kernelVariant   variant = select( choices, x.size(), true, [&]( kernelVariant v, size_t n ) {
+            frnnError e;
+            if ( data.size() != n ) { data.assign( n, dType( 1 ) ); results.assign( n, dType( 0 ) ); }
+            sumVectorizedWith( v, e, data, results );
+        } );
+        sumVectorizedWith( variant, error, x, val );
+    }
+
+    // Softmax function (CPU or GPU)
+    static void softmax( frnnError& error, const std::vector<dType>& x, std::vector<dType>& val ) {
+        std::vector<dType> data, results;
+        static KernelChoices& choices = KernelSelector::instance().choices( name( "softmax" ) );
+        const kernelVariant   variant = select( choices, x.size(), true, [&]( kernelVariant v, size_t n ) {
+            frnnError e;
+            if ( data.size() != n ) data.assign( n, dType( 1 ) );
+            softmaxWith( v, e, data, results );
+        } );
+        softmaxWith( variant, error, x, val );
+    }
+
+    // Dot product function (CPU)
+    static dType dot( frnnError& error, const std::vector<dType>& x, const std::vector<dType>& y ) {
+        std::vector<dType> data;
+        static KernelChoices& choices = KernelSelector::instance().choices( name( "dot" ) );
+        const kernelVariant   variant = select( choices, x.size(), false, [&]( kernelVariant v, size_t n ) {
+            frnnError e;
+            if ( data.size() != n ) data.assign( n, dType( 1 ) );
+            cpu::ScopedVariant scope( v );
+            dotCpu( e, data, data );
+        } );
+        cpu::ScopedVariant scope( variant );
+        return dotCpu( error, x, y );
+    }
+
+    // Max function (CPU)
+    static dType max( frnnError& error, const std::vector<dType>& x ) {
+        std::vector<dType> data;
+        static KernelChoices& choices = KernelSelector::instance().choices( name( "max" ) );
+        const kernelVariant   variant = select( choices, x.size(), false, [&]( kernelVariant v, size_t n ) {
+            frnnError e;
+            if ( data.size() != n ) data.assign( n, dType( 1 ) );
+            cpu::ScopedVariant scope( v );
+            maxCpu( e, data );
+        } );
+        cpu::ScopedVariant scope( variant );
+        return maxCpu( error, x );
+    }
+
+    // X minus Y function (CPU)
+    static void xmy( std::vector<dType>& x, std::vector<dType>& y, std::vector<dType>& result ) {
+        std::vector<dType> data, results;
+        static KernelChoices& choices = KernelSelector::instance().choices( name( "xmy" ) );
+        const kernelVariant   variant = select( choices, x.size(), false, [&]( kernelVariant v, size_t n ) {
+            if ( data.size() != n ) data.assign( n, dType( 1 ) );
+            cpu::ScopedVariant scope( v );
+            xmyCpu( data, data, results );
+        } );
+        cpu::ScopedVariant scope( variant );
+        xmyCpu( x, y, result );
+    }
+
+private:
+    // Name of a function in the selector, which is only built the first time the function is called
+    static std::string name( const char* op ) {
+        return std::string( op ) + "<" + detail::typeName<dType>::value() + ">";
+    }
+
+    template <typename Bench>
+    static kernelVariant select( KernelChoices& choices, size_t N, bool has_gpu_version, Bench bench ) {
+        return KernelSelector::instance().select( choices, N, has_gpu_version && detail::acceleratorPresent(), bench );
+    }
+
+    static dType sumWith( kernelVariant variant, frnnError& error, const std::vector<dType>& x ) {
+        if ( variant == ACCELERATOR ) return math<dType, device::GPU>::sum( error, x );
+        cpu::ScopedVariant scope( variant );
+        return sumCpu( error, x );
+    }
+
+    static void sumVectorizedWith( kernelVariant variant, frnnError& error, const std::vector<dType>& x,
+                                   std::vector<dType>& val ) {
+        if ( variant == ACCELERATOR ) return math<dType, device::GPU>::sumVectorized( error, x, val );
+        cpu::ScopedVariant scope( variant );
+        sumVectorizedCpu( error, x, val );
+    }
+
+    static void softmaxWith( kernelVariant variant, frnnError& error, const std::vector<dType>& x,
+                             std::vector<dType>& val ) {
+        if ( variant == ACCELERATOR ) return math<dType, device::GPU>::softmax( error, x, val );
+        cpu::ScopedVariant scope( variant );
+        softmaxCpu( error, x, val );
+    }
+};
+
+}   // Namespace frnn
+
+#endif
@@ -21,16 +21,474 @@
 #ifndef _FRNN_MATH_KERNELS_CPU_
 #define _FRNN_MATH_KERNELS_CPU_
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
 #include <vector>
 #include <random>
 
 #include "../frnn/types.h"
+#include "../frnn/vectorized_math_cpu.h"
+#include "../frnn/frnn.h"
+#include "../functors/functors.cuh"
+#include "execution_context.hpp"
+
+namespace frnn   {
+namespace cpu    {
+namespace detail {
+
+/*
+ * ==========================================================================================================
+ * Struct       : MaxKernel
+ *
+ * Description  : Kernel which finds the maximum element of an array
+ *
+ * Inputs       : x         : The array
+ *              : N         : The number of elements in the array (at least 1)
+ *
+ * Outputs      : The maximum element of the array
+ * ==========================================================================================================
+ */
+struct MaxKernel {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static dType apply( const dType* x, size_t N ) {
+        typedef VectorizedInstructionsCpu<dType, level> vect_ins;
+        typedef typename vect_ins::vect_type            vect_type;
+        const size_t step = vect_ins::typeSize();
+
+        vect_type biggest = vect_ins::mm_set1( x[ 0 ] );
+        size_t    i       = 0;
+        for ( ; i + step <= N; i += step ) biggest = vect_ins::mm_max_p( biggest, vect_ins::mm_load_u( x + i ) );
+        dType result = vect_ins::mm_hmax( biggest );
+        for ( ; i < N; i++ ) result = std::max( result, x[ i ] );
+        return result;
+    }
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : ExpSumKernel
+ *
+ * Description  : Kernel which computes out = exp( x - shift ) for each element of an array, and the sum of 
+ *                the results
+ *
+ * Inputs       : x         : The array
+ *              : shift     : The value to subtract from each element before exponentiating
+ *              : N         : The number of elements in the array
+ *
+ * Outputs      : out       : The exponentiated elements
+ *              : The sum of the exponentiated elements
+ * ==========================================================================================================
+ */
+struct ExpSumKernel {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static dType apply( const dType* x, dType shift, dType* out, size_t N ) {
+        typedef VectorizedInstructionsCpu<dType, level> vect_ins;
+        typedef VectorizedMathCpu<dType, level>         vect_math;
+        typedef typename vect_ins::vect_type            vect_type;
+        const size_t    step      = vect_ins::typeSize();
+        const vect_type shift_vec = vect_ins::mm_set1( shift );
+
+        vect_type sum = vect_ins::mm_zero();
+        size_t    i   = 0;
+        for ( ; i + step <= N; i += step ) {
+            const vect_type e = vect_math::mm_exp_p( vect_ins::mm_sub_p( vect_ins::mm_load_u( x + i ), shift_vec ) );
+            vect_ins::mm_store_u( out + i, e );
+            sum = vect_ins::mm_add_p( sum, e );
+        }
+        dType result = vect_ins::mm_hsum( sum );
+        if ( i < N ) {                                          // The padding of the tail must not be summed
+            vect_ins::mm_store_n( out + i, vect_math::mm_exp_p( vect_ins::mm_sub_p(
+                                                vect_ins::mm_load_n( x + i, N - i ), shift_vec ) ), N - i );
+            for ( ; i < N; i++ ) result += out[ i ];
+        }
+        return result;
+    }
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : ScaleKernel
+ *
+ * Description  : Kernel which multiplies each element of an array by a scalar
+ *
+ * Inputs       : a         : The scalar
+ *              : N         : The number of elements in the array
+ *
+ * Outputs      : x         : The array, which is scaled in place
+ * ==========================================================================================================
+ */
+struct ScaleKernel {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static void apply( dType* x, dType a, size_t N ) {
+        typedef VectorizedInstructionsCpu<dType, level> vect_ins;
+        const size_t step  = vect_ins::typeSize();
+        const auto   a_vec = vect_ins::mm_set1( a );
+
+        size_t i = 0;
+        for ( ; i + step <= N; i += step ) vect_ins::mm_store_u( x + i, vect_ins::mm_mul_p( vect_ins::mm_load_u( x + i ), a_vec ) );
+        if ( i < N ) vect_ins::mm_store_n( x + i, vect_ins::mm_mul_p( vect_ins::mm_load_n( x + i, N - i ), a_vec ), N - i );
+    }
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : SumExpKernel
+ *
+ * Description  : Kernel which determines the sum of exp( x - shift ) over the elements of an array, without
+ *                storing the exponentials
+ *
+ * Inputs       : x         : The array
+ *              : shift     : The value to subtract from each element before exponentiating
+ *              : N         : The number of elements in the array
+ *
+ * Outputs      : The sum of the exponentiated elements
+ * ==========================================================================================================
+ */
+struct SumExpKernel {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static dType apply( const dType* x, dType shift, size_t N ) {
+        typedef VectorizedInstructionsCpu<dType, level> vect_ins;
+        typedef VectorizedMathCpu<dType, level>         vect_math;
+        typedef typename vect_ins::vect_type            vect_type;
+        const size_t    step      = vect_ins::typeSize();
+        const vect_type shift_vec = vect_ins::mm_set1( shift );
+
+        vect_type sum = vect_ins::mm_zero();
+        size_t    i   = 0;
+        for ( ; i + step <= N; i += step ) {
+            sum = vect_ins::mm_add_p( sum, vect_math::mm_exp_p( vect_ins::mm_sub_p( vect_ins::mm_load_u( x + i ), 
+                                                                                    shift_vec ) ) );
+        }
+        dType result = vect_ins::mm_hsum( sum );
+        for ( ; i < N; i++ ) result += std::exp( x[ i ] - shift );
+        return result;
+    }
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : OffsetKernel
+ *
+ * Description  : Kernel which adds a scalar to each element of an array
+ *
+ * Inputs       : x         : The array
+ *              : a         : The scalar
+ *              : N         : The number of elements in the array
+ *
+ * Outputs      : out       : The results, x + a (which may be the same array as x)
+ * ==========================================================================================================
+ */
+struct OffsetKernel {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static void apply( const dType* x, dType a, dType* out, size_t N ) {
+        typedef VectorizedInstructionsCpu<dType, level> vect_ins;
+        const size_t step  = vect_ins::typeSize();
+        const auto   a_vec = vect_ins::mm_set1( a );
+
+        size_t i = 0;
+        for ( ; i + step <= N; i += step ) vect_ins::mm_store_u( out + i, vect_ins::mm_add_p( vect_ins::mm_load_u( x + i ), a_vec ) );
+        if ( i < N ) vect_ins::mm_store_n( out + i, vect_ins::mm_add_p( vect_ins::mm_load_n( x + i, N - i ), a_vec ), N - i );
+    }
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : XpnyKernel
+ *
+ * Description  : Kernel which sums M arrays into one, for one block of the arrays. The arrays are added four
+ *                at a time to the block of the output, which stays in the cache while every array is added 
+ *                to it, so each array is read once and only four arrays are streamed at a time (however
+ *                large M is).
+ *
+ * Inputs       : vectors   : The arrays to sum
+ *              : M         : The number of arrays
+ *              : start     : The index of the first element of the block in the arrays
+ *              : N         : The number of elements in the block
+ *
+ * Outputs      : out       : The sum of the block of the arrays (which may be the block of the first array)
+ * ==========================================================================================================
+ */
+struct XpnyKernel {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static void apply( const dType* const* vectors, size_t M, size_t start, size_t N, 
+                                         dType* out ) {
+        for ( size_t k = 0; k < M; k += 4 ) {
+            const bool first = k == 0;                  // The output is only read once it has been written
+            switch ( std::min( M - k, size_t( 4 ) ) ) {
+                case 1 : add<level, 1>( vectors + k, start, first, N, out ); break;
+                case 2 : add<level, 2>( vectors + k, start, first, N, out ); break;
+                case 3 : add<level, 3>( vectors + k, start, first, N, out ); break;
+                default: add<level, 4>( vectors + k, start, first, N, out ); break;
+            }
+        }
+    }
+
+private:
+    // Adds G arrays to the output (or sets the output to their sum if first is set)
+    template <isa level, size_t G, typename dType>
+    FRNN_FORCE_INLINE static void add( const dType* const* in, size_t start, bool first, size_t N, dType* out ) {
+        typedef VectorizedInstructionsCpu<dType, level> vect_ins;
+        typedef typename vect_ins::vect_type            vect_type;
+        const size_t step = vect_ins::typeSize();
+
+        size_t i = 0;
+        for ( ; i + step <= N; i += step ) {
+            vect_type sum = first ? vect_ins::mm_zero() : vect_ins::mm_load_u( out + i );
+            for ( size_t g = 0; g < G; g++ ) sum = vect_ins::mm_add_p( sum, vect_ins::mm_load_u( in[ g ] + start + i ) );
+            vect_ins::mm_store_u( out + i, sum );
+        }
+        if ( i < N ) {
+            vect_type sum = first ? vect_ins::mm_zero() : vect_ins::mm_load_n( out + i, N - i );
+            for ( size_t g = 0; g < G; g++ ) {
+                sum = vect_ins::mm_add_p( sum, vect_ins::mm_load_n( in[ g ] + start + i, N - i ) );
+            }
+            vect_ins::mm_store_n( out + i, sum, N - i );
+        }
+    }
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : GradientStepKernel
+ *
+ * Description  : Kernel which applies a gradient descent step with momentum to an array of weights whose
+ *                gradients are g * x (one column of an outer product), without storing the gradients :
+ *
+ *                delta = momentum * delta - rate * g * x
+ *                w     = w + delta
+ *
+ * Inputs       : g         : The gradient factors of the weights (the errors)
+ *              : scale     : The factor of the column, -rate * x
+ *              : momentum  : The momentum
+ *              : N         : The number of weights
+ *
+ * Outputs      : w         : The weights, which are updated in place
+ *              : delta     : The steps of the weights, which are read and updated in place
+ * ==========================================================================================================
+ */
+struct GradientStepKernel {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static void apply( dType* w, dType* delta, const dType* g, dType scale, dType momentum, 
+                                         size_t N ) {
+        typedef VectorizedInstructionsCpu<dType, level> vect_ins;
+        typedef typename vect_ins::vect_type            vect_type;
+        const size_t    step         = vect_ins::typeSize();
+        const vect_type scale_vec    = vect_ins::mm_set1( scale );
+        const vect_type momentum_vec = vect_ins::mm_set1( momentum );
+
+        size_t i = 0;
+        for ( ; i + step <= N; i += step ) {
+            const vect_type d = vect_ins::mm_fmadd_p( vect_ins::mm_load_u( g + i ), scale_vec,
+                                                      vect_ins::mm_mul_p( vect_ins::mm_load_u( delta + i ), momentum_vec ) );
+            vect_ins::mm_store_u( delta + i, d );
+            vect_ins::mm_store_u( w + i, vect_ins::mm_add_p( vect_ins::mm_load_u( w + i ), d ) );
+        }
+        for ( ; i < N; i++ ) {
+            delta[ i ] = momentum * delta[ i ] + scale * g[ i ];
+            w[ i ]    += delta[ i ];
+        }
+    }
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : SumKernel
+ *
+ * Description  : Kernel which sums the elements of an array. Four accumulators are used so that the
+ *                additions do not wait on each other.
+ *
+ * Inputs       : x         : The array
+ *              : N         : The number of elements in the array
+ *
+ * Outputs      : The sum of the elements
+ * ==========================================================================================================
+ */
+struct SumKernel {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static dType apply( const dType* x, size_t N ) {
+        typedef VectorizedInstructionsCpu<dType, level> vect_ins;
+        typedef typename vect_ins::vect_type            vect_type;
+        const size_t step = vect_ins::typeSize();
+
+        vect_type s0 = vect_ins::mm_zero(), s1 = vect_ins::mm_zero(), 
+                  s2 = vect_ins::mm_zero(), s3 = vect_ins::mm_zero();
+        size_t    i  = 0;
+        for ( ; i + 4 * step <= N; i += 4 * step ) {
+            s0 = vect_ins::mm_add_p( s0, vect_ins::mm_load_u( x + i            ) );
+            s1 = vect_ins::mm_add_p( s1, vect_ins::mm_load_u( x + i +     step ) );
+            s2 = vect_ins::mm_add_p( s2, vect_ins::mm_load_u( x + i + 2 * step ) );
+            s3 = vect_ins::mm_add_p( s3, vect_ins::mm_load_u( x + i + 3 * step ) );
+        }
+        for ( ; i + step <= N; i += step ) s0 = vect_ins::mm_add_p( s0, vect_ins::mm_load_u( x + i ) );
+        if ( i < N ) s1 = vect_ins::mm_add_p( s1, vect_ins::mm_load_n( x + i, N - i ) );
+        return vect_ins::mm_hsum( vect_ins::mm_add_p( vect_ins::mm_add_p( s0, s1 ), vect_ins::mm_add_p( s2, s3 ) ) );
+    }
+};
+
+/*
+ * ==========================================================================================================
+ * Struct       : DotKernel
+ *
+ * Description  : Kernel which determines the dot product of two arrays, with four accumulators so that the
+ *                fused multiply adds do not wait on each other
+ *
+ * Inputs       : x         : The first array
+ *              : y         : The second array
+ *              : N         : The number of elements in each array
+ *
+ * Outputs      : The dot product of the arrays
+ * ==========================================================================================================
+ */
+struct DotKernel {
+    template <isa level, typename dType>
+    FRNN_FORCE_INLINE static dType apply( const dType* x, const dType* y, size_t N ) {
+        typedef VectorizedInstructionsCpu<dType, level> vect_ins;
+        typedef typename vect_ins::vect_type            vect_type;
+        const size_t step = vect_ins::typeSize();
+
+        vect_type s0 = vect_ins::mm_zero(), s1 = vect_ins::mm_zero(), 
+                  s2 = vect_ins::mm_zero(), s3 = vect_ins::mm_zero();
+        size_t    i  = 0;
+        for ( ; i + 4 * step <= N; i += 4 * step ) {
+            s0 = vect_ins::mm_fmadd_p( vect_ins::mm_load_u( x + i            ), vect_ins::mm_load_u( y + i            ), s0 );
+            s1 = vect_ins::mm_fmadd_p( vect_ins::mm_load_u( x + i +     step ), vect_ins::mm_load_u( y + i +     step ), s1 );
+            s2 = vect_ins::mm_fmadd_p( vect_ins::mm_load_u( x + i + 2 * step ), vect_ins::mm_load_u( y + i + 2 * step ), s2 );
+            s3 = vect_ins::mm_fmadd_p( vect_ins::mm_load_u( x + i + 3 * step ), vect_ins::mm_load_u( y + i + 3 * step ), s3 );
+        }
+        for ( ; i + step <= N; i += step ) {
+            s0 = vect_ins::mm_fmadd_p( vect_ins::mm_load_u( x + i ), vect_ins::mm_load_u( y + i ), s0 );
+        }
+        if ( i < N ) {
+            s1 = vect_ins::mm_fmadd_p( vect_ins::mm_load_n( x + i, N - i ), vect_ins::mm_load_n( y + i, N - i ), s1 );
+        }
+        return vect_ins::mm_hsum( vect_ins::mm_add_p( vect_ins::mm_add_p( s0, s1 ), vect_ins::mm_add_p( s2, s3 ) ) );
+    }
+};
+
+}   // Namespace detail
+/*
+ * ==========================================================================================================
+ * Function     : pairwiseReductions
+ *
+ * Description  : Gets the flag which makes the CPU reductions deterministic. When it is set, the partial 
+ *                results of the fixed size blocks are combined in a fixed (pairwise) order, so the result
+ *                does not depend on the number of threads. Otherwise the blocks are combined in the order
+ *                the threads finish, which saves storing the partial results.
+ *
+ * Outputs      : A reference to the flag (off by default)
+ * ==========================================================================================================
+ */
+inline std::atomic<bool>& pairwiseReductions() {
+    static std::atomic<bool> pairwise( false );
+    return pairwise;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : setPairwiseReductions
+ *
+ * Description  : Sets whether the CPU reductions (sum, dot and norm) are deterministic
+ *
+ * Inputs       : pairwise  : If the partial results must be combined in a fixed (pairwise) order
+ * ==========================================================================================================
+ */
+inline void setPairwiseReductions( bool pairwise ) {
+    pairwiseReductions().store( pairwise, std::memory_order_relaxed );
+}
+
+namespace detail {
+
+/*
+ * ==========================================================================================================
+ * Function     : sumBlocks
+ *
+ * Description  : Splits [0, N) into blocks, reduces each block with block_op, and sums the results of the
+ *                blocks. Large inputs split the blocks between the OpenMP threads.
+ *
+ * Inputs       : N         : The number of elements to reduce
+ *              : block_op  : A function of ( start, length ) which reduces one block
+ *
+ * Outputs      : The sum of the results of the blocks
+ *
+ * Params       : dType     : The type of data
+ *              : BlockOp   : The type of the block function
+ * ==========================================================================================================
+ */
+template <typename dType, typename BlockOp>
+dType sumBlocks( size_t N, const BlockOp& block_op ) {
+    const size_t block    = mathBlockSize();
+    const long   blocks   = static_cast<long>( ( N + block - 1 ) / block );
+    const int    threads  = parallelThreads( N );
+
+    if ( !pairwiseReductions().load( std::memory_order_relaxed ) ) {
+        dType total = dType( 0 );
+        #pragma omp parallel for num_threads( threads ) schedule( static ) reduction( + : total ) if ( threads > 1 )
+        for ( long b = 0; b < blocks; b++ ) {
+            total += block_op( b * block, std::min( block, N - b * block ) );
+        }
+        return total;
+    }
+
+    std::vector<dType> partials( blocks, dType( 0 ) );
+    #pragma omp parallel for num_threads( threads ) schedule( static ) if ( threads > 1 )
+    for ( long b = 0; b < blocks; b++ ) {
+        partials[ b ] = block_op( b * block, std::min( block, N - b * block ) );
+    }
+    for ( long stride = 1; stride < blocks; stride *= 2 ) {
+        for ( long b = 0; b + stride < blocks; b += 2 * stride ) partials[ b ] += partials[ b + stride ];
+    }
+    return blocks > 0 ? partials[ 0 ] : dType( 0 );
+}
+
+// Maximum of no elements : -infinity, or the lowest value for types without an infinity (integers)
+template <typename dType>
+constexpr dType emptyMax() {
+    return std::numeric_limits<dType>::has_infinity ? -std::numeric_limits<dType>::infinity()
+                                                    : std::numeric_limits<dType>::lowest();
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : maxBlocks
+ *
+ * Description  : Finds the maximum element of an array, splitting large arrays into blocks between the
+ *                OpenMP threads
+ *
+ * Inputs       : x         : The array
+ *              : N         : The number of elements in the array
+ *
+ * Outputs      : The maximum element (see emptyMax if there are no elements)
+ *
+ * Params       : dType     : The type of data
+ * ==========================================================================================================
+ */
+template <typename dType>
+dType maxBlocks( const dType* x, size_t N ) {
+    const size_t block   = mathBlockSize();
+    const long   blocks  = static_cast<long>( ( N + block - 1 ) / block );
+    const int    threads = parallelThreads( N );
+    dType        biggest = emptyMax<dType>();
+
+    #pragma omp parallel for num_threads( threads ) schedule( static ) reduction( max : biggest ) if ( threads > 1 )
+    for ( long b = 0; b < blocks; b++ ) {
+        const size_t start = b * block;
+        biggest = std::max( biggest, dispatch<MaxKernel>( x + start, std::min( block, N - start ) ) );
+    }
+    return biggest;
+}
+
+}   // Namespace detail
+}   // Namespace cpu
+}   // Namespace frnn
 
 /*
  * ==========================================================================================================
  * Function     : rand 
  * 
- * Descrition   : Generates a random number between 2 limits for each element in an array
+ * Descrition   : Generates a random number between 2 limits for each element in an array, with a generator
+ *                which is seeded once for each thread
  * 
  * Inputs       : x         : The array that must be filled with random numbers
  *              : N         : The number of elements in the array that must be filled with a randomm number
@@ -43,16 +501,50 @@
  * ==========================================================================================================
  */
 template <typename dType>
-void randCpu( dType* x, size_t N, dType lo, dType hi ) {
-    std::random_device                  rd;                             // Random device
-    std::mt19937                        gen( rd() );                    // Generator
+void randCpu( std::mt19937& generator, dType* x, size_t N, dType lo, dType hi ) {
     std::uniform_real_distribution<>    dist( lo, hi );
     
     for ( size_t i = 0; i < N; i++ ) {
-        x[ i ] = static_cast<dType>( dist( gen ) );
+        x[ i ] = static_cast<dType>( dist( generator ) );
     }
 }
 
+template <typename dType>
+void randCpu( dType* x, size_t N, dType lo, dType hi ) {
+    randCpu( frnn::ExecutionContext::threadDefault().generator( 0 ), x, N, lo, hi );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : rand 
+ * 
+ * Descrition   : Generates a random number between 2 limits for each element in an array, using the
+ *                generators of a context. Large arrays are split into one chunk for each thread of the
+ *                context, and chunk i is always filled by generator i, so the numbers only depend on the
+ *                seed and number of threads of the context.
+ * 
+ * Inputs       : ctx       : The execution context to use
+ *              : x         : The array that must be filled with random numbers
+ *              : N         : The number of elements in the array that must be filled with a randomm number
+ *              : lo        : The lower bound for each random number
+ *              : hi        : The upper bound for each random number 
+ *              
+ * Oututs       : An array of random number on the range lo - hi
+ * 
+ * Params       : dType     : The type of data of the output element
+ * ==========================================================================================================
+ */
+template <typename dType>
+void randCpu( frnn::ExecutionContext& ctx, dType* x, size_t N, dType lo, dType hi ) {
+    const size_t chunks = N >= frnn::cpu::detail::mathParallelSize() ? ctx.threads() : 1;
+    const size_t chunk  = ( N + chunks - 1 ) / chunks;
+
+    ctx.forEach( chunks, [&]( size_t c, int ) {
+        const size_t start = c * chunk;
+        if ( start < N ) randCpu( ctx.generator( c ), x + start, std::min( chunk, N - start ), lo, hi );
+    } );
+}
+
 /*
  * ==========================================================================================================
  * Function     : xmyCpu
@@ -62,38 +554,537 @@ void randCpu( dType* x, size_t N, dType lo, dType hi ) {
  * Inputs       : x         : The first input vector
  *              : y         : The second input vector
  *              
- * Outputs      : result    : The resultant vector from X - Y
+ * Outputs      : result    : The resultant vector from X - Y (resized if it is too small, and not written
+ *                            if X and Y have different sizes)
  * 
  * Params       : dType     : The type of data in the vectors
  * ==========================================================================================================
  */
 template <typename dType>
 void xmyCpu( std::vector<dType>& x, std::vector<dType>& y, std::vector<dType>& result ) {
-    typedef typename frnn::VectorizedInstructionsCpu<dType>    vect_ins;
-    typedef typename frnn::VectorizedTypeCpu<dType>::vect_type vect4;
-    
-    // Get size and pointers 
-    const size_t N     = x.size();
-    size_t step        = vect_ins::typeSize();
-    dType* x_p         = N > 0 ? &x[ 0 ] : NULL;
-    dType* y_p         = N > 0 ? &y[ 0 ] : NULL;
-    dType* result_p    = &result[ 0 ];
-    
-    vect4 x4; vect4 y4; vect4 result4;
-    
-    // For every 4 elements
-    for ( size_t i = 0; i < N; i += step ) {
-        x4      = vect_ins::mm_load_u( x_p );             // Load to vectorized version
-        y4      = vect_ins::mm_load_u( y_p );             // Load to vectorized version
-        result4 = vect_ins::mm_sub_p( x4, y4 );           // Subtract
-        vect_ins::mm_store_p( result_p, result4 );        // Move result to output
-        
-        // Increment
-        x_p += step; y_p += step; result_p += step;
-    }  
-    for ( size_t i = 0; i < N % step; i ++ ) {
-        result[ N - 1 - i ] = x[ N - 1 - i] - y[ N - i - i ];
+    frnn::frnnError error;
+    const size_t    N = x.size();
+    if ( y.size() != N ) {
+        frnn::err::dimError( error, stringify( x ), stringify( y ) );
+        return;
     }
+    if ( result.size() < N ) result.resize( N, 0 );
+    if ( N == 0 ) return;
+    frnn::cpu::elementwise( frnn::functors::minus(), &result[ 0 ], N, &x[ 0 ], &y[ 0 ] );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : hadamardCpu
+ * 
+ * Description  : Performs the elementwise (Hadamard) product of two vectors X and Y, on the CPU
+ * 
+ * Inputs       : x         : The first input vector
+ *              : y         : The second input vector
+ *              
+ * Outputs      : result    : The resultant vector from X * Y (resized if it is too small, and not written
+ *                            if X and Y have different sizes)
+ * 
+ * Params       : dType     : The type of data in the vectors
+ * ==========================================================================================================
+ */
+template <typename dType>
+void hadamardCpu( const std::vector<dType>& x, const std::vector<dType>& y, std::vector<dType>& result ) {
+    frnn::frnnError error;
+    const size_t    N = x.size();
+    if ( y.size() != N ) {
+        frnn::err::dimError( error, stringify( x ), stringify( y ) );
+        return;
+    }
+    if ( result.size() < N ) result.resize( N, 0 );
+    if ( N == 0 ) return;
+    frnn::cpu::elementwise( frnn::functors::hadamard(), &result[ 0 ], N, &x[ 0 ], &y[ 0 ] );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : xpnyCpu (x plus ny)
+ * 
+ * Description  : Sums M vectors of N elements into one on the CPU, which is the CPU version of the xpny 
+ *                kernel (see math_kernels_gpu.cuh). The vectors are split into blocks of elements, which
+ *                are split between the OpenMP threads when there are enough elements in total, and within
+ *                a block the vectors are added to the output a few at a time while it is in the cache (see
+ *                XpnyKernel).
+ * 
+ * Inputs       : vectors   : An array of pointers to the M vectors
+ *              : N         : The number of elements in each vector
+ *              : M         : The number of vectors
+ *              
+ * Outputs      : out       : The sum of the vectors (which may be the first vector, to accumulate in place,
+ *                            but must not partially overlap any of the vectors)
+ * 
+ * Params       : dType     : The type of data in the vectors
+ * ==========================================================================================================
+ */
+template <typename dType>
+void xpnyCpu( const dType* const* vectors, size_t N, size_t M, dType* out ) {
+    namespace kernels = frnn::cpu::detail;
+
+    if ( M == 0 ) {
+        std::fill( out, out + N, dType( 0 ) );
+        return;
+    }
+
+    const size_t block   = kernels::mathBlockSize();
+    const long   blocks  = static_cast<long>( ( N + block - 1 ) / block );
+    const int    threads = kernels::parallelThreads( N * M );
+
+    #pragma omp parallel for num_threads( threads ) schedule( static ) if ( threads > 1 )
+    for ( long b = 0; b < blocks; b++ ) {
+        const size_t start = b * block;
+        frnn::cpu::dispatch<kernels::XpnyKernel>( vectors, M, start, std::min( block, N - start ), out + start );
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : xpnyCpu (x plus ny)
+ * 
+ * Description  : Adds M - 1 vectors of N elements to the first, in place (see above)
+ * 
+ * Inputs       : vectors   : An array of pointers to the M vectors
+ *              : N         : The number of elements in each vector
+ *              : M         : The number of vectors
+ *              
+ * Outputs      : The sum is stored in the first vector
+ * 
+ * Params       : dType     : The type of data in the vectors
+ * ==========================================================================================================
+ */
+template <typename dType>
+void xpnyCpu( dType** vectors, size_t N, size_t M ) {
+    if ( M > 1 ) xpnyCpu( const_cast<const dType* const*>( vectors ), N, M, vectors[ 0 ] );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : spmvCpu
+ *
+ * Description  : Performs Y = Y + A*X for a dense column major matrix A and a sparse vector X which is given
+ *                as an index list. Only the columns of A for the non-zero elements of X are used, so for a
+ *                one-hot X the multiplication is a single column gather, which is O(M) rather than O(M*N).
+ *
+ * Inputs       : A         : A pointer to the first element of the (column major) matrix
+ *              : lda       : The leading dimension of A (the distance between the start of two columns)
+ *              : M         : The number of rows of A (and elements of Y)
+ *              : indices   : The indices of the non-zero elements of X (the columns of A to use)
+ *              : values    : The values of the non-zero elements of X
+ *
+ * Outputs      : y         : The vector which the result is added to
+ *
+ * Params       : dType     : The type of data in the matrix and vectors
+ * ==========================================================================================================
+ */
+template <typename dType>
+void spmvCpu( const dType* A, size_t lda, size_t M, const std::vector<size_t>& indices,
+              const std::vector<dType>& values, dType* y ) {
+    for ( size_t k = 0; k < indices.size(); k++ ) {
+        const dType* a_col = A + indices[ k ] * lda;
+        const dType  val   = values[ k ];
+        for ( size_t m = 0; m < M; m++ ) {
+            y[ m ] += val * a_col[ m ];
+        }
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : spmmCpu
+ *
+ * Description  : Performs C = C + A*X for a dense column major matrix A and a sparse matrix X in compressed
+ *                sparse row format, where each row of X is a sparse input, so that column r of C gets the
+ *                result of A multiplied by row r of X. The rows are split between the OpenMP threads when
+ *                there is enough work (nnz * M multiply adds) to make the threads worth starting.
+ *
+ * Inputs       : A             : A pointer to the first element of the (column major) matrix
+ *              : lda           : The leading dimension of A
+ *              : M             : The number of rows of A (and of C)
+ *              : row_offsets   : The offset of the first non-zero element of each row of X
+ *              : columns       : The columns of the non-zero elements of X
+ *              : values        : The values of the non-zero elements of X
+ *              : ldc           : The leading dimension of C
+ *
+ * Outputs      : C             : The matrix which the results are added to
+ *
+ * Params       : dType         : The type of data in the matrices
+ * ==========================================================================================================
+ */
+template <typename dType>
+void spmmCpu( const dType* A, size_t lda, size_t M, const std::vector<size_t>& row_offsets,
+              const std::vector<size_t>& columns, const std::vector<dType>& values, dType* C, size_t ldc ) {
+    namespace kernels = frnn::cpu::detail;
+
+    const long rows    = row_offsets.size() > 0 ? static_cast<long>( row_offsets.size() - 1 ) : 0;
+    const int  threads = kernels::parallelThreads( values.size() * M );
+
+    #pragma omp parallel for num_threads( threads ) schedule( static ) if ( threads > 1 )
+    for ( long r = 0; r < rows; r++ ) {
+        dType* c_col = C + r * ldc;
+        for ( size_t k = row_offsets[ r ]; k < row_offsets[ r + 1 ]; k++ ) {
+            const dType* a_col = A + columns[ k ] * lda;
+            const dType  val   = values[ k ];
+            for ( size_t m = 0; m < M; m++ ) {
+                c_col[ m ] += val * a_col[ m ];
+            }
+        }
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxCpu
+ *
+ * Description  : Performs the softmax function of an array of N elements on the CPU, which is 
+ *                  
+ *                softmax( x_i ) = exp( x_i - max( x ) ) / sum[ j=1 to J ]( exp( x_j - max( x ) ) )
+ *
+ *                The maximum is subtracted so that the exponentials can not overflow, which does not change
+ *                the result. Large arrays are split between the OpenMP threads for each of the three
+ *                passes (the maximum, the exponentials and their sum, and the scaling).
+ *
+ * Inputs       : error     : The error for the operation (not used, every array has a softmax)
+ *              : in        : The array to compute the softmax of
+ *              : N         : The number of elements in the arrays
+ *        
+ * Outputs      : out       : The softmax of in (which may be the same array as in, and is not written
+ *                            if there are no elements)
+ *
+ * Params       : dType     : The type of data (float or double)
+ * ==========================================================================================================
+ */ 
+template <typename dType>
+void softmaxCpu( frnn::frnnError&, const dType* in, size_t N, dType* out ) {
+    using frnn::cpu::dispatch;
+    namespace kernels = frnn::cpu::detail;
+
+    if ( N == 0 ) return;
+
+    const size_t block    = kernels::mathBlockSize();
+    const long   blocks   = static_cast<long>( ( N + block - 1 ) / block );
+    const int    threads  = kernels::parallelThreads( N );
+    const dType  biggest  = kernels::maxBlocks( in, N );
+    dType        sum      = dType( 0 );
+
+    #pragma omp parallel for num_threads( threads ) schedule( static ) reduction( + : sum ) if ( threads > 1 )
+    for ( long b = 0; b < blocks; b++ ) {
+        const size_t start = b * block;
+        sum += dispatch<kernels::ExpSumKernel>( in + start, biggest, out + start, std::min( block, N - start ) );
+    }
+
+    const dType scale = dType( 1 ) / sum;
+    #pragma omp parallel for num_threads( threads ) schedule( static ) if ( threads > 1 )
+    for ( long b = 0; b < blocks; b++ ) {
+        const size_t start = b * block;
+        dispatch<kernels::ScaleKernel>( out + start, scale, std::min( block, N - start ) );
+    }
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxCpu
+ *
+ * Description  : Performs the softmax function of a vector of data x on the CPU (see above)
+ *
+ * Inputs       : error     : The error for the operation
+ *              : x         : The vector to compute the softmax of
+ *        
+ * Outputs      : val       : The softmax of x (resized if it is too small)
+ *
+ * Params       : dType     : The type of data (float or double)
+ * ==========================================================================================================
+ */ 
+template <typename dType>
+void softmaxCpu( frnn::frnnError& error, const std::vector<dType>& x, std::vector<dType>& val ) {
+    if ( val.size() < x.size() ) val.resize( x.size(), 0 );
+    softmaxCpu( error, x.data(), x.size(), val.data() );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : logSumExpCpu
+ *
+ * Description  : Determines the log of the sum of the exponentials of an array of N elements on the CPU,
+ *
+ *                lse( x ) = max( x ) + log( sum[ j=1 to J ]( exp( x_j - max( x ) ) ) )
+ *
+ *                which can not overflow, and is the log of the denominator of the softmax. The
+ *                exponentials are not stored, so the array is only read (twice).
+ *
+ * Inputs       : error     : The error for the operation (not used, the log of an empty sum is -infinity)
+ *              : x         : The array
+ *              : N         : The number of elements in the array
+ *
+ * Outputs      : The log of the sum of the exponentials (-infinity if there are no elements)
+ *
+ * Params       : dType     : The type of data (float or double)
+ * ==========================================================================================================
+ */
+template <typename dType>
+dType logSumExpCpu( frnn::frnnError&, const dType* x, size_t N ) {
+    namespace kernels = frnn::cpu::detail;
+
+    const dType biggest = kernels::maxBlocks( x, N );
+    if ( N == 0 || std::isinf( biggest ) ) return biggest;
+
+    const dType sum = kernels::sumBlocks<dType>( N, [x, biggest]( size_t start, size_t len ) {
+        return frnn::cpu::dispatch<kernels::SumExpKernel>( x + start, biggest, len );
+    } );
+    return biggest + std::log( sum );
+}
+
+// Log of the sum of the exponentials of the elements of a vector (see above)
+template <typename dType>
+dType logSumExpCpu( frnn::frnnError& error, const std::vector<dType>& x ) {
+    return logSumExpCpu( error, x.data(), x.size() );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : logSoftmaxCpu
+ *
+ * Description  : Performs the log of the softmax function of an array of N elements on the CPU, 
+ *
+ *                log( softmax( x_i ) ) = x_i - lse( x )
+ *
+ *                which, unlike the log of the result of softmaxCpu, is accurate for very small
+ *                probabilities (which would be rounded to zero)
+ *
+ * Inputs       : error     : The error for the operation
+ *              : in        : The array to compute the log softmax of
+ *              : N         : The number of elements in the arrays
+ *        
+ * Outputs      : out       : The log softmax of in (which may be the same array as in)
+ *
+ * Params       : dType     : The type of data (float or double)
+ * ==========================================================================================================
+ */
+template <typename dType>
+void logSoftmaxCpu( frnn::frnnError& error, const dType* in, size_t N, dType* out ) {
+    namespace kernels = frnn::cpu::detail;
+
+    const dType  shift   = -logSumExpCpu( error, in, N );
+    const size_t block   = kernels::mathBlockSize();
+    const long   blocks  = static_cast<long>( ( N + block - 1 ) / block );
+    const int    threads = kernels::parallelThreads( N );
+
+    #pragma omp parallel for num_threads( threads ) schedule( static ) if ( threads > 1 )
+    for ( long b = 0; b < blocks; b++ ) {
+        const size_t start = b * block;
+        frnn::cpu::dispatch<kernels::OffsetKernel>( in + start, shift, out + start, std::min( block, N - start ) );
+    }
+}
+
+// Log softmax of a vector (val is resized if it is too small, see above)
+template <typename dType>
+void logSoftmaxCpu( frnn::frnnError& error, const std::vector<dType>& x, std::vector<dType>& val ) {
+    if ( val.size() < x.size() ) val.resize( x.size(), 0 );
+    logSoftmaxCpu( error, x.data(), x.size(), val.data() );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : softmaxCrossEntropyCpu
+ *
+ * Description  : Determines the cross entropy loss of the softmax of an array of logits for the index of
+ *                the target, and the gradient of the loss with respect to the logits, together :
+ *
+ *                loss   = lse( x ) - x_target
+ *                grad_i = softmax( x_i ) - ( i == target )
+ *
+ *                The probabilities are written straight into the gradient and the target is an index, so
+ *                there is no array of probabilities or of (one-hot) targets, and no separate pass to
+ *                subtract the targets. Without a gradient only the loss is determined, and nothing is
+ *                written.
+ *
+ * Inputs       : error     : The error for the operation
+ *              : logits    : The logits (the inputs to the softmax)
+ *              : N         : The number of logits
+ *              : target    : The index of the target, in [0, N)
+ *
+ * Outputs      : grad      : The gradient of the loss with respect to the logits (may be the same array as
+ *                            logits, or NULL if it is not needed)
+ *              : The loss, -log( softmax( x_target ) )
+ *
+ * Params       : dType     : The type of data (float or double)
+ * ==========================================================================================================
+ */
+template <typename dType>
+dType softmaxCrossEntropyCpu( frnn::frnnError& error, const dType* logits, size_t N, size_t target, 
+                              dType* grad ) {
+    using frnn::cpu::dispatch;
+    namespace kernels = frnn::cpu::detail;
+
+    if ( target >= N ) {
+        frnn::err::dimError( error, stringify( target ), stringify( N ) );
+        return dType( 0 );
+    }
+    const dType target_logit = logits[ target ];            // Before grad (which may be logits) is written
+    if ( grad == NULL ) return logSumExpCpu( error, logits, N ) - target_logit;
+
+    const size_t block   = kernels::mathBlockSize();
+    const long   blocks  = static_cast<long>( ( N + block - 1 ) / block );
+    const int    threads = kernels::parallelThreads( N );
+    const dType  biggest = kernels::maxBlocks( logits, N );
+    dType        sum     = dType( 0 );
+
+    #pragma omp parallel for num_threads( threads ) schedule( static ) reduction( + : sum ) if ( threads > 1 )
+    for ( long b = 0; b < blocks; b++ ) {
+        const size_t start = b * block;
+        sum += dispatch<kernels::ExpSumKernel>( logits + start, biggest, grad + start, std::min( block, N - start ) );
+    }
+
+    const dType scale = dType( 1 ) / sum;
+    #pragma omp parallel for num_threads( threads ) schedule( static ) if ( threads > 1 )
+    for ( long b = 0; b < blocks; b++ ) {
+        const size_t start = b * block;
+        dispatch<kernels::ScaleKernel>( grad + start, scale, std::min( block, N - start ) );
+    }
+    grad[ target ] -= dType( 1 );
+    return biggest + std::log( sum ) - target_logit;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : sumCpu
+ *
+ * Description  : Performs the sum of the elements in a vector on the CPU
+ *                  
+ * Inputs       : error     : The error for the operation (not used, every vector has a sum)
+ *              : x         : The vector to compute the sum of
+ *        
+ * Outputs      : The sum of the elements of x (0 if x is empty)
+ *
+ * Params       : dType     : The data type of the vector elements
+ * ==========================================================================================================
+ */  
+template <typename dType>
+dType sumCpu( frnn::frnnError&, const std::vector<dType>& x ) {
+    const dType* in = x.data();
+    return frnn::cpu::detail::sumBlocks<dType>( x.size(), [in]( size_t start, size_t len ) {
+        return frnn::cpu::dispatch<frnn::cpu::detail::SumKernel>( in + start, len );
+    } );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : sumVectorizedCpu
+ *
+ * Description  : Performs the sum of the elements in a vector and returns a vector of the same dimension 
+ *                with each element having the result
+ *                  
+ * Inputs       : error     : The error for the operation
+ *              : x         : The vector to compute the sum of
+ *        
+ * Outputs      : val       : A vector with each element equal to the sum of x
+ *
+ * Params       : dType     : The data type of the vector elements
+ * ==========================================================================================================
+ */  
+template <typename dType>
+void sumVectorizedCpu( frnn::frnnError& error, const std::vector<dType>& x, std::vector<dType>& val ) {
+    val.assign( x.size(), sumCpu( error, x ) );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : maxCpu
+ *
+ * Description  : Finds the largest element of a vector on the CPU
+ *                  
+ * Inputs       : error     : The error for the operation
+ *              : x         : The vector to find the largest element of
+ *        
+ * Outputs      : The largest element of x (-infinity, or the lowest value of an integer dType, with a 
+ *                dimension error if x is empty)
+ *
+ * Params       : dType     : The data type of the vector elements
+ * ==========================================================================================================
+ */  
+template <typename dType>
+dType maxCpu( frnn::frnnError& error, const std::vector<dType>& x ) {
+    if ( x.empty() ) {
+        frnn::err::dimError( error, stringify( x ), "a vector with elements" );
+        return frnn::cpu::detail::emptyMax<dType>();
+    }
+    return frnn::cpu::detail::maxBlocks( x.data(), x.size() );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : argmaxCpu
+ *
+ * Description  : Finds the index of the largest element of a vector on the CPU. If the largest value 
+ *                appears more than once the first index is returned.
+ *                  
+ * Inputs       : error     : The error for the operation
+ *              : x         : The vector to find the largest element of
+ *        
+ * Outputs      : The index of the largest element of x (0, with a dimension error, if x is empty)
+ *
+ * Params       : dType     : The data type of the vector elements
+ * ==========================================================================================================
+ */  
+template <typename dType>
+size_t argmaxCpu( frnn::frnnError& error, const std::vector<dType>& x ) {
+    // Finding the value with the SIMD kernels and then searching for it is faster than tracking the 
+    // index of each lane, and the search stops at the first match
+    const dType biggest = maxCpu( error, x );
+    for ( size_t i = 0; i < x.size(); i++ ) {
+        if ( x[ i ] == biggest ) return i;
+    }
+    return 0;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : dotCpu
+ *
+ * Description  : Determines the dot product of two vectors on the CPU
+ *                  
+ * Inputs       : error     : The error for the operation
+ *              : x         : The first vector
+ *              : y         : The second vector
+ *        
+ * Outputs      : The dot product of x and y (0 if the dimensions of x and y are different)
+ *
+ * Params       : dType     : The data type of the vector elements
+ * ==========================================================================================================
+ */  
+template <typename dType>
+dType dotCpu( frnn::frnnError& error, const std::vector<dType>& x, const std::vector<dType>& y ) {
+    if ( x.size() != y.size() ) {
+        frnn::err::dimError( error, stringify( x ), stringify( y ) );
+        return dType( 0 );
+    }
+    const dType* in_x = x.data();
+    const dType* in_y = y.data();
+    return frnn::cpu::detail::sumBlocks<dType>( x.size(), [in_x, in_y]( size_t start, size_t len ) {
+        return frnn::cpu::dispatch<frnn::cpu::detail::DotKernel>( in_x + start, in_y + start, len );
+    } );
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : normCpu
+ *
+ * Description  : Determines the L2 norm of a vector on the CPU
+ *                  
+ * Inputs       : error     : The error for the operation
+ *              : x         : The vector to determine the norm of
+ *        
+ * Outputs      : The L2 norm of x
+ *
+ * Params       : dType     : The data type of the vector elements
+ * ==========================================================================================================
+ */  
+template <typename dType>
+dType normCpu( frnn::frnnError& error, const std::vector<dType>& x ) {
+    return static_cast<dType>( std::sqrt( dotCpu( error, x, x ) ) );
 }
 
 #endif
@@ -36,15 +36,19 @@
 #include "../frnn/frnn.h"
 #include "math_kernels_gpu.cuh"
 #include "blas/frnn_blas.h"
+#include "execution_context.hpp"
 #include "rand/frnn_rand.h"
 
 /*
  * ==========================================================================================================
  * Function     : axpyGpu
  *
- * Description  : Performs simgle/double precision a*X + Y, using CUBLAS
+ * Description  : Performs simgle/double precision a*X + Y, using CUBLAS with the handle of a context. The
+ *                scalar is read from the device, and the pointer mode of the handle is restored afterwards
+ *                since the handle is shared with the other functions which use the context.
  *
- * Inputs       : error     : fastRNN error type for result of operations
+ * Inputs       : ctx       : The execution context to use
+ *              : error     : fastRNN error type for result of operations
  *              : a         : Constant for multiplication 
  *              : x         : Vector to multiply with a
  * 
@@ -54,13 +58,15 @@
  * ==========================================================================================================
  */
 template <typename dType>
-void axpyGpu( frnn::frnnError& error, const dType a, const std::vector<dType>& x, std::vector<dType>& y ) {
+void axpyGpu( frnn::ExecutionContext& ctx, frnn::frnnError& error, const dType a, const std::vector<dType>& x, 
+              std::vector<dType>& y ) {
 
-    cublasHandle_t handle;
-    cublasStatus_t status;
+    cublasHandle_t      handle = ctx.cublasHandle();
+    cublasStatus_t      status;
+    cublasPointerMode_t mode;
     dType* da = 0, *dx = 0, *dy = 0;
 
-    status = cublasCreate( &handle );
+    cublasGetPointerMode( handle, &mode );
     cublasSetPointerMode( handle, CUBLAS_POINTER_MODE_DEVICE );
 
     // Allocate and fill device vectors with host vector data 
@@ -87,18 +93,38 @@ void axpyGpu( frnn::frnnError& error, const dType a, const std::vector<dType>& x
 
     // Perform CUBLAS axpy using wrapper blas library
     status = frnn::blas::functions<dType>::axpy( handle, x.size(), da, dx, 1, dy, 1 );
+    cublasSetPointerMode( handle, mode );
 
     if ( cudaMemcpy( &y[0], dy, y.size() * sizeof( dType ), cudaMemcpyDeviceToHost ) != cudaSuccess ) {
         frnn::err::copyError( error, stringify( y ) );
     }
 
-    status = cublasDestroy( handle );
-
     cudaFree( da );
     cudaFree( dx );
     cudaFree( dy );
 } 
 
+/*
+ * ==========================================================================================================
+ * Function     : axpyGpu
+ *
+ * Description  : Performs simgle/double precision a*X + Y, using CUBLAS with the context of the calling
+ *                thread
+ *
+ * Inputs       : error     : fastRNN error type for result of operations
+ *              : a         : Constant for multiplication 
+ *              : x         : Vector to multiply with a
+ * 
+ * Outputs      : y         : Vector used in a*X + Y, and where the result of a*X + Y is stored
+ * 
+ * Params       : dType     : The type of data used for the computation
+ * ==========================================================================================================
+ */
+template <typename dType>
+void axpyGpu( frnn::frnnError& error, const dType a, const std::vector<dType>& x, std::vector<dType>& y ) {
+    axpyGpu( frnn::ExecutionContext::threadDefault(), error, a, x, y );
+}
+
 /*
  * ==========================================================================================================
  * Function     : axpyGpu (for ints)
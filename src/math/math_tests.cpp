@@ -20,9 +20,13 @@
 
 #include <gtest/gtest.h>
 #include <iostream>
+#include <limits>
+#include <omp.h>
 
 #include "../frnn/types.h"
 #include "math.hpp"             // Math functions for both CPU and GPU
+#include "math_auto.hpp"
+#include "blas/frnn_blas.h"
 
 using std::vector;
 using frnn::device;
@@ -268,3 +272,434 @@ TEST( frnnMathCpu, CanPerformXminusYWithVectorizedCpuKernelWithDoubles ) {
     }
 }
 
+TEST( frnnMathCpu, XminusYDoesNotWriteTheResultIfTheSizesAreDifferent ) {
+    std::vector<float> x( 10, 3.f ), y( 5, 1.f ), out( 10, 7.f );
+    
+    // y is too short, so is not read past its end
+    frnn::math<float, frnn::device::CPU>::xmy( x, y, out );
+    
+    for ( size_t i = 0; i < out.size(); i++ ) EXPECT_EQ( out[ i ], 7.f );
+}
+
+TEST( frnnMathCpu, CanPerformHadamardProductIntoAnEmptyVector ) {
+    std::vector<float> x, y, out;
+
+    // Odd size so that the tail is used
+    for ( size_t i = 0; i < NUM_ELEMENTS_CPU + 3; i++ ) {
+        x.push_back( float( i % 100 ) );
+        y.push_back( 0.5f );
+    }
+
+    frnn::math<float, frnn::device::CPU>::hadamard( x, y, out );
+
+    EXPECT_EQ( x.size(), out.size() );
+    for ( size_t i = 0; i < out.size(); i++ ) {
+        EXPECT_EQ( out[ i ], 0.5f * x[ i ] );
+    }
+}
+
+TEST( frnnMathCpu, CanMultiplyMatrixWithOneHotVector ) {
+    const size_t M = 5, N = 7;
+    std::vector<float>  A( M * N );
+    std::vector<float>  y( M, 1.0f );
+    std::vector<size_t> indices = { 3 };
+    std::vector<float>  values  = { 2.0f };
+    
+    for ( size_t i = 0; i < A.size(); i++ ) A[ i ] = float( i );
+    
+    // y = y + A * x, where x is one-hot at position 3
+    frnn::math<float, frnn::device::CPU>::spmv( &A[ 0 ], M, M, indices, values, &y[ 0 ] );
+    
+    for ( size_t m = 0; m < M; m++ ) {
+        EXPECT_EQ( y[ m ], 1.0f + 2.0f * A[ 3 * M + m ] );
+    }
+}
+
+TEST( frnnMathCpu, CanMultiplyMatrixWithCsrMatrix ) {
+    const size_t M = 4, N = 6;
+    std::vector<double> A( M * N ), C( M * 2, 0.0 );
+    std::vector<size_t> row_offsets = { 0, 1, 3 };
+    std::vector<size_t> columns     = { 5, 0, 2 };
+    std::vector<double> values      = { 1.0, 1.0, 0.5 };
+    
+    for ( size_t i = 0; i < A.size(); i++ ) A[ i ] = double( i );
+    
+    frnn::math<double, frnn::device::CPU>::spmm( &A[ 0 ], M, M, row_offsets, columns, values, &C[ 0 ], M );
+    
+    for ( size_t m = 0; m < M; m++ ) {
+        EXPECT_EQ( C[ m ]    , A[ 5 * M + m ] );
+        EXPECT_EQ( C[ M + m ], A[ m ] + 0.5 * A[ 2 * M + m ] );
+    }
+}
+
+TEST( frnnMathCpu, SoftmaxIsStableAndComputesCorrectlyForDoubles ) {
+    frnn::frnnError error;
+    vector<double> x, results;
+
+    // Values this large overflow exp unless the maximum is subtracted, and the size is not a multiple of
+    // the vector width so that the tail is used
+    for ( size_t i = 0; i < NUM_ELEMENTS_CPU + 3; i++ ) {
+        x.push_back( 1000.0 + ( i % 7 ) );
+    }
+
+    frnn::math<double, frnn::device::CPU>::softmax( error, x, results );
+
+    double normalizer = 0.0, total = 0.0;
+    for ( size_t i = 0; i < 7; i++ ) {
+        normalizer += exp( static_cast<double>( i ) ) * ( ( x.size() - i + 6 ) / 7 );
+    }
+    EXPECT_EQ( x.size(), results.size() );
+    for ( size_t i = 0; i < x.size(); i++ ) {
+        EXPECT_NEAR( exp( static_cast<double>( i % 7 ) ) / normalizer, results[ i ], 1e-12 );
+        total += results[ i ];
+    }
+    EXPECT_NEAR( 1.0, total, 1e-9 );
+}
+
+TEST( frnnMathCpu, LogSoftmaxIsAccurateWhereSoftmaxUnderflows ) {
+    frnn::frnnError error;
+    vector<double> x, results;
+
+    // The smallest probabilities are exp( -1000 ), which are zero as doubles, but not their logs
+    for ( size_t i = 0; i < NUM_ELEMENTS_CPU + 3; i++ ) {
+        x.push_back( i % 2 == 0 ? 1000.0 : 0.0 );
+    }
+    const size_t big       = ( x.size() + 1 ) / 2;
+    const double log_sum   = 1000.0 + log( static_cast<double>( big ) );
+
+    const double lse       = frnn::math<double, frnn::device::CPU>::logSumExp( error, x );
+    frnn::math<double, frnn::device::CPU>::logSoftmax( error, x, results );
+
+    EXPECT_NEAR( log_sum, lse, 1e-9 );
+
+    EXPECT_EQ( x.size(), results.size() );
+    for ( size_t i = 0; i < x.size(); i++ ) EXPECT_NEAR( x[ i ] - log_sum, results[ i ], 1e-9 );
+}
+
+TEST( frnnMathCpu, SoftmaxCrossEntropyMatchesSoftmaxMinusTargets ) {
+    frnn::frnnError error;
+    const size_t    target = 17;
+    vector<double>  x, probs, grad( NUM_ELEMENTS_CPU + 3 ), in_place;
+
+    for ( size_t i = 0; i < NUM_ELEMENTS_CPU + 3; i++ ) x.push_back( 0.01 * ( i % 101 ) );
+    frnn::math<double, frnn::device::CPU>::softmax( error, x, probs );
+
+    const double loss = frnn::math<double, frnn::device::CPU>::softmaxCrossEntropy( error, x.data(), x.size(), 
+                                                                                      target, grad.data() );
+    EXPECT_NEAR( -log( probs[ target ] ), loss, 1e-9 );
+    for ( size_t i = 0; i < x.size(); i++ ) EXPECT_NEAR( probs[ i ] - ( i == target ), grad[ i ], 1e-12 );
+
+    // Without a gradient only the loss is determined, and the gradient may overwrite the logits
+    EXPECT_NEAR( loss, softmaxCrossEntropyCpu( error, x.data(), x.size(), target, ( double* )NULL ), 1e-9 );
+    in_place = x;
+    EXPECT_NEAR( loss, softmaxCrossEntropyCpu( error, in_place.data(), x.size(), target, in_place.data() ), 1e-9 );
+    for ( size_t i = 0; i < x.size(); i++ ) EXPECT_EQ( grad[ i ], in_place[ i ] );
+}
+
+TEST( frnnMathCpu, XpnySumsVectorsInPlaceForAllInstructionSets ) {
+    const size_t           N = NUM_ELEMENTS_CPU + 3, M = 7;     // Not multiples of the vector width or group
+    vector<vector<float>>  vectors( M, vector<float>( N ) );
+    vector<float*>         pointers( M );
+    vector<float>          expected( N, 0.0f ), out( N );
+
+    for ( size_t k = 0; k < M; k++ ) {
+        for ( size_t i = 0; i < N; i++ ) {
+            vectors[ k ][ i ] = static_cast<float>( ( i + k ) % 5 );
+            expected[ i ]    += vectors[ k ][ i ];
+        }
+    }
+
+    for ( int level = frnn::SCALAR; level <= frnn::cpu::supportedIsa(); level++ ) {
+        frnn::cpu::setIsaLimit( static_cast<frnn::isa>( level ) );
+        for ( size_t k = 0; k < M; k++ ) pointers[ k ] = &vectors[ k ][ 0 ];
+
+        frnn::math<float, frnn::device::CPU>::xpny( pointers.data(), N, M, &out[ 0 ] );
+        for ( size_t i = 0; i < N; i++ ) EXPECT_EQ( expected[ i ], out[ i ] );
+
+        // In place, into the first vector (which is restored for the next level)
+        vector<float> first = vectors[ 0 ];
+        xpnyCpu( pointers.data(), N, M );
+        for ( size_t i = 0; i < N; i++ ) EXPECT_EQ( expected[ i ], vectors[ 0 ][ i ] );
+        vectors[ 0 ] = first;
+    }
+    frnn::cpu::setIsaLimit( frnn::AVX512 );
+}
+
+TEST( frnnMathCpu, ReductionSumComputesCorrectlyWithFloatsAndInts ) {
+    frnn::frnnError error;
+    vector<float> x;
+    vector<int>   y, results;
+
+    // Odd size so that the tail is used
+    for ( size_t i = 0; i < NUM_ELEMENTS_CPU + 5; i++ ) {
+        x.push_back( 1.f );
+        y.push_back( static_cast<int>( i % 3 ) );
+    }
+
+    EXPECT_EQ( NUM_ELEMENTS_CPU + 5, ( frnn::math<float, frnn::device::CPU>::sum( error, x ) ) );
+
+    int expected = 0;
+    for ( size_t i = 0; i < y.size(); i++ ) expected += y[ i ];
+
+    frnn::math<int, frnn::device::CPU>::sumVectorized( error, y, results );
+    EXPECT_EQ( y.size(), results.size() );
+    for ( size_t i = 0; i < results.size(); i++ ) {
+        EXPECT_EQ( expected, results[ i ] );
+    }
+}
+
+TEST( frnnMathCpu, PairwiseReductionsDoNotDependOnTheNumberOfThreads ) {
+    frnn::frnnError error;
+    vector<float> x;
+
+    for ( size_t i = 0; i < NUM_ELEMENTS_CPU; i++ ) {
+        x.push_back( 1.f / static_cast<float>( i % 101 + 1 ) );
+    }
+
+    frnn::cpu::setPairwiseReductions( true );
+    omp_set_num_threads( 1 );
+    const float serial   = frnn::math<float, frnn::device::CPU>::sum( error, x );
+    omp_set_num_threads( 3 );
+    const float threaded = frnn::math<float, frnn::device::CPU>::sum( error, x );
+    omp_set_num_threads( omp_get_num_procs() );
+    frnn::cpu::setPairwiseReductions( false );
+
+    double reference = 0.0;
+    for ( size_t i = 0; i < x.size(); i++ ) reference += x[ i ];
+
+    EXPECT_EQ( serial, threaded );
+    EXPECT_NEAR( reference, serial, reference * 1e-6 );
+}
+
+TEST( frnnMathCpu, DotAndNormComputeCorrectlyWithDoubles ) {
+    frnn::frnnError error;
+    vector<double> x, y;
+
+    for ( size_t i = 0; i < NUM_ELEMENTS_CPU + 7; i++ ) {
+        x.push_back( 2.0 );
+        y.push_back( i % 2 == 0 ? 1.5 : -0.5 );
+    }
+
+    double expected_dot = 0.0;
+    for ( size_t i = 0; i < x.size(); i++ ) expected_dot += x[ i ] * y[ i ];
+
+    EXPECT_NEAR( expected_dot, ( frnn::math<double, frnn::device::CPU>::dot( error, x, y ) ), 1e-6 );
+    EXPECT_NEAR( 2.0 * sqrt( static_cast<double>( x.size() ) ), 
+                 ( frnn::math<double, frnn::device::CPU>::norm( error, x ) ), 1e-9 );
+}
+
+TEST( frnnMathCpu, MaxAndArgmaxFindTheFirstLargestElement ) {
+    frnn::frnnError error;
+    vector<float> x;
+
+    for ( size_t i = 0; i < NUM_ELEMENTS_CPU + 3; i++ ) {
+        x.push_back( -static_cast<float>( i % 1000 ) );
+    }
+    x[ NUM_ELEMENTS_CPU / 2 ] = 5.f;
+    x[ NUM_ELEMENTS_CPU + 2 ] = 5.f;                                // Same value in the tail
+
+    EXPECT_EQ( 5.f, ( frnn::math<float, frnn::device::CPU>::max( error, x ) ) );
+    EXPECT_EQ( NUM_ELEMENTS_CPU / 2, ( frnn::math<float, frnn::device::CPU>::argmax( error, x ) ) );
+
+    x[ NUM_ELEMENTS_CPU + 2 ] = 6.f;
+    EXPECT_EQ( NUM_ELEMENTS_CPU + 2, ( frnn::math<float, frnn::device::CPU>::argmax( error, x ) ) );
+
+    vector<float> empty;
+    EXPECT_EQ( -std::numeric_limits<float>::infinity(), ( frnn::math<float, frnn::device::CPU>::max( error, empty ) ) );
+    EXPECT_EQ( frnn::frnnError::FRNN_DIMENSION_ERROR, error );
+}
+
+TEST( frnnMathCpu, ContextRandomNumbersOnlyDependOnTheSeedAndThreads ) {
+    const size_t        N = frnn::cpu::detail::mathParallelSize() + 5;
+    std::vector<double> x( N ), y( N ), z( N );
+    
+    frnn::ExecutionContext first( 3, 42 ), second( 3, 42 ), other( 3, 43 );
+    randCpu( first , &x[ 0 ], N, -1.0, 1.0 );
+    randCpu( second, &y[ 0 ], N, -1.0, 1.0 );
+    randCpu( other , &z[ 0 ], N, -1.0, 1.0 );
+
+    size_t same = 0;
+    for ( size_t i = 0; i < N; i++ ) {
+        EXPECT_GE( x[ i ], -1.0 );
+        EXPECT_LT( x[ i ],  1.0 );
+        EXPECT_EQ( x[ i ], y[ i ] );
+        if ( x[ i ] == z[ i ] ) same++;
+    }
+    EXPECT_LT( same, N / 100 );
+}
+
+TEST( frnnMathCpu, ContextScratchIsAlignedAndOnlyGrows ) {
+    frnn::ExecutionContext ctx( 2, 0 );
+    
+    float* small = ctx.scratch<float>( 10, 1 );
+    EXPECT_EQ( 0u, reinterpret_cast<size_t>( small ) % 64 );
+    EXPECT_EQ( small, ctx.scratch<float>( 5, 1 ) );               // Reused when it fits
+    EXPECT_NE( small, ctx.scratch<float>( 10, 0 ) );              // Separate for each thread
+
+    double* large = ctx.scratch<double>( 1 << 16, 1 );
+    EXPECT_EQ( 0u, reinterpret_cast<size_t>( large ) % 64 );
+    large[ ( 1 << 16 ) - 1 ] = 1.0;
+    EXPECT_EQ( large, ctx.scratch<double>( 100, 1 ) );
+}
+
+TEST( frnnBlasCpu, GemmComputesCorrectlyForAllInstructionSetsAndTransposes ) {
+    typedef frnn::blas::functions<float, frnn::device::CPU> blas;
+    const int M = 37, N = 29, K = 300;                  // Not multiples of any tile size, K > KC
+    const float alpha = 0.5f, beta = 2.0f;
+    std::vector<float> A( M * K ), B( K * N ), C( M * N ), C_ref( M * N );
+    
+    for ( size_t i = 0; i < A.size(); i++ ) A[ i ] = float( i % 7 ) - 3.0f;
+    for ( size_t i = 0; i < B.size(); i++ ) B[ i ] = float( i % 5 ) - 2.0f;
+    
+    for ( int level = frnn::SCALAR; level <= frnn::cpu::supportedIsa(); level++ ) {
+        frnn::cpu::setIsaLimit( static_cast<frnn::isa>( level ) );
+        for ( int op = 0; op < 4; op++ ) {
+            frnn::blas::blasOperation ta = op & 1 ? frnn::blas::BLAS_OP_T : frnn::blas::BLAS_OP_N;
+            frnn::blas::blasOperation tb = op & 2 ? frnn::blas::BLAS_OP_T : frnn::blas::BLAS_OP_N;
+            const int lda = ta == frnn::blas::BLAS_OP_N ? M : K, ldb = tb == frnn::blas::BLAS_OP_N ? K : N;
+            
+            for ( size_t i = 0; i < C.size(); i++ ) C[ i ] = C_ref[ i ] = float( i % 3 );
+            for ( int n = 0; n < N; n++ ) {
+                for ( int m = 0; m < M; m++ ) {
+                    float dot = 0.0f;
+                    for ( int k = 0; k < K; k++ ) {
+                        dot += ( ta == frnn::blas::BLAS_OP_N ? A[ m + k * lda ] : A[ k + m * lda ] ) *
+                               ( tb == frnn::blas::BLAS_OP_N ? B[ k + n * ldb ] : B[ n + k * ldb ] );
+                    }
+                    C_ref[ m + n * M ] = alpha * dot + beta * C_ref[ m + n * M ];
+                }
+            }
+            
+            EXPECT_EQ( blas::gemm( NULL, ta, tb, M, N, K, &alpha, &A[ 0 ], lda, &B[ 0 ], ldb, &beta, &C[ 0 ], M ),
+                       frnn::blas::BLAS_STATUS_SUCCESS );
+            for ( size_t i = 0; i < C.size(); i++ ) EXPECT_NEAR( C[ i ], C_ref[ i ], TOLERANCE );
+        }
+    }
+    frnn::cpu::setIsaLimit( frnn::AVX512 );
+}
+
+TEST( frnnBlasCpu, PackedMatricesGiveTheSameResultsForAllInstructionSets ) {
+    typedef frnn::blas::functions<float, frnn::device::CPU> blas;
+    const int M = 37, N = 29, K = 300;                  // Not multiples of any tile size, K > KC
+    const float alpha = 0.5f, beta = 2.0f;
+    std::vector<float> A( M * K ), B( K * N ), C( M * N ), C_packed( M * N );
+    frnn::blas::packedMatrixCpu<float> packed;
+    
+    for ( size_t i = 0; i < A.size(); i++ ) A[ i ] = float( i % 7 ) - 3.0f;
+    for ( size_t i = 0; i < B.size(); i++ ) B[ i ] = float( i % 5 ) - 2.0f;
+    
+    for ( int level = frnn::SCALAR; level <= frnn::cpu::supportedIsa(); level++ ) {
+        frnn::cpu::setIsaLimit( static_cast<frnn::isa>( level ) );
+        for ( int op = 0; op < 2; op++ ) {
+            frnn::blas::blasOperation ta = op ? frnn::blas::BLAS_OP_T : frnn::blas::BLAS_OP_N;
+            const int lda = ta == frnn::blas::BLAS_OP_N ? M : K;
+            EXPECT_EQ( frnn::blas::gemmPackCpu( NULL, ta, M, K, &A[ 0 ], lda, packed ), frnn::blas::BLAS_STATUS_SUCCESS );
+            EXPECT_EQ( level, packed.level );
+
+            // The same kernels on the same panels, so the results are identical
+            for ( size_t i = 0; i < C.size(); i++ ) C[ i ] = C_packed[ i ] = float( i % 3 );
+            blas::gemm( NULL, ta, frnn::blas::BLAS_OP_N, M, N, K, &alpha, &A[ 0 ], lda, &B[ 0 ], K, &beta, &C[ 0 ], M );
+            frnn::blas::gemmPackedCpu( NULL, frnn::blas::BLAS_OP_N, N, &alpha, packed, &B[ 0 ], K, &beta, &C_packed[ 0 ], M );
+            for ( size_t i = 0; i < C.size(); i++ ) EXPECT_EQ( C[ i ], C_packed[ i ] );
+        }
+    }
+    frnn::cpu::setIsaLimit( frnn::AVX512 );
+}
+
+TEST( frnnBlasCpu, GemvAndAxpyComputeCorrectlyWithDoubles ) {
+    typedef frnn::blas::functions<double, frnn::device::CPU> blas;
+    const int M = 133, N = 71;
+    const double alpha = 2.0, beta = 0.0, one = 1.0;
+    std::vector<double> A( M * N ), x( 2 * M ), y( N, -1.0 ), z( M ), z_ref( M );
+    
+    for ( size_t i = 0; i < A.size(); i++ ) A[ i ] = double( i % 11 ) * 0.25;
+    for ( size_t i = 0; i < x.size(); i++ ) x[ i ] = double( i % 4 );
+    for ( size_t i = 0; i < z.size(); i++ ) z[ i ] = z_ref[ i ] = double( i );
+    
+    // y = alpha * A^T * x, where x has an increment of 2 and beta is 0 so y is overwritten
+    blas::gemv( NULL, frnn::blas::BLAS_OP_T, M, N, &alpha, &A[ 0 ], M, &x[ 0 ], 2, &beta, &y[ 0 ], 1 );
+    for ( int n = 0; n < N; n++ ) {
+        double dot = 0.0;
+        for ( int m = 0; m < M; m++ ) dot += A[ m + n * M ] * x[ 2 * m ];
+        EXPECT_NEAR( y[ n ], alpha * dot, TOLERANCE );
+    }
+    
+    // z = A * y + z
+    blas::gemv( NULL, frnn::blas::BLAS_OP_N, M, N, &one, &A[ 0 ], M, &y[ 0 ], 1, &one, &z[ 0 ], 1 );
+    for ( int m = 0; m < M; m++ ) {
+        for ( int n = 0; n < N; n++ ) z_ref[ m ] += A[ m + n * M ] * y[ n ];
+        EXPECT_NEAR( z[ m ], z_ref[ m ], TOLERANCE );
+    }
+    
+    // z = z + alpha * x (first M elements)
+    blas::axpy( NULL, M, &alpha, &x[ 0 ], 1, &z[ 0 ], 1 );
+    for ( int m = 0; m < M; m++ ) EXPECT_NEAR( z[ m ], z_ref[ m ] + alpha * x[ m ], TOLERANCE );
+    
+    EXPECT_EQ( blas::axpy( NULL, M, &alpha, &x[ 0 ], 0, &z[ 0 ], 1 ), frnn::blas::BLAS_STATUS_INVALID_VALUE );
+}
+
+TEST( frnnBlasCpu, GemvScalesContiguousAndStridedOutputsForAllInstructionSets ) {
+    typedef frnn::blas::functions<double, frnn::device::CPU> blas;
+    const int M = 37, N = 29;
+    const double alpha = 0.5, beta = 3.0;
+    std::vector<double> A( M * N ), x( std::max( M, N ) ), y( 2 * std::max( M, N ) );
+    
+    for ( size_t i = 0; i < A.size(); i++ ) A[ i ] = double( i % 7 ) - 3.0;
+    for ( size_t i = 0; i < x.size(); i++ ) x[ i ] = double( i % 5 ) - 2.0;
+    
+    for ( int level = frnn::SCALAR; level <= frnn::cpu::supportedIsa(); level++ ) {
+        frnn::cpu::setIsaLimit( static_cast<frnn::isa>( level ) );
+        for ( int op = 0; op < 4; op++ ) {
+            frnn::blas::blasOperation trans = op & 1 ? frnn::blas::BLAS_OP_T : frnn::blas::BLAS_OP_N;
+            const int incy  = op & 2 ? 2 : 1;
+            const int len_y = trans == frnn::blas::BLAS_OP_N ? M : N;
+            const int len_x = trans == frnn::blas::BLAS_OP_N ? N : M;
+            
+            // y = alpha * op(A) * x + beta * y, where the elements of y between the strides are not changed
+            for ( size_t i = 0; i < y.size(); i++ ) y[ i ] = double( i % 3 );
+            std::vector<double> y_ref( y );
+            for ( int i = 0; i < len_y; i++ ) {
+                double dot = 0.0;
+                for ( int j = 0; j < len_x; j++ ) {
+                    dot += ( trans == frnn::blas::BLAS_OP_N ? A[ i + j * M ] : A[ j + i * M ] ) * x[ j ];
+                }
+                y_ref[ i * incy ] = alpha * dot + beta * y_ref[ i * incy ];
+            }
+            
+            blas::gemv( NULL, trans, M, N, &alpha, &A[ 0 ], M, &x[ 0 ], 1, &beta, &y[ 0 ], incy );
+            for ( size_t i = 0; i < y.size(); i++ ) EXPECT_NEAR( y[ i ], y_ref[ i ], TOLERANCE );
+        }
+    }
+    frnn::cpu::setIsaLimit( frnn::AVX512 );
+}
+
+TEST( frnnMathAuto, RoutedFunctionsGiveTheSameResultsForEachVariant ) {
+    frnn::frnnError       error;
+    frnn::KernelSelector& selector = frnn::KernelSelector::instance();
+    const size_t          bucket   = frnn::KernelSelector::bucket( NUM_ELEMENTS_CPU );
+    vector<double>        x, y, out, expected;
+
+    for ( size_t i = 0; i < NUM_ELEMENTS_CPU; i++ ) {
+        x.push_back( 0.001 * ( i % 1000 ) );
+        y.push_back( 1.0 - 0.001 * ( i % 1000 ) );
+    }
+    const double sum = frnn::math<double, frnn::device::CPU>::sum( error, x );
+    const double dot = frnn::math<double, frnn::device::CPU>::dot( error, x, y );
+    frnn::math<double, frnn::device::CPU>::softmax( error, x, expected );
+
+    // Force each CPU variant, so that no benchmarks run
+    for ( int v = frnn::SCALAR_SERIAL; v <= frnn::SIMD_PARALLEL; v++ ) {
+        selector.record( "sum<double>"    , bucket, static_cast<frnn::kernelVariant>( v ) );
+        selector.record( "dot<double>"    , bucket, static_cast<frnn::kernelVariant>( v ) );
+        selector.record( "softmax<double>", bucket, static_cast<frnn::kernelVariant>( v ) );
+
+        EXPECT_NEAR( sum, frnn::mathAuto<double>::sum( error, x ), 1e-6 );
+        EXPECT_NEAR( dot, frnn::mathAuto<double>::dot( error, x, y ), 1e-6 );
+        frnn::mathAuto<double>::softmax( error, x, out );
+        for ( size_t i = 0; i < out.size(); i++ ) {
+            if ( std::abs( out[ i ] - expected[ i ] ) > 1e-15 ) { EXPECT_NEAR( expected[ i ], out[ i ], 1e-15 ); break; }
+        }
+    }
+    selector.clear();
+}
+
@@ -22,6 +22,8 @@
 #include <iostream>
 
 #include "tensor.h"
+#include "tensor_sparse.h"
+#include "tensor_view.h"
 
 TEST( frnnTensor, CanCreateTensorWithDefaultConstructor ) 
 {
@@ -227,10 +229,32 @@ TEST( frnnTensor, CanCreateNewTensorFromSlice )
     EXPECT_EQ( slice_dim_size_j, tensor.size(0) );
 }
 
+TEST( frnnTensor, CanBuildRuntimeSlicePlan )
+{
+    using namespace frnn::index;
+    frnn::tensor::RuntimeSlicePlan<3> plan(frnn::Tuple<frnn::Index, frnn::Index, frnn::Index>(k, i, j));
+    
+    EXPECT_EQ( plan.dims[0], 2 );
+    EXPECT_EQ( plan.dims[1], 0 );
+    EXPECT_EQ( plan.dims[2], 1 );
+    
+    std::vector<size_t> dimension_sizes = {2, 3, 4};
+    std::vector<int>    data(24);
+    for (size_t e = 0; e < data.size(); ++e) data[e] = e;
+    frnn::Tensor<int, 3> tensor(dimension_sizes, data);
+    frnn::Tensor<int, 3> sliced_tensor = tensor.slice(k, i, j);
+    
+    EXPECT_EQ( sliced_tensor.size(0), 4 );
+    EXPECT_EQ( sliced_tensor.size(1), 2 );
+    EXPECT_EQ( sliced_tensor.size(2), 3 );
+    EXPECT_EQ( sliced_tensor(3, 1, 2), tensor(1, 2, 3) );
+    EXPECT_EQ( sliced_tensor(2, 0, 1), tensor(0, 1, 2) );
+}
+
 TEST( frnnTensor, CanCreateTensorMultiplier )
 {
     frnn::Tensor<int, 3> tensor_1 = {2, 2, 2};
-    frnn::Tensor<int, 4> tensor_2 = {4, 2, 2, 1};
+    frnn::Tensor<int, 4> tensor_2 = {2, 2, 2, 1};       // j and i have the same sizes as in tensor_1
 
     using namespace frnn::index;
     frnn::TensorMultiplier<int, frnn::Tensor<int, 3>, frnn::Index> tensor_multiplier_1 = tensor_1(i, j, k);
@@ -246,3 +270,149 @@ TEST( frnnTensor, CanCreateTensorMultiplier )
     EXPECT_EQ( vect[1], 2 );
     EXPECT_EQ( vect[2], 1 );
 }
+
+TEST( frnnTensor, CanAccessElementsOfColumnMajorTensor )
+{
+    frnn::Tensor<int, 3, frnn::layout::ColMajor> tensor = {2, 3, 4};
+    
+    tensor(1, 2, 3) = 5;
+    tensor(0, 0, 1) = 7;
+    
+    EXPECT_EQ( tensor.strides()[0], 12 );
+    EXPECT_EQ( tensor.strides()[2], 1 );
+    EXPECT_EQ( tensor[23], 5 );                     // Last element
+    EXPECT_EQ( tensor[1] , 7 );                     // Last dimension is fastest
+    EXPECT_EQ( tensor(1, 2, 3), 5 );
+}
+
+TEST( frnnTensor, CanConvertBetweenLayouts )
+{
+    std::vector<size_t> dimension_sizes = {3, 2};
+    std::vector<int>    data            = {1, 2, 3,             // Row 0 
+                                           4, 5, 6};            // Row 1
+    frnn::Tensor<int, 2> row_major(dimension_sizes, data);
+    frnn::Tensor<int, 2, frnn::layout::ColMajor> col_major = row_major;
+    
+    std::vector<int> col_major_data(col_major.begin(), col_major.end());
+    
+    EXPECT_EQ( col_major(2, 1), row_major(2, 1) );
+    EXPECT_EQ( col_major_data[1], 4 );
+    EXPECT_EQ( col_major_data[2], 2 );
+}
+
+TEST( frnnTensor, CanSliceColumnMajorTensor )
+{
+    using namespace frnn::index;
+    std::vector<size_t> dimension_sizes = {3, 2};
+    std::vector<int>    data            = {1, 4,                // Column 0
+                                           2, 5,                // Column 1
+                                           3, 6};               // Column 2
+    frnn::Tensor<int, 2, frnn::layout::ColMajor> tensor(dimension_sizes, data);
+    frnn::Tensor<int, 2, frnn::layout::ColMajor> transposed = tensor.slice(j, i);
+    
+    EXPECT_EQ( transposed.size(0), 2 );
+    EXPECT_EQ( transposed(1, 0), tensor(0, 1) );
+    EXPECT_EQ( transposed(0, 2), tensor(2, 0) );
+    EXPECT_EQ( transposed(1, 2), tensor(2, 1) );
+}
+
+TEST( frnnTensor, CanMultiplyTensorsWithDifferentLayouts )
+{
+    using namespace frnn::index;
+    std::vector<size_t> x_sizes = {2, 3};
+    std::vector<int>    x_data  = {1, 2,                        // x(0, 0), x(1, 0)
+                                   3, 4,
+                                   5, 6};
+    std::vector<size_t> y_sizes = {3};
+    std::vector<int>    y_data  = {1, 1, 2};
+    frnn::Tensor<int, 2, frnn::layout::RowMajor> x(x_sizes, x_data);
+    frnn::Tensor<int, 1, frnn::layout::ColMajor> y(y_sizes, y_data);
+    
+    auto x_mult = x(i, j);
+    auto y_mult = y(j);
+    frnn::Tensor<int, 1> z = x_mult * y_mult;                   // z(i) = x(i, j) * y(j)
+    
+    EXPECT_EQ( z.size(), 2 );
+    EXPECT_EQ( z[0], 1 + 3 + 10 );
+    EXPECT_EQ( z[1], 2 + 4 + 12 );
+}
+
+TEST( frnnTensorView, CanViewExistingMemory )
+{
+    std::vector<float> data = {1.f, 2.f, 3.f, 4.f, 5.f, 6.f};
+    frnn::TensorView<float, 2> view(&data[0], {3, 2});
+    
+    view(1, 1) = 10.f;
+    
+    EXPECT_EQ( view.size(), 6 );
+    EXPECT_EQ( view(2, 0), 3.f );
+    EXPECT_EQ( data[4], 10.f );                     // Written through to the viewed memory
+}
+
+TEST( frnnTensorView, CanAssignExpressionToView )
+{
+    std::vector<float> data = {1.f, 2.f, 3.f, 4.f};
+    frnn::TensorView<float, 1> view(&data[0], {4});
+    frnn::Tensor<float, 1> tensor = view + view;
+    
+    view = tensor + view;
+    
+    EXPECT_EQ( tensor[3], 8.f );
+    EXPECT_EQ( data[0], 3.f );
+    EXPECT_EQ( data[3], 12.f );
+}
+
+TEST( frnnSparseTensor, CanCreateSparseTensorAndInsertElements )
+{
+    frnn::SparseTensor<float, 2> tensor = {4, 3};
+    
+    tensor.insert(7, 2.f);
+    tensor.insert(1, 3.f);
+    tensor.insert(7, 4.f);                          // Overwrites the existing element
+    
+    EXPECT_EQ( tensor.size(), 12 );
+    EXPECT_EQ( tensor.nnz()  , 2 );
+    EXPECT_EQ( tensor.indices()[0], 1 );            // Indices are kept sorted
+    EXPECT_EQ( tensor[7], 4.f );
+    EXPECT_EQ( tensor[2], 0.f );
+}
+
+TEST( frnnSparseTensor, SizesOfLargeSparseTensorsDoNotOverflow )
+{
+    frnn::SparseTensor<float, 2> tensor = {100000, 50000};      // More elements than an int can count
+    tensor.insert(4999999999, 1.f);
+    
+    EXPECT_EQ( tensor.size(), 5000000000ul );
+    EXPECT_EQ( tensor.nnz() , 1 );
+    EXPECT_EQ( tensor[4999999999], 1.f );
+}
+
+TEST( frnnSparseTensor, CanUseSparseTensorAsExpressionOperand )
+{
+    std::vector<size_t> dimension_sizes = {4};
+    std::vector<float>  data            = {1.f, 2.f, 3.f, 4.f};
+    frnn::Tensor<float, 1>       dense(dimension_sizes, data);
+    frnn::SparseTensor<float, 1> one_hot = {4};
+    
+    one_hot.insert(2, 1.f);
+    frnn::Tensor<float, 1> result = dense + one_hot;
+    
+    EXPECT_EQ( result[1], 2.f );
+    EXPECT_EQ( result[2], 4.f );
+}
+
+TEST( frnnCsrTensor, CanCreateCsrTensorAndGetElements )
+{
+    frnn::CsrTensor<float> tensor = {5, 3};         // 5 columns, 3 rows
+    
+    tensor.insert(4, 2, 1.f);
+    tensor.insert(1, 0, 2.f);
+    tensor.insert(3, 0, 3.f);
+    
+    EXPECT_EQ( tensor.nnz(), 3 );
+    EXPECT_EQ( tensor.rowOffsets()[1], 2 );
+    EXPECT_EQ( tensor.rowOffsets()[3], 3 );
+    EXPECT_EQ( tensor[3]     , 3.f );
+    EXPECT_EQ( tensor[2 * 5 + 4], 1.f );
+    EXPECT_EQ( tensor[5]     , 0.f );
+}
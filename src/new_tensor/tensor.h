@@ -27,10 +27,13 @@
 
 #include "tensor_expressions.h"
 #include "tensor_exceptions.h"
+#include "tensor_layout.h"
+#include "../util/numa.h"
 #include "../containers/tuple.h"
 
 #include <iostream>
 #include <cassert>
+#include <algorithm>
 #include <initializer_list>
 #include <numeric>
 #include <type_traits>
@@ -56,29 +59,37 @@ namespace frnn {
 //!         Tensor<int, 3> new_tensor = tensor + tensor + tensor    // Add 3 Tensors                         \n
 //!         Tensor<int, 2> slice_tensor = tensor(j,i)               // New tensor from dim 1 and 2 of old 
 //!                                                                    tensor                                \n
+//!                                                                                                          \n
+//!         The order of the elements in memory is set by the layout policy L, which is layout::RowMajor     \n
+//!         (first dimension fastest) by default, or layout::ColMajor (last dimension fastest). Indexing,     \n
+//!         slicing and iteration all use the layout, so a stage can choose the layout which gives unit      \n
+//!         stride inner loops without transposing the data.
 //! @tparam T   Type of data used by the Tensor.
 //! @tparam R   Rank of the Tensor (the number of dimensions it has).
+//! @tparam L   The layout of the Tensor's elements in memory.
 // ==========================================================================================================
-template <typename T, const size_t R>
-class Tensor : public TensorExpression<T, Tensor<T, R>> {
+template <typename T, const size_t R, typename L = layout::RowMajor>
+class Tensor : public TensorExpression<T, Tensor<T, R, L>> {
 public:
     /* =========================================== Typedefs =============================================== */
-    using typename TensorExpression<T, Tensor<T,R>>::container_type;
-    using typename TensorExpression<T, Tensor<T,R>>::size_type;
-    using typename TensorExpression<T, Tensor<T,R>>::value_type;
-    using typename TensorExpression<T, Tensor<T,R>>::reference;
+    using typename TensorExpression<T, Tensor<T, R, L>>::container_type;
+    using typename TensorExpression<T, Tensor<T, R, L>>::size_type;
+    using typename TensorExpression<T, Tensor<T, R, L>>::value_type;
+    using typename TensorExpression<T, Tensor<T, R, L>>::reference;
+    typedef L                                           layout_type;
+    typedef typename container_type::iterator           iterator;
+    typedef typename container_type::const_iterator     const_iterator;
     /* ==================================================================================================== */
 private:
     container_type          _data;                          //!< Container to hold Tensor data elements
     std::vector<size_type>  _dim_sizes;                     //!< Sizes of each of the Tensor's dimensions
-    size_type               _counter;                       //!< Iteration of the elemen offset calculation 
-    size_type               _offset;                        //!< For accessing elements with operator()
+    std::vector<size_type>  _strides;                       //!< Strides of each of the Tensor's dimensions
 public:
     // =====================================================================================================
     //! @brief     Default constructor - sets the member variables to 0, and the number of dimensions equal 
     //!            to the rank.
     // =====================================================================================================
-    Tensor() : _data(0), _dim_sizes(R), _counter(0), _offset(0) {}
+    Tensor() : _data(0), _dim_sizes(R), _strides(R) {}
     
     // =====================================================================================================
     //! @brief     Constructor using an initializer list - sets the size of each of the dimensions to the 
@@ -88,28 +99,36 @@ public:
     //!            of the nth dimension of the Tensor.
     // =====================================================================================================
     Tensor(std::initializer_list<int> dim_sizes) 
-    : _data(std::accumulate(dim_sizes.begin(), dim_sizes.end(), 1, std::multiplies<int>())),
-      _counter(0), _offset(0)
+    : _data(std::accumulate(dim_sizes.begin(), dim_sizes.end(), 1, std::multiplies<int>()))
     {   
         ASSERT(dim_sizes.size(), ==, R); 
         for (auto& element : dim_sizes) _dim_sizes.push_back(element);
+        _strides = L::strides(_dim_sizes);
     }
     
     // =====================================================================================================
     //! @brief     Constructor using a TensorExpression - sets the data of the Tensor to the data of the
     //!            TensorExpression so that Tensors can be created from the ouputs of operations such as 
-    //!            addition and subtraction.
+    //!            addition and subtraction. If the layout of the expression is different to the layout of 
+    //!            the Tensor then the elements are reordered.
     //! @param[in] expression  The expression which must be used to construct the Tensor.
     //! @tparam    E           The type of the expression.
     // =====================================================================================================
     template <typename E>
     Tensor(TensorExpression<T,E> const& expression) 
-    : _dim_sizes(expression.dimSizes()), _counter(0), _offset(0)
+    : _dim_sizes(expression.dimSizes()), _strides(L::strides(_dim_sizes))
     {
         E const& expr = expression;
         _data.resize(expr.size());
-        for (size_type i = 0; i != expr.size(); ++i) {
-            _data[i] = expr[i];
+        if (std::is_same<typename E::layout_type, L>::value) {
+            for (size_type i = 0; i != expr.size(); ++i) {
+                _data[i] = expr[i];
+            }
+        } else {                                                    // Map from the expression's layout 
+            std::vector<size_type> expr_strides = E::layout_type::strides(_dim_sizes);
+            for (size_type i = 0; i != expr.size(); ++i) {
+                _data[tensor::mapOffset(i, _dim_sizes, expr_strides, _strides)] = expr[i];
+            }
         }
     }
    
@@ -119,13 +138,13 @@ public:
     //! @param     data         The data for the Tensor.
     // =====================================================================================================
     Tensor(std::vector<size_type>& dim_sizes, container_type& data) 
-    : _dim_sizes(std::move(dim_sizes)), _data(std::move(data)), _counter(0), _offset(0) 
+    : _data(std::move(data)), _dim_sizes(std::move(dim_sizes)), _strides(L::strides(_dim_sizes)) 
     {
         ASSERT(_dim_sizes.size(), ==, R);               // Check number of dimensions is equal to the rank
         ASSERT(_data.size(), ==,                        // Check total data size is consistent with dim sizes
                std::accumulate(_dim_sizes.begin()           , 
                                _dim_sizes.end()             , 
-                               1                            , 
+                               size_type(1)                 , 
                                std::multiplies<size_type>() ));
     }
   
@@ -146,7 +165,7 @@ public:
     size_type size(const int dim) const 
     {
         try {
-            if (dim >= R) throw TensorOutOfRange(dim, R);
+            if (dim < 0 || static_cast<size_t>(dim) >= R) throw TensorOutOfRange(dim, R);
             return _dim_sizes[dim];
         } catch (TensorOutOfRange& e) {
             std::cout << e.what() << std::endl;
@@ -165,12 +184,41 @@ public:
     //! @return     A vector holding the size of each dimension of the Tensor.
     // ======================================================================================================
     const std::vector<size_type>& dimSizes() const { return _dim_sizes; }
+    
+    // ======================================================================================================
+    //! @brief      Gets a vector holding the stride (distance in memory between consecutive elements) of 
+    //!             each dimension of the Tensor, which depends on the layout of the Tensor.
+    //! @return     A vector holding the stride of each dimension of the Tensor.
+    // ======================================================================================================
+    const std::vector<size_type>& strides() const { return _strides; }
      
     // ======================================================================================================
     //! @brief      Gets the Tensor data.
     //! @return     The data for the Tensor.
     // ======================================================================================================
     const container_type& data() const { return _data; }
+    
+    // ======================================================================================================
+    //! @brief      Gets the Tensor data, by reference, so that the data can be moved out of the Tensor (for 
+    //!             example into a Tensor4) without copying it.
+    //! @return     A reference to the data for the Tensor.
+    // ======================================================================================================
+    container_type& data() { return _data; }
+
+    // ======================================================================================================
+    //! @brief      Moves the data out of the Tensor and leaves the Tensor empty (every dimension has a size
+    //!             of zero), so that the data can be given to another container (for example a Tensor4)
+    //!             without copying it, and without the Tensor still claiming to have its old shape.
+    //! @return     The data which was in the Tensor.
+    // ======================================================================================================
+    container_type release() 
+    {
+        container_type data(std::move(_data));
+        _data.clear();
+        std::fill(_dim_sizes.begin(), _dim_sizes.end(), 0);
+        _strides = L::strides(_dim_sizes);
+        return data;
+    }
 
     // ======================================================================================================
     //! @brief      Gets the element at position i in the Tensor's data vector, by reference.
@@ -185,6 +233,47 @@ public:
     //! @return     The element at position i in the Tensor's data vector.
     // ======================================================================================================
     value_type operator[](size_type i) const { return _data[i]; }
+    
+    // ======================================================================================================
+    //! @brief      Gets an iterator to the first element of the Tensor. Iteration is in memory order, so the
+    //!             fastest dimension of the Tensor's layout is the innermost.
+    //! @return     An iterator to the first element of the Tensor.
+    // ======================================================================================================
+    iterator begin() { return _data.begin(); }
+    
+    // ======================================================================================================
+    //! @brief      Gets an iterator to the element after the last element of the Tensor.
+    //! @return     An iterator to the element after the last element of the Tensor.
+    // ======================================================================================================
+    iterator end() { return _data.end(); }
+    
+    // ======================================================================================================
+    //! @brief      Gets a constant iterator to the first element of the Tensor. Iteration is in memory order,
+    //!             so the fastest dimension of the Tensor's layout is the innermost.
+    //! @return     A constant iterator to the first element of the Tensor.
+    // ======================================================================================================
+    const_iterator begin() const { return _data.begin(); }
+    
+    // ======================================================================================================
+    //! @brief      Gets a constant iterator to the element after the last element of the Tensor.
+    //! @return     A constant iterator to the element after the last element of the Tensor.
+    // ======================================================================================================
+    const_iterator end() const { return _data.end(); }
+
+    // ======================================================================================================
+    //! @brief      Places the Tensor's data on the NUMA nodes of the system. For the FIRST_TOUCH policy the
+    //!             data is split into a chunk for each element of the slowest changing dimension (the last 
+    //!             dimension for RowMajor, the first for ColMajor), and chunk i is placed on the node of
+    //!             OpenMP thread i.
+    //! @param[in]  policy  The placement policy to use.
+    //! @param[in]  node    The node to use for the BOUND policy.
+    //! @return     If the data was placed successfully.
+    // ======================================================================================================
+    bool place(numa::placement policy, int node = 0)
+    {
+        const size_type slowest_dim = std::max_element(_strides.begin(), _strides.end()) - _strides.begin();
+        return numa::place(_data.data(), _data.size() * sizeof(T), policy, _dim_sizes[slowest_dim], node);
+    }
 
     // ======================================================================================================
     //! @brief      Returns a TensorSlice which is a remapping of the dimensions of this Tensor in some way. \n
@@ -203,10 +292,10 @@ public:
     //! @tparam     Ts      The types of the dimension variables.
     // ======================================================================================================
     template <typename... Ts>
-    TensorSlice<T, Tensor<T,R>, Ts...> slice(Ts... dims) const 
+    TensorSlice<T, Tensor<T, R, L>, Ts...> slice(Ts... dims) const 
     {
-        return TensorSlice<T, Tensor<T,R>, Ts...>(static_cast<Tensor<T,R> const&>(*this),
-                                                  Tuple<Ts...>(dims...)                 );          
+        return TensorSlice<T, Tensor<T, R, L>, Ts...>(static_cast<Tensor<T, R, L> const&>(*this),
+                                                      Tuple<Ts...>(dims...)                     );          
     }
    
     // ======================================================================================================
@@ -218,155 +307,94 @@ public:
     //! @tparam     Is      The types of the rest of the dimension variables.
     // ======================================================================================================
     template <typename I, typename... Is>
-    TensorMultiplier<T, Tensor<T, R>, I> operator()(I dim, Is... dims) const
+    TensorMultiplier<T, Tensor<T, R, L>, I> operator()(I dim, Is... dims) const
     {
-        return TensorMultiplier<T, Tensor<T, R>, I>(static_cast<Tensor<T, R> const&>(*this) ,
-                                                    dim                                     ,                    
-                                                    dims...                                 );
+        return TensorMultiplier<T, Tensor<T, R, L>, I>(static_cast<Tensor<T, R, L> const&>(*this) ,
+                                                       dim                                         ,                    
+                                                       dims...                                     );
     }
     
     // ======================================================================================================
-    //! @brief      Terminating case for the calculation of the offset for setting an element of the Tensor.
-    //! @param[in]  idx     The index of the element in the last dimension of the Tensor.
+    //! @brief      Gets an element of the Tensor by its index in each of the dimensions, by reference. The 
+    //!             offset of the element in memory is determined from the strides of the Tensor's layout.
+    //! @param[in]  idx     The index of the element in the first dimension of the Tensor.
+    //! @param[in]  indices The indices of the element in the remaining dimensions of the Tensor.
     //! @tparam     I       The type of the idx parameter.
-    //! @return     The element at the location specified by the arguments to the function.
+    //! @tparam     Is      The types of the remaining index parameters.
+    //! @return     The element at the location specified by the arguments to the function, or the first 
+    //!             element if the number of indices or any of the indices are invalid.
     // ======================================================================================================
-    template <typename I>
-    typename std::enable_if<std::is_arithmetic<I>::value, T&>::type  operator() (I idx) 
+    template <typename I, typename... Is>
+    typename std::enable_if<std::is_arithmetic<I>::value, T&>::type operator()(I idx, Is... indices) 
     {
-        try {                                                                       // Check index in range
-            if (idx >= _dim_sizes[_counter]) {                                     // counter +1 in next line 
-                throw TensorOutOfRange(_counter + 1, _dim_sizes[_counter], idx);   // for 0 indexing offset
-            }
-        } catch (TensorOutOfRange& e) {
-            std::cerr << e.what() << std::endl;
-            _counter = 0;
-            return _data[0];
-        }
-        try {                                                                   // Make sure variadic version 
-            if (_counter == 0) throw TensorInvalidArguments(1, R);              // has been called already
+        try {                                                                   // Check correct num arguments
+            if (sizeof...(Is) + 1 != R) throw TensorInvalidArguments(sizeof...(Is) + 1, R);
+            return _data[offset<0>(idx, indices...)];
         } catch (TensorInvalidArguments& e) {
             std::cerr << e.what() << std::endl;
+        } catch (TensorOutOfRange& e) {
+            std::cerr << e.what() << std::endl;
         }
-        _offset += std::accumulate(_dim_sizes.begin()       , 
-                                   _dim_sizes.end() - 1     ,               // Mult all elements except last
-                                   1                        ,               // Start val for multiplication
-                                   std::multiplies<int>()   ) * idx;        // Add offset due to idx for dim
-        _counter = 0;                                                       // Reset counter for next iter
-        return _data[_offset];
-    }
-    
+        return _data[0];
+    }  
+   
     // ======================================================================================================
-    //! @brief      General case for the calculation of the offset for setting an element of the Tensor. 
-    //! @param[in]  idx     The index of the element in the current dimension used in the calculation.
-    //! @param[in]  indices The indices of the element in the remaining dimensions to use for the 
-    //!             calculation.
+    //! @brief      Gets an element of the Tensor by its index in each of the dimensions, by constant 
+    //!             reference. The offset of the element in memory is determined from the strides of the 
+    //!             Tensor's layout.
+    //! @param[in]  idx     The index of the element in the first dimension of the Tensor.
+    //! @param[in]  indices The indices of the element in the remaining dimensions of the Tensor.
     //! @tparam     I       The type of the idx parameter.
     //! @tparam     Is      The types of the remaining index parameters.
-    //! @return     Calls the function with the indices parameter as arguments, and does so until the 
-    //!             terminating case is reached.
+    //! @return     The element at the location specified by the arguments to the function, or the first 
+    //!             element if the number of indices or any of the indices are invalid.
     // ======================================================================================================
     template <typename I, typename... Is>
-    typename std::enable_if<std::is_arithmetic<I>::value, T&>::type operator()(I idx, Is... indices) 
+    typename std::enable_if<std::is_arithmetic<I>::value, const T&>::type 
+    operator()(I idx, Is... indices) const
     {
-        const int num_args = sizeof...(Is);
-        try {                                                                       // Check index in range
-            if (idx >= _dim_sizes[_counter]) {                                      // counter +1 in next line
-                throw TensorOutOfRange(_counter + 1, _dim_sizes[_counter], idx);    // for 0 indexing offset
-            }
-        } catch (TensorOutOfRange& e ) {
-            std::cout << e.what() << std::endl;
-            _counter = 0;
-            return _data[0];
-        }   
-        if (_counter++ == 0) {                                                  // Case for the first index
-            try {                                                               // Check correct num arguments
-                if (num_args + 1 !=  R) throw TensorInvalidArguments(num_args + 1, R);
-                _offset = idx;
-            } catch (TensorInvalidArguments& e) {
-                std::cerr << e.what() << std::endl;
-                return _data[0];
-            }  
-        } else {                                                            // Case for all the other indices
-            _offset += std::accumulate(_dim_sizes.begin()               , 
-                                       _dim_sizes.end() - num_args - 1  ,
-                                       1                                , 
-                                       std::multiplies<size_type>()     ) * idx;
+        try {                                                                   // Check correct num arguments
+            if (sizeof...(Is) + 1 != R) throw TensorInvalidArguments(sizeof...(Is) + 1, R);
+            return _data[offset<0>(idx, indices...)];
+        } catch (TensorInvalidArguments& e) {
+            std::cerr << e.what() << std::endl;
+        } catch (TensorOutOfRange& e) {
+            std::cerr << e.what() << std::endl;
         }
-        return this->operator()(indices...);
+        return _data[0];
     }  
-  
+private:
     // ======================================================================================================
-    //! @brief      Terminating case for the calculation of the offset for getting an element of the Tensor.
+    //! @brief      Terminating case for the calculation of the offset of an element from its indices.
     //! @param[in]  idx     The index of the element in the last dimension of the Tensor.
+    //! @return     The offset due to the index in the last dimension.
+    //! @tparam     d       The dimension which idx is an index of.
     //! @tparam     I       The type of the idx parameter.
-    //! @return     The element at the location specified by the arguments to the function.
+    //! @throw      TensorOutOfRange    If the index is out of the range of the dimension.
     // ======================================================================================================
-    template <typename I>
-    typename std::enable_if<std::is_arithmetic<I>::value, const T&>::type operator()(I idx) const 
+    template <size_type d, typename I>
+    size_type offset(I idx) const 
     {
-        try {                                                                       // Check in range
-            if (idx >= _dim_sizes[_counter]) {                                      // counter +1 in next line 
-                throw TensorOutOfRange(_counter + 1, _dim_sizes[_counter], idx);    // for 0 indexing offset
-            }
-        } catch (TensorOutOfRange& e) {
-            std::cerr << e.what() << std::endl;
-            _counter = 0;
-            return _data[0];
-        }
-        try {                                                               // Make sure variadic version 
-            if (_counter == 0) throw TensorInvalidArguments(1, R);          // has been called already
-        } catch (TensorInvalidArguments& e) {
-            std::cerr << e.what() << std::endl;
-        }
-        _offset += std::accumulate(_dim_sizes.begin()           , 
-                                   _dim_sizes.end() - 1         ,           // Mult all elements exepct last
-                                   1                            ,           // Start val for multiplication
-                                   std::multiplies<size_type>() ) * idx;    // Add offset due to idx for dim
-        _counter = 0;                                                       // Reset counter for next iter
-        return _data[_offset]; 
+        if (static_cast<size_type>(idx) >= _dim_sizes[d])                       // d + 1 for 0 indexing 
+            throw TensorOutOfRange(d + 1, _dim_sizes[d], idx);
+        return idx * _strides[d];
     }
    
     // ======================================================================================================
-    //! @brief      General case for the calculation of the offset for setting an element of the Tensor. 
-    //! @param[in]  idx     The index of the element in the current dimension used in the calculation.
-    //! @param[in]  indices The indices of the element in the remaining dimensions to use for the 
-    //!             calculation.
+    //! @brief      General case for the calculation of the offset of an element from its indices.
+    //! @param[in]  idx     The index of the element in dimension d of the Tensor.
+    //! @param[in]  indices The indices of the element in the remaining dimensions.
+    //! @return     The offset due to the index in dimension d and the remaining dimensions.
+    //! @tparam     d       The dimension which idx is an index of.
     //! @tparam     I       The type of the idx parameter.
     //! @tparam     Is      The types of the remaining index parameters.
-    //! @return     Calls the function with the indices parameter as arguments, and does so until the 
-    //!             terminating case is reached.
+    //! @throw      TensorOutOfRange    If the index is out of the range of the dimension.
     // ======================================================================================================
-    template <typename I, typename... Is>
-    typename std::enable_if<std::is_arithmetic<I>::value, const T&>::type 
-    operator()(I idx, Is... indecies) const
+    template <size_type d, typename I, typename... Is>
+    size_type offset(I idx, Is... indices) const 
     {
-        const int num_args = sizeof...(Is);
-        try {                                                                       // Check index in range
-            if (idx >= _dim_sizes[_counter]) {                                      // counter +1 in next line 
-                throw TensorOutOfRange(_counter + 1, _dim_sizes[_counter], idx);    // for 0 indexing offset
-            }
-        } catch (TensorOutOfRange& e ) {
-            std::cout << e.what() << std::endl;
-            _counter = 0;
-            return _data[0];
-        }   
-        if (const_cast<int&>(_counter)++ == 0) {                                // Case for first index
-            try {                                                               // Check correct num arguments
-                if (num_args + 1 !=  R) throw TensorInvalidArguments(num_args + 1, R);
-                _offset = idx;
-            } catch (TensorInvalidArguments& e) {
-                std::cerr << e.what() << std::endl;
-                return _data[0];
-            }  
-        } else {                                                                // Case for all other indecies
-            _offset += std::accumulate(_dim_sizes.begin()               , 
-                                       _dim_sizes.end() - num_args - 1  ,
-                                       1                                , 
-                                       std::multiplies<size_type>()     ) * idx;
-        }
-        return this->operator()(indecies...);
-    }  
+        return offset<d>(idx) + offset<d + 1>(indices...);
+    }
 };
 
 }   // End namespace frnn
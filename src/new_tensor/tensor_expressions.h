@@ -26,11 +26,15 @@
 #define _FRNN_TENSOR_EXPRESSIONS_
 
 #include "tensor_utils.h"
+#include "tensor_layout.h"
 #include "../containers/tuple.h"
 #include "../containers/index_map.h"
 #include "../util/errors.h"
 
+#include <algorithm>
 #include <set>
+#include <unordered_map>
+#include <type_traits>
 
 namespace frnn {
 
@@ -97,7 +101,10 @@ public:
     using typename TensorExpression<T, TensorDifference<T,E1,E2>>::container_type;
     using typename TensorExpression<T, TensorDifference<T,E1,E2>>::size_type;
     using typename TensorExpression<T, TensorDifference<T,E1,E2>>::value_type;
+    typedef typename E1::layout_type                                        layout_type;
     /* ==================================================================================================== */
+    static_assert(std::is_same<typename E1::layout_type, typename E2::layout_type>::value,
+                  "Expressions for subtraction must have the same layout");
 private:
     E1 const& _x;       //!< First expression for subtraction
     E2 const& _y;       //!< Second expression for subtraction
@@ -149,7 +156,10 @@ public:
     using typename TensorExpression<T, TensorAddition<T,E1,E2>>::container_type;
     using typename TensorExpression<T, TensorAddition<T,E1,E2>>::size_type;
     using typename TensorExpression<T, TensorAddition<T,E1,E2>>::value_type;
+    typedef typename E1::layout_type                                        layout_type;
     /* ==================================================================================================== */
+    static_assert(std::is_same<typename E1::layout_type, typename E2::layout_type>::value,
+                  "Expressions for addition must have the same layout");
 private:
     E1 const& _x;       //!< First expression for addition
     E2 const& _y;       //!< Second expression for addition
@@ -202,6 +212,7 @@ public:
     using typename TensorExpression<T, TensorMultiplier<T, E1, I>>::container_type;
     using typename TensorExpression<T, TensorMultiplier<T, E1, I>>::size_type;
     using typename TensorExpression<T, TensorMultiplier<T, E1, I>>::value_type;
+    typedef typename E1::layout_type                                        layout_type;
     /* ==================================================================================================== */
 private:
     E1 const&       _x;                                 //!< First expression for multiplication
@@ -278,6 +289,7 @@ public:
     using typename TensorExpression<T, TensorMultiplication<T, E1, E2>>::container_type;
     using typename TensorExpression<T, TensorMultiplication<T, E1, E2>>::size_type;
     using typename TensorExpression<T, TensorMultiplication<T, E1, E2>>::value_type;
+    typedef typename E1::layout_type                                            layout_type;
     /* ==================================================================================================== */ 
 private:
     E1&                                 _x;                 //!< Left side expression to multiple
@@ -286,6 +298,11 @@ private:
     std::set<size_t>                    _nreduce_dims_x;    //!< Dimensions of x not to be reduced
     std::set<size_t>                    _nreduce_dims_y;    //!< Dimensions of y not to be reduced
     std::vector<size_type>              _dim_sizes;         //!< Sizes of the dimensions of the result
+    std::vector<size_type>              _strides;           //!< Strides of the dimensions of the result
+    std::vector<size_type>              _x_strides;         //!< Strides of the dimensions of x
+    std::vector<size_type>              _y_strides;         //!< Strides of the dimensions of y
+    size_type                           _size;              //!< Number of elements in the result
+    size_type                           _reduce_size;       //!< Number of elements to sum for each result
 public:
     // ======================================================================================================
     //! @brief      Sets the expressions and created the maps of dimensions to reduce and to not reduce.
@@ -295,7 +312,9 @@ public:
     //!             temporary expression).
     // ======================================================================================================
     TensorMultiplication(TensorExpression<T, E1>& x, TensorExpression<T, E2>& y)
-    : _x(x), _y(y), _dim_sizes(0)
+    : _x(x), _y(y), _dim_sizes(0), 
+      _x_strides(E1::layout_type::strides(_x.dimSizes())),
+      _y_strides(E2::layout_type::strides(_y.dimSizes())) 
     {
         buildDimensions();
         setDimSizes();
@@ -307,20 +326,43 @@ public:
     // ======================================================================================================
     const std::vector<size_type>& dimSizes() const { return _dim_sizes; }
     
-    // CHANGE
     // ======================================================================================================
     //! @brief     Returns the size of the expression.
-    //! @return    The size of the TensorMultiplier.
+    //! @return    The size of the TensorMultiplication.
     // ====================================================================================================== 
-    size_type size() const { return _x.size(); }
+    size_type size() const { return _size; }
     
-    // CHANGE
     // ======================================================================================================
-    //! @brief     Multiplies two elements (one from each Tensor) from the Tensor expression data.
+    //! @brief     Computes an element of the result of the multiplication, by summing the products of the 
+    //!            elements of x and y over the reduced dimensions. The result uses the layout of x, and the 
+    //!            elements of x and y are found using the strides of their own layouts, so the operands do 
+    //!            not need to have the same layout.
     //! @param[in] i   The element in the expression which must be fetched.
     //! @return    The result of the multiplication of the Tensors.
     // ======================================================================================================
-    value_type operator[](size_type i) const { return _x[i]; }
+    value_type operator[](size_type i) const 
+    {
+        size_type x_offset = 0, y_offset = 0, dim = 0;
+        for (auto& dim_x : _nreduce_dims_x) {                           // Offsets due to non-reduced dims
+            x_offset += ((i / _strides[dim]) % _dim_sizes[dim]) * _x_strides[dim_x]; ++dim;
+        }
+        for (auto& dim_y : _nreduce_dims_y) {
+            y_offset += ((i / _strides[dim]) % _dim_sizes[dim]) * _y_strides[dim_y]; ++dim;
+        }
+        
+        value_type result = 0;
+        for (size_type r = 0; r < _reduce_size; ++r) {                  // Sum over all reduced elements
+            size_type x_reduce_offset = x_offset, y_reduce_offset = y_offset, r_idx = r;
+            for (auto& dims : _reduce_dims) {
+                const size_type dim_size = _x.dimSizes()[dims.first];
+                x_reduce_offset += (r_idx % dim_size) * _x_strides[dims.first];
+                y_reduce_offset += (r_idx % dim_size) * _y_strides[dims.second];
+                r_idx           /= dim_size;
+            }
+            result += _x[x_reduce_offset] * _y[y_reduce_offset];
+        }
+        return result;
+    }
     
     // ======================================================================================================
     //! @brief      Creates a unordered_map of common dimensions which must be reduced or contracted (see    \n
@@ -380,6 +422,14 @@ public:
     {
         for (auto& dim : _nreduce_dims_x) _dim_sizes.push_back(_x.dimSizes()[dim]);
         for (auto& dim : _nreduce_dims_y) _dim_sizes.push_back(_y.dimSizes()[dim]);
+        
+        _strides     = layout_type::strides(_dim_sizes);
+        _size        = std::accumulate(_dim_sizes.begin(), _dim_sizes.end(), 1, std::multiplies<size_type>());
+        _reduce_size = 1;
+        for (auto& dims : _reduce_dims) {
+            ASSERT(_x.dimSizes()[dims.first], ==, _y.dimSizes()[dims.second]);
+            _reduce_size *= _x.dimSizes()[dims.first];
+        }
     }
 };
 
@@ -397,30 +447,38 @@ public:
     using typename TensorExpression<T, TensorSlice<T,E,Ts...>>::container_type;
     using typename TensorExpression<T, TensorSlice<T,E,Ts...>>::size_type;
     using typename TensorExpression<T, TensorSlice<T,E,Ts...>>::value_type;
+    typedef typename E::layout_type                                         layout_type;
     /* ==================================================================================================== */ 
 private:
-    // Note : These are mutable because this class is essentially a functor without state an is intended to 
-    //        be used as a functor once. The mutable memebers are really just temporary variables which hold
-    //        state during the dimension mapping computations, thus it is okay to modify them. However, the 
-    //        function which modifies them need to be const to access _x, hence they are mutable.
+    static constexpr size_type N = sizeof...(Ts);   //!< Number of dimensions in the slice
+    
     E const&                        _x;                 //!< Expression to slice
-    mutable Tuple<Ts...>            _slice_dims;        //!< Dimensions of the sliced Expression
-    mutable std::vector<size_type>  _prev_slice_dims;   //!< Dimensions used for iterative index mapping
-    mutable std::vector<size_type>  _slice_dim_sizes;   //!< Sizes of the dimensions for the sliced Expression
-    mutable size_type               _index;             //!< Mapped index from the slice to the Expression
-    mutable size_type               _offset;            //!< Offset in the Expression due to its 0 dimension
+    tensor::RuntimeSlicePlan<N>     _plan;              //!< Dimensions of the Expression which make the slice
+    std::vector<size_type>          _slice_dim_sizes;   //!< Sizes of the dimensions for the sliced Expression
+    size_type                       _slice_strides[N];  //!< Strides of the dimensions of the slice
+    size_type                       _x_strides[N];      //!< Strides in the Expression of each slice dimension
     size_type                       _slice_size;        //!< Size (number of elements) of the slice
 public:        
      // =====================================================================================================
-     //! @brief     Initializes member variables, builds vector of dimensions of the Expression to slice, and 
-     //!            determines the size of the slice.
+     //! @brief     Initializes member variables and determines the sizes and strides of the dimensions of the 
+     //!            slice, so that mapping an index only needs the arrays built here. The slice uses the same 
+     //!            layout as the Expression.
      //! @param[in] x           The Expression to slice.
      //! @param[in] slice_dims  The dimension of Expression which make up the slice.
      // =====================================================================================================
     TensorSlice(TensorExpression<T, E> const& x, Tuple<Ts...> slice_dims)
-    : _x(x), _index(0), _offset(0), _prev_slice_dims(0), 
-      _slice_size(buildSliceDimSizes()), _slice_dims(slice_dims) 
-    {}
+    : _x(x), _plan(slice_dims), _slice_dim_sizes(N)
+    {
+        const std::vector<size_type> x_strides = layout_type::strides(_x.dimSizes());
+        for (size_type d = 0; d < N; ++d) {
+            _slice_dim_sizes[d] = _x.size(_plan.dims[d]);
+            _x_strides[d]       = x_strides[_plan.dims[d]];
+        }
+        const std::vector<size_type> slice_strides = layout_type::strides(_slice_dim_sizes);
+        std::copy(slice_strides.begin(), slice_strides.end(), _slice_strides);
+        _slice_size = std::accumulate(_slice_dim_sizes.begin(), _slice_dim_sizes.end(), 1, 
+                                      std::multiplies<size_type>());
+    }
   
     // ======================================================================================================
     //! @brief     Returns the size of the expression
@@ -439,96 +497,32 @@ public:
     //! @param[in] i   The element in the expression which must be fetched.
     //! @return    The value of the element at position i of the expression data.
     // ======================================================================================================
-    value_type operator[](size_type i) const { return _x[mapIndex(i)]; }
-    
-private:
-    // =====================================================================================================
-    //! @brief     Adds the size of a dimension from the Expression to the slice dimension sizes vector so 
-    //!            that all dimension sizes of the slice are known. Case for all iterations but the last.
-    //! @tparam    i   The iteration of the function.
-    // =====================================================================================================
-    template <size_type i = 0>
-    typename std::enable_if<i != (sizeof...(Ts) - 1), size_type>::type buildSliceDimSizes() const
-    {
-        _slice_dim_sizes.push_back(_x.size(get<i>(_slice_dims)()));                 // Add dimension i's size
-        return ( _x.size(get<i>(_slice_dims)()) *                   // Get size of dim i from the Expression
-                 buildSliceDimSizes<i + 1>()    );                  // Multiply with the remaining dimensions
-    }
-
-    // =====================================================================================================
-    //! @brief     Adds the size of a dimension from the Expression to the slice dimension sizes vector so 
-    //!            that all dimensions sizes of the slice are known. Case for the last iteration.
-    //! @tparam    i   The iteration of the function.
-    // =====================================================================================================
-    template <size_type i>
-    typename std::enable_if<i == (sizeof...(Ts) - 1), size_type>::type buildSliceDimSizes() const 
-    {
-        _slice_dim_sizes.push_back(_x.size(get<i>(_slice_dims)()));                 // Add last dimension size 
-        return _x.size(get<i>(_slice_dims)());                  // Get size of last dimension of the Expression
-    }
-    
-    // =====================================================================================================
-    //! @brief         Takes the index of an element in the slice, and maps the index to and element in the 
-    //!                Expression being sliced. Case for all iterations but the last.
-    //! @param[in]     idx     The index of the element in the slice.
-    //! @return        The index of the element i in the slice, in the Expression's data variable.
-    //! @tparam        i       The iteration of the function, essentially which element (in the vector of
-    //!                slice dimensions) the offset in the Expression's is being determined.
-    // =====================================================================================================
-    template <size_type i = 0>
-    typename std::enable_if<i != (sizeof...(Ts) - 1), size_type>::type mapIndex(size_type idx) const 
-    {
-        size_type mapped_dim = 0, dim = 0, dim_offset = 0;
-
-        dim         = get<i>(_slice_dims)();                                        // Size of dim i
-        dim_offset  = std::accumulate(_x.dimSizes().begin()           ,             // Index offset of i in 
-                                      _x.dimSizes().begin() + dim     ,             // original tensors memory
-                                      1                               ,
-                                      std::multiplies<size_type>()    );
-        
-        tensor::DimensionMapper<i> mapper;                                      // Get index in dimension i of
-        mapped_dim = mapper(idx, _x.dimSizes()[dim]);                           // idx in tensor being sliced
-                
-        dim == 0  ? _index   = mapped_dim
-                  : _offset += dim_offset * mapped_dim;
-        
-        _prev_slice_dims.push_back(dim);
-        return mapIndex<i + 1>(idx);                                // Continue until all dimensions finished
+    value_type operator[](size_type i) const 
+    { 
+        return _x[mapIndex(i, typename MakeIndexSequence<N>::type())]; 
     }
     
+private:
     // =====================================================================================================
     //! @brief         Takes the index of an element in the slice, and maps the index to and element in the 
-    //!                Expression being sliced. Case for the last iteration.
+    //!                Expression being sliced, by finding the index of the element in each of the slice 
+    //!                dimensions (using the strides of the slice) and then adding the offsets due to each of 
+    //!                those indices in the Expression (using the strides of the Expression). The dimensions 
+    //!                are expanded at compile time, so there is no loop over the dimensions.
     //! @param[in]     idx     The index of the element in the slice.
     //! @return        The index of the element i in the slice, in the Expression's data variable.
-    //! @tparam        i       The iteration of the function, essentially which element (in the vector of
-    //!                slice dimensions) the offset in the Expression's is being determined.
+    //! @tparam        Ds      The dimensions of the slice.
     // =====================================================================================================
-    template <size_type i>
-    typename std::enable_if<i == (sizeof...(Ts) - 1), size_type>::type mapIndex(size_type idx) const 
+    template <size_type... Ds>
+    size_type mapIndex(size_type idx, IndexSequence<Ds...>) const 
     {
-        size_type mapped_dim = 0, dim = 0, dim_offset = 0;
-        
-        dim         = get<i>(_slice_dims)();                                        // Size of dim i 
-        dim_offset  = std::accumulate(_x.dimSizes().begin()           ,             // Index offset of i in 
-                                      _x.dimSizes().begin() + dim     ,             // original tensors memory
-                                      1                               ,
-                                      std::multiplies<size_type>()    );
-        
-        tensor::DimensionMapper<i> mapper;                                      // Get index of dimension i of
-        mapped_dim = mapper(idx, _x.dimSizes()[dim], _prev_slice_dims);         // idx in tensor being sliced
-                
-        dim == 0  ? _index   = mapped_dim
-                  : _offset += dim_offset * mapped_dim;
-        
-        size_type total_offset = _index + _offset;                                  // Calculate final offset
-        _prev_slice_dims.clear();                                                   // Reset all class vars
-        _index = 0; _offset = 0;
-    
-        return total_offset;
+        return tensor::sum(((idx / _slice_strides[Ds]) % _slice_dim_sizes[Ds]) * _x_strides[Ds]...);
     }
 };
 
+template <typename T, typename E, typename... Ts>
+constexpr typename TensorSlice<T, E, Ts...>::size_type TensorSlice<T, E, Ts...>::N;
+
 }       // End namespace frnn
 
 /* =========================== Global Operator Overloads using Tensor Expressions ========================= */
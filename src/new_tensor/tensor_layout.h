@@ -0,0 +1,113 @@
+// ==========================================================================================================
+//! @file   Header file for fastRNN tensor layout policies.
+// ==========================================================================================================
+
+/*
+ * ==========================================================================================================
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ==========================================================================================================
+ */
+
+#ifndef _FRNN_TENSOR_LAYOUT_
+#define _FRNN_TENSOR_LAYOUT_
+
+#include <vector>
+#include <cstddef>
+
+namespace frnn   {
+namespace layout {
+
+// ==========================================================================================================
+//! @struct     RowMajor
+//! @brief      Layout policy where the first dimension of a Tensor is the fastest changing in memory.        \n
+//!                                                                                                          \n
+//!             Since the first dimension of a Tensor is the number of columns, a 2D Tensor with dimensions  \n
+//!             {3, 2} stores its 2 rows of 3 elements one after the other. This is the layout which the     \n
+//!             Tensor classes have always used, and is the default.
+// ==========================================================================================================
+struct RowMajor {
+    // ======================================================================================================
+    //! @brief      Determines the stride (distance in memory between two consecutive elements) of each of the
+    //!             dimensions of a Tensor with the given dimension sizes.
+    //! @param[in]  dim_sizes   The sizes of each of the dimensions of the Tensor.
+    //! @return     A vector where element i is the stride of dimension i.
+    //! @tparam     S           The type used for the sizes.
+    // ======================================================================================================
+    template <typename S>
+    static std::vector<S> strides(const std::vector<S>& dim_sizes)
+    {
+        std::vector<S> dim_strides(dim_sizes.size(), 1);
+        for (size_t i = 1; i < dim_sizes.size(); ++i)
+            dim_strides[i] = dim_strides[i - 1] * dim_sizes[i - 1];
+        return dim_strides;
+    }
+
+    // ======================================================================================================
+    //! @brief      Determines the offset of an element in a 4D Tensor.
+    //! @param[in]  x, y, z, w  The index of the element in each of the dimensions.
+    //! @param[in]  X, Y, Z, W  The sizes of each of the dimensions.
+    //! @return     The offset of the element in memory.
+    // ======================================================================================================
+    static constexpr size_t offset(size_t x, size_t y, size_t z, size_t w,
+                                   size_t X, size_t Y, size_t Z, size_t /* W */)
+    {
+        return x + X * (y + Y * (z + Z * w));
+    }
+};
+
+// ==========================================================================================================
+//! @struct     ColMajor
+//! @brief      Layout policy where the last dimension of a Tensor is the fastest changing in memory.         \n
+//!                                                                                                          \n
+//!             A 2D Tensor with dimensions {3, 2} then stores its 3 columns of 2 elements one after the     \n
+//!             other, which gives unit stride inner loops for kernels which iterate over the last           \n
+//!             dimension, for example the batch dimension of recurrent updates.
+// ==========================================================================================================
+struct ColMajor {
+    // ======================================================================================================
+    //! @brief      Determines the stride (distance in memory between two consecutive elements) of each of the
+    //!             dimensions of a Tensor with the given dimension sizes.
+    //! @param[in]  dim_sizes   The sizes of each of the dimensions of the Tensor.
+    //! @return     A vector where element i is the stride of dimension i.
+    //! @tparam     S           The type used for the sizes.
+    // ======================================================================================================
+    template <typename S>
+    static std::vector<S> strides(const std::vector<S>& dim_sizes)
+    {
+        std::vector<S> dim_strides(dim_sizes.size(), 1);
+        for (size_t i = dim_sizes.size(); i > 1; --i)
+            dim_strides[i - 2] = dim_strides[i - 1] * dim_sizes[i - 1];
+        return dim_strides;
+    }
+
+    // ======================================================================================================
+    //! @brief      Determines the offset of an element in a 4D Tensor.
+    //! @param[in]  x, y, z, w  The index of the element in each of the dimensions.
+    //! @param[in]  X, Y, Z, W  The sizes of each of the dimensions.
+    //! @return     The offset of the element in memory.
+    // ======================================================================================================
+    static constexpr size_t offset(size_t x, size_t y, size_t z, size_t w,
+                                   size_t /* X */, size_t Y, size_t Z, size_t W)
+    {
+        return w + W * (z + Z * (y + Y * x));
+    }
+};
+
+}       // End namespace layout
+}       // End namespace frnn
+
+#endif
@@ -0,0 +1,350 @@
+// ==========================================================================================================
+//! @file   Header file for fastRNN sparse tensor classes.
+// ==========================================================================================================
+
+/*
+ * ==========================================================================================================
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ==========================================================================================================
+ */
+
+#ifndef _FRNN_TENSOR_SPARSE_
+#define _FRNN_TENSOR_SPARSE_
+
+#include "tensor_expressions.h"
+#include "tensor_exceptions.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <numeric>
+
+namespace frnn {
+
+// ==========================================================================================================
+//! @class  SparseTensor
+//! @brief  Stores an N dimensional Tensor where most of the elements are zero as an index list, which is   \n
+//!         a sorted list of the offsets of the non-zero elements (as they would be in a dense Tensor's      \n
+//!         memory) and the values of those elements.                                                        \n
+//!                                                                                                          \n
+//!         The SparseTensor is a TensorExpression, so it can be used as an operand anywhere a dense Tensor  \n
+//!         can, and the zero elements are simply returned as zero. The intended use is for one-hot inputs,  \n
+//!         for example:                                                                                     \n
+//!                                                                                                          \n
+//!         SparseTensor<float, 1> input = {vocab_size};        // All elements are zero                     \n
+//!         input.insert(token_id, 1.f);                        // Make the input one-hot                    \n
+//!                                                                                                          \n
+//!         Which can then be passed to the sparse kernels so that a multiplication with a weight matrix     \n
+//!         becomes a gather of the columns of the matrix for the non-zero elements.
+//! @tparam T   Type of data used by the SparseTensor.
+//! @tparam R   Rank of the SparseTensor (the number of dimensions it has).
+// ==========================================================================================================
+template <typename T, const size_t R>
+class SparseTensor : public TensorExpression<T, SparseTensor<T, R>> {
+public:
+    /* =========================================== Typedefs =============================================== */
+    using typename TensorExpression<T, SparseTensor<T,R>>::container_type;
+    using typename TensorExpression<T, SparseTensor<T,R>>::size_type;
+    using typename TensorExpression<T, SparseTensor<T,R>>::value_type;
+    typedef layout::RowMajor                                layout_type;
+    /* ==================================================================================================== */
+private:
+    std::vector<size_type>  _dim_sizes;                     //!< Sizes of each of the dimensions
+    std::vector<size_type>  _indices;                       //!< Sorted offsets of the non-zero elements
+    container_type          _values;                        //!< Values of the non-zero elements
+    size_type               _size;                          //!< Total number of elements (including zeros)
+public:
+    // ======================================================================================================
+    //! @brief     Default constructor - sets the number of dimensions equal to the rank, with no elements.
+    // ======================================================================================================
+    SparseTensor() : _dim_sizes(R), _size(0) {}
+
+    // ======================================================================================================
+    //! @brief     Constructor using an initializer list - sets the size of each of the dimensions to the
+    //!            values in the intializer_list, with all elements being zero.
+    //! @param[in] dim_sizes    The list of dimension sizes where the nth element in the list sets the size
+    //!            of the nth dimension of the SparseTensor.
+    // ======================================================================================================
+    SparseTensor(std::initializer_list<size_type> dim_sizes)
+    : _size(std::accumulate(dim_sizes.begin(), dim_sizes.end(), size_type(1), std::multiplies<size_type>()))
+    {
+        ASSERT(dim_sizes.size(), ==, R);
+        for (auto& element : dim_sizes) _dim_sizes.push_back(element);
+    }
+
+    // ======================================================================================================
+    //! @brief     Constructor using vectors for the dimension sizes, the offsets of the non-zero elements and
+    //!            their values. The offsets do not need to be sorted.
+    //! @param[in] dim_sizes    The sizes of each of the dimensions of the SparseTensor.
+    //! @param[in] indices      The offsets of the non-zero elements.
+    //! @param[in] values       The values of the non-zero elements.
+    // ======================================================================================================
+    SparseTensor(std::vector<size_type>& dim_sizes, std::vector<size_type>& indices, container_type& values)
+    : _dim_sizes(std::move(dim_sizes)),
+      _size(std::accumulate(_dim_sizes.begin(), _dim_sizes.end(), size_type(1), std::multiplies<size_type>()))
+    {
+        ASSERT(_dim_sizes.size(), ==, R);
+        ASSERT(indices.size(), ==, values.size());
+        for (size_type i = 0; i < indices.size(); ++i) insert(indices[i], values[i]);
+    }
+
+    // ======================================================================================================
+    //! @brief     Gets the size (total number of elements, including the zero elements) of the SparseTensor.
+    //! @return    The total number of elements in the SparseTensor.
+    // ======================================================================================================
+    size_type size() const { return _size; }
+
+    // ======================================================================================================
+    //! @brief     Gets the size of a specific dimension of the SparseTensor, if the requested dimension is
+    //!            invalid then 0 is returned.
+    //! @param[in] dim     The dimension for which the size must be returned.
+    //! @return    The number of elements in the requested dimension.
+    // ======================================================================================================
+    size_type size(const int dim) const
+    {
+        try {
+            if (dim < 0 || static_cast<size_t>(dim) >= R) throw TensorOutOfRange(dim, R);
+            return _dim_sizes[dim];
+        } catch (TensorOutOfRange& e) {
+            std::cout << e.what() << std::endl;
+            return 0;
+        }
+    }
+
+    // ======================================================================================================
+    //! @brief      Gets the number of non-zero elements in the SparseTensor.
+    //! @return     The number of non-zero elements.
+    // ======================================================================================================
+    size_type nnz() const { return _values.size(); }
+
+    // ======================================================================================================
+    //! @brief      Gets the rank (number of dimensions) of the SparseTensor.
+    //! @return     The rank of the SparseTensor.
+    // ======================================================================================================
+    size_type rank() const { return R; }
+
+    // ======================================================================================================
+    //! @brief      Gets a vector holding the size of each dimension of the SparseTensor.
+    //! @return     A vector holding the size of each dimension of the SparseTensor.
+    // ======================================================================================================
+    const std::vector<size_type>& dimSizes() const { return _dim_sizes; }
+
+    // ======================================================================================================
+    //! @brief      Gets the sorted offsets of the non-zero elements.
+    //! @return     The offsets of the non-zero elements.
+    // ======================================================================================================
+    const std::vector<size_type>& indices() const { return _indices; }
+
+    // ======================================================================================================
+    //! @brief      Gets the values of the non-zero elements, where value i is for offset i in indices().
+    //! @return     The values of the non-zero elements.
+    // ======================================================================================================
+    const container_type& values() const { return _values; }
+
+    // ======================================================================================================
+    //! @brief      Sets the element at an offset to a value, if the element is already non-zero then its
+    //!             value is overwritten.
+    //! @param[in]  offset  The offset of the element (as it would be in a dense Tensor).
+    //! @param[in]  value   The value of the element.
+    // ======================================================================================================
+    void insert(size_type offset, value_type value)
+    {
+        try {
+            if (offset >= _size) throw TensorOutOfRange(0, _size, offset);
+        } catch (TensorOutOfRange& e) {
+            std::cerr << e.what() << std::endl;
+            return;
+        }
+        auto pos = std::lower_bound(_indices.begin(), _indices.end(), offset);
+        if (pos != _indices.end() && *pos == offset) {
+            _values[pos - _indices.begin()] = value;
+        } else {
+            _values.insert(_values.begin() + (pos - _indices.begin()), value);
+            _indices.insert(pos, offset);
+        }
+    }
+
+    // ======================================================================================================
+    //! @brief      Removes all the non-zero elements, leaving the dimension sizes unchanged so that the
+    //!             SparseTensor can be reused for the next input without reallocation.
+    // ======================================================================================================
+    void clear() { _indices.clear(); _values.clear(); }
+
+    // ======================================================================================================
+    //! @brief      Gets the element at position i as if the SparseTensor were dense.
+    //! @param[in]  i   The offset of the element to get.
+    //! @return     The value of the element if it is non-zero, otherwise 0.
+    // ======================================================================================================
+    value_type operator[](size_type i) const
+    {
+        auto pos = std::lower_bound(_indices.begin(), _indices.end(), i);
+        return (pos != _indices.end() && *pos == i) ? _values[pos - _indices.begin()] : value_type(0);
+    }
+};
+
+// ==========================================================================================================
+//! @class  CsrTensor
+//! @brief  Stores a 2D Tensor where most of the elements are zero in Compressed Sparse Row format.         \n
+//!                                                                                                          \n
+//!         As with the dense Tensor, the first dimension is 'across' (the columns) and the second is the    \n
+//!         rows, so a CsrTensor with dimensions {inputs, batch} holds one sparse input per row, which is    \n
+//!         the layout used for a batch of one-hot inputs. The non-zero elements of row r are at positions   \n
+//!         row_offsets[r] to row_offsets[r + 1] in the columns and values vectors.
+//! @tparam T   Type of data used by the CsrTensor.
+// ==========================================================================================================
+template <typename T>
+class CsrTensor : public TensorExpression<T, CsrTensor<T>> {
+public:
+    /* =========================================== Typedefs =============================================== */
+    using typename TensorExpression<T, CsrTensor<T>>::container_type;
+    using typename TensorExpression<T, CsrTensor<T>>::size_type;
+    using typename TensorExpression<T, CsrTensor<T>>::value_type;
+    typedef layout::RowMajor                                layout_type;
+    /* ==================================================================================================== */
+private:
+    std::vector<size_type>  _dim_sizes;                     //!< Sizes of the dimensions {columns, rows}
+    std::vector<size_type>  _row_offsets;                   //!< Start of each row in _columns and _values
+    std::vector<size_type>  _columns;                       //!< Column of each non-zero element
+    container_type          _values;                        //!< Values of the non-zero elements
+public:
+    // ======================================================================================================
+    //! @brief     Default constructor - creates an empty CsrTensor.
+    // ======================================================================================================
+    CsrTensor() : _dim_sizes(2, 0), _row_offsets(1, 0) {}
+
+    // ======================================================================================================
+    //! @brief     Constructor using an initializer list - sets the number of columns and rows, with all
+    //!            elements being zero.
+    //! @param[in] dim_sizes    The sizes of the dimensions as {columns, rows}.
+    // ======================================================================================================
+    CsrTensor(std::initializer_list<size_type> dim_sizes)
+    : _dim_sizes(dim_sizes.begin(), dim_sizes.end())
+    {
+        ASSERT(dim_sizes.size(), ==, 2);
+        _row_offsets.resize(_dim_sizes[1] + 1, 0);
+    }
+
+    // ======================================================================================================
+    //! @brief     Gets the size (total number of elements, including the zero elements) of the CsrTensor.
+    //! @return    The total number of elements in the CsrTensor.
+    // ======================================================================================================
+    size_type size() const { return _dim_sizes[0] * _dim_sizes[1]; }
+
+    // ======================================================================================================
+    //! @brief     Gets the size of a specific dimension of the CsrTensor, if the requested dimension is
+    //!            invalid then 0 is returned.
+    //! @param[in] dim     The dimension for which the size must be returned.
+    //! @return    The number of elements in the requested dimension.
+    // ======================================================================================================
+    size_type size(const int dim) const
+    {
+        try {
+            if (dim >= 2) throw TensorOutOfRange(dim, 2);
+            return _dim_sizes[dim];
+        } catch (TensorOutOfRange& e) {
+            std::cout << e.what() << std::endl;
+            return 0;
+        }
+    }
+
+    // ======================================================================================================
+    //! @brief      Gets the number of non-zero elements in the CsrTensor.
+    //! @return     The number of non-zero elements.
+    // ======================================================================================================
+    size_type nnz() const { return _values.size(); }
+
+    // ======================================================================================================
+    //! @brief      Gets a vector holding the size of each dimension of the CsrTensor.
+    //! @return     A vector holding the sizes of the dimensions as {columns, rows}.
+    // ======================================================================================================
+    const std::vector<size_type>& dimSizes() const { return _dim_sizes; }
+
+    // ======================================================================================================
+    //! @brief      Gets the offsets of the start of each row, which has rows + 1 elements.
+    //! @return     The row offsets.
+    // ======================================================================================================
+    const std::vector<size_type>& rowOffsets() const { return _row_offsets; }
+
+    // ======================================================================================================
+    //! @brief      Gets the columns of the non-zero elements, sorted within each row.
+    //! @return     The columns of the non-zero elements.
+    // ======================================================================================================
+    const std::vector<size_type>& columns() const { return _columns; }
+
+    // ======================================================================================================
+    //! @brief      Gets the values of the non-zero elements.
+    //! @return     The values of the non-zero elements.
+    // ======================================================================================================
+    const container_type& values() const { return _values; }
+
+    // ======================================================================================================
+    //! @brief      Sets the element at a column and row to a value, if the element is already non-zero then
+    //!             its value is overwritten.
+    //! @param[in]  column  The column of the element.
+    //! @param[in]  row     The row of the element.
+    //! @param[in]  value   The value of the element.
+    // ======================================================================================================
+    void insert(size_type column, size_type row, value_type value)
+    {
+        try {
+            if (column >= _dim_sizes[0]) throw TensorOutOfRange(1, _dim_sizes[0], column);
+            if (row    >= _dim_sizes[1]) throw TensorOutOfRange(2, _dim_sizes[1], row);
+        } catch (TensorOutOfRange& e) {
+            std::cerr << e.what() << std::endl;
+            return;
+        }
+        auto row_start = _columns.begin() + _row_offsets[row];
+        auto row_end   = _columns.begin() + _row_offsets[row + 1];
+        auto pos       = std::lower_bound(row_start, row_end, column);
+        size_type n    = pos - _columns.begin();
+
+        if (pos != row_end && *pos == column) {
+            _values[n] = value;
+            return;
+        }
+        _columns.insert(pos, column);
+        _values.insert(_values.begin() + n, value);
+        for (size_type r = row + 1; r < _row_offsets.size(); ++r) ++_row_offsets[r];
+    }
+
+    // ======================================================================================================
+    //! @brief      Removes all the non-zero elements, leaving the dimension sizes unchanged.
+    // ======================================================================================================
+    void clear()
+    {
+        _columns.clear(); _values.clear();
+        std::fill(_row_offsets.begin(), _row_offsets.end(), 0);
+    }
+
+    // ======================================================================================================
+    //! @brief      Gets the element at position i as if the CsrTensor were dense.
+    //! @param[in]  i   The offset of the element to get.
+    //! @return     The value of the element if it is non-zero, otherwise 0.
+    // ======================================================================================================
+    value_type operator[](size_type i) const
+    {
+        size_type row    = i / _dim_sizes[0];
+        size_type column = i % _dim_sizes[0];
+        auto row_start   = _columns.begin() + _row_offsets[row];
+        auto row_end     = _columns.begin() + _row_offsets[row + 1];
+        auto pos         = std::lower_bound(row_start, row_end, column);
+        return (pos != row_end && *pos == column) ? _values[pos - _columns.begin()] : value_type(0);
+    }
+};
+
+}       // End namespace frnn
+
+#endif
@@ -25,6 +25,9 @@
 #ifndef _FRNN_TENSOR_UTILS_
 #define _FRNN_TENSOR_UTILS_
 
+#include "../containers/tuple.h"
+
+#include <cstddef>
 #include <vector>
 #include <numeric>
 
@@ -32,74 +35,79 @@ namespace frnn {
 namespace tensor {
     
 // ==========================================================================================================
-//! @struct     DimensionMapper 
-//! @brief      Takes an index of an element in a new Tensor A which is a slice of an old Tensor B, and 
-//!             determines the index in a dimension of the old Tensor A which can be used to fetch the 
-//!             corresponding element for idx in B.                                                          \n
-//!                                                                                                          \n
-//!             Say A is a 2D Tensor with dimensions {2, 3}, so x = 2, y = 3, which is :                     \n
-//!                                                                                                          \n
-//!             A = [ x00 x01 ;                                                                              \n
-//!                   x10 x11 ;                                                                              \n
-//!                   x20 x21 ]                                                                              \n
-//!                                                                                                          \n
-//!             Then say that B = A(j, i) (in this case the transpose of A), then B will look like           \n
-//!                                                                                                          \n
-//!             B = [ x00 x10 x20 ;  = [ idx0 idx1 idx2 idx3 idx4 idx5 ] (in memory)                         \n
-//!                   x01 x11 x21 ]                                                                          \n
-//!                                                                                                          \n
-//!             then the DimensionMapper functor, for a given idx, say idx2, determines the offset in a      \n
-//!             dimension (i, or j in this case) of the element in A's memory which corresponds to idx2,     \n
-//!             which in this case would be x20 from A, so the functor would get 0 for dimension i, and 2    \n
-//!             for dimension j.
-//! @tparam     iter    Which iteration of the index mapping the algorithm is on.
+//! @brief      Maps the offset of an element in memory for one layout to the offset of the same element for
+//!             another layout, given the strides of the dimensions for both layouts.
+//! @param[in]  offset          The offset of the element using the source strides.
+//! @param[in]  dim_sizes       The sizes of the dimensions of the Tensor.
+//! @param[in]  src_strides     The strides of the dimensions for the source layout.
+//! @param[in]  dst_strides     The strides of the dimensions for the destination layout.
+//! @return     The offset of the element using the destination strides.
+//! @tparam     S               The type used for the sizes.
 // ==========================================================================================================
-template <size_t iter> struct DimensionMapper{
-public:
-     //======================================================================================================
-     //! @brief     Determines the index of a dimension in a tensor which can be used to fetch the
-     //!            element in that tensor corresponding to element idx in the calling Tensor.
-     //! @param[in] idx             The index of the element to map in the calling Tensor.
-     //! @param[in] dim_size        The size of the dimension in the original tensor for which the index
-     //!            must be mapped.
-     //! @param[in] prev_dim_size   The sizes of the dimensions for which the mappings have already been 
-     //!                            determined.
-     //! @return    A value of a dimension in a Tensor being mapped from which can be used to get the element
-     //!            for position idx in the new Tensor.
-     // =====================================================================================================
-    size_t operator()(const size_t idx, const size_t dim_size, std::vector<size_t>& prev_dim_sizes) const 
-    {
-        // Computes the product of the previous dimensions sizes which were used by 
-        // previous iterations, so if the previous dimension sizes were [2,3,1] then 
-        // the product returns 6, which can be used to map idx to the tensor being sliced
-        size_t prev_dim_sizes_product = std::accumulate(prev_dim_sizes.begin()       ,
-                                                        prev_dim_sizes.end()         ,
-                                                        1                            ,
-                                                        std::multiplies<size_t>()    );
-        
-        return ((idx % (prev_dim_sizes_product * dim_size)) / prev_dim_sizes_product);
-    }
-};
+template <typename S>
+S mapOffset(S offset, const std::vector<S>& dim_sizes, const std::vector<S>& src_strides,
+            const std::vector<S>& dst_strides)
+{
+    S mapped_offset = 0;
+    for (size_t i = 0; i < dim_sizes.size(); ++i)
+        mapped_offset += ((offset / src_strides[i]) % dim_sizes[i]) * dst_strides[i];
+    return mapped_offset;
+}
 
-template<> struct DimensionMapper<0> {
+// ==========================================================================================================
+//! @struct     RuntimeSlicePlan
+//! @brief      The dimensions of an Expression which make up a slice, copied from the Tuple of dimension
+//!             variables passed to slice(), so that the slice does not need to read the Tuple again. The 
+//!             dimension variables (like the Indexes i, j, k, ...) are values rather than types, so a 
+//!             TensorSlice builds its plan at runtime when it is created, and derives its strides from the 
+//!             runtime sizes of the Expression. The plan is a literal type, so a plan built from constant 
+//!             dimension variables can still be used in constant expressions.
+//! @tparam     N   The number of dimensions in the slice.
+// ==========================================================================================================
+template <size_t N>
+struct RuntimeSlicePlan {
 public:
-     //======================================================================================================
-     //! @brief     Determines the index of a dimension in a tensor which can be used to fetch the
-     //!            element in that tensor corresponding to element idx in the calling Tensor, this is 
-     //!            for the partially specialized instance of the DimensionMapper functor for the first 
-     //!            iteration of the algorithm.
-     //! @param[in] idx             The index of the element to map in the calling Tensor.
-     //! @param[in] dim_size        The size of the dimension in the original tensor for which the index
-     //!            must be mapped.
-     //! @return    A value of a dimension in a Tensor being mapped from which can be used to get the element
-     //!            for position idx in the new Tensor.
-     // =====================================================================================================
-    size_t operator()(const size_t idx, const size_t dim_size) const 
+    size_t dims[N];     //!< The dimension of the Expression for each dimension of the slice
+public:
+    // ======================================================================================================
+    //! @brief      Builds the plan from the Tuple of dimension variables used to create a slice.
+    //! @param[in]  slice_dims  The dimensions of the Expression which make up the slice.
+    //! @tparam     Ts          The types of the dimension variables.
+    // ======================================================================================================
+    template <typename... Ts>
+    constexpr RuntimeSlicePlan(const Tuple<Ts...>& slice_dims)
+    : RuntimeSlicePlan(slice_dims, typename MakeIndexSequence<sizeof...(Ts)>::type()) 
     {
-        return idx % dim_size;
+        static_assert(sizeof...(Ts) == N, "RuntimeSlicePlan size must match the number of slice dimensions");
     }
+private:
+    // ======================================================================================================
+    //! @brief      Builds the plan by expanding the indices of the Tuple's elements.
+    //! @param[in]  slice_dims  The dimensions of the Expression which make up the slice.
+    //! @tparam     Ts          The types of the dimension variables.
+    //! @tparam     Is          The indices of the elements of the Tuple.
+    // ======================================================================================================
+    template <typename... Ts, size_t... Is>
+    constexpr RuntimeSlicePlan(const Tuple<Ts...>& slice_dims, IndexSequence<Is...>)
+    : dims{ get<Is>(slice_dims)()... } {}
 };
 
+// ==========================================================================================================
+//! @brief      Terminating case for the sum of a number of values.
+//! @return     Zero, the sum of no values.
+// ==========================================================================================================
+constexpr size_t sum() { return 0; }
+
+// ==========================================================================================================
+//! @brief      Sums a number of values, so that a pack expansion can be reduced in a single expression.
+//! @param[in]  value   The first value to sum.
+//! @param[in]  values  The rest of the values to sum.
+//! @return     The sum of all the values.
+//! @tparam     Ss      The types of the rest of the values.
+// ==========================================================================================================
+template <typename... Ss>
+constexpr size_t sum(size_t value, Ss... values) { return value + sum(values...); }
+
 }       // End namespace tensor
 }       // End namespace frnn
 
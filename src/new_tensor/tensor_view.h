@@ -0,0 +1,271 @@
+// ==========================================================================================================
+//! @file   Header file for fastRNN tensor view class.
+// ==========================================================================================================
+
+/*
+ * ==========================================================================================================
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * ==========================================================================================================
+ */
+
+#ifndef _FRNN_TENSOR_VIEW_
+#define _FRNN_TENSOR_VIEW_
+
+#include "tensor_expressions.h"
+#include "tensor_exceptions.h"
+#include "tensor_layout.h"
+
+#include <iostream>
+#include <numeric>
+#include <type_traits>
+
+namespace frnn {
+
+// ==========================================================================================================
+//! @class  TensorView
+//! @brief  A Tensor which does not own its data, but rather views memory which is owned by something else, \n
+//!         for example the data of a Tensor4, so that the expression engine can be used on that memory      \n
+//!         without copying it.                                                                              \n
+//!                                                                                                          \n
+//!         The view must not outlive the memory it views. For example:                                      \n
+//!                                                                                                          \n
+//!         Tensor4<float> wba(nodes, inputs, depth, 1);                                                     \n
+//!         TensorView<float, 4> wba_view = wba.view();                                                      \n
+//!         Tensor<float, 4> wba_sum = wba_view + wba_view;         // Uses wba's memory                     \n
+//!         wba_view = wba_sum;                                     // Writes into wba's memory              \n
+//! @tparam T   Type of data used by the TensorView.
+//! @tparam R   Rank of the TensorView (the number of dimensions it has).
+//! @tparam L   The layout of the viewed elements in memory.
+// ==========================================================================================================
+template <typename T, const size_t R, typename L = layout::RowMajor>
+class TensorView : public TensorExpression<T, TensorView<T, R, L>> {
+public:
+    /* =========================================== Typedefs =============================================== */
+    using typename TensorExpression<T, TensorView<T, R, L>>::container_type;
+    using typename TensorExpression<T, TensorView<T, R, L>>::size_type;
+    using typename TensorExpression<T, TensorView<T, R, L>>::value_type;
+    using typename TensorExpression<T, TensorView<T, R, L>>::reference;
+    typedef L                                               layout_type;
+    typedef T*                                              iterator;
+    typedef const T*                                        const_iterator;
+    /* ==================================================================================================== */
+private:
+    T*                      _data;                          //!< Pointer to the viewed data (not owned)
+    std::vector<size_type>  _dim_sizes;                     //!< Sizes of each of the view's dimensions
+    std::vector<size_type>  _strides;                       //!< Strides of each of the view's dimensions
+    size_type               _size;                          //!< Total number of elements in the view
+public:
+    // ======================================================================================================
+    //! @brief     Constructor using a pointer to the data to view and the sizes of the dimensions.
+    //! @param[in] data         A pointer to the first element of the data to view.
+    //! @param[in] dim_sizes    The sizes of each of the dimensions of the view.
+    // ======================================================================================================
+    TensorView(T* data, const std::vector<size_type>& dim_sizes)
+    : _data(data), _dim_sizes(dim_sizes), _strides(L::strides(_dim_sizes)),
+      _size(std::accumulate(_dim_sizes.begin(), _dim_sizes.end(), 1, std::multiplies<size_type>()))
+    {
+        ASSERT(_dim_sizes.size(), ==, R);
+    }
+
+    // ======================================================================================================
+    //! @brief     Sets the elements of the viewed memory to the elements of an expression, so that the
+    //!            results of operations can be written directly into memory owned by something else. If the
+    //!            layout of the expression is different to the layout of the view then the elements are
+    //!            reordered.
+    //! @param[in] expression  The expression whose elements must be written to the viewed memory.
+    //! @return    A reference to the view.
+    //! @tparam    E           The type of the expression.
+    // ======================================================================================================
+    template <typename E>
+    TensorView& operator=(TensorExpression<T, E> const& expression)
+    {
+        E const& expr = expression;
+        ASSERT(expr.size(), ==, _size);
+        if (std::is_same<typename E::layout_type, L>::value) {
+            for (size_type i = 0; i < _size; ++i) _data[i] = expr[i];
+        } else {                                                    // Map from the expression's layout
+            std::vector<size_type> expr_strides = E::layout_type::strides(_dim_sizes);
+            for (size_type i = 0; i < _size; ++i)
+                _data[tensor::mapOffset(i, _dim_sizes, expr_strides, _strides)] = expr[i];
+        }
+        return *this;
+    }
+
+    // ======================================================================================================
+    //! @brief     Gets the size (total number of elements) of the view.
+    //! @return    The total number of elements in the view.
+    // ======================================================================================================
+    size_type size() const { return _size; }
+
+    // ======================================================================================================
+    //! @brief     Gets the size of a specific dimension of the view, if the requested dimension is invalid
+    //!            then 0 is returned.
+    //! @param[in] dim                 The dimension for which the size must be returned.
+    //! @return    The number of elements in the requested dimension.
+    //! @throw     TesnorOutOfRange    Throws an error if the requested dimension is invalid for the view.
+    // ======================================================================================================
+    size_type size(const int dim) const
+    {
+        try {
+            if (dim < 0 || static_cast<size_t>(dim) >= R) throw TensorOutOfRange(dim, R);
+            return _dim_sizes[dim];
+        } catch (TensorOutOfRange& e) {
+            std::cout << e.what() << std::endl;
+            return 0;
+        }
+    }
+
+    // ======================================================================================================
+    //! @brief     Gets the rank (number of dimensions) of the view.
+    //! @return    The rank (number of dimensions) of the view.
+    // ======================================================================================================
+    size_type rank() const { return R; }
+
+    // ======================================================================================================
+    //! @brief      Gets a vector holding the size of each dimension of the view.
+    //! @return     A vector holding the size of each dimension of the view.
+    // ======================================================================================================
+    const std::vector<size_type>& dimSizes() const { return _dim_sizes; }
+
+    // ======================================================================================================
+    //! @brief      Gets a vector holding the stride of each dimension of the view.
+    //! @return     A vector holding the stride of each dimension of the view.
+    // ======================================================================================================
+    const std::vector<size_type>& strides() const { return _strides; }
+
+    // ======================================================================================================
+    //! @brief      Gets a pointer to the viewed data.
+    //! @return     A pointer to the first element of the viewed data.
+    // ======================================================================================================
+    T* data() const { return _data; }
+
+    // ======================================================================================================
+    //! @brief      Gets the element at position i in the viewed data, by reference.
+    //! @param[in]  i   The index of the element to access.
+    //! @return     The element at position i in the viewed data.
+    // ======================================================================================================
+    reference operator[](size_type i) { return _data[i]; }
+
+    // ======================================================================================================
+    //! @brief      Gets the element at position i in the viewed data, by value.
+    //! @param[in]  i   The index of the element to access.
+    //! @return     The element at position i in the viewed data.
+    // ======================================================================================================
+    value_type operator[](size_type i) const { return _data[i]; }
+
+    // ======================================================================================================
+    //! @brief      Gets an iterator to the first element of the view, iteration is in memory order.
+    //! @return     An iterator to the first element of the view.
+    // ======================================================================================================
+    iterator begin() const { return _data; }
+
+    // ======================================================================================================
+    //! @brief      Gets an iterator to the element after the last element of the view.
+    //! @return     An iterator to the element after the last element of the view.
+    // ======================================================================================================
+    iterator end() const { return _data + _size; }
+
+    // ======================================================================================================
+    //! @brief      Returns a TensorSlice which is a remapping of the dimensions of the view, see Tensor::slice.
+    //! @param[in]  dims    The dimensions of the view which will make the sliced Tensor.
+    //! @return     A TensorSlice which is a remapping of this view's dimensions.
+    //! @tparam     Ts      The types of the dimension variables.
+    // ======================================================================================================
+    template <typename... Ts>
+    TensorSlice<T, TensorView<T, R, L>, Ts...> slice(Ts... dims) const
+    {
+        return TensorSlice<T, TensorView<T, R, L>, Ts...>(static_cast<TensorView<T, R, L> const&>(*this),
+                                                          Tuple<Ts...>(dims...)                         );
+    }
+
+    // ======================================================================================================
+    //! @brief      Returns a TensorMultiplier which can then be used with the overloaded multiplication
+    //!             operator to multiply the view with another Tensor.
+    //! @param[in]  dim     The first dimension of the view which must be multiplied.
+    //! @param[in]  dims    The rest of the dimensions of the view which must be multiplied.
+    //! @return     A TensorMultiplier which stores the dimensions to multiply over.
+    //! @tparam     I       The type of the first dimension variable.
+    //! @tparam     Is      The types of the rest of the dimension variables.
+    // ======================================================================================================
+    template <typename I, typename... Is>
+    typename std::enable_if<!std::is_arithmetic<I>::value, TensorMultiplier<T, TensorView<T, R, L>, I>>::type
+    operator()(I dim, Is... dims) const
+    {
+        return TensorMultiplier<T, TensorView<T, R, L>, I>(static_cast<TensorView<T, R, L> const&>(*this),
+                                                           dim                                            ,
+                                                           dims...                                        );
+    }
+
+    // ======================================================================================================
+    //! @brief      Gets an element of the view by its index in each of the dimensions, by reference.
+    //! @param[in]  idx     The index of the element in the first dimension of the view.
+    //! @param[in]  indices The indices of the element in the remaining dimensions of the view.
+    //! @tparam     I       The type of the idx parameter.
+    //! @tparam     Is      The types of the remaining index parameters.
+    //! @return     The element at the location specified by the arguments to the function, or the first
+    //!             element if the number of indices or any of the indices are invalid.
+    // ======================================================================================================
+    template <typename I, typename... Is>
+    typename std::enable_if<std::is_arithmetic<I>::value, T&>::type operator()(I idx, Is... indices) const
+    {
+        try {                                                                   // Check correct num arguments
+            if (sizeof...(Is) + 1 != R) throw TensorInvalidArguments(sizeof...(Is) + 1, R);
+            return _data[offset<0>(idx, indices...)];
+        } catch (TensorInvalidArguments& e) {
+            std::cerr << e.what() << std::endl;
+        } catch (TensorOutOfRange& e) {
+            std::cerr << e.what() << std::endl;
+        }
+        return _data[0];
+    }
+private:
+    // ======================================================================================================
+    //! @brief      Terminating case for the calculation of the offset of an element from its indices.
+    //! @param[in]  idx     The index of the element in the last dimension of the view.
+    //! @return     The offset due to the index in the last dimension.
+    //! @tparam     d       The dimension which idx is an index of.
+    //! @tparam     I       The type of the idx parameter.
+    //! @throw      TensorOutOfRange    If the index is out of the range of the dimension.
+    // ======================================================================================================
+    template <size_type d, typename I>
+    size_type offset(I idx) const
+    {
+        if (static_cast<size_type>(idx) >= _dim_sizes[d])                       // d + 1 for 0 indexing
+            throw TensorOutOfRange(d + 1, _dim_sizes[d], idx);
+        return idx * _strides[d];
+    }
+
+    // ======================================================================================================
+    //! @brief      General case for the calculation of the offset of an element from its indices.
+    //! @param[in]  idx     The index of the element in dimension d of the view.
+    //! @param[in]  indices The indices of the element in the remaining dimensions.
+    //! @return     The offset due to the index in dimension d and the remaining dimensions.
+    //! @tparam     d       The dimension which idx is an index of.
+    //! @tparam     I       The type of the idx parameter.
+    //! @tparam     Is      The types of the remaining index parameters.
+    //! @throw      TensorOutOfRange    If the index is out of the range of the dimension.
+    // ======================================================================================================
+    template <size_type d, typename I, typename... Is>
+    size_type offset(I idx, Is... indices) const
+    {
+        return offset<d>(idx) + offset<d + 1>(indices...);
+    }
+};
+
+}   // End namespace frnn
+
+#endif
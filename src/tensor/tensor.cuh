@@ -25,6 +25,12 @@
 #include <iostream>
 #include <limits>
 
+#include "../frnn/host_device.h"
+#include "../new_tensor/tensor.h"
+#include "../new_tensor/tensor_layout.h"
+#include "../new_tensor/tensor_view.h"
+#include "../util/numa.h"
+
 namespace frnn  {
 
 /*
@@ -34,18 +40,32 @@ namespace frnn  {
  * Description	: Provides a 4D tensor to store 4 dimensionaly data, or to join data to 4 dimensions to that
  *				  less passes need to be made to the GPU
  *
+ *				  The order of the elements in memory is given by the layout L, which by default is
+ *				  layout::RowMajor (x fastest), or can be layout::ColMajor (w fastest)
+ *
  * Params		: dType		: The data type for the matrix
+ *				: L			: The layout of the elements in memory
  * ==========================================================================================================
  */
-template <typename dType>
+template <typename dType, typename L = layout::RowMajor>
 class Tensor4 {
 	private:
-		uint				w_;
 		uint				x_;
 		uint				y_; 
 		uint				z_;
+		uint				w_;
 		std::vector<dType>	data;
+
+		// Places the allocated data (which may not have been touched yet) for place
+		inline bool placeData(numa::placement policy, int node, int threads) {
+			if (policy == numa::placement::FIRST_TOUCH && !std::is_same<L, layout::RowMajor>::value) {
+				policy = numa::placement::INTERLEAVED;
+			}
+			return numa::place(data.data(), data.capacity() * sizeof(dType), policy, z_ * w_, node, threads);
+		}
 	public:
+		typedef L			layout_type;
+
 		/*
 		 * ==================================================================================================
 		 * Function			: Tensor4 
@@ -72,6 +92,49 @@ class Tensor4 {
 		Tensor4(uint _x, uint _y, uint _z, uint _w) :
 			x_(_x), y_(_y), z_(_z), w_(_w), data(_x * _y * _z * _w, 0) {}
 
+		/*
+		 * ==================================================================================================
+		 * Function			: Tensor4 (constructor)
+		 *
+		 * Description		: Sets the number of elements in each dimension of the tensor, allocates the 
+		 *					  tensor data and places it on the NUMA nodes of the system before it is 
+		 *					  touched, and then sets it to be zero. Since the pages of the data have not been 
+		 *					  touched when they are placed, they are allocated on their nodes when they are 
+		 *					  zeroed rather than being moved there. See place for the policies
+		 *
+		 * Inputs			: _x		: Number of elements in the 1st dimension
+		 *					: _y		: Number of elements in the 2nd dimension
+		 *					: _z		: Number of elements in the 3rd dimension
+		 *					: _w		: Number of elements in the 4th dimension
+		 *					: policy	: The placement policy to use
+		 *					: threads	: The number of threads of the ExecutionContext which will 
+		 *								  compute on the pages, for the FIRST_TOUCH policy (0 for the 
+		 *								  OpenMP default)
+		 * ==================================================================================================
+		 */
+		Tensor4(uint _x, uint _y, uint _z, uint _w, numa::placement policy, int threads = 0) :
+			x_(_x), y_(_y), z_(_z), w_(_w) 
+		{
+			data.reserve(static_cast<size_t>(_x) * _y * _z * _w);
+			placeData(policy, 0, threads);
+			data.resize(data.capacity(), 0);
+		}
+
+		/*
+		 * ==================================================================================================
+		 * Function			: Tensor4 (move constructor)
+		 *
+		 * Description		: Creates a Tensor4 from a rank 4 Tensor by moving the Tensor's data, so that 
+		 *					  no elements are copied. The Tensor is left empty (with a size of zero in
+		 *					  every dimension)
+		 *
+		 * Inputs			: tensor	: The Tensor to move the data from
+		 * ==================================================================================================
+		 */
+		explicit Tensor4(Tensor<dType, 4, L>&& tensor) :
+			x_(tensor.size(0)), y_(tensor.size(1)), z_(tensor.size(2)), w_(tensor.size(3)), 
+			data(tensor.release()) {}
+
         /*
          * ==================================================================================================
          * Function         : getData 
@@ -92,9 +155,47 @@ class Tensor4 {
          * Inputs           : otherTensor   : The tensor from which the data must be moved from
          * ==================================================================================================
          */
-        inline void moveData(Tensor4<dType>& otherTensor) {
+        inline void moveData(Tensor4<dType, L>& otherTensor) {
             otherTensor.getData() = std::move(data);
         }
+        
+        /*
+         * ==================================================================================================
+         * Function         : view
+         * 
+         * Description      : Gets a TensorView of the Tensor4's data, so that expressions can be used on the 
+         *                    data without copying it. The view is invalidated if the Tensor4 is reshaped or 
+         *                    its data is moved
+         * 
+         * Outputs          : A rank 4 TensorView with dimensions {x, y, z, w}
+         * ==================================================================================================
+         */
+        inline TensorView<dType, 4, L> view() {
+            return TensorView<dType, 4, L>(data.data(), std::vector<size_t>{ x_, y_, z_, w_ });
+        }
+
+        /*
+         * ==================================================================================================
+         * Function         : place
+         * 
+         * Description      : Places the Tensor4's data on the NUMA nodes of the system. For the FIRST_TOUCH 
+         *                    policy page i of the z * w pages is placed on the node of the thread which 
+         *                    runs index i of a forEach loop over the pages (thread i % threads), which is 
+         *                    the thread that computes on the page in the layer functions. The pages of a 
+         *                    ColMajor tensor are not contiguous, so they are interleaved instead. Data which 
+         *                    has already been touched is moved, so prefer the placing constructor
+         *  
+         * Inputs           : policy    : The placement policy to use
+         *                  : node      : The node to use for the BOUND policy
+         *                  : threads   : The number of threads of the ExecutionContext which will compute 
+         *                                on the pages, for the FIRST_TOUCH policy (0 for the OpenMP default)
+         *
+         * Outputs          : If the data was placed successfully
+         * ==================================================================================================
+         */
+        inline bool place(numa::placement policy, int node = 0, int threads = 0) {
+            return placeData(policy, node, threads);
+        }
          
 		/* ==================================================================================================
 		 * Function		: size
@@ -145,10 +246,10 @@ class Tensor4 {
 		 */
 		dType& operator() (uint x_elem, uint y_elem, uint z_elem, uint w_elem) {
 			int error = 0;
-			if (x_elem < 0 || x_elem >= x_) error = -1;
-			if (y_elem < 0 || y_elem >= y_) error = -2;
-			if (z_elem < 0 || z_elem >= z_) error = -3;
-			if (w_elem < 0 || w_elem >= w_) error = -4;
+			if (x_elem >= x_) error = -1;
+			if (y_elem >= y_) error = -2;
+			if (z_elem >= z_) error = -3;
+			if (w_elem >= w_) error = -4;
 
 			switch (error) {
 				case -1:
@@ -168,10 +269,7 @@ class Tensor4 {
 						         " out of range of dimension 4 (w) for tensor : Returning first element\n";
 					return data[0];
 			}
-			int offset = x_ * y_ * z_ * w_elem	+			// 4th dimension offset
-				         x_ * y_ * z_elem		+			// 3rd dimension offset
-						 x_ * y_elem			+			// 2nd dimension offset
-						 x_elem;						    // 1st dimension offset
+			size_t offset = L::offset(x_elem, y_elem, z_elem, w_elem, x_, y_, z_, w_);
 			return 	data[offset];
 		}
 
@@ -189,10 +287,10 @@ class Tensor4 {
 		 */
 		dType const& operator()(uint x_elem, uint y_elem, uint z_elem, uint w_elem) const {
 			int error = 0;
-			if (x_elem < 0 || x_elem >= x_) error = -1;
-			if (y_elem < 0 || y_elem >= y_) error = -2;
-			if (z_elem < 0 || z_elem >= z_) error = -3;
-			if (w_elem < 0 || w_elem >= w_) error = -4;
+			if (x_elem >= x_) error = -1;
+			if (y_elem >= y_) error = -2;
+			if (z_elem >= z_) error = -3;
+			if (w_elem >= w_) error = -4;
 
 			switch (error) {
 				case -1:
@@ -212,10 +310,7 @@ class Tensor4 {
 						         " out of range of dimension 4 (w) for tensor : Returning first element\n";
 					return data[0];
 			}
-			int offset = x_ * y_ * z_ * w_elem	+			// 4th dimension offset
-				         x_ * y_ * z_elem		+			// 3rd dimension offset
-						 x_ * y_elem			+			// 2nd dimension offset
-						 x_elem;						// 1st dimension offset
+			size_t offset = L::offset(x_elem, y_elem, z_elem, w_elem, x_, y_, z_, w_);
 			return data[offset];
 		}
 };
@@ -20,6 +20,7 @@
 
 #include <gtest/gtest.h>
 #include <iostream>
+#include <omp.h>
 
 #include "tensor.cuh"
 
@@ -163,3 +164,69 @@ TEST(frnnTensor, CanMoveTensorDataCorrectly) {
     }
 }
 
+
+TEST(frnnTensor, CanUseColumnMajorLayout) {
+	frnn::Tensor4<float, frnn::layout::ColMajor> testTensor(X, Y, Z, W);
+
+	testTensor(0, 0, 0, 1) = 1.f;
+	testTensor(0, 0, 1, 0) = 2.f;
+	float* testPointer = &testTensor(0, 0, 0, 0);
+
+	// w is the fastest dimension, then z
+	EXPECT_EQ( testPointer[1], 1.f );
+	EXPECT_EQ( testPointer[W], 2.f );
+}
+
+TEST(frnnTensor, CanViewTensorDataWithoutCopying) {
+	frnn::Tensor4<float> testTensor(X, Y, Z, W);
+	frnn::TensorView<float, 4> view = testTensor.view();
+
+	view(1, 2, 3, 1) = 4.f;
+
+	EXPECT_EQ( view.data(), &testTensor(0, 0, 0, 0) );
+	EXPECT_EQ( testTensor(1, 2, 3, 1), 4.f );
+}
+
+TEST(frnnTensor, CanMoveNewTensorIntoTensor4) {
+	frnn::Tensor<float, 4> tensor = {2, 3, 1, 1};
+	tensor(1, 2, 0, 0) = 3.f;
+	const float* tensorData = &tensor.data()[0];
+
+	frnn::Tensor4<float> testTensor(std::move(tensor));
+
+	EXPECT_EQ( testTensor.x(), 2 );
+	EXPECT_EQ( testTensor.y(), 3 );
+	EXPECT_EQ( testTensor(1, 2, 0, 0), 3.f );
+	EXPECT_EQ( &testTensor(0, 0, 0, 0), tensorData );		// No copy was made
+
+	// The moved from Tensor is empty, rather than keeping its shape without its data
+	EXPECT_EQ( tensor.size(), 0 );
+	for (int dim = 0; dim < 4; dim++) EXPECT_EQ( tensor.size(dim), 0 );
+}
+
+TEST(frnnTensor, CanPlaceTensorDataOnNumaNodes) {
+	frnn::Tensor4<float> testTensor(X, Y, Z, W);
+	testTensor(1, 2, 3, 1) = 4.f;
+
+	testTensor.place(frnn::numa::placement::FIRST_TOUCH);
+
+	EXPECT_EQ( testTensor(1, 2, 3, 1), 4.f );
+}
+
+TEST(frnnTensor, PlacesEachPageOnTheNodeOfTheThreadWhichComputesOnIt) {
+	// Pages which span many OS pages, so that each starts on a page of its own
+	const int threads = 2, pages = 6;
+	frnn::Tensor4<float> testTensor(1024, 16, pages, 1, frnn::numa::placement::FIRST_TOUCH, threads);
+
+	// The node of each thread of the team, which forEach gives page i to thread i % threads
+	std::vector<int> thread_nodes(threads, 0);
+	#pragma omp parallel num_threads( threads )
+	thread_nodes[omp_get_thread_num()] = frnn::numa::currentNode();
+
+	EXPECT_EQ( testTensor(1023, 15, pages - 1, 0), 0.f );
+	for (int page = 0; page < pages; page++) {
+		const int node = frnn::numa::pageNode(&testTensor(0, 0, page, 0));
+		if (node < 0) continue;										// Can not be queried on this system
+		EXPECT_EQ( node, thread_nodes[page % threads] );
+	}
+}
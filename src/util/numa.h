@@ -0,0 +1,224 @@
+/*
+ *  Header file for fastRNN NUMA placement functions.
+ *
+ *  Copyright (C) 2015 Rob Clucas robclu1818@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FRNN_NUMA_
+#define _FRNN_NUMA_
+
+#include <omp.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+// Memory policy modes and flags for mbind (from linux/mempolicy.h), defined here so that libnuma is not needed
+#define FRNN_MPOL_DEFAULT       0
+#define FRNN_MPOL_PREFERRED     1
+#define FRNN_MPOL_BIND          2
+#define FRNN_MPOL_INTERLEAVE    3
+#define FRNN_MPOL_MF_MOVE       ( 1 << 1 )
+
+namespace frnn {
+namespace numa {
+
+/*
+ * ==========================================================================================================
+ * Enum         : placement
+ *
+ * Description  : Enumerator for the policies for placing memory on the NUMA nodes of the system
+ *
+ *                DEFAULT       : Use the default (first touch by whichever thread touches the memory first)
+ *                INTERLEAVED   : Spread the pages of the memory round-robin accross all nodes
+ *                FIRST_TOUCH   : Split the memory into chunks and place each chunk on the node of the worker
+ *                                thread which will compute on it, as if that thread had touched it first.
+ *                                Chunk i belongs to thread i % threads of a team, which is the thread that 
+ *                                ExecutionContext::forEach runs index i on
+ *                BOUND         : Place all the memory on a single node
+ * ==========================================================================================================
+ */
+enum placement {
+    DEFAULT,
+    INTERLEAVED,
+    FIRST_TOUCH,
+    BOUND
+};
+
+/*
+ * ==========================================================================================================
+ * Function     : numNodes
+ *
+ * Description  : Gets the number of NUMA nodes on the system, which is 1 if the system is not NUMA or the
+ *                number of nodes can not be determined
+ *
+ * Outputs      : The number of NUMA nodes on the system
+ * ==========================================================================================================
+ */
+inline int numNodes() {
+    std::ifstream   node_file( "/sys/devices/system/node/possible" );       // Format is "0" or "0-N"
+    std::string     nodes;
+
+    if ( !( node_file >> nodes ) ) return 1;
+    size_t dash = nodes.find( '-' );
+    return dash == std::string::npos ? 1 : std::stoi( nodes.substr( dash + 1 ) ) + 1;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : currentNode
+ *
+ * Description  : Gets the NUMA node of the CPU which the calling thread is running on
+ *
+ * Outputs      : The node of the calling thread, or 0 if it can not be determined
+ * ==========================================================================================================
+ */
+inline int currentNode() {
+#if defined( __linux__ ) && defined( SYS_getcpu )
+    unsigned cpu = 0, node = 0;
+    if ( syscall( SYS_getcpu, &cpu, &node, NULL ) == 0 ) return static_cast<int>( node );
+#endif
+    return 0;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : pageNode
+ *
+ * Description  : Gets the NUMA node which the page of memory holding an address is on
+ *
+ * Inputs       : addr      : The address, which must have been touched (so that the page exists)
+ *
+ * Outputs      : The node of the page, or -1 if it can not be determined
+ * ==========================================================================================================
+ */
+inline int pageNode( const void* addr ) {
+#if defined( __linux__ ) && defined( SYS_move_pages )
+    const uintptr_t page_size = static_cast<uintptr_t>( sysconf( _SC_PAGESIZE ) );
+    void*           page      = reinterpret_cast<void*>( reinterpret_cast<uintptr_t>( addr ) & ~( page_size - 1 ) );
+    int             status    = -1;
+
+    // Without target nodes move_pages only reports the node of each page
+    if ( syscall( SYS_move_pages, 0, 1ul, &page, NULL, &status, 0 ) == 0 && status >= 0 ) return status;
+#endif
+    return -1;
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : setPolicy
+ *
+ * Description  : Sets the memory policy for the pages of a region of memory and moves any pages which have
+ *                already been touched so that they conform to the policy. Only the pages which are entirely
+ *                inside the region are used, so that neighbouring memory is not affected.
+ *
+ * Inputs       : addr      : The start of the memory region
+ *              : bytes     : The number of bytes in the region
+ *              : mode      : The memory policy mode (FRNN_MPOL_*)
+ *              : node_mask : A bitmask of the nodes for the policy (0 for the default policy)
+ *
+ * Outputs      : If the policy was set successfully
+ * ==========================================================================================================
+ */
+inline bool setPolicy( void* addr, size_t bytes, int mode, unsigned long node_mask ) {
+#if defined( __linux__ ) && defined( SYS_mbind )
+    const uintptr_t page_size = static_cast<uintptr_t>( sysconf( _SC_PAGESIZE ) );
+    const uintptr_t start     = ( reinterpret_cast<uintptr_t>( addr ) + page_size - 1 ) & ~( page_size - 1 );
+    const uintptr_t end       = ( reinterpret_cast<uintptr_t>( addr ) + bytes ) & ~( page_size - 1 );
+
+    if ( end <= start ) return true;                                        // No whole pages to place
+
+    // The kernel reads maxnode - 1 bits from the mask
+    return syscall( SYS_mbind, start, end - start, mode, mode == FRNN_MPOL_DEFAULT ? NULL : &node_mask,
+                    mode == FRNN_MPOL_DEFAULT ? 0 : sizeof( node_mask ) * 8 + 1, FRNN_MPOL_MF_MOVE ) == 0;
+#else
+    return false;
+#endif
+}
+
+/*
+ * ==========================================================================================================
+ * Function     : place
+ *
+ * Description  : Places a region of memory on the NUMA nodes of the system using the given policy. For the
+ *                FIRST_TOUCH policy the region is split into equal sized chunks, and chunk i is placed on
+ *                the node of thread i % threads of a team of threads OpenMP threads, which is the thread
+ *                that runs index i of a forEach loop of an ExecutionContext with that many threads (the
+ *                OpenMP threads should be bound to cores, for example with OMP_PROC_BIND=true, so that a
+ *                thread number stays on the same core). The policy is set on the pages, so pages which
+ *                have not been touched yet are allocated on the node when they are first touched, rather
+ *                than being moved there. Nothing is done on systems with a single node.
+ *
+ * Inputs       : addr      : The start of the memory region
+ *              : bytes     : The number of bytes in the region
+ *              : policy    : The placement policy to use
+ *              : chunks    : The number of chunks (one for each unit of work) for the FIRST_TOUCH policy
+ *              : node      : The node to place the memory on for the BOUND policy
+ *              : threads   : The number of threads in the team for the FIRST_TOUCH policy (0 for the 
+ *                            OpenMP default, which is the team of a default ExecutionContext)
+ *
+ * Outputs      : If the memory was placed successfully
+ * ==========================================================================================================
+ */
+inline bool place( void* addr, size_t bytes, placement policy, size_t chunks = 1, int node = 0,
+                   int threads = 0 ) {
+    const int num_nodes = numNodes();
+    if ( num_nodes <= 1 || bytes == 0 ) return true;
+
+    const unsigned long all_nodes = num_nodes >= 64 ? ~0ul : ( 1ul << num_nodes ) - 1;
+    bool                placed    = true;
+
+    switch ( policy ) {
+        case placement::DEFAULT:
+            return setPolicy( addr, bytes, FRNN_MPOL_DEFAULT, 0 );
+        case placement::INTERLEAVED:
+            return setPolicy( addr, bytes, FRNN_MPOL_INTERLEAVE, all_nodes );
+        case placement::BOUND:
+            return setPolicy( addr, bytes, FRNN_MPOL_BIND, 1ul << ( node % num_nodes ) );
+        case placement::FIRST_TOUCH: {
+            chunks  = std::max( chunks, size_t( 1 ) );
+            threads = threads > 0 ? threads : std::max( 1, omp_get_max_threads() );
+            const size_t chunk_bytes = ( bytes + chunks - 1 ) / chunks;
+            char*        start       = static_cast<char*>( addr );
+
+            // The same mapping of chunks to the threads of the team as ExecutionContext::forEach
+            #pragma omp parallel num_threads( threads ) reduction( && : placed ) if ( threads > 1 && chunks > 1 )
+            {
+                for ( size_t chunk = omp_get_thread_num(); chunk < chunks; chunk += omp_get_num_threads() ) {
+                    const size_t offset = chunk * chunk_bytes;
+                    if ( offset < bytes ) {
+                        placed = setPolicy( start + offset, std::min( chunk_bytes, bytes - offset ),
+                                            FRNN_MPOL_PREFERRED, 1ul << currentNode() ) && placed;
+                    }
+                }
+            }
+            return placed;
+        }
+    }
+    return placed;
+}
+
+}   // Namespace numa
+}   // Namespace frnn
+
+#endif
@@ -22,6 +22,7 @@
 #include <iostream>
 
 #include "../frnn/frnn.h"
+#include "numa.h"
 
 TEST( frnnErrors, DeterminesErrorForBadAlloc ) {
     
@@ -55,3 +56,25 @@ TEST( frnnErrors, DeterminesErrorForBadCopy ) {
 
     EXPECT_EQ( error, frnn::frnnError::FRNN_COPY_ERROR );
 }
+
+TEST( frnnNuma, CanDetermineNodes ) {
+    
+    int num_nodes    = frnn::numa::numNodes();
+    int current_node = frnn::numa::currentNode();
+    
+    EXPECT_GE( num_nodes, 1 );
+    EXPECT_GE( current_node, 0 );
+    EXPECT_LT( current_node, num_nodes );
+}
+
+TEST( frnnNuma, PlacementPreservesData ) {
+    
+    std::vector<float> data( 1 << 20, 2.f );
+    
+    frnn::numa::place( &data[ 0 ], data.size() * sizeof( float ), frnn::numa::placement::INTERLEAVED );
+    frnn::numa::place( &data[ 0 ], data.size() * sizeof( float ), frnn::numa::placement::FIRST_TOUCH, 4 );
+    frnn::numa::place( &data[ 0 ], data.size() * sizeof( float ), frnn::numa::placement::BOUND, 1, 0 );
+    
+    EXPECT_EQ( data[ 0 ], 2.f );
+    EXPECT_EQ( data[ data.size() - 1 ], 2.f );
+}